@@ -168,9 +168,12 @@ void gln64FBRead(uint32_t addr)
             Since depth buffer is also being watched, the reported addr
             may belong to depth buffer
 
+            Not implemented: CPU writes to the frame buffer are not
+            shown.
+
   input:    addr        rdram address
             val         val
-            size        1 = uint8, 2 = uint16, 4 = uint32
+            size        bytes written from addr, a multiple of 4
   output:   none
 *******************************************************************/ 
 
@@ -695,7 +695,8 @@ void FrameBufferManager::FrameBufferWriteByCPU(uint32_t addr, uint32_t size)
 
     //WARNING(TRACE2("Frame Buffer Write, address=%08X, CI Address=%08X", addr, g_CI.dwAddr));
     status.frameWriteByCPU = true;
-    frameWriteRecord.push_back(addr&(g_dwRamSize-1));
+    for (uint32_t offset = 0; offset < size; offset += 4)
+        frameWriteRecord.push_back((addr + offset)&(g_dwRamSize-1));
 }
 
 extern M64P_RECT frameWriteByCPURect;
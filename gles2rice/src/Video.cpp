@@ -606,9 +606,12 @@ void riceFBRead(uint32_t addr)
             Since depth buffer is also being watched, the reported addr
             may belong to depth buffer
 
+            The core merges adjacent words into one call; every
+            word of the range is recorded.
+
   input:    addr        rdram address
             val         val
-            size        1 = uint8_t, 2 = uint16_t, 4 = uint32_t
+            size        bytes written from addr, a multiple of 4
   output:   none
 *******************************************************************/ 
 
@@ -1468,9 +1468,12 @@ void glide64FBRead(uint32_t addr)
 Function: FrameBufferWrite
 Purpose:  This function is called to notify the dll that the
 frame buffer has been modified by CPU at the given address.
+The core merges adjacent words into one call, so the range may
+wrap over the next lines: the dirty rectangle then spans the
+whole width.
 input:    addr          rdram address
 val                     val
-size            1 = uint8_t, 2 = uint16_t, 4 = uint32_t
+size            bytes written from addr, a multiple of 4
 output:   none
 *******************************************************************/
 void glide64FBWrite(uint32_t addr, uint32_t size)
@@ -1495,11 +1498,20 @@ void glide64FBWrite(uint32_t addr, uint32_t size)
 
   cpu_fb_write = true;
   shift_l      = (a - gDP.colorImage.address) >> 1;
-  shift_r      = shift_l+2;
+  shift_r      = (a + size - gDP.colorImage.address) >> 1;
 
-  part_framebuf.d_ul_x       = MIN(part_framebuf.d_ul_x, shift_l % gDP.colorImage.width);
+  if (shift_l / gDP.colorImage.width != shift_r / gDP.colorImage.width)
+  {
+    /* the write goes on over the next line */
+    part_framebuf.d_ul_x     = 0;
+    part_framebuf.d_lr_x     = gDP.colorImage.width - 1;
+  }
+  else
+  {
+    part_framebuf.d_ul_x     = MIN(part_framebuf.d_ul_x, shift_l % gDP.colorImage.width);
+    part_framebuf.d_lr_x     = MAX(part_framebuf.d_lr_x, shift_r % gDP.colorImage.width);
+  }
   part_framebuf.d_ul_y       = MIN(part_framebuf.d_ul_y, shift_l / gDP.colorImage.width);
-  part_framebuf.d_lr_x       = MAX(part_framebuf.d_lr_x, shift_r % gDP.colorImage.width);
   part_framebuf.d_lr_y       = MAX(part_framebuf.d_lr_y, shift_r / gDP.colorImage.width);
 }
 
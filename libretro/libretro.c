@@ -15,8 +15,11 @@
 #include "plugin/plugin.h"
 #include "api/m64p_types.h"
 #include "r4300/r4300.h"
+#include "r4300/interupt.h"
 #include "memory/memory.h"
 #include "main/main.h"
+#include "main/profile.h"
+#include "osal/preproc.h"
 #include "main/version.h"
 #include "main/savestates.h"
 #include "pi/pi_controller.h"
@@ -76,10 +79,12 @@ int astick_deadzone;
 int first_time = 1;
 bool flip_only;
 
-static uint8_t* game_data = NULL;
+static const uint8_t* game_data = NULL;
 static uint32_t game_size = 0;
 
 static bool     emu_initialized     = false;
+/* the r4300 runs, there is a state to save */
+static bool     emu_running         = false;
 static unsigned initial_boot        = true;
 static unsigned audio_buffer_size   = 2048;
 
@@ -90,6 +95,40 @@ static bool     pushed_frame        = false;
 
 unsigned frame_dupe = false;
 
+/* Fast-forward: a retro_run emulates fastforward_frames VIs and only shows
+ * the last one. The others skip the screen update of the plugins which
+ * merely present the frame there (angrylion's VI filter and blit) and are
+ * otherwise not handed to the frontend. */
+enum fastforward_mode
+{
+   FASTFORWARD_DISABLED,
+   FASTFORWARD_FRONTEND,
+   FASTFORWARD_ALWAYS
+};
+
+static enum fastforward_mode fastforward_mode = FASTFORWARD_DISABLED;
+static unsigned fastforward_option_frames     = 4;
+static unsigned fastforward_frames            = 1;
+static unsigned fastforward_vi                = 0;
+
+/* In-core rewind: every retro_run ends with a snapshot in the rewind ring
+ * of the core, unless R3 of the first pad is held, in which case it starts
+ * from the previous snapshot instead. */
+static unsigned rewind_frames        = 0;
+/* the newest snapshot is the current state, nothing ran since it was taken */
+static bool rewind_top_is_current    = false;
+
+/* the current VI is emulated but won't be shown */
+int retro_vi_hidden(void)
+{
+   return fastforward_vi + 1 < fastforward_frames;
+}
+
+int retro_skip_update_screen(void)
+{
+   return gfx_plugin == GFX_ANGRYLION && retro_vi_hidden();
+}
+
 uint32_t *blitter_buf;
 uint32_t *blitter_buf_lock   = NULL;
 
@@ -118,10 +157,8 @@ int pad_present[4] = {1, 1, 1, 1};
 
 static void n64DebugCallback(void* aContext, int aLevel, const char* aMessage)
 {
-    char buffer[1024];
-    snprintf(buffer, 1024, "mupen64plus: %s\n", aMessage);
     if (log_cb)
-       log_cb(RETRO_LOG_INFO, buffer);
+       log_cb(RETRO_LOG_INFO, "mupen64plus: %s\n", aMessage);
 }
 
 extern m64p_rom_header ROM_HEADER;
@@ -272,6 +309,8 @@ static void setup_variables(void)
 #else
          "CPU Core; cached_interpreter|pure_interpreter" },
 #endif
+      { NAME_PREFIX "-cached-fusion",
+         "Cached Interpreter Instruction Fusion; enabled|disabled" },
       {NAME_PREFIX "-audio-buffer-size",
          "Audio Buffer Size (restart); 2048|1024"},
       {NAME_PREFIX "-astick-deadzone",
@@ -326,6 +365,9 @@ static void setup_variables(void)
       { NAME_PREFIX "-angrylion-vioverlay",
        "(Angrylion) VI Overlay; disabled|enabled"
       },
+      { NAME_PREFIX "-angrylion-multithread",
+       "(Angrylion) Rendering threads (restart); 1|2|3|4|6|8|auto"
+      },
       { NAME_PREFIX "-virefresh",
          "VI Refresh (Overclock); 1500|2200" },
 #endif
@@ -334,6 +376,12 @@ static void setup_variables(void)
       },
       { NAME_PREFIX "-framerate",
          "Framerate (restart); original|fullspeed" },
+      { NAME_PREFIX "-fastforward",
+         "Fast-Forward VI Skipping; disabled|frontend|always" },
+      { NAME_PREFIX "-fastforward-frames",
+         "Fast-Forward VIs per Frame; 4|2|3|6|8" },
+      { NAME_PREFIX "-rewind",
+         "In-Core Rewind Frames (hold R3); disabled|60|120|300|600" },
 #ifndef ONLY_VULKAN
       { NAME_PREFIX "-vcache-vbo",
          "(Glide64) Vertex cache VBO (restart); off|on" },
@@ -349,6 +397,14 @@ static void setup_variables(void)
 }
 
 
+static void release_game_data(void)
+{
+#ifdef EMSCRIPTEN
+   free((void*)game_data);
+#endif
+   game_data = NULL;
+}
+
 static bool emu_step_load_data()
 {
    if(CoreStartup(FRONTEND_API_VERSION, ".", ".", "Core", n64DebugCallback, 0, 0) && log_cb)
@@ -363,8 +419,7 @@ static bool emu_step_load_data()
        goto load_fail;
    }
 
-   free(game_data);
-   game_data = NULL;
+   release_game_data();
 
    log_cb(RETRO_LOG_INFO, "EmuThread: M64CMD_ROM_GET_HEADER\n");
 
@@ -378,8 +433,7 @@ static bool emu_step_load_data()
    return true;
 
 load_fail:
-   free(game_data);
-   game_data = NULL;
+   release_game_data();
    stop = 1;
 
    return false;
@@ -389,6 +443,9 @@ bool emu_step_render(void)
 {
    if (flip_only)
    {
+      if (retro_vi_hidden())
+         return true;
+
       switch (gfx_plugin)
       {
          case GFX_ANGRYLION:
@@ -421,6 +478,69 @@ bool emu_step_render(void)
    return false;
 }
 
+static void fastforward_begin_frame(void)
+{
+   bool fastforwarding = false;
+
+   fastforward_vi     = 0;
+   fastforward_frames = 1;
+
+   switch (fastforward_mode)
+   {
+      case FASTFORWARD_ALWAYS:
+         fastforward_frames = fastforward_option_frames;
+         break;
+      case FASTFORWARD_FRONTEND:
+         if (environ_cb(RETRO_ENVIRONMENT_GET_FASTFORWARDING, &fastforwarding) && fastforwarding)
+            fastforward_frames = fastforward_option_frames;
+         break;
+      case FASTFORWARD_DISABLED:
+         break;
+   }
+
+   set_audio_batching_libretro(fastforward_frames > 1);
+}
+
+/* Steps back one frame if rewinding, returns whether it did */
+static bool rewind_begin_frame(void)
+{
+   if (rewind_frames == 0)
+      return false;
+
+   /* the core only polls from the VI interrupt, which comes later */
+   poll_cb();
+   if (!input_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R3))
+      return false;
+
+   if (rewind_top_is_current)
+   {
+      rewind_top_is_current = false;
+      if (!savestates_rewind_pop())
+         return false;
+   }
+
+   return savestates_rewind_pop();
+}
+
+static void rewind_end_frame(bool rewound)
+{
+   size_t bytes;
+
+   /* the push compares all of RDRAM against the shadow copy */
+   if (rewind_frames == 0)
+      return;
+
+   if (rewound || !emu_running)
+      return;
+
+   timed_section_start(TIMED_SECTION_REWIND);
+   bytes = savestates_rewind_push();
+   timed_section_end(TIMED_SECTION_REWIND);
+   timed_sections_count_bytes(TIMED_SECTION_REWIND, bytes);
+
+   rewind_top_is_current = bytes != 0;
+}
+
 static void emu_step_initialize(void)
 {
    if (emu_initialized)
@@ -512,6 +632,7 @@ static void EmuThreadFunction(void)
     co_switch(main_thread);
 #endif
 
+    emu_running = true;
     main_run();
     log_cb(RETRO_LOG_INFO, "EmuThread: co_switch main_thread. \n");
 
@@ -666,6 +787,16 @@ void retro_deinit(void)
 
    deinit_audio_libretro();
 
+#ifdef PERF_TEST
+   {
+      char trace_path[PATH_MAX];
+      snprintf(trace_path, sizeof(trace_path), "%s/mupen64plus_trace.json", retro_get_system_directory());
+      timed_sections_dump_trace(trace_path);
+      snprintf(trace_path, sizeof(trace_path), "%s/mupen64plus_events.bin", retro_get_system_directory());
+      dump_eventqueue_trace(trace_path);
+   }
+#endif
+
    if (perf_cb.perf_log)
       perf_cb.perf_log();
 }
@@ -676,6 +807,7 @@ void retro_deinit(void)
 extern void glide_set_filtering(unsigned value);
 #endif
 extern void angrylion_set_filtering(unsigned value);
+extern void angrylion_set_threads(unsigned value);
 extern void ChangeSize();
 
 void update_variables(bool startup)
@@ -775,6 +907,17 @@ void update_variables(bool startup)
    else
       overlay = 1;
 
+   var.key = NAME_PREFIX "-angrylion-multithread";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "auto"))
+         angrylion_set_threads(0);
+      else
+         angrylion_set_threads(atoi(var.value));
+   }
+
    CFG_HLE_GFX = (gfx_plugin != GFX_ANGRYLION) && (gfx_plugin != GFX_PARALLEL) ? 1 : 0;
    CFG_HLE_AUD = 0; /* There is no HLE audio code in libretro audio plugin. */
 
@@ -897,6 +1040,46 @@ void update_variables(bool startup)
          frame_dupe = true;
    }
 
+   var.key = NAME_PREFIX "-fastforward";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "frontend"))
+         fastforward_mode = FASTFORWARD_FRONTEND;
+      else if (!strcmp(var.value, "always"))
+         fastforward_mode = FASTFORWARD_ALWAYS;
+      else
+         fastforward_mode = FASTFORWARD_DISABLED;
+   }
+
+   var.key = NAME_PREFIX "-fastforward-frames";
+   var.value = NULL;
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      fastforward_option_frames = atoi(var.value);
+      if (fastforward_option_frames < 1)
+         fastforward_option_frames = 1;
+   }
+
+   var.key = NAME_PREFIX "-rewind";
+   var.value = NULL;
+
+   {
+      /* atoi gives 0 for "disabled" */
+      unsigned frames = 0;
+
+      if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+         frames = atoi(var.value);
+
+      if (startup || frames != rewind_frames)
+      {
+         rewind_top_is_current = false;
+         rewind_frames = savestates_rewind_init(frames) ? frames : 0;
+      }
+   }
+
    
    {
       struct retro_variable pk1var = { NAME_PREFIX "-pak1" };
@@ -1084,8 +1267,15 @@ bool retro_load_game(const struct retro_game_info *game)
          break;
    }
 
+#ifdef EMSCRIPTEN
+   /* the rom is only opened by the first retro_run */
    game_data = malloc(game->size);
-   memcpy(game_data, game->data, game->size);
+   memcpy((void*)game_data, game->data, game->size);
+#else
+   /* the rom is opened (and copied) by the co_switch below, while the
+    * frontend buffer is still valid */
+   game_data = (const uint8_t*)game->data;
+#endif
    game_size = game->size;
 
    stop = false;
@@ -1110,8 +1300,12 @@ void retro_unload_game(void)
     co_switch(game_thread);
 #endif
 
+    savestates_rewind_deinit();
+    rewind_frames = 0;
+
     CoreDoCommand(M64CMD_ROM_CLOSE, 0, NULL);
     emu_initialized = false;
+    emu_running = false;
 }
 
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
@@ -1149,6 +1343,7 @@ static void glsm_enter(void)
 void retro_run (void)
 {
    static bool updated = false;
+   bool rewound;
 
    blitter_buf_lock = blitter_buf;
 
@@ -1217,6 +1412,8 @@ void retro_run (void)
 
    FAKE_SDL_TICKS += 16;
    pushed_frame = false;
+   rewound = rewind_begin_frame();
+   fastforward_begin_frame();
 
    if (reinit_screen)
    {
@@ -1280,6 +1477,9 @@ void retro_run (void)
             break;
       }
    } while (emu_step_render());
+
+   flush_audio_libretro();
+   rewind_end_frame(rewound);
 }
 
 void retro_reset (void)
@@ -1301,13 +1501,22 @@ size_t retro_get_memory_size(unsigned type)
 
 size_t retro_serialize_size (void)
 {
-    return 16788288 + 1024; // < 16MB and some change... ouch
+    return savestates_size();
 }
 
 bool retro_serialize(void *data, size_t size)
 {
-    if (savestates_save_m64p(data, size))
+    int ret;
+
+    timed_section_start(TIMED_SECTION_SAVESTATE);
+    ret = savestates_save_m64p(data, size);
+    timed_section_end(TIMED_SECTION_SAVESTATE);
+
+    if (ret)
+    {
+        timed_sections_count_bytes(TIMED_SECTION_SAVESTATE, savestates_size());
         return true;
+    }
 
     return false;
 }
@@ -1315,7 +1524,10 @@ bool retro_serialize(void *data, size_t size)
 bool retro_unserialize(const void * data, size_t size)
 {
     if (savestates_load_m64p(data, size))
+    {
+        rewind_top_is_current = false;
         return true;
+    }
 
     return false;
 }
@@ -1363,6 +1575,10 @@ int retro_return(int just_flipping)
    if (stop)
       return 0;
 
+   /* keep emulating the hidden VIs of a fast-forward frame */
+   if (!just_flipping && ++fastforward_vi < fastforward_frames)
+      return 0;
+
 #if defined(HAVE_OPENGL) || defined(HAVE_OPENGLES)
    vbo_disable();
 #endif
@@ -17,6 +17,8 @@ extern retro_perf_get_counter_t perf_get_counter_cb;
 extern retro_log_printf_t log_cb;
 extern retro_perf_register_t perf_register_cb;
 int retro_return(int just_flipping);
+int retro_vi_hidden(void);
+int retro_skip_update_screen(void);
 
 #define SDL_GetTicks() FAKE_SDL_TICKS
 
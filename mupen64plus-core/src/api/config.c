@@ -1205,6 +1205,11 @@ EXPORT int CALL ConfigGetParamBool(m64p_handle ConfigSectionHandle, const char *
             { 0, "disabled" }, { 1, "enabled" }
          }
       },
+      { "FuseInstructions", NAME_PREFIX "-cached-fusion",
+         {
+            { 0, "disabled" }, { 1, "enabled" }
+         }
+      },
       { 0, 0, { {0, 0} } }
    };
 
@@ -207,6 +207,7 @@ typedef struct
    uint32_t height;
 } FrameBufferInfo;
 typedef void (*ptr_FBRead)(uint32_t addr);
+/* size is in bytes: the core passes runs of adjacent written words */
 typedef void (*ptr_FBWrite)(uint32_t addr, uint32_t size);
 typedef void (*ptr_FBGetFrameBufferInfo)(void *p);
 #if defined(M64P_PLUGIN_PROTOTYPES)
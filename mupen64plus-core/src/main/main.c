@@ -46,6 +46,7 @@
 #include "main.h"
 #include "cheat.h"
 #include "eventloop.h"
+#include "profile.h"
 #include "rom.h"
 #include "savestates.h"
 #include "util.h"
@@ -78,6 +79,7 @@
 #include "api/libretro.h"
 
 extern retro_input_poll_t poll_cb;
+extern int retro_vi_hidden(void);
 
 /* version number for Core config section */
 #define CONFIG_PARAM_VERSION 1.01
@@ -167,6 +169,7 @@ int main_set_core_defaults(void)
    ConfigSetDefaultInt(g_CoreConfig, "R4300Emulator", 1, "Use Pure Interpreter if 0, Cached Interpreter if 1, or Dynamic Recompiler if 2 or more");
 #endif
    ConfigSetDefaultBool(g_CoreConfig, "NoCompiledJump", 0, "Disable compiled jump commands in dynamic recompiler (should be set to False) ");
+   ConfigSetDefaultBool(g_CoreConfig, "FuseInstructions", 1, "Merge common instruction pairs into single handlers in the cached interpreter");
    ConfigSetDefaultBool(g_CoreConfig, "DisableExtraMem", 0, "Disable 4MB expansion RAM pack. May be necessary for some games");
    ConfigSetDefaultBool(g_CoreConfig, "EnableDebugger", 0, "Activate the R4300 debugger when ROM execution begins, if core was built with Debugger support");
    ConfigSetDefaultInt(g_CoreConfig, "CountPerOp", 0, "Force number of cycles per emulated instruction.");
@@ -290,11 +293,13 @@ void new_vi(void)
 {
    gs_apply_cheats();
 
-   main_check_inputs();
+   /* the frontend input only changes between two retro_run */
+   if (!retro_vi_hidden())
+      main_check_inputs();
 
-#if 0
    timed_sections_refresh();
 
+#if 0
    pause_loop();
 
    apply_speed_limiter();
@@ -348,6 +353,7 @@ m64p_error main_init(void)
 
    /* set some other core parameters based on the config file values */
    no_compiled_jump = ConfigGetParamBool(g_CoreConfig, "NoCompiledJump");
+   fuse_instructions = ConfigGetParamBool(g_CoreConfig, "FuseInstructions");
    disable_extra_mem = ConfigGetParamInt(g_CoreConfig, "DisableExtraMem");
 #if 0
    count_per_op = ConfigGetParamInt(g_CoreConfig, "CountPerOp");
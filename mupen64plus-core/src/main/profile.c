@@ -21,14 +21,90 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
-#ifdef PROFILE
 #include "profile.h"
 
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "../api/m64p_types.h"
 #include "../api/callbacks.h"
+#include "../r4300/r4300.h"
+#include "../r4300/tlb.h"
+
+#include "libretro_perf.h"
+
+/* number of VI frames kept for the frame time percentiles */
+#define FRAME_HISTORY 512
+/* number of section samples kept for the chrome trace export */
+#define TRACE_CAPACITY 65536
+/* deepest nesting of sections, the compiler recurses */
+#define MAX_OPEN_SECTIONS 32
+
+struct trace_event
+{
+   enum timed_section section;
+   long long int start;
+   long long int end;
+};
+
+static const char* const section_names[NUM_TIMED_SECTIONS] =
+{
+   "frame",
+   "rsp_gfx",
+   "rsp_audio",
+   "compiler",
+   "idle",
+   "rsp_other",
+   "rdp",
+   "vi",
+   "audio_resample",
+   "savestate",
+   "rewind"
+};
 
 static long long int time_in_section[NUM_TIMED_SECTIONS];
+static long long int time_in_frame[NUM_TIMED_SECTIONS];
 static long long int last_start[NUM_TIMED_SECTIONS];
+static long long int last_frame_start;
+
+/* time spent in a section minus the time spent in the sections it contains */
+static long long int self_time_in_section[NUM_TIMED_SECTIONS];
+
+struct open_section
+{
+   enum timed_section section;
+   long long int start;
+   long long int nested;
+};
+
+static struct open_section open_sections[MAX_OPEN_SECTIONS];
+static unsigned int open_sections_count;
+static unsigned int open_count[NUM_TIMED_SECTIONS];
+
+static long long int frame_history[FRAME_HISTORY][NUM_TIMED_SECTIONS];
+static unsigned int frame_history_index;
+static unsigned int frame_history_count;
+
+static struct trace_event trace_events[TRACE_CAPACITY];
+static unsigned int trace_events_index;
+static unsigned int trace_events_count;
+static long long int trace_origin;
+
+static struct retro_perf_counter perf_counters[NUM_TIMED_SECTIONS];
+
+unsigned long long int timed_sections_r4300_instructions;
+
+static unsigned long long int bytes_in_section[NUM_TIMED_SECTIONS];
+static unsigned int calls_in_section[NUM_TIMED_SECTIONS];
+
+static unsigned int texture_cache_hits;
+static unsigned int texture_cache_misses;
+static unsigned int texture_cache_evictions;
+static unsigned int texture_cache_collisions;
+static unsigned long long int texture_cache_bytes;
 
 #if defined(WIN32) && !defined(__MINGW32__)
   // timing
@@ -62,40 +138,270 @@ static long long int last_start[NUM_TIMED_SECTIONS];
   }
 #endif
 
+static void record_trace_event(enum timed_section section, long long int start, long long int end)
+{
+   struct trace_event* event = &trace_events[trace_events_index];
+
+   if (trace_events_count == 0)
+      trace_origin = start;
+
+   event->section = section;
+   event->start   = start;
+   event->end     = end;
+
+   trace_events_index = (trace_events_index + 1) % TRACE_CAPACITY;
+   if (trace_events_count < TRACE_CAPACITY)
+      ++trace_events_count;
+}
+
+static int compare_times(const void* a, const void* b)
+{
+   long long int ta = *(const long long int*)a;
+   long long int tb = *(const long long int*)b;
+
+   return (ta > tb) - (ta < tb);
+}
+
+/* returns the p-th percentile (in nsec) of a section over the frame history */
+static long long int frame_percentile(enum timed_section section, unsigned int p)
+{
+   static long long int sorted[FRAME_HISTORY];
+   unsigned int i;
+
+   if (frame_history_count == 0)
+      return 0;
+
+   for (i = 0; i < frame_history_count; ++i)
+      sorted[i] = frame_history[i][section];
+
+   qsort(sorted, frame_history_count, sizeof(sorted[0]), compare_times);
+
+   return time_to_nsec(sorted[(frame_history_count - 1) * p / 100]);
+}
+
+static const char* cpu_section_name(void)
+{
+   switch (r4300emu)
+   {
+      case CORE_PURE_INTERPRETER: return "cpu_pure_interp";
+      case CORE_INTERPRETER:      return "cpu_cached_interp";
+      default:                    return "cpu_dynarec";
+   }
+}
+
 void timed_section_start(enum timed_section section)
 {
+   if (perf_counters[section].ident == NULL)
+   {
+      perf_counters[section].ident = section_names[section];
+      if (perf_cb.perf_register)
+         perf_cb.perf_register(&perf_counters[section]);
+   }
+
+   /* the frontend leaves counters it can't take unregistered */
+   if (perf_cb.perf_start && perf_counters[section].registered)
+      RETRO_PERFORMANCE_START(perf_cb, perf_counters[section]);
+
    last_start[section] = get_time();
+
+   if (open_sections_count < MAX_OPEN_SECTIONS)
+   {
+      struct open_section* open = &open_sections[open_sections_count++];
+
+      open->section = section;
+      open->start   = last_start[section];
+      open->nested  = 0;
+      open_count[section]++;
+   }
 }
 
 void timed_section_end(enum timed_section section)
 {
    long long int end = get_time();
+
+   if (perf_cb.perf_stop && perf_counters[section].registered)
+      RETRO_PERFORMANCE_STOP(perf_cb, perf_counters[section]);
+
+   if (open_sections_count != 0
+         && open_sections[open_sections_count - 1].section == section)
+   {
+      struct open_section* open = &open_sections[--open_sections_count];
+      long long int duration = end - open->start;
+
+      self_time_in_section[section] += duration - open->nested;
+      if (open_sections_count != 0)
+         open_sections[open_sections_count - 1].nested += duration;
+
+      /* a section re-entered by itself is only counted once */
+      if (--open_count[section] != 0)
+         return;
+
+      last_start[section] = open->start;
+   }
+
    time_in_section[section] += end - last_start[section];
+   time_in_frame[section]   += end - last_start[section];
+
+   record_trace_event(section, last_start[section], end);
+}
+
+void timed_sections_count_bytes(enum timed_section section, unsigned long long int bytes)
+{
+   bytes_in_section[section] += bytes;
+   calls_in_section[section]++;
+}
+
+void timed_sections_count_texture_cache(unsigned int hits, unsigned int misses,
+      unsigned int evictions, unsigned int collisions, unsigned long long int cached_bytes)
+{
+   texture_cache_hits += hits;
+   texture_cache_misses += misses;
+   texture_cache_evictions += evictions;
+   texture_cache_collisions += collisions;
+   texture_cache_bytes = cached_bytes;
 }
 
+/* called once per VI */
 void timed_sections_refresh()
 {
+   unsigned int i;
    long long int curr_time = get_time();
+
+   if (last_frame_start != 0)
+   {
+      time_in_frame[TIMED_SECTION_ALL] = curr_time - last_frame_start;
+      record_trace_event(TIMED_SECTION_ALL, last_frame_start, curr_time);
+
+      for (i = 0; i < NUM_TIMED_SECTIONS; ++i)
+         frame_history[frame_history_index][i] = time_in_frame[i];
+
+      frame_history_index = (frame_history_index + 1) % FRAME_HISTORY;
+      if (frame_history_count < FRAME_HISTORY)
+         ++frame_history_count;
+   }
+   else
+   {
+      last_start[TIMED_SECTION_ALL] = curr_time;
+   }
+
+   for (i = 0; i < NUM_TIMED_SECTIONS; ++i)
+      time_in_frame[i] = 0;
+   last_frame_start = curr_time;
+
    if(time_to_nsec(curr_time - last_start[TIMED_SECTION_ALL]) >= 2000000000)
    {
+      long long int cpu;
+
       time_in_section[TIMED_SECTION_ALL] = curr_time - last_start[TIMED_SECTION_ALL];
+      cpu = time_in_section[TIMED_SECTION_ALL];
+      for (i = TIMED_SECTION_ALL + 1; i < NUM_TIMED_SECTIONS; ++i)
+         cpu -= self_time_in_section[i];
+
       DebugMessage(M64MSG_INFO, "gfx=%f%% - audio=%f%% - compiler=%f%%, idle=%f%%",
          100.0 * (double)time_in_section[TIMED_SECTION_GFX] / time_in_section[TIMED_SECTION_ALL],
          100.0 * (double)time_in_section[TIMED_SECTION_AUDIO] / time_in_section[TIMED_SECTION_ALL],
          100.0 * (double)time_in_section[TIMED_SECTION_COMPILER] / time_in_section[TIMED_SECTION_ALL],
          100.0 * (double)time_in_section[TIMED_SECTION_IDLE] / time_in_section[TIMED_SECTION_ALL]);
+      DebugMessage(M64MSG_INFO, "rsp_other=%f%% - rdp=%f%% - vi=%f%% - audio_resample=%f%% - %s=%f%%",
+         100.0 * (double)time_in_section[TIMED_SECTION_RSP_OTHER] / time_in_section[TIMED_SECTION_ALL],
+         100.0 * (double)time_in_section[TIMED_SECTION_RDP] / time_in_section[TIMED_SECTION_ALL],
+         100.0 * (double)time_in_section[TIMED_SECTION_VI] / time_in_section[TIMED_SECTION_ALL],
+         100.0 * (double)time_in_section[TIMED_SECTION_AUDIO_RESAMPLE] / time_in_section[TIMED_SECTION_ALL],
+         cpu_section_name(),
+         100.0 * (double)cpu / time_in_section[TIMED_SECTION_ALL]);
       DebugMessage(M64MSG_INFO, "gfx=%llins - audio=%llins - compiler %llins - idle=%llins",
          time_to_nsec(time_in_section[TIMED_SECTION_GFX]),
          time_to_nsec(time_in_section[TIMED_SECTION_AUDIO]),
          time_to_nsec(time_in_section[TIMED_SECTION_COMPILER]),
          time_to_nsec(time_in_section[TIMED_SECTION_IDLE]));
-      time_in_section[TIMED_SECTION_GFX] = 0;
-      time_in_section[TIMED_SECTION_AUDIO] = 0;
-      time_in_section[TIMED_SECTION_COMPILER] = 0;
-      time_in_section[TIMED_SECTION_IDLE] = 0;
+      DebugMessage(M64MSG_INFO, "frame p50=%llins - p99=%llins - max=%llins (last %u frames)",
+         frame_percentile(TIMED_SECTION_ALL, 50),
+         frame_percentile(TIMED_SECTION_ALL, 99),
+         frame_percentile(TIMED_SECTION_ALL, 100),
+         frame_history_count);
+      /* the dynarecs don't keep track of the retired instructions */
+      if (timed_sections_r4300_instructions != 0 && cpu > 0)
+         DebugMessage(M64MSG_INFO, "%s: %llu instructions - %f MIPS",
+            cpu_section_name(),
+            timed_sections_r4300_instructions,
+            1000.0 * (double)timed_sections_r4300_instructions / time_to_nsec(cpu));
+      timed_sections_r4300_instructions = 0;
+
+      for (i = TIMED_SECTION_SAVESTATE; i <= TIMED_SECTION_REWIND; ++i)
+      {
+         if (calls_in_section[i] != 0)
+            DebugMessage(M64MSG_INFO, "%s: %u calls - %llu bytes/call - %llins/call",
+               section_names[i],
+               calls_in_section[i],
+               bytes_in_section[i] / calls_in_section[i],
+               time_to_nsec(time_in_section[i]) / calls_in_section[i]);
+         bytes_in_section[i] = 0;
+         calls_in_section[i] = 0;
+      }
+
+      if (texture_cache_hits + texture_cache_misses != 0)
+         DebugMessage(M64MSG_INFO, "texture cache: %u hits - %u misses (%f%% hits) - %u evictions - %u collisions - %llu KB cached",
+            texture_cache_hits,
+            texture_cache_misses,
+            100.0 * texture_cache_hits / (texture_cache_hits + texture_cache_misses),
+            texture_cache_evictions,
+            texture_cache_collisions,
+            texture_cache_bytes >> 10);
+      texture_cache_hits = 0;
+      texture_cache_misses = 0;
+      texture_cache_evictions = 0;
+      texture_cache_collisions = 0;
+
+      if (tlb_counters.maps + tlb_counters.refills != 0)
+         DebugMessage(M64MSG_INFO, "tlb: %u writes - %u pages mapped - %u pages unmapped - %u lazy fills - %u refills",
+            tlb_counters.maps,
+            tlb_counters.pages_mapped,
+            tlb_counters.pages_unmapped,
+            tlb_counters.lazy_fills,
+            tlb_counters.refills);
+      memset(&tlb_counters, 0, sizeof(tlb_counters));
+
+      for (i = TIMED_SECTION_ALL + 1; i < NUM_TIMED_SECTIONS; ++i)
+      {
+         time_in_section[i] = 0;
+         self_time_in_section[i] = 0;
+      }
       last_start[TIMED_SECTION_ALL] = curr_time;
    }
 }
 
-#endif
+/* write the recorded section samples in the chrome://tracing JSON format */
+int timed_sections_dump_trace(const char* path)
+{
+   unsigned int i;
+   unsigned int first;
+   FILE* f = fopen(path, "w");
 
+   if (f == NULL)
+   {
+      DebugMessage(M64MSG_WARNING, "couldn't open %s for writing the profiling trace", path);
+      return -1;
+   }
+
+   fputs("{\"traceEvents\":[\n", f);
+
+   first = (trace_events_index + TRACE_CAPACITY - trace_events_count) % TRACE_CAPACITY;
+   for (i = 0; i < trace_events_count; ++i)
+   {
+      const struct trace_event* event = &trace_events[(first + i) % TRACE_CAPACITY];
+
+      fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}\n",
+         (i == 0) ? "" : ",",
+         section_names[event->section],
+         time_to_nsec(event->start - trace_origin) / 1000.0,
+         time_to_nsec(event->end - event->start) / 1000.0);
+   }
+
+   fputs("]}\n", f);
+   fclose(f);
+
+   DebugMessage(M64MSG_INFO, "wrote %u profiling samples to %s", trace_events_count, path);
+   return 0;
+}
+
+#endif
@@ -24,6 +24,14 @@
 #ifndef PROFILE_H
 #define PROFILE_H
 
+/* PERF_TEST=1 builds enable the profiler */
+#if defined(PERF_TEST) && !defined(PROFILE)
+#define PROFILE
+#endif
+
+/* Sections may nest (e.g. RDP inside GFX): every section reports its
+ * inclusive time, and the CPU share is what is left of the frame once the
+ * exclusive time of every section is subtracted. */
 enum timed_section
 {
     TIMED_SECTION_ALL,
@@ -31,17 +39,47 @@ enum timed_section
     TIMED_SECTION_AUDIO,
     TIMED_SECTION_COMPILER,
     TIMED_SECTION_IDLE,
+    TIMED_SECTION_RSP_OTHER,
+    TIMED_SECTION_RDP,
+    TIMED_SECTION_VI,
+    TIMED_SECTION_AUDIO_RESAMPLE,
+    TIMED_SECTION_SAVESTATE,
+    TIMED_SECTION_REWIND,
     NUM_TIMED_SECTIONS
 };
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #ifdef PROFILE
   void timed_section_start(enum timed_section section);
   void timed_section_end(enum timed_section section);
   void timed_sections_refresh(void);
+  int timed_sections_dump_trace(const char* path);
+
+  /* r4300 instructions retired, used to report the interpreters MIPS */
+  extern unsigned long long int timed_sections_r4300_instructions;
+  #define timed_sections_count_instructions(n) (timed_sections_r4300_instructions += (n))
+
+  /* bytes produced by a section, reported per call (e.g. savestate sizes) */
+  void timed_sections_count_bytes(enum timed_section section, unsigned long long int bytes);
+
+  /* texture cache events of the video plugin, cached_bytes is the current cache size */
+  void timed_sections_count_texture_cache(unsigned int hits, unsigned int misses,
+        unsigned int evictions, unsigned int collisions, unsigned long long int cached_bytes);
 #else
   #define timed_section_start(a)
   #define timed_section_end(a)
   #define timed_sections_refresh()
+  #define timed_sections_dump_trace(a) (0)
+  #define timed_sections_count_instructions(n)
+  #define timed_sections_count_bytes(a, n)
+  #define timed_sections_count_texture_cache(hits, misses, evictions, collisions, cached_bytes)
+#endif
+
+#ifdef __cplusplus
+}
 #endif
 
 #endif
@@ -127,50 +127,96 @@ static int is_valid_rom(const unsigned char *buffer)
       return 0;
 }
 
-/* If rom is a .v64 or .n64 image, byteswap or wordswap loadlength amount of
- * rom data to native .z64 before forwarding. Makes sure that data extraction
- * and MD5ing routines always deal with a .z64 image.
- */
-static void swap_rom(unsigned char* localrom, unsigned char* imagetype, int loadlength)
+/* Returns the image type of a rom from its first byte. */
+static unsigned char rom_image_type(const unsigned char* romimage)
+{
+   if (romimage[0] == 0x37)
+      return V64IMAGE;
+   else if (romimage[0] == 0x40)
+      return N64IMAGE;
+   else
+      return Z64IMAGE;
+}
+
+/* Copies a .z64, .v64 or .n64 image to dest in the word-swapped order used
+ * by the emulator (each 32-bit word of the .z64 image byteswapped), so that
+ * the rom doesn't need a separate byteswapping pass once loaded. */
+static void copy_rom_swapped(uint32_t* dest, const unsigned char* romimage, unsigned char imagetype, int size)
 {
-   unsigned char temp;
    int i;
+   uint32_t word;
 
-   /* Btyeswap if .v64 image. */
-   if(localrom[0]==0x37)
+   switch (imagetype)
    {
-      *imagetype = V64IMAGE;
-      for (i = 0; i < loadlength; i+=2)
-      {
-         temp=localrom[i];
-         localrom[i]=localrom[i+1];
-         localrom[i+1]=temp;
-      }
+      case N64IMAGE:
+         /* .n64 images are already word-swapped */
+         memcpy(dest, romimage, size);
+         break;
+      case V64IMAGE:
+         for (i = 0; i < size / 4; i++)
+         {
+            memcpy(&word, romimage + i * 4, 4);
+            dest[i] = (word << 16) | (word >> 16);
+         }
+         break;
+      default:
+         for (i = 0; i < size / 4; i++)
+         {
+            memcpy(&word, romimage + i * 4, 4);
+            dest[i] = m64p_swap32(word);
+         }
+         break;
    }
-   /* Wordswap if .n64 image. */
-   else if(localrom[0]==0x40)
+}
+
+/* The MD5 is only used to identify savestates, it is computed the first time
+ * it's needed instead of delaying the rom loading. */
+static int rom_md5_valid = 0;
+
+const char* rom_md5(void)
+{
+   static uint32_t chunk[0x4000];
+   md5_state_t state;
+   md5_byte_t digest[16];
+   int offset, length, i;
+
+   if (rom_md5_valid || g_rom == NULL)
+      return ROM_SETTINGS.MD5;
+
+   /* hash the .z64 order, regardless of how the rom is stored in g_rom */
+   md5_init(&state);
+   for (offset = 0; offset < g_rom_size; offset += sizeof(chunk))
    {
-      *imagetype = N64IMAGE;
-      for (i = 0; i < loadlength; i+=4)
+      length = g_rom_size - offset;
+      if (length > (int)sizeof(chunk))
+         length = sizeof(chunk);
+
+      if (g_MemHasBeenBSwapped)
       {
-         temp=localrom[i];
-         localrom[i]=localrom[i+3];
-         localrom[i+3]=temp;
-         temp=localrom[i+1];
-         localrom[i+1]=localrom[i+2];
-         localrom[i+2]=temp;
+         const uint32_t* words = (const uint32_t*)(g_rom + offset);
+         for (i = 0; i < length / 4; i++)
+            chunk[i] = m64p_swap32(words[i]);
+         md5_append(&state, (const md5_byte_t*)chunk, length);
       }
+      else
+         md5_append(&state, (const md5_byte_t*)(g_rom + offset), length);
    }
-   else
-      *imagetype = Z64IMAGE;
+   md5_finish(&state, digest);
+
+   for (i = 0; i < 16; ++i)
+      sprintf(ROM_SETTINGS.MD5 + i * 2, "%02X", digest[i]);
+   ROM_SETTINGS.MD5[32] = '\0';
+   rom_md5_valid = 1;
+
+   DebugMessage(M64MSG_INFO, "MD5: %s", ROM_SETTINGS.MD5);
+   return ROM_SETTINGS.MD5;
 }
 
 m64p_error open_rom(const unsigned char* romimage, unsigned int size)
 {
 #include "rom_luts.c"
-   md5_state_t state;
-   md5_byte_t digest[16];
    char buffer[256];
+   uint32_t header[sizeof(m64p_rom_header) / 4];
    unsigned char imagetype;
    int i;
    uint64_t lut_id;
@@ -188,27 +234,23 @@ m64p_error open_rom(const unsigned char* romimage, unsigned int size)
       return M64ERR_INPUT_INVALID;
    }
 
-   /* Clear Byte-swapped flag, since ROM is now deleted. */
-   g_MemHasBeenBSwapped = 0;
-   /* allocate new buffer for ROM and copy into this buffer */
-   g_rom_size = size;
-   g_rom = (unsigned char *) malloc(size);
+   /* allocate new buffer for ROM and copy it there, already byteswapped */
+   g_rom_size = size & ~3;
+   g_rom = (unsigned char *) malloc(g_rom_size);
    alternate_vi_timing = 0;
    if (g_rom == NULL)
       return M64ERR_NO_MEMORY;
-   memcpy(g_rom, romimage, size);
-   swap_rom(g_rom, &imagetype, g_rom_size);
+   imagetype = rom_image_type(romimage);
+   copy_rom_swapped((uint32_t*)g_rom, romimage, imagetype, g_rom_size);
+   g_MemHasBeenBSwapped = 1;
 
-   memcpy(&ROM_HEADER, g_rom, sizeof(m64p_rom_header));
+   /* the header is needed in .z64 order */
+   for (i = 0; i < (int)(sizeof(header) / 4); ++i)
+      header[i] = m64p_swap32(((const uint32_t*)g_rom)[i]);
+   memcpy(&ROM_HEADER, header, sizeof(m64p_rom_header));
 
-   /* Calculate MD5 hash  */
-   md5_init(&state);
-   md5_append(&state, (const md5_byte_t*)g_rom, g_rom_size);
-   md5_finish(&state, digest);
-   for ( i = 0; i < 16; ++i )
-      sprintf(buffer+i*2, "%02X", digest[i]);
-   buffer[32] = '\0';
-   strcpy(ROM_SETTINGS.MD5, buffer);
+   rom_md5_valid = 0;
+   ROM_SETTINGS.MD5[0] = '\0';
 
    /* add some useful properties to ROM_PARAMS */
    ROM_PARAMS.systemtype = rom_country_code_to_system_type(ROM_HEADER.destination_code);
@@ -325,7 +367,6 @@ m64p_error open_rom(const unsigned char* romimage, unsigned int size)
    DebugMessage(M64MSG_INFO, "Headername: %s", ROM_PARAMS.headername);
    DebugMessage(M64MSG_INFO, "Name: %s", ROM_HEADER.Name);
    imagestring(imagetype, buffer);
-   DebugMessage(M64MSG_INFO, "MD5: %s", ROM_SETTINGS.MD5);
    DebugMessage(M64MSG_INFO, "CRC: %x %x", sl(ROM_HEADER.CRC1), sl(ROM_HEADER.CRC2));
    DebugMessage(M64MSG_INFO, "Imagetype: %s", buffer);
    DebugMessage(M64MSG_INFO, "Rom size: %d bytes (or %d Mb or %d Megabits)", g_rom_size, g_rom_size/1024/1024, g_rom_size/1024/1024*8);
@@ -356,6 +397,7 @@ m64p_error close_rom(void)
 
    free(g_rom);
    g_rom = NULL;
+   rom_md5_valid = 0;
 
    /* Clear Byte-swapped flag, since ROM is now deleted. */
    g_MemHasBeenBSwapped = 0;
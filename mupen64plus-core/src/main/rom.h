@@ -31,6 +31,9 @@
 m64p_error open_rom(const unsigned char* romimage, unsigned int size);
 m64p_error close_rom(void);
 
+/* Returns the MD5 of the loaded rom, computing it on first call. */
+const char* rom_md5(void);
+
 extern unsigned char* g_rom;
 extern int g_rom_size;
 
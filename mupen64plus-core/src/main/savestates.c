@@ -22,6 +22,7 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -50,7 +51,56 @@
 #include "osal/preproc.h"
 
 static const char* savestate_magic = "M64+SAVE";
-static const int savestate_latest_version = 0x00010000;  /* 1.0 */
+/* 1.1 stores the RDRAM size in the header, only saves the connected RDRAM
+ * and rebuilds the TLB lookup tables on load instead of storing them */
+static const int savestate_latest_version = 0x00010100;  /* 1.1 */
+
+/* everything but the RDRAM, in the order save_state writes it */
+enum
+{
+   /* magic, version, ROM MD5 and RDRAM size */
+   SAVESTATE_HEADER_SIZE = 8 + 4 + 32 + 4,
+   /* RDRAM, MI, PI, SP, SI, VI, RI, AI and DP registers, including the
+    * duplicated flags and padding of the old implementation */
+   SAVESTATE_REGS_SIZE = 40 + 36 + 52 + 60 + 16 + 60 + 32 + 40 + 64,
+   SAVESTATE_FLASHRAM_SIZE = 24,
+   /* LL bit, GPRs, CP0 registers, LO/HI, FPRs, FCR0 and FCR31 */
+   SAVESTATE_CPU_SIZE = 4 + 32*8 + 32*4 + 2*8 + 32*8 + 2*4,
+   SAVESTATE_TLB_SIZE = 32 * 52,
+   /* PC, next interrupt, next VI and VI field */
+   SAVESTATE_TIMING_SIZE = 4 * 4,
+   SAVESTATE_QUEUE_MAX_SIZE = 1024,
+
+   SAVESTATE_BASE_SIZE = SAVESTATE_HEADER_SIZE + SAVESTATE_REGS_SIZE
+      + SP_MEM_SIZE + PIF_RAM_SIZE + SAVESTATE_FLASHRAM_SIZE
+      + SAVESTATE_CPU_SIZE + SAVESTATE_TLB_SIZE + SAVESTATE_TIMING_SIZE
+      + SAVESTATE_QUEUE_MAX_SIZE
+};
+
+/* granularity of the rewind deltas */
+enum { REWIND_PAGE_SIZE = 0x1000 };
+
+struct rewind_delta
+{
+   /* savestate without RDRAM (SAVESTATE_BASE_SIZE bytes) */
+   unsigned char *state;
+   size_t state_size;
+   /* RDRAM pages of the previous snapshot which differ in this one */
+   uint16_t *page_index;
+   uint32_t *pages;
+   unsigned int page_count;
+   unsigned int page_capacity;
+};
+
+static struct
+{
+   struct rewind_delta *deltas;
+   unsigned int capacity;
+   unsigned int first;
+   unsigned int count;
+   /* RDRAM at the time of the newest snapshot */
+   uint32_t *shadow;
+} rewind_ring;
 
 #define GETARRAY(buff, type, count) \
     (to_little_endian_buffer(buff, sizeof(type),count), \
@@ -68,10 +118,14 @@ static const int savestate_latest_version = 0x00010000;  /* 1.0 */
 #define PUTDATA(buff, type, value) \
     do { type x = value; PUTARRAY(&x, buff, type, 1); } while(0)
 
-int savestates_load_m64p(const unsigned char *data, size_t size)
+/* The rewind ring stores its snapshots with an RDRAM size of 0 and restores
+ * their pages separately: such states leave RDRAM untouched when
+ * allow_no_rdram is set and are rejected otherwise. */
+static int load_state(const unsigned char *data, size_t size, int allow_no_rdram)
 {
    char queue[1024];
    int version;
+   uint32_t rdram_size = RDRAM_MAX_SIZE;
    int i;
    uint32_t FCR31;
    uint32_t* cp0_regs = r4300_cp0_regs();
@@ -88,14 +142,23 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    version = (version << 8) | *curr++;
    version = (version << 8) | *curr++;
 
-   if(version != 0x00010000)
+   if(version != 0x00010000 && version != 0x00010100)
       return 0;
 
-   if(memcmp((char *)curr, ROM_SETTINGS.MD5, 32))
+   if(memcmp((char *)curr, rom_md5(), 32))
       return 0;
 
    curr += 32;
 
+   if (version >= 0x00010100)
+   {
+      rdram_size = GETDATA(curr, uint32_t);
+      if (rdram_size > RDRAM_MAX_SIZE || (rdram_size & 3) != 0
+            || (rdram_size == 0 && !allow_no_rdram)
+            || size < SAVESTATE_BASE_SIZE + rdram_size)
+         return 0;
+   }
+
    /* Parse savestate */
    g_ri.rdram.regs[RDRAM_CONFIG_REG] = GETDATA(curr, uint32_t);
    g_ri.rdram.regs[RDRAM_DEVICE_ID_REG] = GETDATA(curr, uint32_t);
@@ -213,7 +276,11 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    g_dp.dps_regs[DPS_BUFTEST_ADDR_REG] = GETDATA(curr, uint32_t);
    g_dp.dps_regs[DPS_BUFTEST_DATA_REG] = GETDATA(curr, uint32_t);
 
-   COPYARRAY(g_rdram, curr, uint32_t, RDRAM_MAX_SIZE/4);
+   if (rdram_size != 0)
+   {
+      COPYARRAY(g_rdram, curr, uint32_t, rdram_size/4);
+      memset((uint8_t*)g_rdram + rdram_size, 0, RDRAM_MAX_SIZE - rdram_size);
+   }
    COPYARRAY(g_sp.mem, curr, uint32_t, SP_MEM_SIZE/4);
    COPYARRAY(g_si.pif.ram, curr, uint8_t, PIF_RAM_SIZE);
 
@@ -223,8 +290,12 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    g_pi.flashram.erase_offset = GETDATA(curr, unsigned int);
    g_pi.flashram.write_pointer = GETDATA(curr, unsigned int);
 
-   COPYARRAY(tlb_LUT_r, curr, unsigned int, 0x100000);
-   COPYARRAY(tlb_LUT_w, curr, unsigned int, 0x100000);
+   if (version == 0x00010000)
+   {
+      tlb_init();
+      COPYARRAY(tlb_LUT_r, curr, unsigned int, 0x100000);
+      COPYARRAY(tlb_LUT_w, curr, unsigned int, 0x100000);
+   }
 
    *r4300_llbit() = GETDATA(curr, unsigned int);
    COPYARRAY(r4300_regs(), curr, int64_t, 32);
@@ -273,6 +344,13 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
       tlb_e[i].phys_odd   = GETDATA(curr, unsigned int);
    }
 
+   if (version >= 0x00010100)
+   {
+      tlb_init();
+      for (i = 0; i < 32; i++)
+         tlb_map(&tlb_e[i]);
+   }
+
    savestates_load_set_pc(GETDATA(curr, uint32_t));
 
    *r4300_next_interrupt() = GETDATA(curr, unsigned int);
@@ -292,17 +370,15 @@ int savestates_load_m64p(const unsigned char *data, size_t size)
    return 1;
 }
 
-int savestates_save_m64p(unsigned char *data, size_t size)
+/* returns the number of bytes written */
+static size_t save_state(unsigned char *data, uint32_t rdram_size)
 {
    unsigned char outbuf[4];
    int i, queuelength;
-   char queue[1024];
+   char queue[SAVESTATE_QUEUE_MAX_SIZE];
    uint32_t* cp0_regs = r4300_cp0_regs();
    unsigned char *curr = (unsigned char*)data;
 
-   if (!curr)
-      return 0;
-
    queuelength = save_eventqueue_infos(queue);
 
    // Write the save state data to memory
@@ -314,7 +390,8 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    outbuf[3] = (savestate_latest_version >>  0) & 0xff;
    PUTARRAY(outbuf, curr, unsigned char, 4);
 
-   PUTARRAY(ROM_SETTINGS.MD5, curr, char, 32);
+   PUTARRAY(rom_md5(), curr, char, 32);
+   PUTDATA(curr, uint32_t, rdram_size);
 
    PUTDATA(curr, uint32_t, g_ri.rdram.regs[RDRAM_CONFIG_REG]);
    PUTDATA(curr, uint32_t, g_ri.rdram.regs[RDRAM_DEVICE_ID_REG]);
@@ -456,7 +533,7 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    PUTDATA(curr, uint32_t, g_dp.dps_regs[DPS_BUFTEST_ADDR_REG]);
    PUTDATA(curr, uint32_t, g_dp.dps_regs[DPS_BUFTEST_DATA_REG]);
 
-   PUTARRAY(g_rdram, curr, uint32_t, RDRAM_MAX_SIZE/4);
+   PUTARRAY(g_rdram, curr, uint32_t, rdram_size/4);
    PUTARRAY(g_sp.mem, curr, uint32_t, SP_MEM_SIZE/4);
    PUTARRAY(g_si.pif.ram, curr, uint8_t, PIF_RAM_SIZE);
 
@@ -466,9 +543,6 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    PUTDATA(curr, unsigned int, g_pi.flashram.erase_offset);
    PUTDATA(curr, unsigned int, g_pi.flashram.write_pointer);
 
-   PUTARRAY(tlb_LUT_r, curr, unsigned int, 0x100000);
-   PUTARRAY(tlb_LUT_w, curr, unsigned int, 0x100000);
-
    PUTDATA(curr, unsigned int, *r4300_llbit());
    PUTARRAY(r4300_regs(), curr, int64_t, 32);
    PUTARRAY(cp0_regs, curr, uint32_t, 32);
@@ -519,9 +593,192 @@ int savestates_save_m64p(unsigned char *data, size_t size)
    to_little_endian_buffer(queue, 4, queuelength/4);
    PUTARRAY(queue, curr, char, queuelength);
 
+   /* anything written here has to be accounted for in SAVESTATE_BASE_SIZE */
+   assert((size_t)(curr - data) + SAVESTATE_QUEUE_MAX_SIZE - queuelength
+         == SAVESTATE_BASE_SIZE + rdram_size);
+
+   return curr - data;
+}
+
+int savestates_load_m64p(const unsigned char *data, size_t size)
+{
+   return load_state(data, size, 0);
+}
+
+int savestates_save_m64p(unsigned char *data, size_t size)
+{
+   if (!data || g_ri.rdram.dram_size == 0 || size < savestates_size())
+      return 0;
+
+   save_state(data, g_ri.rdram.dram_size);
+
    /* Deliver callback to indicate completion 
     * of state saving operation */
    StateChanged(M64CORE_STATE_SAVECOMPLETE, 1);
 
    return 1;
 }
+
+size_t savestates_size(void)
+{
+   size_t rdram_size = g_ri.rdram.dram_size;
+
+   /* the frontend may ask before the emulation thread connected the RDRAM */
+   if (rdram_size == 0)
+      rdram_size = (ConfigGetParamInt(g_CoreConfig, "DisableExtraMem") == 0) ? 0x800000 : 0x400000;
+
+   return SAVESTATE_BASE_SIZE + rdram_size;
+}
+
+
+void savestates_rewind_deinit(void)
+{
+   unsigned int i;
+
+   for (i = 0; i < rewind_ring.capacity; i++)
+   {
+      free(rewind_ring.deltas[i].state);
+      free(rewind_ring.deltas[i].page_index);
+      free(rewind_ring.deltas[i].pages);
+   }
+
+   free(rewind_ring.deltas);
+   free(rewind_ring.shadow);
+   memset(&rewind_ring, 0, sizeof(rewind_ring));
+}
+
+int savestates_rewind_init(unsigned int frames)
+{
+   savestates_rewind_deinit();
+
+   if (frames == 0)
+      return 1;
+
+   rewind_ring.deltas = (struct rewind_delta*)calloc(frames, sizeof(struct rewind_delta));
+   rewind_ring.shadow = (uint32_t*)malloc(RDRAM_MAX_SIZE);
+
+   if (!rewind_ring.deltas || !rewind_ring.shadow)
+   {
+      free(rewind_ring.deltas);
+      free(rewind_ring.shadow);
+      rewind_ring.deltas = NULL;
+      rewind_ring.shadow = NULL;
+      return 0;
+   }
+
+   rewind_ring.capacity = frames;
+   return 1;
+}
+
+static int rewind_add_page(struct rewind_delta *delta, unsigned int page)
+{
+   if (delta->page_count == delta->page_capacity)
+   {
+      unsigned int capacity = delta->page_capacity ? 2 * delta->page_capacity : 16;
+      uint16_t *page_index = (uint16_t*)realloc(delta->page_index, capacity * sizeof(uint16_t));
+      uint32_t *pages;
+
+      if (!page_index)
+         return 0;
+      delta->page_index = page_index;
+
+      pages = (uint32_t*)realloc(delta->pages, (size_t)capacity * REWIND_PAGE_SIZE);
+      if (!pages)
+         return 0;
+      delta->pages = pages;
+
+      delta->page_capacity = capacity;
+   }
+
+   delta->page_index[delta->page_count] = page;
+   memcpy(delta->pages + delta->page_count * (REWIND_PAGE_SIZE/4),
+         rewind_ring.shadow + page * (REWIND_PAGE_SIZE/4), REWIND_PAGE_SIZE);
+   delta->page_count++;
+
+   return 1;
+}
+
+/* Snapshots the emulator into the rewind ring, dropping the oldest snapshot
+ * once the ring is full. Only the RDRAM pages which changed since the
+ * previous snapshot are stored. Returns the size of the snapshot in bytes,
+ * 0 on failure. */
+size_t savestates_rewind_push(void)
+{
+   struct rewind_delta *delta;
+   unsigned int page;
+   unsigned int pages = g_ri.rdram.dram_size / REWIND_PAGE_SIZE;
+
+   if (rewind_ring.capacity == 0)
+      return 0;
+
+   if (rewind_ring.count == rewind_ring.capacity)
+   {
+      rewind_ring.first = (rewind_ring.first + 1) % rewind_ring.capacity;
+      rewind_ring.count--;
+   }
+
+   delta = &rewind_ring.deltas[(rewind_ring.first + rewind_ring.count) % rewind_ring.capacity];
+   delta->page_count = 0;
+
+   if (!delta->state)
+   {
+      delta->state = (unsigned char*)malloc(SAVESTATE_BASE_SIZE);
+      if (!delta->state)
+         return 0;
+   }
+
+   /* Pages are compared instead of being tracked by the RDRAM write
+    * handlers: DMAs, the RSP and RDP plugins and the dynarecs write to
+    * RDRAM directly. */
+   if (rewind_ring.count == 0)
+      memcpy(rewind_ring.shadow, g_rdram, g_ri.rdram.dram_size);
+   else
+   {
+      for (page = 0; page < pages; page++)
+      {
+         uint32_t *live   = g_rdram + page * (REWIND_PAGE_SIZE/4);
+         uint32_t *shadow = rewind_ring.shadow + page * (REWIND_PAGE_SIZE/4);
+
+         if (memcmp(live, shadow, REWIND_PAGE_SIZE) == 0)
+            continue;
+
+         if (!rewind_add_page(delta, page))
+         {
+            /* the shadow no longer matches the previous snapshot */
+            rewind_ring.count = 0;
+            return 0;
+         }
+         memcpy(shadow, live, REWIND_PAGE_SIZE);
+      }
+   }
+
+   delta->state_size = save_state(delta->state, 0);
+   rewind_ring.count++;
+
+   return delta->state_size + delta->page_count * (REWIND_PAGE_SIZE + sizeof(uint16_t));
+}
+
+/* Restores the newest snapshot of the rewind ring and drops it */
+int savestates_rewind_pop(void)
+{
+   struct rewind_delta *delta;
+   unsigned int i;
+
+   if (rewind_ring.count == 0)
+      return 0;
+
+   delta = &rewind_ring.deltas[(rewind_ring.first + rewind_ring.count - 1) % rewind_ring.capacity];
+
+   memcpy(g_rdram, rewind_ring.shadow, g_ri.rdram.dram_size);
+   if (!load_state(delta->state, SAVESTATE_BASE_SIZE, 1))
+      return 0;
+
+   /* step the shadow back to the previous snapshot */
+   for (i = 0; i < delta->page_count; i++)
+      memcpy(rewind_ring.shadow + delta->page_index[i] * (REWIND_PAGE_SIZE/4),
+            delta->pages + i * (REWIND_PAGE_SIZE/4), REWIND_PAGE_SIZE);
+
+   rewind_ring.count--;
+
+   return 1;
+}
@@ -34,6 +34,12 @@ typedef enum _savestates_job
 
 int savestates_load_m64p(const unsigned char *data, size_t size);
 int savestates_save_m64p(unsigned char *data, size_t size);
+size_t savestates_size(void);
+
+int savestates_rewind_init(unsigned int frames);
+void savestates_rewind_deinit(void);
+size_t savestates_rewind_push(void);
+int savestates_rewind_pop(void);
 
 
 #endif /* __SAVESTAVES_H__ */
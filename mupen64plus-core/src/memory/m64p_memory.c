@@ -81,6 +81,9 @@ void (*writememb[0x10000])(void);
 void (*writememd[0x10000])(void);
 void (*writememh[0x10000])(void);
 
+// host addresses of the plain RDRAM regions
+uint8_t *mem_base[0x10000];
+
 uint32_t VI_REFRESH = 1500;
 
 typedef int (*readfn)(void*,uint32_t,uint32_t*);
@@ -1014,6 +1017,8 @@ static void write_ddipl(void)
    writew(write_dd_ipl, &g_pi, address, cpu_word);
 }
 
+static void map_region_base(uint16_t region);
+
 #ifdef DBG
 static int memtype[0x10000];
 static void (*saved_readmemb[0x10000])(void);
@@ -1104,6 +1109,7 @@ void activate_memory_break_read(uint32_t address)
    readmemh[region] = readmemh_with_bp_checks;
    readmem [region] = readmem_with_bp_checks;
    readmemd[region] = readmemd_with_bp_checks;
+   map_region_base(region);
 }
 
 void deactivate_memory_break_read(uint32_t address)
@@ -1121,6 +1127,7 @@ void deactivate_memory_break_read(uint32_t address)
    saved_readmemh[region] = NULL;
    saved_readmem [region] = NULL;
    saved_readmemd[region] = NULL;
+   map_region_base(region);
 }
 
 void activate_memory_break_write(uint32_t address)
@@ -1138,6 +1145,7 @@ void activate_memory_break_write(uint32_t address)
    writememh[region] = writememh_with_bp_checks;
    writemem [region] = writemem_with_bp_checks;
    writememd[region] = writememd_with_bp_checks;
+   map_region_base(region);
 }
 
 void deactivate_memory_break_write(uint32_t address)
@@ -1155,6 +1163,7 @@ void deactivate_memory_break_write(uint32_t address)
    saved_writememh[region] = NULL;
    saved_writemem [region] = NULL;
    saved_writememd[region] = NULL;
+   map_region_base(region);
 }
 
 int get_memory_type(uint32_t address)
@@ -1447,6 +1456,17 @@ void map_region_w(uint16_t region,
    }
 }
 
+/* Regions handled by read_rdram/write_rdram get a host address, so that
+ * the interpreters can skip the handlers. Anything else, including RDRAM
+ * behind the rdramFB or breakpoint handlers, keeps going through them. */
+static void map_region_base(uint16_t region)
+{
+   if (readmem[region] == read_rdram && writemem[region] == write_rdram)
+      mem_base[region] = (uint8_t*)g_ri.rdram.dram + ((uint32_t)(region & 0x1fff) << 16);
+   else
+      mem_base[region] = NULL;
+}
+
 void map_region(uint16_t region,
       int type,
  void (*read8)(void),
@@ -1461,12 +1481,18 @@ void map_region(uint16_t region,
    map_region_t(region, type);
    map_region_r(region, read8, read16, read32, read64);
    map_region_w(region, write8, write16, write32, write64);
+   map_region_base(region);
 }
 
 uint32_t *fast_mem_access(uint32_t address)
 {
    /* This code is performance critical, specially on pure interpreter mode.
     * Removing error checking saves some time, but the emulator may crash. */
+   uint8_t *base = mem_base[address >> 16];
+
+   if (base)
+      return (uint32_t*)(base + (address & 0xfffc));
+
    if ((address & 0xc0000000) != 0x80000000)
       address = virtual_to_physical_address(address, 2);
 
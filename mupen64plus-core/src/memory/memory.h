@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 
+#include <retro_inline.h>
+
 #ifndef MASKED_WRITE
 #define MASKED_WRITE(dst, value, mask) ((*(dst) & ~(mask)) | ((value) & (mask)))
 #endif
@@ -58,6 +60,11 @@ extern void (*writememb[0x10000])(void);
 extern void (*writememh[0x10000])(void);
 extern void (*writememd[0x10000])(void);
 
+/* host address of each 64KB region that is plain RDRAM, NULL where the
+ * handlers above must be used (I/O, framebuffers protected by the video
+ * plugin, TLB mapped segments, memory breakpoints). */
+extern uint8_t *mem_base[0x10000];
+
 #ifdef MSB_FIRST
 #define sl(mot) mot
 #define S8 0
@@ -77,6 +84,129 @@ extern void (*writememd[0x10000])(void);
 #define Sh16 1
 #endif
 
+/* Loads and stores with explicit operands, for the interpreters.  RDRAM is
+ * accessed through mem_base, anything else through the handler tables.
+ * Either way 'address' is left as the handlers leave it: 0 after a TLB
+ * miss, in which case the loads return 0 and do not touch *value. */
+static INLINE int mem_read8(uint32_t addr, uint64_t* value)
+{
+   const uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      *value = base[(addr & 0xffff) ^ S8];
+      return 1;
+   }
+   rdword = value;
+   readmemb[addr >> 16]();
+   return address != 0;
+}
+
+static INLINE int mem_read16(uint32_t addr, uint64_t* value)
+{
+   const uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      *value = *(const uint16_t*)(base + ((addr & 0xfffe) ^ S16));
+      return 1;
+   }
+   rdword = value;
+   readmemh[addr >> 16]();
+   return address != 0;
+}
+
+static INLINE int mem_read32(uint32_t addr, uint64_t* value)
+{
+   const uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      *value = *(const uint32_t*)(base + (addr & 0xfffc));
+      return 1;
+   }
+   rdword = value;
+   readmem[addr >> 16]();
+   return address != 0;
+}
+
+static INLINE int mem_read64(uint32_t addr, uint64_t* value)
+{
+   const uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      const uint32_t* w = (const uint32_t*)(base + (addr & 0xfffc));
+      *value = ((uint64_t)w[0] << 32) | w[1];
+      return 1;
+   }
+   rdword = value;
+   readmemd[addr >> 16]();
+   return address != 0;
+}
+
+static INLINE void mem_write8(uint32_t addr, uint8_t value)
+{
+   uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      base[(addr & 0xffff) ^ S8] = value;
+      return;
+   }
+   cpu_byte = value;
+   writememb[addr >> 16]();
+}
+
+static INLINE void mem_write16(uint32_t addr, uint16_t value)
+{
+   uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      *(uint16_t*)(base + ((addr & 0xfffe) ^ S16)) = value;
+      return;
+   }
+   cpu_hword = value;
+   writememh[addr >> 16]();
+}
+
+static INLINE void mem_write32(uint32_t addr, uint32_t value)
+{
+   uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      *(uint32_t*)(base + (addr & 0xfffc)) = value;
+      return;
+   }
+   cpu_word = value;
+   writemem[addr >> 16]();
+}
+
+static INLINE void mem_write64(uint32_t addr, uint64_t value)
+{
+   uint8_t* base = mem_base[addr >> 16];
+
+   address = addr;
+   if (base)
+   {
+      uint32_t* w = (uint32_t*)(base + (addr & 0xfffc));
+      w[0] = (uint32_t)(value >> 32);
+      w[1] = (uint32_t)value;
+      return;
+   }
+   cpu_dword = value;
+   writememd[addr >> 16]();
+}
+
 
 int init_memory(void);
 
@@ -23,6 +23,7 @@
 #include "api/libretro.h"
 #include "ai/ai_controller.h"
 #include "main/main.h"
+#include "main/profile.h"
 #include "main/rom.h"
 #include "plugin/plugin.h"
 #include "ri/ri_controller.h"
@@ -39,6 +40,7 @@
 
 extern retro_audio_sample_batch_t audio_batch_cb;
 
+#include "audio_plugin.h"
 #include "audio_resampler_driver.h"
 
 static unsigned MAX_AUDIO_FRAMES = 2048;
@@ -59,6 +61,13 @@ static float *audio_in_buffer_float;
 static float *audio_out_buffer_float;
 static int16_t *audio_out_buffer_s16;
 
+/* while batching, the samples of a whole retro_run are resampled and
+ * pushed at once by flush_audio_libretro */
+static bool audio_batching;
+static int16_t *audio_batch_buffer;
+static size_t audio_batch_frames;
+static size_t audio_batch_capacity;
+
 void (*audio_convert_s16_to_float_arm)(float *out,
       const int16_t *in, size_t samples, float gain);
 void (*audio_convert_float_to_s16_arm)(int16_t *out,
@@ -75,6 +84,12 @@ void deinit_audio_libretro(void)
       free(audio_out_buffer_float);
       free(audio_out_buffer_s16);
    }
+
+   free(audio_batch_buffer);
+   audio_batch_buffer   = NULL;
+   audio_batch_frames   = 0;
+   audio_batch_capacity = 0;
+   audio_batching       = false;
 }
 
 void init_audio_libretro(unsigned max_audio_frames)
@@ -115,44 +130,18 @@ void set_audio_format_via_libretro(void* user_data,
    g_ai.regs[AI_DACRATE_REG] = saved_ai_dacrate;
 }
 
-/* Abuse core & audio plugin implementation details to obtain the desired effect. */
-void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t size)
+static void resample_and_push(int16_t *raw_data, size_t frames)
 {
    int16_t *out;
    size_t max_frames, remain_frames;
-   uint32_t i;
    double ratio;
    struct resampler_data data = {0};
-   int16_t *raw_data = (int16_t*)buffer;
-   size_t frames     = size / 4;
-   uint8_t *p        = (uint8_t*)buffer;
-
-   /* save registers values */
-   uint32_t saved_ai_length = g_ai.regs[AI_LEN_REG];
-   uint32_t saved_ai_dram = g_ai.regs[AI_DRAM_ADDR_REG];
-
-   /* notify plugin of new samples to play.
-    * Exploit the fact that buffer points in g_rdram to retreive dram_addr_reg value */
-   g_ai.regs[AI_DRAM_ADDR_REG] = (uint8_t*)buffer - (uint8_t*)g_rdram;
-   g_ai.regs[AI_LEN_REG] = size;
-
-   for (i = 0; i < size; i += 4)
-   {
-      p[i ] ^= p[i + 2];
-      p[i + 2] ^= p[i ];
-      p[i ] ^= p[i + 2];
-      p[i + 1] ^= p[i + 3];
-      p[i + 3] ^= p[i + 1];
-      p[i + 1] ^= p[i + 3];
-   }
 
 audio_batch:
    out               = NULL;
    ratio             = 44100.0 / GameFreq;
    max_frames        = (GameFreq > 44100) ? MAX_AUDIO_FRAMES : (size_t)(MAX_AUDIO_FRAMES / ratio - 1);
    remain_frames     = 0;
-   if (no_audio)
-      return;
 
    if (frames > max_frames)
    {
@@ -165,9 +154,11 @@ audio_batch:
    data.input_frames = frames;
    data.ratio        = ratio;
 
+   timed_section_start(TIMED_SECTION_AUDIO_RESAMPLE);
    convert_s16_to_float(audio_in_buffer_float, raw_data, frames * 2, 1.0f);
    resampler->process(resampler_audio_data, &data);
    convert_float_to_s16(audio_out_buffer_s16, audio_out_buffer_float, data.output_frames * 2);
+   timed_section_end(TIMED_SECTION_AUDIO_RESAMPLE);
 
    out                    = audio_out_buffer_s16;
 
@@ -183,6 +174,84 @@ audio_batch:
       frames   = remain_frames;
       goto audio_batch;
    }
+}
+
+void flush_audio_libretro(void)
+{
+   if (audio_batch_frames)
+   {
+      resample_and_push(audio_batch_buffer, audio_batch_frames);
+      audio_batch_frames = 0;
+   }
+}
+
+static void append_to_batch(const int16_t *raw_data, size_t frames)
+{
+   if (audio_batch_frames + frames > audio_batch_capacity)
+   {
+      size_t capacity = audio_batch_capacity ? audio_batch_capacity : MAX_AUDIO_FRAMES;
+      int16_t *buffer;
+
+      while (capacity < audio_batch_frames + frames)
+         capacity *= 2;
+
+      buffer = (int16_t*)realloc(audio_batch_buffer, capacity * 2 * sizeof(int16_t));
+      if (!buffer)
+      {
+         /* push what there is rather than dropping samples */
+         flush_audio_libretro();
+         resample_and_push((int16_t*)raw_data, frames);
+         return;
+      }
+      audio_batch_buffer   = buffer;
+      audio_batch_capacity = capacity;
+   }
+
+   memcpy(audio_batch_buffer + audio_batch_frames * 2, raw_data, frames * 2 * sizeof(int16_t));
+   audio_batch_frames += frames;
+}
+
+void set_audio_batching_libretro(bool enable)
+{
+   if (!enable)
+      flush_audio_libretro();
+   audio_batching = enable;
+}
+
+/* Abuse core & audio plugin implementation details to obtain the desired effect. */
+void push_audio_samples_via_libretro(void* user_data, const void* buffer, size_t size)
+{
+   uint32_t i;
+   int16_t *raw_data = (int16_t*)buffer;
+   size_t frames     = size / 4;
+   uint8_t *p        = (uint8_t*)buffer;
+
+   /* save registers values */
+   uint32_t saved_ai_length = g_ai.regs[AI_LEN_REG];
+   uint32_t saved_ai_dram = g_ai.regs[AI_DRAM_ADDR_REG];
+
+   /* notify plugin of new samples to play.
+    * Exploit the fact that buffer points in g_rdram to retreive dram_addr_reg value */
+   g_ai.regs[AI_DRAM_ADDR_REG] = (uint8_t*)buffer - (uint8_t*)g_rdram;
+   g_ai.regs[AI_LEN_REG] = size;
+
+   for (i = 0; i < size; i += 4)
+   {
+      p[i ] ^= p[i + 2];
+      p[i + 2] ^= p[i ];
+      p[i ] ^= p[i + 2];
+      p[i + 1] ^= p[i + 3];
+      p[i + 3] ^= p[i + 1];
+      p[i + 1] ^= p[i + 3];
+   }
+
+   if (no_audio)
+      return;
+
+   if (audio_batching)
+      append_to_batch(raw_data, frames);
+   else
+      resample_and_push(raw_data, frames);
 
    /* restore original registers vlaues */
    g_ai.regs[AI_LEN_REG]       = saved_ai_length;
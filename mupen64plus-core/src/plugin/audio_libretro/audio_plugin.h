@@ -23,8 +23,14 @@
 #define M64P_PLUGIN_EMULATE_SPEAKER_VIA_LIBRETRO_H
 
 #include <stddef.h>
+#include <boolean.h>
 
 void init_audio_libretro(unsigned max_frames);
 void deinit_audio_libretro(void);
 
+/* Collects the samples until flush_audio_libretro instead of resampling and
+ * pushing them as the game plays them. */
+void set_audio_batching_libretro(bool enable);
+void flush_audio_libretro(void);
+
 #endif
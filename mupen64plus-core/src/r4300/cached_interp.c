@@ -26,6 +26,8 @@
 #include <inttypes.h>
 #include <string.h>
 
+#include <encodings/crc32.h>
+
 #include "api/callbacks.h"
 #include "api/debugger.h"
 #include "api/m64p_types.h"
@@ -146,9 +148,13 @@ uint32_t jump_to_address;
 
 #define CHECK_MEMORY() \
    if (!invalid_code[address>>12]) \
+   { \
       if (blocks[address>>12]->block[(address&0xFFF)/4].ops != \
           current_instruction_table.NOTCOMPILED) \
-         invalid_code[address>>12] = 1;
+         invalidate_cached_subpage(address); \
+   } \
+   else if (blocks[address>>12] != NULL && blocks[address>>12]->dirty_subpages) \
+      invalidate_cached_subpage(address);
 
 // two functions are defined from the macros above but never used
 // these prototype declarations will prevent a warning
@@ -230,6 +236,55 @@ static void NOTCOMPILED2(void)
    NOTCOMPILED();
 }
 
+// -----------------------------------------------------------
+// Fused instructions
+// -----------------------------------------------------------
+/* A fused handler runs two consecutive instructions without going back
+ * through the dispatch loop. The second instruction keeps its own handler
+ * so that jumping to it still works. */
+#define DECLARE_FUSED(first, second) \
+   static void first##_##second(void) \
+   { \
+      first(); \
+      second(); \
+   }
+
+/* constant materialization */
+DECLARE_FUSED(LUI, ORI)
+DECLARE_FUSED(LUI, ADDIU)
+
+/* memory access relative to an upper immediate */
+DECLARE_FUSED(LUI, LB)
+DECLARE_FUSED(LUI, LBU)
+DECLARE_FUSED(LUI, LH)
+DECLARE_FUSED(LUI, LHU)
+DECLARE_FUSED(LUI, LW)
+DECLARE_FUSED(LUI, SB)
+DECLARE_FUSED(LUI, SH)
+DECLARE_FUSED(LUI, SW)
+DECLARE_FUSED(LUI, LWC1)
+DECLARE_FUSED(LUI, SWC1)
+
+/* compare and branch */
+#define DECLARE_FUSED_BRANCHES(first) \
+   DECLARE_FUSED(first, BEQ) \
+   DECLARE_FUSED(first, BEQ_OUT) \
+   DECLARE_FUSED(first, BNE) \
+   DECLARE_FUSED(first, BNE_OUT)
+
+DECLARE_FUSED_BRANCHES(ADDIU)
+DECLARE_FUSED_BRANCHES(ANDI)
+DECLARE_FUSED_BRANCHES(SLTI)
+DECLARE_FUSED_BRANCHES(SLTIU)
+DECLARE_FUSED_BRANCHES(SLT)
+DECLARE_FUSED_BRANCHES(SLTU)
+
+/* run of NOPs, the length is stored in the immediate field of the first one */
+static void NOP_RUN(void)
+{
+   PC += PC->f.i.immediate;
+}
+
 // -----------------------------------------------------------
 // Cached interpreter instruction table
 // -----------------------------------------------------------
@@ -512,12 +567,273 @@ const cpu_instruction_table cached_interpreter_table = {
    NOTCOMPILED2
 };
 
+/* Sub-page tracking
+ *
+ * Every 4KB block is split in SUBPAGE_COUNT sub-pages. When a sub-page gets
+ * compiled, a CRC of its content is recorded; stores hitting compiled code
+ * flag their sub-page as dirty on top of invalidating the block. When the
+ * block is entered again, only the dirty sub-pages whose content changed are
+ * sent back to NOTCOMPILED, the rest of the block is kept as is.
+ *
+ * A block invalidated without any dirty sub-page (alias propagation,
+ * invalidate everything, TLB...) has all of its hashed sub-pages checked.
+ */
+static uint32_t hash_subpage(const uint32_t *page, unsigned int subpage)
+{
+   /* the decoding of the last instruction peeks at the following one */
+   size_t words = SUBPAGE_WORDS + (subpage + 1 < SUBPAGE_COUNT);
+
+   return encoding_crc32(0, (const uint8_t *) (page + subpage * SUBPAGE_WORDS),
+         words * 4);
+}
+
+void hash_compiled_subpages(precomp_block *block, const uint32_t *source,
+                            unsigned int first, unsigned int last)
+{
+   unsigned int i;
+
+   for (i = first; i <= last && i < SUBPAGE_COUNT; i++)
+   {
+      uint16_t bit = 1 << i;
+      uint32_t crc = hash_subpage(source, i);
+
+      if (!(block->hashed_subpages & bit))
+      {
+         block->subpage_crc[i] = crc;
+         block->hashed_subpages |= bit;
+      }
+      else if (block->subpage_crc[i] != crc)
+      {
+         /* some instructions of this sub-page were compiled from a different
+          * content, the hash can't tell anymore if they're up to date. */
+         block->stale_subpages |= bit;
+      }
+   }
+}
+
+void invalidate_cached_subpage(uint32_t address)
+{
+   precomp_block *block = blocks[address>>12];
+   uint16_t bit = 1 << ((address & 0xFFF) >> SUBPAGE_SHIFT);
+
+   /* the previous sub-page hash covers the first word of this one */
+   if ((address & ((1 << SUBPAGE_SHIFT) - 1)) < 4)
+      bit |= bit >> 1;
+
+   if (!invalid_code[address>>12])
+   {
+      invalid_code[address>>12] = 1;
+      block->dirty_subpages = bit;
+      block->invalidations++;
+   }
+   else if (block->dirty_subpages)
+      block->dirty_subpages |= bit;
+}
+
+#define FUSED(first, second) { first, second, first##_##second }
+#define FUSED_BRANCHES(first) \
+   FUSED(first, BEQ), FUSED(first, BEQ_OUT), FUSED(first, BNE), FUSED(first, BNE_OUT)
+
+static const struct
+{
+   void (*first)(void);
+   void (*second)(void);
+   void (*fused)(void);
+} fused_pairs[] =
+{
+   FUSED(LUI, ORI), FUSED(LUI, ADDIU),
+   FUSED(LUI, LB), FUSED(LUI, LBU), FUSED(LUI, LH), FUSED(LUI, LHU), FUSED(LUI, LW),
+   FUSED(LUI, SB), FUSED(LUI, SH), FUSED(LUI, SW), FUSED(LUI, LWC1), FUSED(LUI, SWC1),
+   FUSED_BRANCHES(ADDIU), FUSED_BRANCHES(ANDI), FUSED_BRANCHES(SLTI),
+   FUSED_BRANCHES(SLTIU), FUSED_BRANCHES(SLT), FUSED_BRANCHES(SLTU)
+};
+
+/* Tells if an opcode has a delay slot. */
+static int is_branch_opcode(uint32_t op)
+{
+   switch (op >> 26)
+   {
+      case 0x00: /* SPECIAL: JR, JALR */
+         return (op & 0x3E) == 0x08;
+      case 0x01: /* REGIMM: BLTZ(L), BGEZ(L), BLTZAL(L), BGEZAL(L) */
+         return ((op >> 16) & 0x0C) == 0;
+      case 0x11: /* COP1: BC1 */
+         return ((op >> 21) & 0x1F) == 0x08;
+      case 0x02: case 0x03: case 0x04: case 0x05: case 0x06: case 0x07:
+      case 0x14: case 0x15: case 0x16: case 0x17:
+         return 1;
+      default:
+         return 0;
+   }
+}
+
+void fuse_compiled_instructions(precomp_block *block, const uint32_t *source,
+                                unsigned int first, unsigned int end)
+{
+   unsigned int i, j, k;
+   precomp_instr *inst = block->block;
+
+#ifdef DBG
+   /* the debugger needs to see every instruction */
+   if (g_DebuggerActive)
+      return;
+#endif
+
+   for (i = first; i + 1 < end; i++)
+   {
+      /* An instruction in a delay slot is executed by its branch, which
+       * resumes at the jump target: it must stay on its own. If the
+       * previous instruction wasn't compiled along with this one, it has
+       * to be NOTCOMPILED (its recompilation will overwrite this one). */
+      if (i > 0)
+      {
+         if (i == first)
+         {
+            if (inst[i-1].ops != cached_interpreter_table.NOTCOMPILED)
+               continue;
+         }
+         else if (is_branch_opcode(source[i-1]))
+            continue;
+      }
+
+      if (inst[i].ops == NOP)
+      {
+         /* a run stays in its sub-page, the next one can be sent back to
+          * NOTCOMPILED on its own */
+         unsigned int run_end = (i / SUBPAGE_WORDS + 1) * SUBPAGE_WORDS;
+
+         if (run_end > end)
+            run_end = end;
+         for (j = i + 1; j < run_end && inst[j].ops == NOP; j++);
+         if (j - i >= 2)
+         {
+            inst[i].ops = NOP_RUN;
+            inst[i].f.i.immediate = (short) (j - i);
+         }
+         continue;
+      }
+
+      for (k = 0; k < sizeof(fused_pairs) / sizeof(fused_pairs[0]); k++)
+      {
+         if (inst[i].ops == fused_pairs[k].first && inst[i+1].ops == fused_pairs[k].second)
+         {
+            inst[i].ops = fused_pairs[k].fused;
+            break;
+         }
+      }
+   }
+}
+
+/* Keeps the dirty sub-pages of two KSEG0/KSEG1 aliases in sync when
+ * update_invalid_addr() propagates an invalidation between them. */
+static void merge_dirty_subpages(uint32_t addr, uint32_t alt_addr, int was_invalid, int alt_was_invalid)
+{
+   precomp_block *block = blocks[addr>>12];
+   precomp_block *alt_block = blocks[alt_addr>>12];
+   uint16_t dirty = block ? block->dirty_subpages : 0;
+   uint16_t alt_dirty = alt_block ? alt_block->dirty_subpages : 0;
+
+   if (was_invalid && alt_was_invalid)
+      dirty = alt_dirty = (dirty && alt_dirty) ? (dirty | alt_dirty) : 0;
+   else if (was_invalid)
+      alt_dirty = dirty;
+   else if (alt_was_invalid)
+      dirty = alt_dirty;
+
+   if (block) block->dirty_subpages = dirty;
+   if (alt_block) alt_block->dirty_subpages = alt_dirty;
+}
+
+/* Sends the changed sub-pages of an invalid block back to NOTCOMPILED.
+ * Returns 0 if the block has to be fully reinitialized instead. */
+static int revalidate_block(precomp_block *block)
+{
+   unsigned int i, j;
+   uint16_t check;
+   const uint32_t *mem;
+
+   if (block == NULL || block->block == NULL)
+      return 0;
+
+   mem = fast_mem_access(block->start);
+   if (mem == NULL)
+      return 0;
+
+   check = block->dirty_subpages ? block->dirty_subpages : 0xFFFF;
+   check &= block->hashed_subpages;
+
+   for (i = 0; i < SUBPAGE_COUNT; i++)
+   {
+      uint16_t bit = 1 << i;
+
+      if (!(check & bit))
+         continue;
+
+      if (!(block->stale_subpages & bit) && block->subpage_crc[i] == hash_subpage(mem, i))
+         continue;
+
+      for (j = i * SUBPAGE_WORDS; j < (i + 1) * SUBPAGE_WORDS; j++)
+         block->block[j].ops = current_instruction_table.NOTCOMPILED;
+
+      block->hashed_subpages &= ~bit;
+      block->stale_subpages &= ~bit;
+      block->retranslations++;
+   }
+
+   block->dirty_subpages = 0;
+   invalid_code[block->start>>12] = 0;
+   return 1;
+}
+
+static int revalidate_page(uint32_t addr)
+{
+   uint32_t alt_addr = addr ^ 0x20000000;
+
+   /* TLB mapped pages and dynarec code always take the init_block() path */
+   if (r4300emu != CORE_INTERPRETER || addr < 0x80000000 || addr >= 0xc0000000)
+      return 0;
+
+   if (!revalidate_block(blocks[addr>>12]))
+      return 0;
+
+   if (invalid_code[alt_addr>>12] && !revalidate_block(blocks[alt_addr>>12]))
+   {
+      precomp_block *alt_block = get_precomp_block(alt_addr);
+      alt_block->start = alt_addr & ~0xFFF;
+      alt_block->end = (alt_addr & ~0xFFF) + 0x1000;
+      init_block(alt_block);
+   }
+
+   return 1;
+}
+
+precomp_block *get_precomp_block(uint32_t address)
+{
+   precomp_block *block = blocks[address>>12];
+
+   if (block == NULL)
+   {
+      block = (precomp_block *) calloc(1, sizeof(precomp_block));
+      block->start = address & ~UINT32_C(0xFFF);
+      block->end = (address & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
+      blocks[address>>12] = block;
+   }
+
+   return block;
+}
+
 static unsigned int update_invalid_addr(unsigned int addr)
 {
    if (addr >= 0x80000000 && addr < 0xc0000000)
    {
-      if (invalid_code[addr>>12]) invalid_code[(addr^0x20000000)>>12] = 1;
-      if (invalid_code[(addr^0x20000000)>>12]) invalid_code[addr>>12] = 1;
+      unsigned int alt_addr = addr ^ 0x20000000;
+      int was_invalid = invalid_code[addr>>12];
+      int alt_was_invalid = invalid_code[alt_addr>>12];
+
+      if (invalid_code[addr>>12]) invalid_code[alt_addr>>12] = 1;
+      if (invalid_code[alt_addr>>12]) invalid_code[addr>>12] = 1;
+      if (was_invalid || alt_was_invalid)
+         merge_dirty_subpages(addr, alt_addr, was_invalid, alt_was_invalid);
       return addr;
    }
    else
@@ -543,22 +859,14 @@ void jump_to_func(void)
    if (skip_jump) return;
    paddr = update_invalid_addr(addr);
    if (!paddr) return;
-   actual = blocks[addr>>12];
-   if (invalid_code[addr>>12])
+   if (invalid_code[addr>>12] && !revalidate_page(addr))
    {
-      if (!blocks[addr>>12])
-      {
-         blocks[addr>>12] = (precomp_block *) malloc(sizeof(precomp_block));
-         actual = blocks[addr>>12];
-         blocks[addr>>12]->code = NULL;
-         blocks[addr>>12]->block = NULL;
-         blocks[addr>>12]->jumps_table = NULL;
-         blocks[addr>>12]->riprel_table = NULL;
-      }
-      blocks[addr>>12]->start = addr & ~0xFFF;
-      blocks[addr>>12]->end = (addr & ~0xFFF) + 0x1000;
-      init_block(blocks[addr>>12]);
+      precomp_block *block = get_precomp_block(addr);
+      block->start = addr & ~0xFFF;
+      block->end = (addr & ~0xFFF) + 0x1000;
+      init_block(block);
    }
+   actual = blocks[addr>>12];
    PC=actual->block+((addr-actual->start)>>2);
 
    if (r4300emu == CORE_DYNAREC) dyna_jump();
@@ -578,15 +886,21 @@ void init_blocks(void)
 void free_blocks(void)
 {
    int i;
+   unsigned int invalidations = 0;
+   unsigned int retranslations = 0;
    for (i=0; i<0x100000; i++)
    {
       if (blocks[i])
       {
+         invalidations += blocks[i]->invalidations;
+         retranslations += blocks[i]->retranslations;
          free_block(blocks[i]);
          free(blocks[i]);
          blocks[i] = NULL;
       }
    }
+   DebugMessage(M64MSG_VERBOSE, "Cached interpreter: %u block invalidations, %u sub-pages retranslated",
+         invalidations, retranslations);
 }
 
 void invalidate_cached_code_hacktarux(uint32_t address, size_t size)
@@ -599,6 +913,11 @@ void invalidate_cached_code_hacktarux(uint32_t address, size_t size)
    {
       /* invalidate everthing */
       memset(invalid_code, 1, 0x100000);
+      for (i = 0; i < 0x100000; i++)
+      {
+         if (blocks[i])
+            blocks[i]->dirty_subpages = 0;
+      }
    }
    else
    {
@@ -609,24 +928,25 @@ void invalidate_cached_code_hacktarux(uint32_t address, size_t size)
       {
          i = (addr >> 12);
 
-         if (invalid_code[i] == 0)
+         if (blocks[i] == NULL)
+         {
+            invalid_code[i] = 1;
+            /* go directly to next i */
+            addr |= 0xffc;
+         }
+         else if ((invalid_code[i] == 0
+                  && blocks[i]->block[(addr & 0xfff) / 4].ops != current_instruction_table.NOTCOMPILED)
+               || (invalid_code[i] != 0 && blocks[i]->dirty_subpages))
          {
-            if (blocks[i] == NULL
-                  || blocks[i]->block[(addr & 0xfff) / 4].ops != current_instruction_table.NOTCOMPILED)
-            {
-               invalid_code[i] = 1;
-               /* go directly to next i */
-               addr &= ~0xfff;
-               addr |= 0xffc;
-            }
+            invalidate_cached_subpage(addr);
+            /* go directly to next sub-page */
+            addr |= (1 << SUBPAGE_SHIFT) - 4;
          }
-         else
+         else if (invalid_code[i] != 0)
          {
             /* go directly to next i */
-            addr &= ~0xfff;
             addr |= 0xffc;
          }
       }
    }
 }
-
@@ -39,6 +39,22 @@ void init_blocks(void);
 void free_blocks(void);
 void jump_to_func(void);
 
+/* Returns the block covering the given address, allocating it on first use. */
+precomp_block *get_precomp_block(uint32_t address);
+
+/* Records the content hash of the sub-pages [first, last] of a block
+ * which have just been compiled from 'source'. */
+void hash_compiled_subpages(precomp_block *block, const uint32_t *source,
+                            unsigned int first, unsigned int last);
+
+/* Replaces common instruction sequences of the range [first, end) of a
+ * block, which has just been compiled from 'source', by fused handlers. */
+void fuse_compiled_instructions(precomp_block *block, const uint32_t *source,
+                                unsigned int first, unsigned int end);
+
+/* Flags the sub-page holding 'address' as overwritten. */
+void invalidate_cached_subpage(uint32_t address);
+
 void invalidate_cached_code_hacktarux(uint32_t address, size_t size);
 
 /* Jumps to the given address. This is for the cached interpreter / dynarec. */
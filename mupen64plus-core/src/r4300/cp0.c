@@ -23,6 +23,7 @@
 
 #include "cp0_private.h"
 #include "exception.h"
+#include "main/profile.h"
 #include "new_dynarec/new_dynarec.h"
 #include "r4300.h"
 #include "recomp.h"
@@ -62,6 +63,7 @@ void cp0_update_count(void)
    if (r4300emu != CORE_DYNAREC)
    {
 #endif
+      timed_sections_count_instructions((PC->addr - last_addr) >> 2);
       g_cp0_regs[CP0_COUNT_REG] += ((PC->addr - last_addr) >> 2) * count_per_op;
       last_addr = PC->addr;
 #ifdef NEW_DYNAREC
@@ -0,0 +1,204 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - event_queue.c                                           *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *   Copyright (C) 2002 Hacktarux                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "event_queue.h"
+
+#include "interupt.h"
+
+
+/* node allocation/deallocation on a given pool */
+static struct node* alloc_node(struct pool* p)
+{
+    /* return NULL if pool is too small */
+    if (p->index >= POOL_CAPACITY)
+        return NULL;
+
+    return p->stack[p->index++];
+}
+
+static void free_node(struct pool* p, struct node* node)
+{
+    if (p->index == 0 || node == NULL)
+        return;
+
+    p->stack[--p->index] = node;
+}
+
+/* release all nodes */
+static void clear_pool(struct pool* p)
+{
+    size_t i;
+
+    for(i = 0; i < POOL_CAPACITY; ++i)
+        p->stack[i] = &p->nodes[i];
+
+    p->index = 0;
+}
+
+
+void clear_queue(struct interrupt_queue* q)
+{
+    q->first = NULL;
+    clear_pool(&q->pool);
+}
+
+struct node* find_event(const struct interrupt_queue* q, int type)
+{
+    struct node* e;
+
+    for(e = q->first; e != NULL && e->data.type != type; e = e->next);
+
+    return e;
+}
+
+
+static int before_event(unsigned int evt1, unsigned int evt2, int type2,
+                        unsigned int now, int special_done)
+{
+    if(evt1 - now < UINT32_C(0x80000000))
+    {
+        if(evt2 - now < UINT32_C(0x80000000))
+        {
+            if((evt1 - now) < (evt2 - now)) return 1;
+            else return 0;
+        }
+        else
+        {
+            if((now - evt2) < UINT32_C(0x10000000))
+            {
+                switch(type2)
+                {
+                    case SPECIAL_INT:
+                        if(special_done) return 1;
+                        else return 0;
+                        break;
+                    default:
+                        return 0;
+                }
+            }
+            else return 1;
+        }
+    }
+    else return 0;
+}
+
+int insert_event(struct interrupt_queue* q, int type, unsigned int count,
+                 unsigned int now, int special_done)
+{
+    struct node* event;
+    struct node* e;
+    int special = (type == SPECIAL_INT);
+
+    /* a pending event at count 0 doesn't count, as get_event returns 0 */
+    e = find_event(q, type);
+    if (e != NULL && e->data.count != 0)
+        return EVENT_DUPLICATE;
+
+    event = alloc_node(&q->pool);
+    if (event == NULL)
+        return EVENT_QUEUE_FULL;
+
+    event->data.count = count;
+    event->data.type = type;
+
+    if (q->first == NULL)
+    {
+        q->first = event;
+        event->next = NULL;
+        return EVENT_INSERTED_FIRST;
+    }
+    else if (before_event(count, q->first->data.count, q->first->data.type, now, special_done) && !special)
+    {
+        event->next = q->first;
+        q->first = event;
+        return EVENT_INSERTED_FIRST;
+    }
+
+    for(e = q->first;
+        e->next != NULL &&
+        (!before_event(count, e->next->data.count, e->next->data.type, now, special_done) || special);
+        e = e->next);
+
+    if (e->next != NULL && !special)
+        for(; e->next != NULL && e->next->data.count == count; e = e->next);
+
+    event->next = e->next;
+    e->next = event;
+    return EVENT_INSERTED;
+}
+
+int push_event(struct interrupt_queue* q, int type, unsigned int count)
+{
+    struct node* event = alloc_node(&q->pool);
+
+    if (event == NULL)
+        return EVENT_QUEUE_FULL;
+
+    event->data.count = count;
+    event->data.type = type;
+    event->next = q->first;
+    q->first = event;
+    return EVENT_INSERTED_FIRST;
+}
+
+void pop_event(struct interrupt_queue* q)
+{
+    struct node* e = q->first;
+
+    q->first = e->next;
+    free_node(&q->pool, e);
+}
+
+void remove_event_type(struct interrupt_queue* q, int type)
+{
+    struct node* to_del;
+    struct node* e = q->first;
+
+    if (e == NULL)
+        return;
+
+    if (e->data.type == type)
+    {
+        q->first = e->next;
+        free_node(&q->pool, e);
+    }
+    else
+    {
+        for(; e->next != NULL && e->next->data.type != type; e = e->next);
+
+        if (e->next != NULL)
+        {
+            to_del = e->next;
+            e->next = to_del->next;
+            free_node(&q->pool, to_del);
+        }
+    }
+}
+
+void rebase_events(struct interrupt_queue* q, unsigned int now, unsigned int base)
+{
+    struct node* e;
+
+    for(e = q->first; e != NULL; e = e->next)
+    {
+        e->data.count = (e->data.count - now) + base;
+    }
+}
@@ -0,0 +1,118 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *   Mupen64plus - event_queue.h                                           *
+ *   Mupen64Plus homepage: http://code.google.com/p/mupen64plus/           *
+ *   Copyright (C) 2002 Hacktarux                                          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef M64P_R4300_EVENT_QUEUE_H
+#define M64P_R4300_EVENT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The interrupt event queue of interupt.c. It doesn't depend on the rest of
+ * the core, so that tools/interupt-bench can replay recorded traces on it:
+ * the Count register and the SPECIAL_INT state are passed in. */
+
+struct interrupt_event
+{
+    int type;
+    unsigned int count;
+};
+
+
+/***************************************************************************
+ * Pool of Single Linked List Nodes
+ **************************************************************************/
+#define POOL_CAPACITY 16
+
+struct node
+{
+    struct interrupt_event data;
+    struct node *next;
+};
+
+struct pool
+{
+    struct node nodes[POOL_CAPACITY];
+    struct node* stack[POOL_CAPACITY];
+    size_t index;
+};
+
+/***************************************************************************
+ * Interrupt Queue
+ *
+ * Events are kept in a singly linked list ordered by trigger count. The
+ * queue holds 8 events or fewer, so walking it beats any index kept next
+ * to it (see tools/interupt-bench).
+ **************************************************************************/
+
+struct interrupt_queue
+{
+    struct pool pool;
+    struct node* first;
+};
+
+/* results of insert_event */
+enum
+{
+    EVENT_INSERTED = 0,
+    EVENT_INSERTED_FIRST = 1,
+    EVENT_DUPLICATE = -1,
+    EVENT_QUEUE_FULL = -2
+};
+
+void clear_queue(struct interrupt_queue* q);
+
+/* inserts in trigger order, unless an event of this type is pending */
+int insert_event(struct interrupt_queue* q, int type, unsigned int count,
+                 unsigned int now, int special_done);
+/* inserts at the head of the queue, whatever its count */
+int push_event(struct interrupt_queue* q, int type, unsigned int count);
+void pop_event(struct interrupt_queue* q);
+
+struct node* find_event(const struct interrupt_queue* q, int type);
+void remove_event_type(struct interrupt_queue* q, int type);
+
+/* moves all the events from the Count 'now' to 'base' */
+void rebase_events(struct interrupt_queue* q, unsigned int now, unsigned int base);
+
+
+/* Queue operations as recorded by the PERF_TEST builds and replayed by
+ * tools/interupt-bench, in host byte order. */
+enum event_queue_op
+{
+    EVENT_QUEUE_CLEAR,
+    EVENT_QUEUE_INSERT,
+    EVENT_QUEUE_PUSH,
+    EVENT_QUEUE_POP,
+    EVENT_QUEUE_FIND,
+    EVENT_QUEUE_REMOVE,
+    EVENT_QUEUE_REBASE
+};
+
+struct event_queue_record
+{
+    uint8_t op;
+    uint8_t special_done;
+    uint16_t type;
+    uint32_t count;     /* trigger count, or the base of EVENT_QUEUE_REBASE */
+    uint32_t now;       /* Count register */
+};
+
+#endif /* M64P_R4300_EVENT_QUEUE_H */
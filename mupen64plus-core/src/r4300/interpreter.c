@@ -168,16 +168,11 @@ DECLARE_INSTRUCTION(LDL)
    ADD_TO_PC(1);
    if ((lsaddr & 7) == 0)
    {
-     address = lsaddr;
-     rdword = (uint64_t*) lsrtp;
-     read_dword_in_memory();
+     mem_read64(lsaddr, (uint64_t*) lsrtp);
    }
    else
    {
-     address = lsaddr & UINT32_C(0xFFFFFFF8);
-     rdword = &word;
-     read_dword_in_memory();
-     if (address)
+     if (mem_read64(lsaddr & UINT32_C(0xFFFFFFF8), &word))
      {
        /* How many low bits do we want to preserve from the old value? */
        uint64_t old_mask = BITS_BELOW_MASK64((lsaddr & 7) * 8);
@@ -194,17 +189,13 @@ DECLARE_INSTRUCTION(LDR)
    int64_t *lsrtp = &irt;
    uint64_t word = 0;
    ADD_TO_PC(1);
-   address = lsaddr & UINT32_C(0xFFFFFFF8);
    if ((lsaddr & 7) == 7)
    {
-     rdword = (uint64_t*) lsrtp;
-     read_dword_in_memory();
+     mem_read64(lsaddr & UINT32_C(0xFFFFFFF8), (uint64_t*) lsrtp);
    }
    else
    {
-     rdword = &word;
-     read_dword_in_memory();
-     if (address)
+     if (mem_read64(lsaddr & UINT32_C(0xFFFFFFF8), &word))
      {
        /* How many high bits do we want to preserve from the old value? */
        uint64_t old_mask = BITS_ABOVE_MASK64(((lsaddr & 7) + 1) * 8);
@@ -220,10 +211,7 @@ DECLARE_INSTRUCTION(LB)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_byte_in_memory();
-   if (address)
+   if (mem_read8(lsaddr, (uint64_t*) lsrtp))
      *lsrtp = SE8(*lsrtp);
 }
 
@@ -232,10 +220,7 @@ DECLARE_INSTRUCTION(LH)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_hword_in_memory();
-   if (address)
+   if (mem_read16(lsaddr, (uint64_t*) lsrtp))
      *lsrtp = SE16(*lsrtp);
 }
 
@@ -247,18 +232,12 @@ DECLARE_INSTRUCTION(LWL)
    ADD_TO_PC(1);
    if ((lsaddr & 3) == 0)
    {
-     address = lsaddr;
-     rdword = (uint64_t*) lsrtp;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr, (uint64_t*) lsrtp))
        *lsrtp = SE32(*lsrtp);
    }
    else
    {
-     address = lsaddr & UINT32_C(0xFFFFFFFC);
-     rdword = &word;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr & UINT32_C(0xFFFFFFFC), &word))
      {
        /* How many low bits do we want to preserve from the old value? */
        uint32_t old_mask = BITS_BELOW_MASK32((lsaddr & 3) * 8);
@@ -274,10 +253,7 @@ DECLARE_INSTRUCTION(LW)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_word_in_memory();
-   if (address)
+   if (mem_read32(lsaddr, (uint64_t*) lsrtp))
      *lsrtp = SE32(*lsrtp);
 }
 
@@ -286,9 +262,7 @@ DECLARE_INSTRUCTION(LBU)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_byte_in_memory();
+   mem_read8(lsaddr, (uint64_t*) lsrtp);
 }
 
 DECLARE_INSTRUCTION(LHU)
@@ -296,9 +270,7 @@ DECLARE_INSTRUCTION(LHU)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_hword_in_memory();
+   mem_read16(lsaddr, (uint64_t*) lsrtp);
 }
 
 DECLARE_INSTRUCTION(LWR)
@@ -307,19 +279,14 @@ DECLARE_INSTRUCTION(LWR)
    int64_t *lsrtp = &irt;
    uint64_t word = 0;
    ADD_TO_PC(1);
-   address = lsaddr & UINT32_C(0xFFFFFFFC);
    if ((lsaddr & 3) == 3)
    {
-     rdword = (uint64_t*) lsrtp;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr & UINT32_C(0xFFFFFFFC), (uint64_t*) lsrtp))
        *lsrtp = SE32(*lsrtp);
    }
    else
    {
-     rdword = &word;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr & UINT32_C(0xFFFFFFFC), &word))
      {
        /* How many high bits do we want to preserve from the old value? */
        uint32_t old_mask = BITS_ABOVE_MASK32(((lsaddr & 3) + 1) * 8);
@@ -335,9 +302,7 @@ DECLARE_INSTRUCTION(LWU)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_word_in_memory();
+   mem_read32(lsaddr, (uint64_t*) lsrtp);
 }
 
 DECLARE_INSTRUCTION(SB)
@@ -345,9 +310,7 @@ DECLARE_INSTRUCTION(SB)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   cpu_byte = (uint8_t) *lsrtp;
-   write_byte_in_memory();
+   mem_write8(lsaddr, (uint8_t) *lsrtp);
    CHECK_MEMORY();
 }
 
@@ -356,9 +319,7 @@ DECLARE_INSTRUCTION(SH)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   cpu_hword = (uint16_t) *lsrtp;
-   write_hword_in_memory();
+   mem_write16(lsaddr, (uint16_t) *lsrtp);
    CHECK_MEMORY();
 }
 
@@ -370,17 +331,12 @@ DECLARE_INSTRUCTION(SWL)
    ADD_TO_PC(1);
    if ((lsaddr & 3) == 0)
    {
-     address = lsaddr;
-     cpu_word = (uint32_t) *lsrtp;
-     write_word_in_memory();
+     mem_write32(lsaddr, (uint32_t) *lsrtp);
      CHECK_MEMORY();
    }
    else
    {
-     address = lsaddr & UINT32_C(0xFFFFFFFC);
-     rdword = &old_word;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr & UINT32_C(0xFFFFFFFC), &old_word))
      {
        /* How many high bits do we want to preserve from what was in memory
         * before? */
@@ -388,8 +344,7 @@ DECLARE_INSTRUCTION(SWL)
        /* How many bits down do we need to shift the register to store some
         * of its high bits into the low bits of the memory word? */
        int new_shift = (lsaddr & 3) * 8;
-       cpu_word = ((uint32_t) old_word & old_mask) | ((uint32_t) *lsrtp >> new_shift);
-       write_word_in_memory();
+       mem_write32(address, ((uint32_t) old_word & old_mask) | ((uint32_t) *lsrtp >> new_shift));
        CHECK_MEMORY();
      }
    }
@@ -400,9 +355,7 @@ DECLARE_INSTRUCTION(SW)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   cpu_word = (uint32_t) *lsrtp;
-   write_word_in_memory();
+   mem_write32(lsaddr, (uint32_t) *lsrtp);
    CHECK_MEMORY();
 }
 
@@ -414,17 +367,12 @@ DECLARE_INSTRUCTION(SDL)
    ADD_TO_PC(1);
    if ((lsaddr & 7) == 0)
    {
-     address = lsaddr;
-     cpu_dword = *lsrtp;
-     write_dword_in_memory();
+     mem_write64(lsaddr, *lsrtp);
      CHECK_MEMORY();
    }
    else
    {
-     address = lsaddr & UINT32_C(0xFFFFFFF8);
-     rdword = &old_word;
-     read_dword_in_memory();
-     if (address)
+     if (mem_read64(lsaddr & UINT32_C(0xFFFFFFF8), &old_word))
      {
        /* How many high bits do we want to preserve from what was in memory
         * before? */
@@ -432,8 +380,7 @@ DECLARE_INSTRUCTION(SDL)
        /* How many bits down do we need to shift the register to store some
         * of its high bits into the low bits of the memory word? */
        int new_shift = (lsaddr & 7) * 8;
-       cpu_dword = (old_word & old_mask) | ((uint64_t) *lsrtp >> new_shift);
-       write_dword_in_memory();
+       mem_write64(address, (old_word & old_mask) | ((uint64_t) *lsrtp >> new_shift));
        CHECK_MEMORY();
      }
    }
@@ -445,18 +392,14 @@ DECLARE_INSTRUCTION(SDR)
    int64_t *lsrtp = &irt;
    uint64_t old_word = 0;
    ADD_TO_PC(1);
-   address = lsaddr & UINT32_C(0xFFFFFFF8);
    if ((lsaddr & 7) == 7)
    {
-     cpu_dword = *lsrtp;
-     write_dword_in_memory();
+     mem_write64(lsaddr & UINT32_C(0xFFFFFFF8), *lsrtp);
      CHECK_MEMORY();
    }
    else
    {
-     rdword = &old_word;
-     read_dword_in_memory();
-     if (address)
+     if (mem_read64(lsaddr & UINT32_C(0xFFFFFFF8), &old_word))
      {
        /* How many low bits do we want to preserve from what was in memory
         * before? */
@@ -464,8 +407,7 @@ DECLARE_INSTRUCTION(SDR)
        /* How many bits up do we need to shift the register to store some
         * of its low bits into the high bits of the memory word? */
        int new_shift = (7 - (lsaddr & 7)) * 8;
-       cpu_dword = (old_word & old_mask) | (*lsrtp << new_shift);
-       write_dword_in_memory();
+       mem_write64(address, (old_word & old_mask) | (*lsrtp << new_shift));
        CHECK_MEMORY();
      }
    }
@@ -477,18 +419,14 @@ DECLARE_INSTRUCTION(SWR)
    int64_t *lsrtp = &irt;
    uint64_t old_word = 0;
    ADD_TO_PC(1);
-   address = lsaddr & UINT32_C(0xFFFFFFFC);
    if ((lsaddr & 3) == 3)
    {
-     cpu_word = (uint32_t) *lsrtp;
-     write_word_in_memory();
+     mem_write32(lsaddr & UINT32_C(0xFFFFFFFC), (uint32_t) *lsrtp);
      CHECK_MEMORY();
    }
    else
    {
-     rdword = &old_word;
-     read_word_in_memory();
-     if (address)
+     if (mem_read32(lsaddr & UINT32_C(0xFFFFFFFC), &old_word))
      {
        /* How many low bits do we want to preserve from what was in memory
         * before? */
@@ -496,8 +434,7 @@ DECLARE_INSTRUCTION(SWR)
        /* How many bits up do we need to shift the register to store some
         * of its low bits into the high bits of the memory word? */
        int new_shift = (3 - (lsaddr & 3)) * 8;
-       cpu_word = ((uint32_t) old_word & old_mask) | ((uint32_t) *lsrtp << new_shift);
-       write_word_in_memory();
+       mem_write32(address, ((uint32_t) old_word & old_mask) | ((uint32_t) *lsrtp << new_shift));
        CHECK_MEMORY();
      }
    }
@@ -513,10 +450,7 @@ DECLARE_INSTRUCTION(LL)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_word_in_memory();
-   if (address)
+   if (mem_read32(lsaddr, (uint64_t*) lsrtp))
      {
     *lsrtp = SE32(*lsrtp);
     llbit = 1;
@@ -530,11 +464,8 @@ DECLARE_INSTRUCTION(LWC1)
    uint64_t temp;
    if (check_cop1_unusable()) return;
    ADD_TO_PC(1);
-   address = lslfaddr;
-   rdword = &temp;
-   read_word_in_memory();
-   if (address)
-     *((uint32_t*) reg_cop1_simple[lslfft]) = (uint32_t) *rdword;
+   if (mem_read32(lslfaddr, &temp))
+     *((uint32_t*) reg_cop1_simple[lslfft]) = (uint32_t) temp;
 }
 
 DECLARE_INSTRUCTION(LDC1)
@@ -543,9 +474,7 @@ DECLARE_INSTRUCTION(LDC1)
    const uint32_t lslfaddr = (uint32_t) reg[lfbase] + lfoffset;
    if (check_cop1_unusable()) return;
    ADD_TO_PC(1);
-   address = lslfaddr;
-   rdword = (uint64_t*) reg_cop1_double[lslfft];
-   read_dword_in_memory();
+   mem_read64(lslfaddr, (uint64_t*) reg_cop1_double[lslfft]);
 }
 
 DECLARE_INSTRUCTION(LD)
@@ -553,9 +482,7 @@ DECLARE_INSTRUCTION(LD)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   rdword = (uint64_t*) lsrtp;
-   read_dword_in_memory();
+   mem_read64(lsaddr, (uint64_t*) lsrtp);
 }
 
 DECLARE_INSTRUCTION(SC)
@@ -565,9 +492,7 @@ DECLARE_INSTRUCTION(SC)
    ADD_TO_PC(1);
    if(llbit)
    {
-      address = lsaddr;
-      cpu_word = (uint32_t) *lsrtp;
-      write_word_in_memory();
+      mem_write32(lsaddr, (uint32_t) *lsrtp);
       CHECK_MEMORY();
       llbit = 0;
       *lsrtp = 1;
@@ -584,9 +509,7 @@ DECLARE_INSTRUCTION(SWC1)
    const uint32_t lslfaddr = (uint32_t) reg[lfbase] + lfoffset;
    if (check_cop1_unusable()) return;
    ADD_TO_PC(1);
-   address = lslfaddr;
-   cpu_word = *((uint32_t*) reg_cop1_simple[lslfft]);
-   write_word_in_memory();
+   mem_write32(lslfaddr, *((uint32_t*) reg_cop1_simple[lslfft]));
    CHECK_MEMORY();
 }
 
@@ -596,9 +519,7 @@ DECLARE_INSTRUCTION(SDC1)
    const uint32_t lslfaddr = (uint32_t) reg[lfbase] + lfoffset;
    if (check_cop1_unusable()) return;
    ADD_TO_PC(1);
-   address = lslfaddr;
-   cpu_dword = *((uint64_t*) reg_cop1_double[lslfft]);
-   write_dword_in_memory();
+   mem_write64(lslfaddr, *((uint64_t*) reg_cop1_double[lslfft]));
    CHECK_MEMORY();
 }
 
@@ -607,9 +528,7 @@ DECLARE_INSTRUCTION(SD)
    const uint32_t lsaddr = irs32 + iimmediate;
    int64_t *lsrtp = &irt;
    ADD_TO_PC(1);
-   address = lsaddr;
-   cpu_dword = *lsrtp;
-   write_dword_in_memory();
+   mem_write64(lsaddr, *lsrtp);
    CHECK_MEMORY();
 }
 
@@ -1807,8 +1726,8 @@ static void TLBWrite(unsigned int idx)
       {
          for (i=tlb_e[idx].start_even>>12; i<=tlb_e[idx].end_even>>12; i++)
          {
-            if(!invalid_code[i] &&(invalid_code[tlb_LUT_r[i]>>12] ||
-               invalid_code[(tlb_LUT_r[i]>>12)+0x20000]))
+            if(!invalid_code[i] &&(invalid_code[tlb_LUT_r_lookup(i)>>12] ||
+               invalid_code[(tlb_LUT_r_lookup(i)>>12)+0x20000]))
                invalid_code[i] = 1;
             if (!invalid_code[i])
             {
@@ -1817,12 +1736,12 @@ static void TLBWrite(unsigned int idx)
                 md5_byte_t digest[16];
                 md5_init(&state);
                 md5_append(&state, 
-                       (const md5_byte_t*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],
+                       (const md5_byte_t*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],
                        0x1000);
                 md5_finish(&state, digest);
                 for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
                 
-                blocks[i]->adler32 = encoding_crc32(0, (void*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+                blocks[i]->adler32 = encoding_crc32(0, (void*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4], 0x1000);
                 
                 invalid_code[i] = 1;
             }
@@ -1838,8 +1757,8 @@ static void TLBWrite(unsigned int idx)
       {
          for (i=tlb_e[idx].start_odd>>12; i<=tlb_e[idx].end_odd>>12; i++)
          {
-            if(!invalid_code[i] &&(invalid_code[tlb_LUT_r[i]>>12] ||
-               invalid_code[(tlb_LUT_r[i]>>12)+0x20000]))
+            if(!invalid_code[i] &&(invalid_code[tlb_LUT_r_lookup(i)>>12] ||
+               invalid_code[(tlb_LUT_r_lookup(i)>>12)+0x20000]))
                invalid_code[i] = 1;
             if (!invalid_code[i])
             {
@@ -1848,12 +1767,12 @@ static void TLBWrite(unsigned int idx)
                md5_byte_t digest[16];
                md5_init(&state);
                md5_append(&state, 
-                      (const md5_byte_t*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],
+                      (const md5_byte_t*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],
                       0x1000);
                md5_finish(&state, digest);
                for (j=0; j<16; j++) blocks[i]->md5[j] = digest[j];*/
                 
-               blocks[i]->adler32 = encoding_crc32(0, (void*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4], 0x1000);
+               blocks[i]->adler32 = encoding_crc32(0, (void*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4], 0x1000);
                 
                invalid_code[i] = 1;
             }
@@ -1912,7 +1831,7 @@ static void TLBWrite(unsigned int idx)
                md5_byte_t digest[16];
                md5_init(&state);
                md5_append(&state, 
-                  (const md5_byte_t*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],
+                  (const md5_byte_t*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],
                   0x1000);
                md5_finish(&state, digest);
                for (j=0; j<16; j++)
@@ -1922,7 +1841,7 @@ static void TLBWrite(unsigned int idx)
                }*/
                if(blocks[i] && blocks[i]->adler32)
                {
-                  if(blocks[i]->adler32 == encoding_crc32(0,(void*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+                  if(blocks[i]->adler32 == encoding_crc32(0,(void*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],0x1000))
                      invalid_code[i] = 0;
                }
          }
@@ -1941,7 +1860,7 @@ static void TLBWrite(unsigned int idx)
             md5_byte_t digest[16];
             md5_init(&state);
             md5_append(&state, 
-                   (const md5_byte_t*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],
+                   (const md5_byte_t*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],
                    0x1000);
             md5_finish(&state, digest);
             for (j=0; j<16; j++)
@@ -1951,7 +1870,7 @@ static void TLBWrite(unsigned int idx)
             }*/
             if(blocks[i] && blocks[i]->adler32)
             {
-               if(blocks[i]->adler32 == encoding_crc32(0,(void*)&g_rdram[(tlb_LUT_r[i]&0x7FF000)/4],0x1000))
+               if(blocks[i]->adler32 == encoding_crc32(0,(void*)&g_rdram[(tlb_LUT_r_lookup(i)&0x7FF000)/4],0x1000))
                   invalid_code[i] = 0;
             }
          }
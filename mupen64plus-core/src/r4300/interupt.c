@@ -25,6 +25,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ai/ai_controller.h"
@@ -33,6 +35,7 @@
 #include "cached_interp.h"
 #include "cp0_private.h"
 #include "dd/dd_controller.h"
+#include "event_queue.h"
 #include "exception.h"
 #include "main/main.h"
 #include "main/savestates.h"
@@ -54,114 +57,59 @@ extern int retro_return(bool just_flipping);
 
 int interupt_unsafe_state = 0;
 
-struct interrupt_event
-{
-    int type;
-    unsigned int count;
-};
-
-
-/***************************************************************************
- * Pool of Single Linked List Nodes
- **************************************************************************/
-#define POOL_CAPACITY 16
-
-struct node
-{
-    struct interrupt_event data;
-    struct node *next;
-};
+static struct interrupt_queue q;
 
-struct pool
-{
-    struct node nodes[POOL_CAPACITY];
-    struct node* stack[POOL_CAPACITY];
-    size_t index;
-};
+static int SPECIAL_done = 0;
 
-static struct node* alloc_node(struct pool* p);
-static void free_node(struct pool* p, struct node* node);
-static void clear_pool(struct pool* p);
+#ifdef PERF_TEST
+/* number of queue operations recorded for tools/interupt-bench */
+#define EVENT_TRACE_CAPACITY (1 << 22)
 
+static struct event_queue_record* event_trace;
+static size_t event_trace_count;
 
-/* node allocation/deallocation on a given pool */
-static struct node* alloc_node(struct pool* p)
+static void record_event_op(int op, int type, unsigned int count)
 {
-    /* return NULL if pool is too small */
-    if (p->index >= POOL_CAPACITY)
-        return NULL;
+    struct event_queue_record* r;
 
-    return p->stack[p->index++];
-}
+    if (event_trace == NULL)
+        event_trace = malloc(EVENT_TRACE_CAPACITY * sizeof(*event_trace));
 
-static void free_node(struct pool* p, struct node* node)
-{
-    if (p->index == 0 || node == NULL)
+    if (event_trace == NULL || event_trace_count >= EVENT_TRACE_CAPACITY)
         return;
 
-    p->stack[--p->index] = node;
-}
-
-/* release all nodes */
-static void clear_pool(struct pool* p)
-{
-    size_t i;
-
-    for(i = 0; i < POOL_CAPACITY; ++i)
-        p->stack[i] = &p->nodes[i];
-
-    p->index = 0;
+    r = &event_trace[event_trace_count++];
+    r->op = op;
+    r->special_done = SPECIAL_done;
+    r->type = type;
+    r->count = count;
+    r->now = g_cp0_regs[CP0_COUNT_REG];
 }
 
-/***************************************************************************
- * Interrupt Queue
- **************************************************************************/
-
-struct interrupt_queue
+int dump_eventqueue_trace(const char* path)
 {
-    struct pool pool;
-    struct node* first;
-};
+    FILE* f = fopen(path, "wb");
 
-static struct interrupt_queue q;
+    if (f == NULL)
+    {
+        DebugMessage(M64MSG_WARNING, "couldn't open %s for writing the event queue trace", path);
+        return -1;
+    }
 
+    fwrite(event_trace, sizeof(*event_trace), event_trace_count, f);
+    fclose(f);
 
-static void clear_queue(void)
-{
-    q.first = NULL;
-    clear_pool(&q.pool);
+    DebugMessage(M64MSG_INFO, "wrote %u event queue operations to %s", (unsigned int)event_trace_count, path);
+    return 0;
 }
+#else
+#define record_event_op(op, type, count)
+#endif
 
-
-static int SPECIAL_done = 0;
-
-static int before_event(unsigned int evt1, unsigned int evt2, int type2)
+static void reset_queue(void)
 {
-    if(evt1 - g_cp0_regs[CP0_COUNT_REG] < UINT32_C(0x80000000))
-    {
-        if(evt2 - g_cp0_regs[CP0_COUNT_REG] < UINT32_C(0x80000000))
-        {
-            if((evt1 - g_cp0_regs[CP0_COUNT_REG]) < (evt2 - g_cp0_regs[CP0_COUNT_REG])) return 1;
-            else return 0;
-        }
-        else
-        {
-            if((g_cp0_regs[CP0_COUNT_REG] - evt2) < UINT32_C(0x10000000))
-            {
-                switch(type2)
-                {
-                    case SPECIAL_INT:
-                        if(SPECIAL_done) return 1;
-                        else return 0;
-                        break;
-                    default:
-                        return 0;
-                }
-            }
-            else return 1;
-        }
-    }
-    else return 0;
+    record_event_op(EVENT_QUEUE_CLEAR, 0, 0);
+    clear_queue(&q);
 }
 
 void add_interupt_event(int type, unsigned int delay)
@@ -171,75 +119,32 @@ void add_interupt_event(int type, unsigned int delay)
 
 void add_interupt_event_count(int type, unsigned int count)
 {
-    struct node* event;
-    struct node* e;
-    int special;
-
-    special = (type == SPECIAL_INT);
-   
     if(g_cp0_regs[CP0_COUNT_REG] > UINT32_C(0x80000000)) SPECIAL_done = 0;
-   
-    if (get_event(type)) {
-        DebugMessage(M64MSG_WARNING, "two events of type 0x%x in interrupt queue", type);
-        /* FIXME: hack-fix for freezing in Perfect Dark
-         * http://code.google.com/p/mupen64plus/issues/detail?id=553
-         * https://github.com/mupen64plus-ae/mupen64plus-ae/commit/802d8f81d46705d64694d7a34010dc5f35787c7d
-         */
-        return;
-    }
 
-    event = alloc_node(&q.pool);
-    if (event == NULL)
-    {
-        DebugMessage(M64MSG_ERROR, "Failed to allocate node for new interrupt event");
-        return;
-    }
+    record_event_op(EVENT_QUEUE_INSERT, type, count);
 
-    event->data.count = count;
-    event->data.type = type;
-
-    if (q.first == NULL)
+    switch (insert_event(&q, type, count, g_cp0_regs[CP0_COUNT_REG], SPECIAL_done))
     {
-        q.first = event;
-        event->next = NULL;
-        next_interupt = q.first->data.count;
-    }
-    else if (before_event(count, q.first->data.count, q.first->data.type) && !special)
-    {
-        event->next = q.first;
-        q.first = event;
-        next_interupt = q.first->data.count;
-    }
-    else
-    {
-        for(e = q.first;
-            e->next != NULL &&
-            (!before_event(count, e->next->data.count, e->next->data.type) || special);
-            e = e->next);
-
-        if (e->next == NULL)
-        {
-            e->next = event;
-            event->next = NULL;
-        }
-        else
-        {
-            if (!special)
-                for(; e->next != NULL && e->next->data.count == count; e = e->next);
-
-            event->next = e->next;
-            e->next = event;
-        }
+        case EVENT_DUPLICATE:
+            DebugMessage(M64MSG_WARNING, "two events of type 0x%x in interrupt queue", type);
+            /* FIXME: hack-fix for freezing in Perfect Dark
+             * http://code.google.com/p/mupen64plus/issues/detail?id=553
+             * https://github.com/mupen64plus-ae/mupen64plus-ae/commit/802d8f81d46705d64694d7a34010dc5f35787c7d
+             */
+            break;
+        case EVENT_QUEUE_FULL:
+            DebugMessage(M64MSG_ERROR, "Failed to allocate node for new interrupt event");
+            break;
+        case EVENT_INSERTED_FIRST:
+            next_interupt = q.first->data.count;
+            break;
     }
 }
 
 static void remove_interupt_event(void)
 {
-    struct node* e;
-
-    e = q.first;
-    q.first = e->next;
-    free_node(&q.pool, e);
+    record_event_op(EVENT_QUEUE_POP, 0, 0);
+    pop_event(&q);
 
     next_interupt = (q.first != NULL
          && (q.first->data.count > g_cp0_regs[CP0_COUNT_REG]
@@ -250,18 +155,13 @@ static void remove_interupt_event(void)
 
 unsigned int get_event(int type)
 {
-    struct node* e = q.first;
-
-    if (e == NULL)
-        return 0;
-
-    if (e->data.type == type)
-        return e->data.count;
+    struct node* e;
 
-    for(; e->next != NULL && e->next->data.type != type; e = e->next);
+    record_event_op(EVENT_QUEUE_FIND, type, 0);
+    e = find_event(&q, type);
 
-    return (e->next != NULL)
-        ? e->next->data.count
+    return (e != NULL)
+        ? e->data.count
         : 0;
 }
 
@@ -274,41 +174,18 @@ int get_next_event_type(void)
 
 void remove_event(int type)
 {
-    struct node* to_del;
-    struct node* e = q.first;
-
-    if (e == NULL)
-        return;
-
-    if (e->data.type == type)
-    {
-        q.first = e->next;
-        free_node(&q.pool, e);
-    }
-    else
-    {
-        for(; e->next != NULL && e->next->data.type != type; e = e->next);
-
-        if (e->next != NULL)
-        {
-            to_del = e->next;
-            e->next = to_del->next;
-            free_node(&q.pool, to_del);
-        }
-    }
+    record_event_op(EVENT_QUEUE_REMOVE, type, 0);
+    remove_event_type(&q, type);
 }
 
 void translate_event_queue(unsigned int base)
 {
-    struct node* e;
-
     remove_event(COMPARE_INT);
     remove_event(SPECIAL_INT);
 
-    for(e = q.first; e != NULL; e = e->next)
-    {
-        e->data.count = (e->data.count - g_cp0_regs[CP0_COUNT_REG]) + base;
-    }
+    record_event_op(EVENT_QUEUE_REBASE, 0, base);
+    rebase_events(&q, g_cp0_regs[CP0_COUNT_REG], base);
+
     add_interupt_event_count(COMPARE_INT, g_cp0_regs[CP0_COMPARE_REG]);
     add_interupt_event_count(SPECIAL_INT, 0);
 }
@@ -334,7 +211,7 @@ int save_eventqueue_infos(char *buf)
 void load_eventqueue_infos(char *buf)
 {
     int len = 0;
-    clear_queue();
+    reset_queue();
     while (*((unsigned int*)&buf[len]) != 0xFFFFFFFF)
     {
         int type = *((unsigned int*)&buf[len]);
@@ -350,15 +227,13 @@ void init_interupt(void)
 
     g_vi.delay = g_vi.next_vi = 5000;
 
-    clear_queue();
+    reset_queue();
     add_interupt_event_count(VI_INT, g_vi.next_vi);
     add_interupt_event_count(SPECIAL_INT, 0);
 }
 
 void check_interupt(void)
 {
-    struct node* event;
-
     if (g_r4300.mi.regs[MI_INTR_REG] & g_r4300.mi.regs[MI_INTR_MASK_REG])
         g_cp0_regs[CP0_CAUSE_REG] = (g_cp0_regs[CP0_CAUSE_REG] | UINT32_C(0x400)) & UINT32_C(0xFFFFFF83);
     else
@@ -366,28 +241,15 @@ void check_interupt(void)
     if ((g_cp0_regs[CP0_STATUS_REG] & UINT32_C(7)) != 1) return;
     if (g_cp0_regs[CP0_STATUS_REG] & g_cp0_regs[CP0_CAUSE_REG] & UINT32_C(0xFF00))
     {
-        event = alloc_node(&q.pool);
+        record_event_op(EVENT_QUEUE_PUSH, CHECK_INT, g_cp0_regs[CP0_COUNT_REG]);
 
-        if (event == NULL)
+        if (push_event(&q, CHECK_INT, g_cp0_regs[CP0_COUNT_REG]) == EVENT_QUEUE_FULL)
         {
             DebugMessage(M64MSG_ERROR, "Failed to allocate node for new interrupt event");
             return;
         }
 
-        event->data.count = next_interupt = g_cp0_regs[CP0_COUNT_REG];
-        event->data.type = CHECK_INT;
-
-        if (q.first == NULL)
-        {
-            q.first = event;
-            event->next = NULL;
-        }
-        else
-        {
-            event->next = q.first;
-            q.first = event;
-
-        }
+        next_interupt = g_cp0_regs[CP0_COUNT_REG];
     }
 }
 
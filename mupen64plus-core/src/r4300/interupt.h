@@ -45,6 +45,11 @@ int get_next_event_type(void);
 int save_eventqueue_infos(char *buf);
 void load_eventqueue_infos(char *buf);
 
+#ifdef PERF_TEST
+/* writes the queue operations recorded so far, see tools/interupt-bench */
+int dump_eventqueue_trace(const char* path);
+#endif
+
 #define VI_INT      0x001
 #define COMPARE_INT 0x002
 #define CHECK_INT   0x004
@@ -122,11 +122,7 @@ void r4300_reset_hard(void)
         tlb_e[i].end_odd=0;
         tlb_e[i].phys_odd=0;
     }
-    for (i=0; i<0x100000; i++)
-    {
-        tlb_LUT_r[i] = 0;
-        tlb_LUT_w[i] = 0;
-    }
+    tlb_init();
     llbit=0;
     hi=0;
     lo=0;
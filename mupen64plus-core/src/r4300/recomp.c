@@ -55,6 +55,7 @@ precomp_instr *dst           = NULL; /* destination structure for the recompiled
 unsigned char **inst_pointer = NULL; /* output buffer for recompiled code */
 precomp_block *dst_block     = NULL; /* the current block that we are recompiling */
 int no_compiled_jump = 0;            /* use cached interpreter instead of recompiler for jumps */
+int fuse_instructions = 1;           /* merge common instruction pairs in the cached interpreter */
 int code_length;                     /* current real recompiled code length */
 int max_code_length;                 /* current recompiled code's buffer length */
 uint32_t src;                        /* the current recompiled instruction */
@@ -2192,6 +2193,11 @@ void init_block(precomp_block *block)
     already_exist = 0;
   }
 
+  /* every instruction goes back to NOTCOMPILED, no sub-page is tracked anymore */
+  block->dirty_subpages = 0;
+  block->hashed_subpages = 0;
+  block->stale_subpages = 0;
+
   if (r4300emu == CORE_DYNAREC)
   {
     if (!block->code)
@@ -2264,31 +2270,11 @@ void init_block(precomp_block *block)
   { 
     uint32_t paddr = virtual_to_physical_address(block->start, 2);
     invalid_code[paddr>>12] = 0;
-    if (!blocks[paddr>>12])
-    {
-      blocks[paddr>>12] = (precomp_block *) malloc(sizeof(precomp_block));
-      blocks[paddr>>12]->code = NULL;
-      blocks[paddr>>12]->block = NULL;
-      blocks[paddr>>12]->jumps_table = NULL;
-      blocks[paddr>>12]->riprel_table = NULL;
-      blocks[paddr>>12]->start = paddr & ~UINT32_C(0xFFF);
-      blocks[paddr>>12]->end = (paddr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
-    }
-    init_block(blocks[paddr>>12]);
+    init_block(get_precomp_block(paddr));
     
     paddr += block->end - block->start - 4;
     invalid_code[paddr>>12] = 0;
-    if (!blocks[paddr>>12])
-    {
-      blocks[paddr>>12] = (precomp_block *) malloc(sizeof(precomp_block));
-      blocks[paddr>>12]->code = NULL;
-      blocks[paddr>>12]->block = NULL;
-      blocks[paddr>>12]->jumps_table = NULL;
-      blocks[paddr>>12]->riprel_table = NULL;
-      blocks[paddr>>12]->start = paddr & ~UINT32_C(0xFFF);
-      blocks[paddr>>12]->end = (paddr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
-    }
-    init_block(blocks[paddr>>12]);
+    init_block(get_precomp_block(paddr));
   }
   else
   {
@@ -2296,17 +2282,7 @@ void init_block(precomp_block *block)
 
     if (invalid_code[alt_addr>>12])
     {
-      if (!blocks[alt_addr>>12])
-      {
-        blocks[alt_addr>>12] = (precomp_block *) malloc(sizeof(precomp_block));
-        blocks[alt_addr>>12]->code = NULL;
-        blocks[alt_addr>>12]->block = NULL;
-        blocks[alt_addr>>12]->jumps_table = NULL;
-        blocks[alt_addr>>12]->riprel_table = NULL;
-        blocks[alt_addr>>12]->start = alt_addr & ~UINT32_C(0xFFF);
-        blocks[alt_addr>>12]->end = (alt_addr & ~UINT32_C(0xFFF)) + UINT32_C(0x1000);
-      }
-      init_block(blocks[alt_addr>>12]);
+      init_block(get_precomp_block(alt_addr));
     }
   }
   timed_section_end(TIMED_SECTION_COMPILER);
@@ -2399,6 +2375,16 @@ void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func
       finished = 1;
      }
 
+   if (r4300emu == CORE_INTERPRETER)
+   {
+      uint32_t end = (i < (uint32_t) length) ? i : (uint32_t) length;
+
+      hash_compiled_subpages(block, source, (func & 0xFFF) >> SUBPAGE_SHIFT,
+            (end - 1) / SUBPAGE_WORDS);
+      if (fuse_instructions)
+         fuse_compiled_instructions(block, source, (func & 0xFFF) / 4, end);
+   }
+
    if (i >= length)
      {
     dst = block->block + i;
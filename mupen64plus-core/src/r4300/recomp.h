@@ -72,6 +72,12 @@ typedef struct _precomp_instr
    reg_cache_struct reg_cache_infos;
 } precomp_instr;
 
+/* Blocks are split in sub-pages so that the cached interpreter only
+ * retranslates the parts of a page that were actually overwritten. */
+#define SUBPAGE_SHIFT 8
+#define SUBPAGE_WORDS ((1 << SUBPAGE_SHIFT) / 4)
+#define SUBPAGE_COUNT (0x1000 >> SUBPAGE_SHIFT)
+
 typedef struct _precomp_block
 {
    precomp_instr *block;
@@ -86,6 +92,13 @@ typedef struct _precomp_block
    int riprel_number;
    //unsigned char md5[16];
    unsigned int adler32;
+   /* cached interpreter self-modifying code tracking (see cached_interp.c) */
+   uint16_t dirty_subpages;
+   uint16_t hashed_subpages;
+   uint16_t stale_subpages;
+   uint32_t subpage_crc[SUBPAGE_COUNT];
+   unsigned int invalidations;
+   unsigned int retranslations;
 } precomp_block;
 
 void recompile_block(const uint32_t *source, precomp_block *block, uint32_t func);
@@ -100,6 +113,7 @@ void *realloc_exec(void *ptr, size_t oldsize, size_t newsize);
 extern precomp_instr *dst; /* precomp_instr structure for instruction being recompiled */
 
 extern int no_compiled_jump;
+extern int fuse_instructions;
 
 #ifdef DYNAREC
 #include "hacktarux_dynarec/assemble.h"
@@ -21,108 +21,265 @@
 
 #include "tlb.h"
 
+#include <string.h>
+
 #include "api/m64p_types.h"
 #include "exception.h"
 #include "main/rom.h"
+#include "r4300.h"
 
 tlb tlb_e[32];
 
 uint32_t tlb_LUT_r[0x100000];
 uint32_t tlb_LUT_w[0x100000];
 
-void tlb_unmap(tlb *entry)
+struct tlb_counters tlb_counters;
+
+/* Halves of more than TLB_LAZY_PAGES pages are entered in the LUTs page by
+ * page as they are accessed instead of all at once by tlb_map. */
+#define TLB_LAZY_PAGES 16
+
+struct lazy_half
 {
-    unsigned int i;
+   uint32_t start;
+   uint32_t size;
+   uint32_t value;   /* LUT value of the first page */
+   int writable;
+   unsigned int filled;
+};
 
-    if (entry->v_even)
+/* indexed by entry * 2 + odd, the bits of lazy_mask tell the used ones */
+static struct lazy_half lazy_halves[64];
+static uint64_t lazy_mask;
+
+/* new_dynarec reads the LUTs without going through this file, so they must
+ * hold every mapped page and the fixed mapping below can't be left out of
+ * them */
+static int lut_complete;
+
+/* Fixed virtual to physical mapping of the running ROM, which doesn't need
+ * a TLB entry (the GoldenEye hack). */
+static uint32_t fixed_start;
+static uint32_t fixed_size;
+static uint32_t fixed_base;
+/* fixed_size if the fixed mapping must be checked before the LUTs */
+static uint32_t fixed_override_size;
+
+static void lut_fill(uint32_t* lut, uint32_t page, uint32_t count, uint32_t value)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+        lut[page + i] = value + (i << 12);
+}
+
+/* same as lut_fill but leaves the pages of the fixed mapping empty, so that
+ * it still takes precedence when it is only looked up on LUT misses */
+static void lut_fill_clipped(uint32_t* lut, uint32_t page, uint32_t count, uint32_t value)
+{
+    uint32_t first = fixed_start >> 12;
+    uint32_t last = first + (fixed_size >> 12);
+
+    if (fixed_override_size == 0 && first < page + count && last > page)
     {
-        for (i=entry->start_even; i<entry->end_even; i += 0x1000)
-            tlb_LUT_r[i>>12] = 0;
-        if (entry->d_even)
-            for (i=entry->start_even; i<entry->end_even; i += 0x1000)
-                tlb_LUT_w[i>>12] = 0;
+        if (first > page)
+            lut_fill(lut, page, first - page, value);
+        if (last < page + count)
+            lut_fill(lut, last, page + count - last, value + ((last - page) << 12));
+        return;
     }
 
-    if (entry->v_odd)
+    lut_fill(lut, page, count, value);
+}
+
+static uint32_t page_count(unsigned int start, unsigned int end)
+{
+    return (start < end) ? (end - start + 0xFFF) >> 12 : 0;
+}
+
+static void unmap_half(unsigned int slot, unsigned int start, unsigned int end, int d)
+{
+    uint32_t count = page_count(start, end);
+
+    if (lazy_mask & (UINT64_C(1) << slot))
     {
-        for (i=entry->start_odd; i<entry->end_odd; i += 0x1000)
-            tlb_LUT_r[i>>12] = 0;
-        if (entry->d_odd)
-            for (i=entry->start_odd; i<entry->end_odd; i += 0x1000)
-                tlb_LUT_w[i>>12] = 0;
+        lazy_mask &= ~(UINT64_C(1) << slot);
+        /* nothing to clear if the half was never accessed */
+        if (lazy_halves[slot].filled == 0)
+            return;
     }
+
+    memset(&tlb_LUT_r[start >> 12], 0, count * sizeof(tlb_LUT_r[0]));
+    if (d)
+        memset(&tlb_LUT_w[start >> 12], 0, count * sizeof(tlb_LUT_w[0]));
+    tlb_counters.pages_unmapped += count;
 }
 
-void tlb_map(tlb *entry)
+static void map_half(unsigned int slot, unsigned int start, unsigned int end, unsigned int phys, int d)
 {
-    unsigned int i;
+    uint32_t count;
+    uint32_t value;
 
-    if (entry->v_even)
+    if (start >= end ||
+        (start >= 0x80000000 && end < 0xC0000000) ||
+        phys >= 0x20000000)
+        return;
+
+    count = page_count(start, end);
+    value = UINT32_C(0x80000000) | (phys + 0xFFF);
+
+    if (!lut_complete && count > TLB_LAZY_PAGES)
     {
-        if (entry->start_even < entry->end_even &&
-            !(entry->start_even >= 0x80000000 && entry->end_even < 0xC0000000) &&
-            entry->phys_even < 0x20000000)
-        {
-            for (i=entry->start_even;i<entry->end_even;i+=0x1000)
-                tlb_LUT_r[i>>12] = UINT32_C(0x80000000) | (entry->phys_even + (i - entry->start_even) + 0xFFF);
-            if (entry->d_even)
-                for (i=entry->start_even;i<entry->end_even;i+=0x1000)
-                    tlb_LUT_w[i>>12] = UINT32_C(0x80000000) | (entry->phys_even + (i - entry->start_even) + 0xFFF);
-        }
+        lazy_halves[slot].start = start;
+        lazy_halves[slot].size = count << 12;
+        lazy_halves[slot].value = value;
+        lazy_halves[slot].writable = d;
+        lazy_halves[slot].filled = 0;
+        lazy_mask |= UINT64_C(1) << slot;
+        return;
     }
 
-    if (entry->v_odd)
+    lut_fill_clipped(tlb_LUT_r, start >> 12, count, value);
+    if (d)
+        lut_fill_clipped(tlb_LUT_w, start >> 12, count, value);
+    tlb_counters.pages_mapped += count;
+}
+
+/* enters the page of addresse in the LUTs if a lazily mapped half covers it */
+static uint32_t lazy_fill(uint32_t addresse, int w)
+{
+    uint64_t mask = lazy_mask;
+
+    if (addresse - fixed_start < fixed_size)
+        return 0;
+
+    while (mask)
     {
-        if (entry->start_odd < entry->end_odd &&
-            !(entry->start_odd >= 0x80000000 && entry->end_odd < 0xC0000000) &&
-            entry->phys_odd < 0x20000000)
+        unsigned int slot = 0;
+        struct lazy_half* half;
+
+        while (!(mask & (UINT64_C(1) << slot)))
+            slot++;
+        mask &= ~(UINT64_C(1) << slot);
+
+        half = &lazy_halves[slot];
+        if (addresse - half->start < half->size && (w != 1 || half->writable))
         {
-            for (i=entry->start_odd;i<entry->end_odd;i+=0x1000)
-                tlb_LUT_r[i>>12] = UINT32_C(0x80000000) | (entry->phys_odd + (i - entry->start_odd) + 0xFFF);
-            if (entry->d_odd)
-                for (i=entry->start_odd;i<entry->end_odd;i+=0x1000)
-                    tlb_LUT_w[i>>12] = UINT32_C(0x80000000) | (entry->phys_odd + (i - entry->start_odd) + 0xFFF);
+            uint32_t page = addresse >> 12;
+            uint32_t value = half->value + (((addresse - half->start) >> 12) << 12);
+
+            tlb_LUT_r[page] = value;
+            if (half->writable)
+                tlb_LUT_w[page] = value;
+            half->filled++;
+            tlb_counters.lazy_fills++;
+            return value;
         }
     }
+
+    return 0;
 }
 
-uint32_t virtual_to_physical_address(uint32_t addresse, int w)
+void tlb_init(void)
 {
-    if (addresse >= UINT32_C(0x7f000000) && addresse < UINT32_C(0x80000000) && isGoldeneyeRom)
+    memset(tlb_LUT_r, 0, sizeof(tlb_LUT_r));
+    memset(tlb_LUT_w, 0, sizeof(tlb_LUT_w));
+    lazy_mask = 0;
+
+#ifdef NEW_DYNAREC
+    lut_complete = (r4300emu >= CORE_DYNAREC);
+#else
+    lut_complete = 0;
+#endif
+
+    fixed_start = 0;
+    fixed_size = 0;
+    fixed_base = 0;
+    if (isGoldeneyeRom)
     {
         /**************************************************
          GoldenEye 007 hack allows for use of TLB.
          Recoded by okaygo to support all US, J, and E ROMS.
         **************************************************/
+        fixed_start = UINT32_C(0x7f000000);
+        fixed_size = UINT32_C(0x01000000);
         switch (ROM_HEADER.destination_code & UINT16_C(0xFF))
         {
-           case 0x45:
-              /* U */
-              return UINT32_C(0xb0034b30) + (addresse & UINT32_C(0xFFFFFF));
            case 0x4A:
               /* J */
-              return UINT32_C(0xb0034b70) + (addresse & UINT32_C(0xFFFFFF));
+              fixed_base = UINT32_C(0xb0034b70);
+              break;
            case 0x50:
               /* E */
-              return UINT32_C(0xb00329f0) + (addresse & UINT32_C(0xFFFFFF));
+              fixed_base = UINT32_C(0xb00329f0);
+              break;
+           case 0x45:
+              /* U */
            default:
               /* UNKNOWN COUNTRY CODE FOR GOLDENEYE USING AMERICAN VERSION HACK */
+              fixed_base = UINT32_C(0xb0034b30);
               break;
         }
-        return UINT32_C(0xb0034b30) + (addresse & UINT32_C(0xFFFFFF));
     }
+    fixed_override_size = lut_complete ? fixed_size : 0;
+}
 
-    if (w == 1)
-    {
-        if (tlb_LUT_w[addresse>>12])
-            return (tlb_LUT_w[addresse>>12] & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
-    }
-    else
+void tlb_unmap(tlb *entry)
+{
+    unsigned int slot = (unsigned int)(entry - tlb_e) * 2;
+
+    tlb_counters.unmaps++;
+
+    if (entry->v_even)
+        unmap_half(slot, entry->start_even, entry->end_even, entry->d_even);
+
+    if (entry->v_odd)
+        unmap_half(slot + 1, entry->start_odd, entry->end_odd, entry->d_odd);
+}
+
+void tlb_map(tlb *entry)
+{
+    unsigned int slot = (unsigned int)(entry - tlb_e) * 2;
+
+    tlb_counters.maps++;
+
+    if (entry->v_even)
+        map_half(slot, entry->start_even, entry->end_even, entry->phys_even, entry->d_even);
+
+    if (entry->v_odd)
+        map_half(slot + 1, entry->start_odd, entry->end_odd, entry->phys_odd, entry->d_odd);
+}
+
+uint32_t tlb_LUT_r_lookup(uint32_t page)
+{
+    if (tlb_LUT_r[page] || !lazy_mask)
+        return tlb_LUT_r[page];
+
+    return lazy_fill(page << 12, 0);
+}
+
+uint32_t virtual_to_physical_address(uint32_t addresse, int w)
+{
+    uint32_t value;
+
+    if (addresse - fixed_start < fixed_override_size)
+        return fixed_base + (addresse - fixed_start);
+
+    value = (w == 1) ? tlb_LUT_w[addresse>>12] : tlb_LUT_r[addresse>>12];
+    if (value)
+        return (value & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
+
+    if (addresse - fixed_start < fixed_size)
+        return fixed_base + (addresse - fixed_start);
+
+    if (lazy_mask)
     {
-        if (tlb_LUT_r[addresse>>12])
-            return (tlb_LUT_r[addresse>>12] & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
+        value = lazy_fill(addresse, w);
+        if (value)
+            return (value & UINT32_C(0xFFFFF000)) | (addresse & UINT32_C(0xFFF));
     }
 
+    tlb_counters.refills++;
     //printf("tlb exception !!! @ %x, %x, add:%x\n", addresse, w, PC->addr);
     //getchar();
     TLB_refill_exception(addresse,w);
@@ -53,8 +53,28 @@ extern tlb tlb_e[32];
 extern uint32_t tlb_LUT_r[0x100000];
 extern uint32_t tlb_LUT_w[0x100000];
 
+/* TLB activity since the profiler last reset them */
+struct tlb_counters
+{
+   unsigned int maps;
+   unsigned int unmaps;
+   unsigned int pages_mapped;
+   unsigned int pages_unmapped;
+   unsigned int lazy_fills;
+   unsigned int refills;
+};
+
+extern struct tlb_counters tlb_counters;
+
+/* Clears the LUTs. Call it after the ROM is loaded and the r4300 core is
+ * chosen, and before (re)mapping tlb_e. */
+void tlb_init(void);
 void tlb_unmap(tlb *entry);
 void tlb_map(tlb *entry);
+/* The pages of big TLB entries are only entered in the LUTs when accessed.
+ * Code which reads tlb_LUT_r directly, other than new_dynarec, must use this
+ * to get the entry of a page. */
+uint32_t tlb_LUT_r_lookup(uint32_t page);
 uint32_t virtual_to_physical_address(uint32_t addresse, int w);
 
 #endif /* M64P_R4300_TLB_H */
@@ -24,11 +24,13 @@
 
 #include "../memory/memory.h"
 #include "../plugin/plugin.h"
+#include "../r4300/r4300.h"
 #include "../r4300/r4300_core.h"
 #include "../ri/ri_controller.h"
 
 extern int fast_memory;
 
+#include <stdlib.h>
 #include <string.h>
 
 void init_fb(struct fb* fb)
@@ -38,45 +40,120 @@ void init_fb(struct fb* fb)
 }
 
 
-static void pre_framebuffer_read(struct fb* fb, uint32_t address)
+/* the infos are only used if the plugin takes both notifications */
+static int fb_notifications_enabled(void)
+{
+    return gfx.fBGetFrameBufferInfo && gfx.fBRead && gfx.fBWrite;
+}
+
+/* Only the x86 dynarec compiles RDRAM accesses to direct loads and stores,
+ * unless fast_memory is off. The interpreters look mem_base up on every
+ * access and see the rdramFB handlers as soon as they are mapped. */
+static int rdram_accesses_compiled(void)
 {
+#if defined(DYNAREC) && !defined(NEW_DYNAREC)
+    return r4300emu == CORE_DYNAREC;
+#else
+    return 0;
+#endif
+}
+
+static int in_framebuffer(const struct fb* fb, uint32_t address)
+{
+    unsigned int owners = fb->page_owners[address >> 12];
     size_t i;
 
-    for(i = 0; i < FB_INFOS_COUNT; ++i)
+    for (i = 0; owners != 0; ++i, owners >>= 1)
+    {
+        if ((owners & 1) && address >= fb->begin[i] && address < fb->end[i])
+            return 1;
+    }
+
+    return 0;
+}
+
+static int compare_pages(const void* a, const void* b)
+{
+    return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+/* Tells the plugin about the words written since the last call, once each,
+ * with one fBWrite(addr, size) call per run of adjacent words: size is the
+ * length of the run in bytes, which may cross pages and lines. Glide64
+ * widens its dirty rectangle to cover it, Rice records each of its words
+ * and gles2n64 ignores fBWrite. */
+static void flush_framebuffer_writes(struct fb* fb)
+{
+    uint32_t run_begin = 0, run_end = 0;
+    unsigned int i;
+
+    qsort(fb->written_pages, fb->written_pages_count, sizeof(fb->written_pages[0]), compare_pages);
+
+    for (i = 0; i < fb->written_pages_count; ++i)
     {
-        if (fb->infos[i].addr)
+        unsigned int page = fb->written_pages[i];
+        uint32_t* words = fb->written_words[page];
+        size_t j;
+
+        for (j = 0; j < FB_PAGE_WORDS / 32; ++j)
         {
-            unsigned int start = fb->infos[i].addr & 0x7FFFFF;
-            unsigned int end   = start + fb->infos[i].width*
-                               fb->infos[i].height*
-                               fb->infos[i].size - 1;
+            uint32_t bits = words[j];
+            uint32_t address = (page << 12) | (j << 7);
 
-            if ((address & 0x7FFFFF) >= start && (address & 0x7FFFFF) <= end &&
-                    fb->dirty_page[(address & 0x7FFFFF)>>12])
+            for (; bits != 0; address += 4, bits >>= 1)
             {
-                gfx.fBRead(address);
-                fb->dirty_page[(address & 0x7FFFFF)>>12] = 0;
+                if (!(bits & 1))
+                    continue;
+
+                if (address != run_end)
+                {
+                    if (run_end != run_begin)
+                        gfx.fBWrite(0x80000000 | run_begin, run_end - run_begin);
+                    run_begin = address;
+                }
+                run_end = address + 4;
             }
+            words[j] = 0;
         }
+
+        fb->written_page[page] = 0;
+    }
+
+    if (run_end != run_begin)
+        gfx.fBWrite(0x80000000 | run_begin, run_end - run_begin);
+
+    fb->written_pages_count = 0;
+}
+
+static void pre_framebuffer_read(struct fb* fb, uint32_t address)
+{
+    uint32_t addr = address & 0x7FFFFF;
+
+    if (fb->dirty_page[addr >> 12] && in_framebuffer(fb, addr))
+    {
+        /* keep the plugin's view of the reads and writes in order */
+        flush_framebuffer_writes(fb);
+        gfx.fBRead(address);
+        fb->dirty_page[addr >> 12] = 0;
     }
 }
 
 static void pre_framebuffer_write(struct fb* fb, uint32_t address)
 {
-    size_t i;
+    uint32_t addr = address & 0x7FFFFF;
+    unsigned int page = addr >> 12;
+    unsigned int word = (addr & 0xFFF) >> 2;
 
-    for(i = 0; i < FB_INFOS_COUNT; ++i)
+    if (!fb->page_owners[page] || !in_framebuffer(fb, addr))
+        return;
+
+    if (!fb->written_page[page])
     {
-        if (fb->infos[i].addr)
-        {
-            unsigned int start = fb->infos[i].addr & 0x7FFFFF;
-            unsigned int end   = start + fb->infos[i].width*
-                               fb->infos[i].height*
-                               fb->infos[i].size - 1;
-            if ((address & 0x7FFFFF) >= start && (address & 0x7FFFFF) <= end)
-                gfx.fBWrite(address, 4);
-        }
+        fb->written_page[page] = 1;
+        fb->written_pages[fb->written_pages_count++] = page;
     }
+
+    fb->written_words[page][word / 32] |= UINT32_C(1) << (word % 32);
 }
 
 int read_rdram_fb(void* opaque, uint32_t address, uint32_t* value)
@@ -101,92 +178,77 @@ int write_rdram_fb(void* opaque, uint32_t address, uint32_t value, uint32_t mask
 void protect_framebuffers(struct rdp_core* dp)
 {
     struct fb* fb = &dp->fb;
+    size_t i;
 
-    if (gfx.fBGetFrameBufferInfo && gfx.fBRead && gfx.fBWrite)
-        gfx.fBGetFrameBufferInfo(fb->infos);
-
-    if (!gfx.fBGetFrameBufferInfo)
-       return;
-    if (!gfx.fBRead && gfx.fBWrite)
+    if (!fb_notifications_enabled())
        return;
 
-    if (fb->infos[0].addr)
+    gfx.fBGetFrameBufferInfo(fb->infos);
+
+    memset(fb->dirty_page, 0, sizeof(fb->dirty_page));
+    memset(fb->page_owners, 0, sizeof(fb->page_owners));
+
+    for (i = 0; i < FB_INFOS_COUNT; ++i)
     {
-       size_t i;
-       for(i = 0; i < FB_INFOS_COUNT; ++i)
-       {
-          if (fb->infos[i].addr)
-          {
-             int j;
-             int start  = fb->infos[i].addr & 0x7FFFFF;
-             int end    = start + fb->infos[i].width*
-                fb->infos[i].height*
-                fb->infos[i].size - 1;
-             int start1 = start;
-             int end1   = end;
-
-             start >>= 16;
-             end   >>= 16;
-
-             for (j = start; j <= end; j++)
-             {
-                map_region(0x8000+j, M64P_MEM_RDRAM, RW(rdramFB));
-                map_region(0xa000+j, M64P_MEM_RDRAM, RW(rdramFB));
-             }
-
-             start <<= 4;
-             end   <<= 4;
-
-             for (j=start; j<=end; j++)
-             {
-                if (j >= start1 && j <= end1)
-                   fb->dirty_page[j] = 1;
-                else
-                   fb->dirty_page[j] = 0;
-             }
-
-             if (fb->once != 0)
-             {
-                fb->once = 0;
-                fast_memory = 0;
-                invalidate_r4300_cached_code(0, 0);
-             }
-          }
-       }
+        uint32_t begin = fb->infos[i].addr & 0x7FFFFF;
+        uint32_t end   = begin + fb->infos[i].width*
+           fb->infos[i].height*
+           fb->infos[i].size;
+        uint32_t j;
+
+        if (end > 0x800000)
+           end = 0x800000;
+
+        fb->begin[i] = begin;
+        fb->end[i]   = end;
+
+        if (!fb->infos[i].addr || end <= begin)
+           continue;
+
+        for (j = begin >> 16; j <= (end - 1) >> 16; j++)
+        {
+           map_region(0x8000+j, M64P_MEM_RDRAM, RW(rdramFB));
+           map_region(0xa000+j, M64P_MEM_RDRAM, RW(rdramFB));
+        }
+
+        for (j = begin >> 12; j <= (end - 1) >> 12; j++)
+        {
+           fb->dirty_page[j] = 1;
+           fb->page_owners[j] |= 1 << i;
+        }
+
+        /* compiled accesses would bypass the rdramFB handlers */
+        if (fb->once != 0 && rdram_accesses_compiled())
+        {
+           fb->once = 0;
+           fast_memory = 0;
+           invalidate_r4300_cached_code(0, 0);
+        }
     }
 }
 
 void unprotect_framebuffers(struct rdp_core* dp)
 {
     struct fb* fb = &dp->fb;
+    size_t i;
 
-    if (!gfx.fBGetFrameBufferInfo)
+    if (!fb_notifications_enabled())
        return;
-    if (!gfx.fBRead && gfx.fBWrite)
-       return;
-    
-    if (fb->infos[0].addr)
+
+    /* the display list which comes next may depend on them */
+    flush_framebuffer_writes(fb);
+
+    for (i = 0; i < FB_INFOS_COUNT; ++i)
     {
-       size_t i;
-
-       for(i = 0; i < FB_INFOS_COUNT; ++i)
-       {
-          if (fb->infos[i].addr)
-          {
-             int j;
-             int start = fb->infos[i].addr & 0x7FFFFF;
-             int end   = start + fb->infos[i].width *
-                fb->infos[i].height*
-                fb->infos[i].size - 1;
-             start     = start >> 16;
-             end       = end >> 16;
-
-             for (j = start; j <= end; j++)
-             {
-                map_region(0x8000+j, M64P_MEM_RDRAM, RW(rdram));
-                map_region(0xa000+j, M64P_MEM_RDRAM, RW(rdram));
-             }
-          }
-       }
+        uint32_t j;
+
+        if (!fb->infos[i].addr || fb->end[i] <= fb->begin[i])
+           continue;
+
+        for (j = fb->begin[i] >> 16; j <= (fb->end[i] - 1) >> 16; j++)
+        {
+           map_region(0x8000+j, M64P_MEM_RDRAM, RW(rdram));
+           map_region(0xa000+j, M64P_MEM_RDRAM, RW(rdram));
+        }
     }
 }
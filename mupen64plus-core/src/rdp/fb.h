@@ -30,11 +30,24 @@ struct rdp_core;
 
 enum { FB_INFOS_COUNT = 6 };
 enum { FB_DIRTY_PAGES_COUNT = 0x800 };
+enum { FB_PAGE_WORDS = 0x1000 / 4 };
 
 struct fb
 {
     unsigned char dirty_page[FB_DIRTY_PAGES_COUNT];
+    /* bit i is set if infos[i] covers part of the 4KB page */
+    unsigned char page_owners[FB_DIRTY_PAGES_COUNT];
     FrameBufferInfo infos[FB_INFOS_COUNT];
+    /* RDRAM range of each of the infos, end excluded */
+    uint32_t begin[FB_INFOS_COUNT];
+    uint32_t end[FB_INFOS_COUNT];
+
+    /* words written by the CPU since the last notification of the plugin */
+    uint32_t written_words[FB_DIRTY_PAGES_COUNT][FB_PAGE_WORDS / 32];
+    unsigned char written_page[FB_DIRTY_PAGES_COUNT];
+    uint16_t written_pages[FB_DIRTY_PAGES_COUNT];
+    unsigned int written_pages_count;
+
     unsigned int once;
 };
 
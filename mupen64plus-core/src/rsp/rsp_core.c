@@ -308,7 +308,9 @@ void do_SP_Task(struct rsp_core* sp)
     {
        /* Unknown list */
         sp->regs2[SP_PC_REG] &= 0xfff;
+        timed_section_start(TIMED_SECTION_RSP_OTHER);
         rsp.doRspCycles(0xffffffff);
+        timed_section_end(TIMED_SECTION_RSP_OTHER);
         sp->regs2[SP_PC_REG] |= save_pc;
 
         cp0_update_count();
@@ -22,6 +22,7 @@
 #include "vi_controller.h"
 
 #include "main/main.h"
+#include "main/profile.h"
 #include "memory/memory.h"
 #include "plugin/plugin.h"
 #include "r4300/r4300_core.h"
@@ -103,9 +104,16 @@ int write_vi_regs(void* opaque, uint32_t address,
     return 0;
 }
 
+extern int retro_skip_update_screen(void);
+
 void vi_vertical_interrupt_event(struct vi_controller* vi)
 {
-   gfx.updateScreen();
+   if (!retro_skip_update_screen())
+   {
+      timed_section_start(TIMED_SECTION_VI);
+      gfx.updateScreen();
+      timed_section_end(TIMED_SECTION_VI);
+   }
 
    /* allow main module to do things on VI event */
    new_vi();
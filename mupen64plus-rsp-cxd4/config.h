@@ -22,6 +22,20 @@ extern unsigned char rsp_conf[32];
 #define SEMAPHORE_LOCK_CORRECTIONS
 #define WAIT_FOR_CPU_HOST
 #define EMULATE_STATIC_PC
+#ifndef NO_PREDECODE_IMEM
+#define PREDECODE_IMEM
+#endif
+
+/*
+ * Build the AVX2 and AVX-512 vector unit ops (vu/avx.h) next to the SSE2
+ * ones and pick them at run time.  Left out on Windows, where GCC does not
+ * align the stack for spilling 256-bit and wider registers.
+ */
+#if defined(ARCH_MIN_SSE2) && defined(__GNUC__) && !defined(_WIN32)
+#ifndef NO_VU_AVX
+#define VU_AVX
+#endif
+#endif
 
 /*
  * The config file used to be a 32-byte EEPROM with binary settings storage.
@@ -0,0 +1,232 @@
+/******************************************************************************\
+* Project:  cxd4 RSP trace replay                                              *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+
+/*
+ * Runs the tasks recorded by rsp_dump.cpp (core built with HAVE_RSP_DUMP=1)
+ * through the interpreter, checks the final state of every task against the
+ * recording and reports the number of RSP instructions run per second.
+ *
+ * cc -std=gnu89 -O2 -DARCH_MIN_SSE2 -DM64P_PLUGIN_API -DM64P_CORE_PROTOTYPES \
+ *    -I../mupen64plus-core/src/api -I../libretro-common/include \
+ *    replay.c rsp_dump_reader.c ../libretro-common/features/features_cpu.c \
+ *    ../libretro-common/compat/compat_strl.c -o cxd4-replay
+ *
+ * Add -DNO_PREDECODE_IMEM to decode every instruction when it is fetched.
+ */
+
+#define HAVE_RSP_REPLAY
+#include "rsp.c"
+#include "rsp_dump_reader.h"
+
+#include <time.h>
+
+RSP_INFO rsp_info;
+
+EXPORT m64p_error CALL ConfigSetDefaultFloat(m64p_handle handle, const char *name, float value, const char *help)
+{
+    return M64ERR_SUCCESS;
+}
+
+EXPORT m64p_error CALL ConfigSetDefaultBool(m64p_handle handle, const char *name, int value, const char *help)
+{
+    return M64ERR_SUCCESS;
+}
+
+EXPORT int CALL ConfigGetParamBool(m64p_handle handle, const char *name)
+{
+    return 0;
+}
+
+static void check_interrupts(void)
+{
+}
+
+static struct rsp_dump_trace trace;
+static const char *trace_error;
+static size_t next_dma;
+static unsigned dmas_left;
+
+/* Copies a block into data, or counts the bytes which differ if compare. */
+static long read_block(const struct rsp_dump_block *b, const char *tag,
+                       void *data, uint32_t size, int compare)
+{
+    const unsigned char *block = trace.data + b->offset;
+    uint32_t i;
+    long errors = 0;
+
+    if (b->size != size)
+    {
+        trace_error = tag;
+        return -1;
+    }
+
+    if (!compare)
+        memcpy(data, block, size);
+    else
+        for (i = 0; i < size; i++)
+            errors += ((const unsigned char *)data)[i] != block[i];
+    return errors;
+}
+
+/* Returns non-zero if the transfer wrote to IMEM. */
+static int rsp_replay_read_dma(void)
+{
+    if (dmas_left == 0)
+    {
+        trace_error = "BEGINDMA";
+        return 0;
+    }
+    dmas_left--;
+    return rsp_dump_apply_dma(&trace, &next_dma, RSP.DMEM);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Replays the whole trace once, returns the number of tasks which failed. */
+static unsigned replay(unsigned *tasks, double *seconds)
+{
+    unsigned failed = 0;
+
+    for (*tasks = 0; *tasks < trace.task_count && trace_error == NULL; ++*tasks)
+    {
+        const struct rsp_dump_task *t = &trace.tasks[*tasks];
+        uint16_t VCO = 0, VCC = 0, VCE = 0;
+        long errors = 0;
+        int i;
+        double start;
+
+        read_block(&t->dmem, "DMEM    ", RSP.DMEM, 0x1000, 0);
+        read_block(&t->imem, "IMEM    ", RSP.IMEM, 0x1000, 0);
+        read_block(&t->sr, "SR32    ", SR, sizeof(SR), 0);
+        read_block(&t->vr, "VR32    ", VR, sizeof(VR), 0);
+        read_block(&t->vlo, "VLO     ", VACC[LO], sizeof(VACC[LO]), 0);
+        read_block(&t->vmd, "VMD     ", VACC[MD], sizeof(VACC[MD]), 0);
+        read_block(&t->vhi, "VHI     ", VACC[HI], sizeof(VACC[HI]), 0);
+        read_block(&t->pc, "PC      ", &PC, sizeof(PC), 0);
+        read_block(&t->vco, "VCO     ", &VCO, sizeof(VCO), 0);
+        read_block(&t->vcc, "VCC     ", &VCC, sizeof(VCC), 0);
+        read_block(&t->vce, "VCE     ", &VCE, sizeof(VCE), 0);
+        if (trace_error != NULL)
+            break;
+
+        set_VCO(VCO);
+        set_VCC(VCC);
+        set_VCE((unsigned char)VCE);
+
+        *RSP.SP_STATUS_REG = 0x00000000;
+        *RSP.SP_PC_REG = 0x04001000 | FIT_IMEM(PC);
+        for (i = 0; i < 32; i++)
+            MFC0_count[i] = 0;
+        next_dma = t->dma;
+        dmas_left = t->dmas;
+
+        start = now();
+        run_task();
+        *seconds += now() - start;
+
+        VCO = get_VCO();
+        VCC = get_VCC();
+        VCE = get_VCE();
+
+        errors += read_block(&t->dmem_end, "DMEM END", RSP.DMEM, 0x1000, 1);
+        errors += read_block(&t->imem_end, "IMEM END", RSP.IMEM, 0x1000, 1);
+        errors += read_block(&t->sr_end, "SR32 END", SR, sizeof(SR), 1);
+        errors += read_block(&t->vr_end, "VR32 END", VR, sizeof(VR), 1);
+        errors += read_block(&t->vlo_end, "VLO  END", VACC[LO], sizeof(VACC[LO]), 1);
+        errors += read_block(&t->vmd_end, "VMD  END", VACC[MD], sizeof(VACC[MD]), 1);
+        errors += read_block(&t->vhi_end, "VHI  END", VACC[HI], sizeof(VACC[HI]), 1);
+        errors += read_block(&t->vco_end, "VCO  END", &VCO, sizeof(VCO), 1);
+        errors += read_block(&t->vcc_end, "VCC  END", &VCC, sizeof(VCC), 1);
+        errors += read_block(&t->vce_end, "VCE  END", &VCE, sizeof(VCE), 1);
+        if (trace_error != NULL)
+            break;
+
+        if (errors != 0)
+        {
+            fprintf(stderr, "task %u: %ld bytes differ\n", *tasks, errors);
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    static unsigned char mem[0x2000];
+    static uint32_t regs[32];
+    unsigned iterations = argc > 2 ? (unsigned)atoi(argv[2]) : 10;
+    unsigned i, tasks = 0, failed = 0;
+    double seconds = 0.0;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <trace> [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    if (!rsp_dump_load_trace(&trace, argv[1]))
+        return 1;
+
+    memset(&RSP, 0, sizeof(RSP));
+    RSP.DMEM = mem;
+    RSP.IMEM = mem + 0x1000;
+    RSP.RDRAM = calloc(1, MAX_DRAM_ADDR + 1);
+    RSP.CheckInterrupts = check_interrupts;
+    RSP.MI_INTR_REG = &regs[0];
+    RSP.SP_MEM_ADDR_REG = &regs[1];
+    RSP.SP_DRAM_ADDR_REG = &regs[2];
+    RSP.SP_RD_LEN_REG = &regs[3];
+    RSP.SP_WR_LEN_REG = &regs[4];
+    RSP.SP_STATUS_REG = &regs[5];
+    RSP.SP_DMA_FULL_REG = &regs[6];
+    RSP.SP_DMA_BUSY_REG = &regs[7];
+    RSP.SP_PC_REG = &regs[8];
+    RSP.SP_SEMAPHORE_REG = &regs[9];
+    RSP.DPC_START_REG = &regs[10];
+    RSP.DPC_END_REG = &regs[11];
+    RSP.DPC_CURRENT_REG = &regs[12];
+    RSP.DPC_STATUS_REG = &regs[13];
+    RSP.DPC_CLOCK_REG = &regs[14];
+    RSP.DPC_BUFBUSY_REG = &regs[15];
+    RSP.DPC_PIPEBUSY_REG = &regs[16];
+    RSP.DPC_TMEM_REG = &regs[17];
+    cxd4InitiateRSP(RSP, NULL);
+
+    for (i = 0; i < iterations && trace_error == NULL; i++)
+        failed += replay(&tasks, &seconds);
+
+    if (trace_error != NULL)
+    {
+        fprintf(stderr, "malformed trace near tag \"%s\"\n", trace_error);
+        return 1;
+    }
+
+    printf("%u tasks x %u, %u failed, %llu instructions in %.3f s: %.2f MIPS (%s)\n",
+           tasks, iterations, failed, replay_instructions, seconds,
+           replay_instructions / (seconds > 0.0 ? seconds : 1.0) / 1e6,
+#ifdef PREDECODE_IMEM
+           "predecoded IMEM"
+#else
+           "decode on fetch"
+#endif
+           );
+
+    return failed != 0;
+}
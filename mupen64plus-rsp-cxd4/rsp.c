@@ -64,48 +64,101 @@ extern RSP_INFO rsp_info;
 
 #define FIT_IMEM(PC)    (PC & 0xFFF & 0xFFC)
 
-static INLINE unsigned SPECIAL(uint32_t inst, uint32_t PC)
+struct rsp_decoded
 {
-   unsigned int rs;
-#if (1u >> 1 == 0)
-   unsigned int rd = (inst & 0x0000FFFFu) >> 11;
-   /* rs = inst >> 21; // Primary op is 0, so we don't need &= 31. */
+   void (*vu)(int, int, int, int); /* COP2_C2 handler, NULL for scalar ops */
+   uint32_t inst;
+   int16_t offset; /* LWC2/SWC2 offset, sign-extended */
+   uint8_t rs, rt, rd, sa, element;
+};
+
+#ifdef PREDECODE_IMEM
+/* IMEM, decoded once per instruction word instead of on every fetch */
+static struct rsp_decoded imem_decoded[0x1000 / 4];
+#endif
+
+static void decode_inst(struct rsp_decoded *d, uint32_t inst)
+{
+   int16_t offset = (signed short)(inst & 0x0000FFFFu);
+
+#if defined(ARCH_MIN_SSE2)
+   offset <<= 5 + 4; /* safe on x86, skips 5-bit rd, 4-bit element */
+   offset >>= 5 + 4;
 #else
-   unsigned int rd = (inst >> 11) % 32;
-   /* rs = (inst >> 21) % 32; */
+   offset = SE(offset, 6);
 #endif
-   unsigned int rt = (inst >> 16) % (1 << 5);
+
+   d->inst    = inst;
+   d->offset  = offset;
+   d->rs      = (inst >> 21) & 31;
+   d->rt      = (inst >> 16) & 31;
+   d->rd      = (inst & 0x0000F800u) >> 11;
+   d->sa      = (inst & 0x000007FFu) >> 6;
+   d->element = (inst & 0x000007FFu) >> 7;
+   d->vu      = (inst >> 25 == 0x25) ? COP2_C2[inst % 64] : NULL;
+}
+
+#ifdef PREDECODE_IMEM
+/* Decodes again the IMEM words which changed since they were decoded. */
+static void predecode_imem(void)
+{
+   unsigned int i;
+   const uint32_t *imem = (const uint32_t *)RSP.IMEM;
+
+   for (i = 0; i < 0x1000 / 4; i++)
+      if (imem_decoded[i].inst != imem[i])
+         decode_inst(&imem_decoded[i], imem[i]);
+}
+
+#ifdef VU_AVX
+/* Decodes the table again after COP2_C2 has been switched to another set. */
+static void redecode_imem(void)
+{
+   unsigned int i;
+
+   for (i = 0; i < 0x1000 / 4; i++)
+      decode_inst(&imem_decoded[i], imem_decoded[i].inst);
+}
+#endif
+#endif
+
+static INLINE unsigned SPECIAL(const struct rsp_decoded *d, uint32_t PC)
+{
+   const uint32_t inst = d->inst;
+   unsigned int rs;
+   unsigned int rd = d->rd;
+   unsigned int rt = d->rt;
 
    switch (inst % 64)
    {
       case 000: /* SLL */
-         SR[rd] = SR[rt] << MASK_SA(inst >> 6);
+         SR[rd] = SR[rt] << MASK_SA(d->sa);
          SR[0] = 0x00000000;
          break;
       case 002: /* SRL */
-         SR[rd] = (unsigned)(SR[rt]) >> MASK_SA(inst >> 6);
+         SR[rd] = (unsigned)(SR[rt]) >> MASK_SA(d->sa);
          SR[0] = 0x00000000;
          break;
       case 003: /* SRA */
-         SR[rd] = (signed)(SR[rt]) >> MASK_SA(inst >> 6);
+         SR[rd] = (signed)(SR[rt]) >> MASK_SA(d->sa);
          SR[0] = 0x00000000;
          break;
       case 004: /* SLLV */
-         SR[rd] = SR[rt] << MASK_SA(SR[rs = inst >> 21]);
+         SR[rd] = SR[rt] << MASK_SA(SR[rs = d->rs]);
          SR[0] = 0x00000000;
          break;
       case 006: /* SRLV */
-         SR[rd] = (unsigned)(SR[rt]) >> MASK_SA(SR[rs = inst >> 21]);
+         SR[rd] = (unsigned)(SR[rt]) >> MASK_SA(SR[rs = d->rs]);
          SR[0] = 0x00000000;
          break;
       case 007: /* SRAV */
-         SR[rd] = (signed)(SR[rt]) >> MASK_SA(SR[rs = inst >> 21]);
+         SR[rd] = (signed)(SR[rt]) >> MASK_SA(SR[rs = d->rs]);
          SR[0] = 0x00000000;
          break;
       case 011: /* JALR */
          SR[rd] = (PC + LINK_OFF) & 0x00000FFC;
          SR[0] = 0x00000000;
-         SET_PC(SR[rs = inst >> 21]);
+         SET_PC(SR[rs = d->rs]);
 
 #ifdef INTENSE_DEBUG
          {
@@ -116,7 +169,7 @@ static INLINE unsigned SPECIAL(uint32_t inst, uint32_t PC)
 
          return 1;
       case 010: /* JR */
-         SET_PC(SR[rs = inst >> 21]);
+         SET_PC(SR[rs = d->rs]);
 #ifdef INTENSE_DEBUG
          {
             uint64_t hash = hash_imem((const uint8_t*)VR, sizeof(VR));
@@ -137,43 +190,43 @@ static INLINE unsigned SPECIAL(uint32_t inst, uint32_t PC)
          break;
       case 040: /* ADD */
       case 041: /* ADDU */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = SR[rs] + SR[rt];
          SR[0] = 0x00000000; /* needed for Rareware ucodes */
          break;
       case 042: /* SUB */
       case 043: /* SUBU */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = SR[rs] - SR[rt];
          SR[0] = 0x00000000;
          break;
       case 044: /* AND */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = SR[rs] & SR[rt];
          SR[0] = 0x00000000; /* needed for Rareware ucodes */
          break;
       case 045: /* OR */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = SR[rs] | SR[rt];
          SR[0] = 0x00000000;
          break;
       case 046: /* XOR */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = SR[rs] ^ SR[rt];
          SR[0] = 0x00000000;
          break;
       case 047: /* NOR */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = ~(SR[rs] | SR[rt]);
          SR[0] = 0x00000000;
          break;
       case 052: /* SLT */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = ((signed)(SR[rs]) < (signed)(SR[rt]));
          SR[0] = 0x00000000;
          break;
       case 053: /* SLTU */
-         rs = inst >> 21;
+         rs = d->rs;
          SR[rd] = ((unsigned)(SR[rs]) < (unsigned)(SR[rt]));
          SR[0] = 0x00000000;
          break;
@@ -185,26 +238,30 @@ static INLINE unsigned SPECIAL(uint32_t inst, uint32_t PC)
 
 static int PC;
 static int CPC;
+#ifdef HAVE_RSP_REPLAY
+static unsigned long long replay_instructions;
+#endif
 
 /* Allocate the RSP CPU loop to its own functional space. */
-static unsigned int run_task_opcode(uint32_t inst, const int opcode)
+static unsigned int run_task_opcode(const struct rsp_decoded *d)
 {
+   const uint32_t inst = d->inst;
    register int base;
    register int rd, rs, rt;
-   const unsigned int element = (inst & 0x000007FF) >> 7;
+   const unsigned int element = d->element;
 
-   switch (opcode)
+   switch (inst >> 26)
    {
       int16_t offset;
       register uint32_t addr;
 
       case 000: /* SPECIAL */
-         if (SPECIAL(inst, PC) != 0)
+         if (SPECIAL(d, PC) != 0)
             return 1; /* JR and JALR should return a non-zero value. */
          break;
       case 001: /* REGIMM */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          switch (rt)
          {
             case 020: /* BLTZAL */
@@ -241,74 +298,74 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          SET_PC(4*inst);
          return 1;
       case 004: /* BEQ */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          if (!(SR[rs] == SR[rt]))
             break;
          SET_PC(PC + 4*inst + SLOT_OFF);
          return 1;
       case 005: /* BNE */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          if (!(SR[rs] != SR[rt]))
             break;
          SET_PC(PC + 4*inst + SLOT_OFF);
          return 1;
       case 006: /* BLEZ */
-         if (!((signed)SR[rs = (inst >> 21) & 31] <= 0x00000000))
+         if (!((signed)SR[rs = d->rs] <= 0x00000000))
             break;
          SET_PC(PC + 4*inst + SLOT_OFF);
          return 1;
       case 007: /* BGTZ */
-         if (!((signed)SR[rs = (inst >> 21) & 31] >  0x00000000))
+         if (!((signed)SR[rs = d->rs] >  0x00000000))
             break;
          SET_PC(PC + 4*inst + SLOT_OFF);
          return 1;
       case 010: /* ADDI */
       case 011: /* ADDIU */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = SR[rs] + (signed short)(inst);
          SR[0] = 0x00000000;
          break;
       case 012: /* SLTI */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = ((signed)(SR[rs]) < (signed short)(inst));
          SR[0] = 0x00000000;
          break;
       case 013: /* SLTIU */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = ((unsigned)(SR[rs]) < (unsigned short)(inst));
          SR[0] = 0x00000000;
          break;
       case 014: /* ANDI */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = SR[rs] & (unsigned short)(inst);
          SR[0] = 0x00000000;
          break;
       case 015: /* ORI */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = SR[rs] | (unsigned short)(inst);
          SR[0] = 0x00000000;
          break;
       case 016: /* XORI */
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rs = d->rs;
+         rt = d->rt;
          SR[rt] = SR[rs] ^ (unsigned short)(inst);
          SR[0] = 0x00000000;
          break;
       case 017: /* LUI */
-         SR[rt = (inst >> 16) & 31] = inst << 16;
+         SR[rt = d->rt] = inst << 16;
          SR[0] = 0x00000000;
          break;
       case 020: /* COP0 */
-         rd = (inst & 0x0000F800u) >> 11;
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rd = d->rd;
+         rs = d->rs;
+         rt = d->rt;
          switch (rs)
          {
             case 000: /* MFC0 */
@@ -322,9 +379,9 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          }
          break;
       case 022: /* COP2 */
-         rd = (inst & 0x0000F800u) >> 11;
-         rs = (inst >> 21) & 31;
-         rt = (inst >> 16) & 31;
+         rd = d->rd;
+         rs = d->rs;
+         rt = d->rt;
          switch (rs)
          {
             case 000: /* MFC2 */
@@ -350,17 +407,17 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          }
          break;
       case 040: /* LB */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          SR[rt] = RSP.DMEM[BES(addr)];
          SR[rt] = (signed char)(SR[rt]);
          SR[0] = 0x00000000;
          break;
       case 041: /* LH */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          if (addr%0x004 == 0x003)
          {
             SR_B(rt, 2) = RSP.DMEM[addr - BES(0x000)];
@@ -376,9 +433,9 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          SR[0] = 0x00000000;
          break;
       case 043: /* LW */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          if (addr%0x004 != 0x000)
             ULW(rt, addr);
          else
@@ -386,17 +443,17 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          SR[0] = 0x00000000;
          break;
       case 044: /* LBU */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          SR[rt] = RSP.DMEM[BES(addr)];
          SR[rt] = (unsigned char)(SR[rt]);
          SR[0] = 0x00000000;
          break;
       case 045: /* LHU */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          if (addr%0x004 == 0x003)
          {
             SR_B(rt, 2) = RSP.DMEM[addr - BES(0x000)];
@@ -412,15 +469,15 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          SR[0] = 0x00000000;
          break;
       case 050: /* SB */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          RSP.DMEM[BES(addr)] = (unsigned char)(SR[rt]);
          break;
       case 051: /* SH */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          if (addr%0x004 == 0x003)
          {
             RSP.DMEM[addr - BES(0x000)] = SR_B(rt, 2);
@@ -432,25 +489,19 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
          *(short *)(RSP.DMEM + addr) = (short)(SR[rt]);
          break;
       case 053: /* SW */
-         rt = (inst >> 16) % (1 << 5);
+         rt = d->rt;
          offset = (signed short)(inst);
-         addr = (SR[base = (inst >> 21) & 31] + offset) & 0x00000FFF;
+         addr = (SR[base = d->rs] + offset) & 0x00000FFF;
          if (addr%0x004 != 0x000)
             USW(rt, addr);
          else
             *(int32_t *)(RSP.DMEM + addr) = SR[rt];
          break;
       case 062: /* LWC2 */
-         rt = (inst >> 16) % (1 << 5);
-         offset = (signed short)(inst & 0x0000FFFFu);
-#if defined(ARCH_MIN_SSE2)
-         offset <<= 5 + 4; /* safe on x86, skips 5-bit rd, 4-bit element */
-         offset >>= 5 + 4;
-#else
-         offset = SE(offset, 6);
-#endif
-         base = (inst >> 21) & 31;
-         LWC2_op[rd = (inst & 0xF800u) >> 11](rt, element, offset, base);
+         rt = d->rt;
+         offset = d->offset;
+         base = d->rs;
+         LWC2_op[rd = d->rd](rt, element, offset, base);
 
 #ifdef INTENSE_DEBUG
          {
@@ -462,16 +513,10 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
 
          break;
       case 072: /* SWC2 */
-         rt = (inst >> 16) % (1 << 5);
-         offset = (signed short)(inst & 0x0000FFFFu);
-#if defined(ARCH_MIN_SSE2)
-         offset <<= 5 + 4; /* safe on x86, skips 5-bit rd, 4-bit element */
-         offset >>= 5 + 4;
-#else
-         offset = SE(offset, 6);
-#endif
-         base = (inst >> 21) & 31;
-         SWC2_op[rd = (inst & 0xF800u) >> 11](rt, element, offset, base);
+         rt = d->rt;
+         offset = d->offset;
+         base = d->rs;
+         SWC2_op[rd = d->rd](rt, element, offset, base);
 
 #ifdef INTENSE_DEBUG
          {
@@ -491,6 +536,10 @@ static unsigned int run_task_opcode(uint32_t inst, const int opcode)
 
 NOINLINE void run_task(void)
 {
+#ifndef PREDECODE_IMEM
+    struct rsp_decoded fetched;
+#endif
+
     PC = FIT_IMEM(*RSP.SP_PC_REG);
 
 #ifdef INTENSE_DEBUG
@@ -519,38 +568,46 @@ NOINLINE void run_task(void)
        rsp_dump_block("VCC     ", &VCC, sizeof(VCC));
        uint16_t VCE = get_VCE();
        rsp_dump_block("VCE     ", &VCE, sizeof(VCE));
+       rsp_dump_rdram("RDRAM   ", RSP.RDRAM, MAX_DRAM_ADDR + 1);
     }
 #endif
 
+#ifdef PREDECODE_IMEM
+    predecode_imem();
+#define FETCH(d, pc)   ((d) = &imem_decoded[FIT_IMEM(pc) >> 2])
+#else
+#define FETCH(d, pc)   (decode_inst(&fetched, *(uint32_t *)(RSP.IMEM + FIT_IMEM(pc))), (d) = &fetched)
+#endif
+
     while ((*RSP.SP_STATUS_REG & 0x00000001) == 0x00000000)
     {
-       register uint32_t inst = *(uint32_t *)(RSP.IMEM + FIT_IMEM(PC));
+       const struct rsp_decoded *d;
+
+       FETCH(d, PC);
        CPC = FIT_IMEM(PC);
 #ifdef EMULATE_STATIC_PC
        PC = (PC + 0x004);
 EX:
+#endif
+#ifdef HAVE_RSP_REPLAY
+       ++replay_instructions;
 #endif
 
-       if (inst >> 25 == 0x25) /* is a VU instruction */
+       if (d->vu != NULL) /* is a VU instruction */
        {
-          const int opcode = inst % 64; /* inst.R.func */
-          const int vd = (inst & 0x000007FF) >> 6; /* inst.R.sa */
-          const int vs = (unsigned short)(inst) >> 11; /* inst.R.rd */
-          const int vt = (inst >> 16) & 31; /* inst.R.rt */
-          const int e  = (inst >> 21) & 0xF; /* rs & 0xF */
-
-          COP2_C2[opcode](vd, vs, vt, e);
+          /* vd is inst.R.sa, vs is inst.R.rd and e is rs & 0xF */
+          d->vu(d->sa, d->rd, d->rt, d->rs & 0xF);
 #ifdef INTENSE_DEBUG
           {
              uint64_t hash = hash_imem((const uint8_t*)VR, sizeof(VR));
-             fprintf(stderr, "CP2 (PC: %u): 0, %llu\n", opcode, hash);
+             fprintf(stderr, "CP2 (PC: %u): 0, %llu\n", d->inst % 64, hash);
           }
 #endif
        }
-       else if (run_task_opcode(inst, inst >> 26))
+       else if (run_task_opcode(d))
        {
 #ifdef EMULATE_STATIC_PC
-          inst = *(uint32_t *)(RSP.IMEM + FIT_IMEM(PC));
+          FETCH(d, PC);
           CPC = FIT_IMEM(PC);
           PC = temp_PC & 0x00000FFC;
           goto EX;
@@ -576,6 +633,7 @@ EX:
        continue;
     }
     *RSP.SP_PC_REG = 0x04001000 | FIT_IMEM(PC);
+#undef FETCH
 }
 
 static void DebugMessage(int level, const char *message, ...)
@@ -731,6 +789,7 @@ EXPORT unsigned int CALL cxd4DoRspCycles(unsigned int cycles)
       rsp_dump_block("VCC  END", &VCC, sizeof(VCC));
       uint16_t VCE = get_VCE();
       rsp_dump_block("VCE  END", &VCE, sizeof(VCE));
+      rsp_dump_rdram("RDRAMEND", RSP.RDRAM, MAX_DRAM_ADDR + 1);
 
       rsp_dump_end_trace();
    }
@@ -802,6 +861,13 @@ EXPORT void CALL cxd4InitiateRSP(RSP_INFO Rsp_Info, unsigned int *CycleCount)
     MF_SP_STATUS_TIMEOUT = 16384;
     stale_signals = 0;
 
+#ifdef VU_AVX
+    set_vu_backend(detect_vu_backend());
+#ifdef PREDECODE_IMEM
+    redecode_imem();
+#endif
+#endif
+
 #ifdef HAVE_RSP_DUMP
     const char *path = getenv("RSP_DUMP");
     rsp_open_trace(path ? path : "/tmp/dump.rsp");
@@ -1,16 +1,27 @@
 #include "rsp_dump.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
 static FILE *file;
 static bool in_trace;
 
+// RDRAM as of the last rsp_dump_rdram(), so only the pages which changed
+// since then have to be written.
+#define RDRAM_PAGE_SIZE 0x1000
+static uint8_t *rdram_shadow;
+static size_t rdram_shadow_size;
+
 void rsp_open_trace(const char *path)
 {
    file = fopen(path, "wb");
    fwrite("RSPDUMP1", 1, 8, file);
+
+   free(rdram_shadow);
+   rdram_shadow = nullptr;
+   rdram_shadow_size = 0;
 }
 
 void rsp_close_trace(void)
@@ -89,3 +100,33 @@ void rsp_dump_end_read_dma(void)
    fwrite("ENDDMA  ", 1, 8, file);
 }
 
+
+void rsp_dump_rdram(const char *tag, const void *rdram, size_t size)
+{
+   if (!file)
+      return;
+
+   if (rdram_shadow_size != size)
+   {
+      free(rdram_shadow);
+      rdram_shadow = (uint8_t *)calloc(1, size);
+      rdram_shadow_size = rdram_shadow ? size : 0;
+   }
+
+   const uint8_t *data = (const uint8_t *)rdram;
+   for (size_t offset = 0; offset + RDRAM_PAGE_SIZE <= rdram_shadow_size; offset += RDRAM_PAGE_SIZE)
+   {
+      if (memcmp(rdram_shadow + offset, data + offset, RDRAM_PAGE_SIZE) == 0)
+         continue;
+      memcpy(rdram_shadow + offset, data + offset, RDRAM_PAGE_SIZE);
+
+      uint32_t base_data = offset;
+      uint32_t size_data = RDRAM_PAGE_SIZE;
+
+      assert(strlen(tag) == 8);
+      fwrite(tag, 1, 8, file);
+      fwrite(&base_data, sizeof(base_data), 1, file);
+      fwrite(&size_data, sizeof(size_data), 1, file);
+      fwrite(data + offset, RDRAM_PAGE_SIZE, 1, file);
+   }
+}
@@ -19,6 +19,10 @@ void rsp_dump_begin_read_dma(void);
 void rsp_dump_poke_mem(unsigned base, const void *data, size_t size);
 void rsp_dump_end_read_dma(void);
 
+/* Writes the pages of RDRAM which changed since the last call as
+ * <tag> <offset> <size> <data> records. */
+void rsp_dump_rdram(const char *tag, const void *rdram, size_t size);
+
 int rsp_dump_recording_trace(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,239 @@
+#include "rsp_dump_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct parser
+{
+   const struct rsp_dump_trace *trace;
+   size_t pos;
+   const char *error; /* tag near which the trace is malformed */
+};
+
+static int next_tag(struct parser *p, const char *tag)
+{
+   if (p->pos > p->trace->size || p->trace->size - p->pos < 8 || memcmp(p->trace->data + p->pos, tag, 8) != 0)
+      return 0;
+   p->pos += 8;
+   return 1;
+}
+
+static uint32_t next_u32(struct parser *p)
+{
+   uint32_t value = 0;
+
+   if (p->pos <= p->trace->size && p->trace->size - p->pos >= 4)
+      memcpy(&value, p->trace->data + p->pos, 4);
+   p->pos += 4;
+   return value;
+}
+
+static void skip(struct parser *p, const char *tag, uint32_t size)
+{
+   if (p->pos > p->trace->size || p->trace->size - p->pos < size)
+   {
+      p->error = tag;
+      p->pos = p->trace->size;
+      return;
+   }
+   p->pos += size;
+}
+
+static struct rsp_dump_block read_block(struct parser *p, const char *tag)
+{
+   struct rsp_dump_block b = { 0, 0 };
+
+   if (p->error)
+      return b;
+   if (!next_tag(p, tag))
+   {
+      p->error = tag;
+      return b;
+   }
+   b.size = next_u32(p);
+   b.offset = p->pos;
+   skip(p, tag, b.size);
+   return b;
+}
+
+/* Counts the <tag> <offset> <size> <data> records of a run which stay
+ * below limit. */
+static unsigned read_records(struct parser *p, const char *tag, uint32_t limit)
+{
+   unsigned count = 0;
+
+   while (!p->error && next_tag(p, tag))
+   {
+      uint32_t offset = next_u32(p);
+      uint32_t size = next_u32(p);
+
+      if (offset > limit || size > limit - offset)
+         p->error = tag;
+      skip(p, tag, size);
+      count++;
+   }
+   return count;
+}
+
+static int index_trace(struct rsp_dump_trace *trace)
+{
+   struct parser p;
+   unsigned capacity = 0;
+
+   p.trace = trace;
+   p.pos = 8;
+   p.error = NULL;
+
+   while (!p.error && next_tag(&p, "BEGIN   "))
+   {
+      struct rsp_dump_task t;
+
+      t.dmem = read_block(&p, "DMEM    ");
+      t.imem = read_block(&p, "IMEM    ");
+      t.sr = read_block(&p, "SR32    ");
+      t.vr = read_block(&p, "VR32    ");
+      t.vlo = read_block(&p, "VLO     ");
+      t.vmd = read_block(&p, "VMD     ");
+      t.vhi = read_block(&p, "VHI     ");
+      t.pc = read_block(&p, "PC      ");
+      t.vco = read_block(&p, "VCO     ");
+      t.vcc = read_block(&p, "VCC     ");
+      t.vce = read_block(&p, "VCE     ");
+      t.rdram = p.pos;
+      t.rdram_pages = read_records(&p, "RDRAM   ", RSP_DUMP_RDRAM_SIZE);
+
+      t.dma = p.pos;
+      t.dmas = 0;
+      while (!p.error && next_tag(&p, "BEGINDMA"))
+      {
+         read_records(&p, "POKE    ", 0x2000);
+         if (!p.error && !next_tag(&p, "ENDDMA  "))
+            p.error = "ENDDMA  ";
+         t.dmas++;
+      }
+
+      t.dmem_end = read_block(&p, "DMEM END");
+      t.imem_end = read_block(&p, "IMEM END");
+      t.sr_end = read_block(&p, "SR32 END");
+      t.vr_end = read_block(&p, "VR32 END");
+      t.vlo_end = read_block(&p, "VLO  END");
+      t.vmd_end = read_block(&p, "VMD  END");
+      t.vhi_end = read_block(&p, "VHI  END");
+      t.vco_end = read_block(&p, "VCO  END");
+      t.vcc_end = read_block(&p, "VCC  END");
+      t.vce_end = read_block(&p, "VCE  END");
+      t.rdram_end = p.pos;
+      t.rdram_end_pages = read_records(&p, "RDRAMEND", RSP_DUMP_RDRAM_SIZE);
+      if (!p.error && !next_tag(&p, "END     "))
+         p.error = "END     ";
+      if (p.error)
+         break;
+
+      if (t.dmem.size != 0x1000 || t.imem.size != 0x1000 || t.pc.size != 4
+            || t.dmem_end.size != 0x1000 || t.imem_end.size != 0x1000)
+      {
+         p.error = "DMEM    ";
+         break;
+      }
+
+      if (trace->task_count == capacity)
+      {
+         struct rsp_dump_task *tasks;
+
+         capacity = capacity ? 2 * capacity : 256;
+         tasks = (struct rsp_dump_task*)realloc(trace->tasks, capacity * sizeof(*tasks));
+         if (!tasks)
+         {
+            fprintf(stderr, "out of memory\n");
+            return 0;
+         }
+         trace->tasks = tasks;
+      }
+      trace->tasks[trace->task_count++] = t;
+   }
+
+   if (!p.error && !next_tag(&p, "EOF     "))
+      p.error = "EOF     ";
+   if (p.error)
+   {
+      fprintf(stderr, "malformed trace near tag \"%s\"\n", p.error);
+      return 0;
+   }
+   return 1;
+}
+
+int rsp_dump_load_trace(struct rsp_dump_trace *trace, const char *path)
+{
+   FILE *file = fopen(path, "rb");
+   long size;
+
+   memset(trace, 0, sizeof(*trace));
+   if (!file)
+   {
+      fprintf(stderr, "cannot open %s\n", path);
+      return 0;
+   }
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   trace->data = (unsigned char*)malloc(size > 0 ? size : 1);
+   if (!trace->data || size < 8 || fread(trace->data, 1, size, file) != (size_t)size
+         || memcmp(trace->data, "RSPDUMP1", 8) != 0)
+   {
+      fprintf(stderr, "%s is not an RSP trace\n", path);
+      fclose(file);
+      rsp_dump_free_trace(trace);
+      return 0;
+   }
+   fclose(file);
+   trace->size = size;
+
+   if (!index_trace(trace))
+   {
+      rsp_dump_free_trace(trace);
+      return 0;
+   }
+   return 1;
+}
+
+void rsp_dump_free_trace(struct rsp_dump_trace *trace)
+{
+   free(trace->data);
+   free(trace->tasks);
+   memset(trace, 0, sizeof(*trace));
+}
+
+void rsp_dump_apply_pages(const struct rsp_dump_trace *trace, size_t at,
+      unsigned count, unsigned char *rdram)
+{
+   while (count--)
+   {
+      uint32_t offset, size;
+
+      memcpy(&offset, trace->data + at + 8, 4);
+      memcpy(&size, trace->data + at + 12, 4);
+      memcpy(rdram + offset, trace->data + at + 16, size);
+      at += 16 + size;
+   }
+}
+
+int rsp_dump_apply_dma(const struct rsp_dump_trace *trace, size_t *at,
+      unsigned char *sp_mem)
+{
+   size_t pos = *at + 8; /* BEGINDMA */
+   int imem = 0;
+
+   while (memcmp(trace->data + pos, "POKE    ", 8) == 0)
+   {
+      uint32_t offset, size;
+
+      memcpy(&offset, trace->data + pos + 8, 4);
+      memcpy(&size, trace->data + pos + 12, 4);
+      memcpy(sp_mem + offset, trace->data + pos + 16, size);
+      imem |= offset + size > 0x1000;
+      pos += 16 + size;
+   }
+
+   *at = pos + 8; /* ENDDMA */
+   return imem;
+}
@@ -0,0 +1,62 @@
+#ifndef RSP_DUMP_READER_H__
+#define RSP_DUMP_READER_H__
+
+/* Reads the RSPDUMP1 traces written by rsp_dump.cpp, for the tools which
+ * replay them (replay.c, tools/rsp-replay.c). */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest RDRAM offset a trace may record */
+#define RSP_DUMP_RDRAM_SIZE 0x800000
+
+/* Offset and size of a block in the trace. */
+struct rsp_dump_block
+{
+   size_t offset;
+   uint32_t size;
+};
+
+/* A BEGIN ... END record: one DoRspCycles call. */
+struct rsp_dump_task
+{
+   struct rsp_dump_block dmem, imem, sr, vr, vlo, vmd, vhi, pc, vco, vcc, vce;
+   struct rsp_dump_block dmem_end, imem_end, sr_end, vr_end, vlo_end, vmd_end,
+         vhi_end, vco_end, vcc_end, vce_end;
+   /* runs of <tag> <offset> <size> <data> records: RDRAM pages before and
+    * after the call, and BEGINDMA ... ENDDMA transfers to SP memory */
+   size_t rdram, dma, rdram_end;
+   unsigned rdram_pages, dmas, rdram_end_pages;
+};
+
+struct rsp_dump_trace
+{
+   unsigned char *data;
+   size_t size;
+   struct rsp_dump_task *tasks;
+   unsigned task_count;
+};
+
+/* Loads and indexes a trace, prints why to stderr and returns 0 if it
+ * can't. */
+int rsp_dump_load_trace(struct rsp_dump_trace *trace, const char *path);
+void rsp_dump_free_trace(struct rsp_dump_trace *trace);
+
+/* Copies the RDRAM pages of a run into rdram. */
+void rsp_dump_apply_pages(const struct rsp_dump_trace *trace, size_t at,
+      unsigned count, unsigned char *rdram);
+
+/* Copies the transfer at *at into sp_mem (DMEM then IMEM) and moves *at to
+ * the next one, returns non-zero if it wrote to IMEM. */
+int rsp_dump_apply_dma(const struct rsp_dump_trace *trace, size_t *at,
+      unsigned char *sp_mem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -142,6 +142,15 @@ static void MT_DMA_DRAM(int rt)
 void log_rsp_mem(void);
 #endif
 
+#ifdef PREDECODE_IMEM
+static void predecode_imem(void);
+#endif
+
+#ifdef HAVE_RSP_REPLAY
+/* replay.c feeds DMA reads from the transfers recorded in the trace */
+static int rsp_replay_read_dma(void);
+#endif
+
 static void MT_DMA_READ_LENGTH(int rt)
 {
     unsigned int offC, offD; /* SP cache and dynamic DMA pointers */
@@ -151,6 +160,17 @@ static void MT_DMA_READ_LENGTH(int rt)
 #endif
 
     *RSP.SP_RD_LEN_REG = SR[rt] | 07;
+#ifdef HAVE_RSP_REPLAY
+#ifdef PREDECODE_IMEM
+    if (rsp_replay_read_dma()) /* overlay loaded into IMEM */
+       predecode_imem();
+#else
+    rsp_replay_read_dma();
+#endif
+    *RSP.SP_DMA_BUSY_REG = 0x00000000;
+    *RSP.SP_STATUS_REG &= ~SP_STATUS_DMA_BUSY;
+    return;
+#endif
     {
        unsigned int length = (*RSP.SP_RD_LEN_REG & 0x00000FFF) >>  0;
        unsigned int count  = (*RSP.SP_RD_LEN_REG & 0x000FF000) >> 12;
@@ -192,6 +212,10 @@ static void MT_DMA_READ_LENGTH(int rt)
 
        if ((offC & 0x1000) ^ (*RSP.SP_MEM_ADDR_REG & 0x1000))
 	  message("DMA over the DMEM-to-IMEM gap.", 3);
+#ifdef PREDECODE_IMEM
+       if ((offC | *RSP.SP_MEM_ADDR_REG) & 0x1000) /* overlay loaded into IMEM */
+          predecode_imem();
+#endif
        *RSP.SP_DMA_BUSY_REG = 0x00000000;
        *RSP.SP_STATUS_REG &= ~SP_STATUS_DMA_BUSY;
     }
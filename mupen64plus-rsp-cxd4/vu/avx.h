@@ -0,0 +1,668 @@
+/******************************************************************************\
+* Project:  MSP Emulation Layer for Vector Unit Computational Operations       *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+#ifndef _AVX_H
+#define _AVX_H
+
+/*
+ * AVX2 and AVX-512 versions of the multiply, clip and reciprocal op-codes.
+ *
+ * They are compiled with per-function target attributes next to the SSE2
+ * versions, so the plug-in still runs on any SSE2 host;  set_vu_backend()
+ * patches them into COP2_C2 when the host CPU supports them.  Every one of
+ * them has to produce exactly the same VD, accumulator and flags as the op
+ * it replaces, lane for lane (see vufuzz.c).
+ *
+ * An RSP vector is eight 16-bit lanes, so one XMM holds all of it:  the
+ * AVX2 versions stay 128 bits wide and mostly win by selecting elements
+ * with one PSHUFB instead of a call through SSE2_SHUFFLE_16, by replacing
+ * the scalar loops of the SSE2 build, and by VEX three-operand forms.  The
+ * AVX-512 versions of the multiply-accumulate ops use AVX-512BW/VL on the
+ * same XMM registers, taking the carries out of the accumulator and the
+ * clamp conditions as unsigned compares into mask registers.  (Fusing the
+ * 48-bit accumulators as 64-bit lanes of a ZMM was slower than AVX2:  VACC
+ * is kept split as HI, MD and LO, so every op paid for converting it.)
+ */
+#include "vu.h"
+
+#include <immintrin.h>
+#include <features/features_cpu.h>
+
+#define TARGET_AVX2     __attribute__((target("avx2")))
+#define TARGET_AVX512   \
+    __attribute__((target("avx2,avx512f,avx512bw,avx512vl")))
+
+enum {
+    VU_BACKEND_SSE2,
+    VU_BACKEND_AVX2,
+    VU_BACKEND_AVX512
+};
+
+TARGET_AVX2 INLINE static __m128i shuffle_avx2(short* VT, int e)
+{
+    __m128i xmm, key;
+
+    xmm = _mm_load_si128((__m128i *)VT);
+    key = _mm_loadu_si128((__m128i *)(smask[e]));
+    return _mm_shuffle_epi8(xmm, key);
+}
+
+/*
+ * all ones in every lane where the unsigned sum = x + y wrapped around
+ */
+TARGET_AVX2 INLINE static __m128i carry_avx2(__m128i sum, __m128i y)
+{
+    __m128i no_carry;
+
+    no_carry = _mm_cmpeq_epi16(_mm_max_epu16(sum, y), sum);
+    return _mm_xor_si128(no_carry, _mm_set1_epi32(~0));
+}
+
+/*
+ * accumulator += (a2:a1:a0), with the 48-bit carries done exactly
+ */
+TARGET_AVX2 INLINE static void acc_add_avx2(
+    __m128i* lo, __m128i* md, __m128i* hi, __m128i a0, __m128i a1, __m128i a2)
+{
+    __m128i c0, c1, c2;
+
+    *lo = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_L), a0);
+    c0 = carry_avx2(*lo, a0);
+    *md = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_M), a1);
+    c1 = carry_avx2(*md, a1);
+    c2 = _mm_and_si128(c0, _mm_cmpeq_epi16(*md, _mm_set1_epi32(~0)));
+    *md = _mm_sub_epi16(*md, c0);
+    *hi = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_H), a2);
+    *hi = _mm_sub_epi16(*hi, _mm_or_si128(c1, c2)); /* never both at once */
+
+    _mm_store_si128((__m128i *)VACC_L, *lo);
+    _mm_store_si128((__m128i *)VACC_M, *md);
+    _mm_store_si128((__m128i *)VACC_H, *hi);
+    return;
+}
+
+/*
+ * sign-clamp of accumulator bits 47..16, as SIGNED_CLAMP_AM
+ */
+TARGET_AVX2 INLINE static __m128i clamp_am_avx2(__m128i md, __m128i hi)
+{
+    return _mm_packs_epi32(
+        _mm_unpacklo_epi16(md, hi), _mm_unpackhi_epi16(md, hi));
+}
+
+/*
+ * accumulator-low clamp, as SIGNED_CLAMP_AL
+ */
+TARGET_AVX2 INLINE static __m128i clamp_al_avx2(
+    __m128i lo, __m128i md, __m128i hi)
+{
+    __m128i clamped, raw;
+
+    clamped = clamp_am_avx2(md, hi);
+    raw = _mm_cmpeq_epi16(md, clamped);
+    clamped = _mm_xor_si128(clamped, _mm_set1_epi16((short)0x8000));
+    return _mm_blendv_epi8(clamped, lo, raw);
+}
+
+/*
+ * sign-zero hybrid clamp, as UNSIGNED_CLAMP
+ */
+TARGET_AVX2 INLINE static __m128i clamp_u_avx2(__m128i md, __m128i hi)
+{
+    __m128i clamped, cond;
+
+    clamped = clamp_am_avx2(md, hi);
+    cond = _mm_cmpgt_epi16(clamped, md);
+    clamped = _mm_andnot_si128(_mm_srai_epi16(clamped, 15), clamped);
+    return _mm_or_si128(clamped, cond);
+}
+
+/*
+ * VMULF and VMULU:  acc = (VS * VT) * 2 + 0x8000
+ * The rounding add is done at half scale on the 32-bit product first.
+ */
+TARGET_AVX2 INLINE static __m128i mulf_avx2(
+    __m128i vs, __m128i vt, __m128i* eq)
+{
+    __m128i prod_lo, prod_hi, round;
+    __m128i md, hi;
+
+    prod_lo = _mm_mullo_epi16(vs, vt);
+    prod_hi = _mm_mulhi_epi16(vs, vt);
+    *eq = _mm_cmpeq_epi16(vs, vt);
+
+    round = _mm_add_epi16(prod_lo, _mm_set1_epi16(0x4000));
+    prod_lo = _mm_andnot_si128(round, prod_lo); /* sign flipped:  carry out */
+    prod_hi = _mm_sub_epi16(prod_hi, _mm_srai_epi16(prod_lo, 15));
+    md = _mm_or_si128(_mm_slli_epi16(prod_hi, 1), _mm_srli_epi16(round, 15));
+    hi = _mm_andnot_si128(*eq, _mm_srai_epi16(md, 15)); /* -32768 * -32768 */
+
+    _mm_store_si128((__m128i *)VACC_L, _mm_slli_epi16(round, 1));
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    return (md);
+}
+
+TARGET_AVX2 static void VMULF_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i md, eq;
+
+    md = mulf_avx2(
+        _mm_load_si128((__m128i *)VR[vs]), shuffle_avx2(VR[vt], e), &eq);
+    eq = _mm_and_si128(eq, _mm_srai_epi16(md, 15));
+    _mm_store_si128((__m128i *)VR[vd], _mm_add_epi16(md, eq));
+    return;
+}
+
+TARGET_AVX2 static void VMULU_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i md, eq, sign;
+
+    md = mulf_avx2(
+        _mm_load_si128((__m128i *)VR[vs]), shuffle_avx2(VR[vt], e), &eq);
+    sign = _mm_srai_epi16(md, 15);
+    md = _mm_or_si128(md, sign);
+    md = _mm_andnot_si128(_mm_andnot_si128(eq, sign), md);
+    _mm_store_si128((__m128i *)VR[vd], md);
+    return;
+}
+
+TARGET_AVX2 static void VMUDL_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i lo;
+
+    lo = _mm_mulhi_epu16(
+        _mm_load_si128((__m128i *)VR[vs]), shuffle_avx2(VR[vt], e));
+    _mm_store_si128((__m128i *)VACC_L, lo);
+    _mm_store_si128((__m128i *)VACC_M, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)VACC_H, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)VR[vd], lo);
+    return;
+}
+
+TARGET_AVX2 static void VMUDM_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, lo, md;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    lo = _mm_mullo_epi16(vs_, vt_);
+    md = _mm_mulhi_epu16(vs_, vt_);
+    md = _mm_sub_epi16(md, _mm_and_si128(vt_, _mm_srai_epi16(vs_, 15)));
+
+    _mm_store_si128((__m128i *)VACC_L, lo);
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, _mm_srai_epi16(md, 15));
+    _mm_store_si128((__m128i *)VR[vd], md);
+    return;
+}
+
+TARGET_AVX2 static void VMUDN_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, lo, md;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    lo = _mm_mullo_epi16(vs_, vt_);
+    md = _mm_mulhi_epu16(vs_, vt_);
+    md = _mm_sub_epi16(md, _mm_and_si128(vs_, _mm_srai_epi16(vt_, 15)));
+
+    _mm_store_si128((__m128i *)VACC_L, lo);
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, _mm_srai_epi16(md, 15));
+    _mm_store_si128((__m128i *)VR[vd], lo);
+    return;
+}
+
+TARGET_AVX2 static void VMUDH_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    md = _mm_mullo_epi16(vs_, vt_);
+    hi = _mm_mulhi_epi16(vs_, vt_);
+
+    _mm_store_si128((__m128i *)VACC_L, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+/*
+ * VMACF and VMACU:  acc += (VS * VT) * 2
+ */
+TARGET_AVX2 INLINE static void macf_avx2(
+    __m128i* lo, __m128i* md, __m128i* hi, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epi16(vs_, vt_);
+    acc_add_avx2(lo, md, hi,
+        _mm_slli_epi16(prod_lo, 1),
+        _mm_or_si128(_mm_slli_epi16(prod_hi, 1), _mm_srli_epi16(prod_lo, 15)),
+        _mm_srai_epi16(prod_hi, 15));
+    return;
+}
+
+TARGET_AVX2 static void VMACF_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i lo, md, hi;
+
+    macf_avx2(&lo, &md, &hi, vs, vt, e);
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+TARGET_AVX2 static void VMACU_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i lo, md, hi;
+
+    macf_avx2(&lo, &md, &hi, vs, vt, e);
+    _mm_store_si128((__m128i *)VR[vd], clamp_u_avx2(md, hi));
+    return;
+}
+
+TARGET_AVX2 static void VMADL_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i lo, md, hi, prod, carry;
+
+    prod = _mm_mulhi_epu16(
+        _mm_load_si128((__m128i *)VR[vs]), shuffle_avx2(VR[vt], e));
+    lo = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_L), prod);
+    carry = carry_avx2(lo, prod);
+    md = _mm_sub_epi16(_mm_load_si128((__m128i *)VACC_M), carry);
+    carry = _mm_and_si128(carry, _mm_cmpeq_epi16(md, _mm_setzero_si128()));
+    hi = _mm_sub_epi16(_mm_load_si128((__m128i *)VACC_H), carry);
+
+    _mm_store_si128((__m128i *)VACC_L, lo);
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    _mm_store_si128((__m128i *)VR[vd], clamp_al_avx2(lo, md, hi));
+    return;
+}
+
+TARGET_AVX2 static void VMADM_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i lo, md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epu16(vs_, vt_);
+    prod_hi = _mm_sub_epi16(prod_hi, _mm_and_si128(vt_, _mm_srai_epi16(vs_, 15)));
+    acc_add_avx2(&lo, &md, &hi, prod_lo, prod_hi, _mm_srai_epi16(prod_hi, 15));
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+TARGET_AVX2 static void VMADN_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i lo, md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epu16(vs_, vt_);
+    prod_hi = _mm_sub_epi16(prod_hi, _mm_and_si128(vs_, _mm_srai_epi16(vt_, 15)));
+    acc_add_avx2(&lo, &md, &hi, prod_lo, prod_hi, _mm_srai_epi16(prod_hi, 15));
+    _mm_store_si128((__m128i *)VR[vd], clamp_al_avx2(lo, md, hi));
+    return;
+}
+
+TARGET_AVX2 static void VMADH_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epi16(vs_, vt_);
+
+    md = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_M), prod_lo);
+    hi = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_H), prod_hi);
+    hi = _mm_sub_epi16(hi, carry_avx2(md, prod_lo));
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+/*
+ * The flags registers are arrays of 0 or 1 per lane;  the clip ops work
+ * with all-ones masks in between.
+ */
+#define FLAG_TO_MASK(flag)  \
+    _mm_sub_epi16(_mm_setzero_si128(), _mm_load_si128((__m128i *)(flag)))
+#define MASK_TO_FLAG(flag, mask)    \
+    _mm_store_si128((__m128i *)(flag), _mm_srli_epi16(mask, 15))
+
+TARGET_AVX2 static void VCH_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, vc, sn, eq, ge, le, ext, sel;
+    const __m128i ones = _mm_set1_epi32(~0);
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+
+    sn = _mm_srai_epi16(_mm_xor_si128(vs_, vt_), 15);
+    vc = _mm_xor_si128(vt_, sn);
+    ext = _mm_and_si128(_mm_cmpeq_epi16(vs_, vc), sn); /* VS == ~VT */
+    vc = _mm_sub_epi16(vc, sn); /* conditional negation of VT, if (sn) */
+    eq = _mm_or_si128(_mm_cmpeq_epi16(vs_, vc), ext);
+
+    ge = _mm_cmpgt_epi16(vt_, _mm_or_si128(sn, vs_));
+    ge = _mm_xor_si128(ge, ones);
+    le = _mm_cmpgt_epi16(_mm_sub_epi16(vc, vs_), ones); /* VC - VS >= 0 */
+    le = _mm_blendv_epi8(_mm_srai_epi16(vt_, 15), le, sn);
+    sel = _mm_blendv_epi8(ge, le, sn);
+    vc = _mm_blendv_epi8(vs_, vc, sel);
+
+    _mm_store_si128((__m128i *)VACC_L, vc);
+    _mm_store_si128((__m128i *)VR[vd], vc);
+    MASK_TO_FLAG(clip, ge);
+    MASK_TO_FLAG(comp, le);
+    MASK_TO_FLAG(ne, _mm_xor_si128(eq, ones));
+    MASK_TO_FLAG(co, sn);
+    MASK_TO_FLAG(vce, ext);
+    return;
+}
+
+TARGET_AVX2 static void VCL_AVX2(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, vc, sn, eq, ext, ge, le, lz, uz, sel;
+    const __m128i ones = _mm_set1_epi32(~0);
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    sn = FLAG_TO_MASK(co);
+    eq = _mm_cmpeq_epi16(_mm_load_si128((__m128i *)ne), _mm_setzero_si128());
+    ext = FLAG_TO_MASK(vce);
+
+    vc = _mm_sub_epi16(_mm_xor_si128(vt_, sn), sn);
+    lz = _mm_cmpeq_epi16(vs_, vc);
+    uz = _mm_xor_si128(vs_, ones); /* no carry out of VS + VT:  VT <= ~VS */
+    uz = _mm_cmpeq_epi16(_mm_max_epu16(vt_, uz), uz);
+
+    le = _mm_and_si128(_mm_or_si128(lz, uz), ext);
+    le = _mm_or_si128(_mm_andnot_si128(ext, _mm_and_si128(lz, uz)), le);
+    ge = _mm_cmpeq_epi16(_mm_max_epu16(vs_, vc), vs_); /* VS >= VC */
+
+    le = _mm_blendv_epi8(FLAG_TO_MASK(comp), le, _mm_and_si128(eq, sn));
+    ge = _mm_blendv_epi8(FLAG_TO_MASK(clip), ge, _mm_andnot_si128(sn, eq));
+    sel = _mm_blendv_epi8(ge, le, sn);
+    vc = _mm_blendv_epi8(vs_, vc, sel);
+
+    _mm_store_si128((__m128i *)VACC_L, vc);
+    _mm_store_si128((__m128i *)VR[vd], vc);
+    MASK_TO_FLAG(clip, ge);
+    MASK_TO_FLAG(comp, le);
+    _mm_store_si128((__m128i *)ne, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)co, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)vce, _mm_setzero_si128());
+    return;
+}
+
+/*
+ * The reciprocals are a scalar ROM look-up;  only the copy of the selected
+ * elements of VT into the accumulator is vectorized.
+ */
+TARGET_AVX2 static void VRCP_AVX2(int vd, int de, int vt, int e)
+{
+    DivIn = (int)VR[vt][e & 07];
+    do_div(DivIn, SP_DIV_SQRT_NO, SP_DIV_PRECISION_SINGLE);
+    _mm_store_si128((__m128i *)VACC_L, shuffle_avx2(VR[vt], e));
+    VR[vd][de &= 07] = (short)DivOut;
+    DPH = SP_DIV_PRECISION_SINGLE;
+    return;
+}
+
+TARGET_AVX2 static void VRCPL_AVX2(int vd, int de, int vt, int e)
+{
+    if (DPH)
+       DivIn = DivIn | (unsigned short)VR[vt][e & 07];
+    else
+       DivIn = VR[vt][e & 07];
+
+    do_div(DivIn, SP_DIV_SQRT_NO, DPH);
+    _mm_store_si128((__m128i *)VACC_L, shuffle_avx2(VR[vt], e));
+    VR[vd][de &= 07] = (short)DivOut;
+    DPH = SP_DIV_PRECISION_SINGLE;
+    return;
+}
+
+TARGET_AVX2 static void VRCPH_AVX2(int vd, int de, int vt, int e)
+{
+    DivIn = VR[vt][e & 07] << 16;
+    _mm_store_si128((__m128i *)VACC_L, shuffle_avx2(VR[vt], e));
+    VR[vd][de &= 07] = DivOut >> 16;
+    DPH = SP_DIV_PRECISION_DOUBLE;
+    return;
+}
+
+/*
+ * AVX-512 (with the BW and VL extensions on XMM):  unsigned compares and
+ * per-lane selects straight into and out of mask registers
+ */
+TARGET_AVX512 INLINE static void acc_add_avx512(
+    __m128i* lo, __m128i* md, __m128i* hi, __m128i a0, __m128i a1, __m128i a2)
+{
+    const __m128i ones = _mm_set1_epi32(~0);
+    __mmask8 c0, c1;
+
+    *lo = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_L), a0);
+    c0 = _mm_cmplt_epu16_mask(*lo, a0);
+    *md = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_M), a1);
+    c1 = _mm_cmplt_epu16_mask(*md, a1);
+    c1 |= c0 & _mm_cmpeq_epi16_mask(*md, ones);
+    *md = _mm_mask_sub_epi16(*md, c0, *md, ones);
+    *hi = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_H), a2);
+    *hi = _mm_mask_sub_epi16(*hi, c1, *hi, ones);
+
+    _mm_store_si128((__m128i *)VACC_L, *lo);
+    _mm_store_si128((__m128i *)VACC_M, *md);
+    _mm_store_si128((__m128i *)VACC_H, *hi);
+    return;
+}
+
+TARGET_AVX512 INLINE static __m128i clamp_al_avx512(
+    __m128i lo, __m128i md, __m128i hi)
+{
+    __m128i clamped;
+
+    clamped = clamp_am_avx2(md, hi);
+    return _mm_mask_blend_epi16(_mm_cmpneq_epi16_mask(clamped, md),
+        lo, _mm_xor_si128(clamped, _mm_set1_epi16((short)0x8000)));
+}
+
+TARGET_AVX512 INLINE static __m128i clamp_u_avx512(__m128i md, __m128i hi)
+{
+    __m128i clamped;
+
+    clamped = clamp_am_avx2(md, hi);
+    return _mm_mask_mov_epi16(_mm_max_epi16(clamped, _mm_setzero_si128()),
+        _mm_cmpgt_epi16_mask(clamped, md), _mm_set1_epi32(~0));
+}
+
+TARGET_AVX512 INLINE static void macf_avx512(
+    __m128i* lo, __m128i* md, __m128i* hi, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epi16(vs_, vt_);
+    acc_add_avx512(lo, md, hi,
+        _mm_slli_epi16(prod_lo, 1),
+        _mm_or_si128(_mm_slli_epi16(prod_hi, 1), _mm_srli_epi16(prod_lo, 15)),
+        _mm_srai_epi16(prod_hi, 15));
+    return;
+}
+
+TARGET_AVX512 static void VMACF_AVX512(int vd, int vs, int vt, int e)
+{
+    __m128i lo, md, hi;
+
+    macf_avx512(&lo, &md, &hi, vs, vt, e);
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+TARGET_AVX512 static void VMACU_AVX512(int vd, int vs, int vt, int e)
+{
+    __m128i lo, md, hi;
+
+    macf_avx512(&lo, &md, &hi, vs, vt, e);
+    _mm_store_si128((__m128i *)VR[vd], clamp_u_avx512(md, hi));
+    return;
+}
+
+TARGET_AVX512 static void VMADL_AVX512(int vd, int vs, int vt, int e)
+{
+    const __m128i ones = _mm_set1_epi32(~0);
+    __m128i lo, md, hi, prod;
+    __mmask8 carry;
+
+    prod = _mm_mulhi_epu16(
+        _mm_load_si128((__m128i *)VR[vs]), shuffle_avx2(VR[vt], e));
+    lo = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_L), prod);
+    carry = _mm_cmplt_epu16_mask(lo, prod);
+    md = _mm_load_si128((__m128i *)VACC_M);
+    md = _mm_mask_sub_epi16(md, carry, md, ones);
+    carry &= _mm_cmpeq_epi16_mask(md, _mm_setzero_si128());
+    hi = _mm_load_si128((__m128i *)VACC_H);
+    hi = _mm_mask_sub_epi16(hi, carry, hi, ones);
+
+    _mm_store_si128((__m128i *)VACC_L, lo);
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    _mm_store_si128((__m128i *)VR[vd], clamp_al_avx512(lo, md, hi));
+    return;
+}
+
+TARGET_AVX512 static void VMADM_AVX512(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i lo, md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epu16(vs_, vt_);
+    prod_hi = _mm_mask_sub_epi16(
+        prod_hi, _mm_movepi16_mask(vs_), prod_hi, vt_);
+    acc_add_avx512(&lo, &md, &hi, prod_lo, prod_hi, _mm_srai_epi16(prod_hi, 15));
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+TARGET_AVX512 static void VMADN_AVX512(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i lo, md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epu16(vs_, vt_);
+    prod_hi = _mm_mask_sub_epi16(
+        prod_hi, _mm_movepi16_mask(vt_), prod_hi, vs_);
+    acc_add_avx512(&lo, &md, &hi, prod_lo, prod_hi, _mm_srai_epi16(prod_hi, 15));
+    _mm_store_si128((__m128i *)VR[vd], clamp_al_avx512(lo, md, hi));
+    return;
+}
+
+TARGET_AVX512 static void VMADH_AVX512(int vd, int vs, int vt, int e)
+{
+    __m128i vs_, vt_, prod_lo, prod_hi;
+    __m128i md, hi;
+
+    vs_ = _mm_load_si128((__m128i *)VR[vs]);
+    vt_ = shuffle_avx2(VR[vt], e);
+    prod_lo = _mm_mullo_epi16(vs_, vt_);
+    prod_hi = _mm_mulhi_epi16(vs_, vt_);
+
+    md = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_M), prod_lo);
+    hi = _mm_add_epi16(_mm_load_si128((__m128i *)VACC_H), prod_hi);
+    hi = _mm_mask_sub_epi16(hi, _mm_cmplt_epu16_mask(md, prod_lo), hi,
+        _mm_set1_epi32(~0));
+    _mm_store_si128((__m128i *)VACC_M, md);
+    _mm_store_si128((__m128i *)VACC_H, hi);
+    _mm_store_si128((__m128i *)VR[vd], clamp_am_avx2(md, hi));
+    return;
+}
+
+static int detect_vu_backend(void)
+{
+    const uint64_t simd = cpu_features_get();
+
+/*
+ * RETRO_SIMD_AVX also checks that the OS saves the YMM state;  the AVX2
+ * bit alone is only CPUID.  There is no RETRO_SIMD_* bit for AVX-512.
+ */
+    if (!(simd & RETRO_SIMD_AVX) || !(simd & RETRO_SIMD_AVX2))
+        return VU_BACKEND_SSE2;
+    if (__builtin_cpu_supports("avx512f")
+     && __builtin_cpu_supports("avx512bw")
+     && __builtin_cpu_supports("avx512vl"))
+        return VU_BACKEND_AVX512;
+    return VU_BACKEND_AVX2;
+}
+
+static void set_vu_backend(int backend)
+{
+    static void (*SSE2_C2[64])(int, int, int, int);
+
+    if (SSE2_C2[0] == NULL)
+        memcpy(SSE2_C2, COP2_C2, sizeof(SSE2_C2));
+    memcpy(COP2_C2, SSE2_C2, sizeof(COP2_C2));
+
+    if (backend >= VU_BACKEND_AVX2)
+    {
+        COP2_C2[000] = VMULF_AVX2;
+        COP2_C2[001] = VMULU_AVX2;
+        COP2_C2[004] = VMUDL_AVX2;
+        COP2_C2[005] = VMUDM_AVX2;
+        COP2_C2[006] = VMUDN_AVX2;
+        COP2_C2[007] = VMUDH_AVX2;
+        COP2_C2[010] = VMACF_AVX2;
+        COP2_C2[011] = VMACU_AVX2;
+        COP2_C2[014] = VMADL_AVX2;
+        COP2_C2[015] = VMADM_AVX2;
+        COP2_C2[016] = VMADN_AVX2;
+        COP2_C2[017] = VMADH_AVX2;
+        COP2_C2[044] = VCL_AVX2;
+        COP2_C2[045] = VCH_AVX2;
+        COP2_C2[060] = VRCP_AVX2;
+        COP2_C2[061] = VRCPL_AVX2;
+        COP2_C2[062] = VRCPH_AVX2;
+    }
+    if (backend >= VU_BACKEND_AVX512)
+    {
+        COP2_C2[010] = VMACF_AVX512;
+        COP2_C2[011] = VMACU_AVX512;
+        COP2_C2[014] = VMADL_AVX512;
+        COP2_C2[015] = VMADM_AVX512;
+        COP2_C2[016] = VMADN_AVX512;
+        COP2_C2[017] = VMADH_AVX512;
+    }
+    return;
+}
+#endif
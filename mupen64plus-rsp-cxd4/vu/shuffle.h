@@ -73,7 +73,7 @@ INLINE static void SHUFFLE_VECTOR(short* VD, short* VT, const int e)
     return;
 }
 #else
-#ifdef ARCH_MIN_SSSE3
+#if defined(ARCH_MIN_SSSE3) || defined(VU_AVX)
 static const unsigned char smask[16][16] = {
     {0x0,0x1,0x2,0x3,0x4,0x5,0x6,0x7,0x8,0x9,0xA,0xB,0xC,0xD,0xE,0xF},
     {0x0,0x1,0x2,0x3,0x4,0x5,0x6,0x7,0x8,0x9,0xA,0xB,0xC,0xD,0xE,0xF},
@@ -92,6 +92,9 @@ static const unsigned char smask[16][16] = {
     {0xC,0xD,0xC,0xD,0xC,0xD,0xC,0xD,0xC,0xD,0xC,0xD,0xC,0xD,0xC,0xD},
     {0xE,0xF,0xE,0xF,0xE,0xF,0xE,0xF,0xE,0xF,0xE,0xF,0xE,0xF,0xE,0xF}
 };
+#endif
+
+#ifdef ARCH_MIN_SSSE3
 
 INLINE static void SHUFFLE_VECTOR(short* VD, short* VT, const int e)
 { /* SSSE3 shuffling method was written entirely by CEN64 author MarathonMan. */
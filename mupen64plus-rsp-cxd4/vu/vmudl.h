@@ -39,7 +39,7 @@ INLINE static void do_mudl(short* VD, short* VS, short* VT)
     register int i;
 
     for (i = 0; i < N; i++)
-        VACC_L[i] = (unsigned short)(VS[i])*(unsigned short)(VT[i]) >> 16;
+        VACC_L[i] = (unsigned)(unsigned short)(VS[i])*(unsigned short)(VT[i]) >> 16;
     for (i = 0; i < N; i++)
         VACC_M[i] = 0x0000;
     for (i = 0; i < N; i++)
@@ -36,9 +36,8 @@ INLINE static void do_mulf(short* VD, short* VS, short* VT)
     for (i = 0; i < N; i++)
         VACC_H[i] = -((VACC_M[i] < 0) & (VS[i] != VT[i])); /* -32768 * -32768 */
 #ifndef ARCH_MIN_SSE2
-    vector_copy(VD, VACC_M);
-    for (i = 0; i < N; i++)
-        VD[i] -= (VACC_M[i] < 0) & (VS[i] == VT[i]); /* ACC b 31 set, min*min */
+    for (i = 0; i < N; i++) /* before VD is written:  it may be VS */
+        VD[i] = VACC_M[i] - ((VACC_M[i] < 0) & (VS[i] == VT[i])); /* min*min */
 #else
     SIGNED_CLAMP_AM(VD);
 #endif
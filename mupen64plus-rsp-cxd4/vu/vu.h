@@ -133,4 +133,8 @@ static void (*COP2_C2[64])(int, int, int, int) = {
     VRCP   ,VRCPL  ,VRCPH  ,VMOV   ,VRSQ   ,VRSQL  ,VRSQH  ,VNOP   , /* 110 */
     res_V  ,res_V  ,res_V  ,res_V  ,res_V  ,res_V  ,res_V  ,res_V  , /* 111 */
 }; /* 000     001     010     011     100     101     110     111 */
+
+#ifdef VU_AVX
+#include "avx.h"
+#endif
 #endif
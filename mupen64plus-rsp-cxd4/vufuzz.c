@@ -0,0 +1,286 @@
+/******************************************************************************\
+* Project:  cxd4 vector unit fuzz test                                         *
+* License:  CC0 Public Domain Dedication                                       *
+*                                                                              *
+* To the extent possible under law, the author(s) have dedicated all copyright *
+* and related and neighboring rights to this software to the public domain     *
+* worldwide. This software is distributed without any warranty.                *
+*                                                                              *
+* You should have received a copy of the CC0 Public Domain Dedication along    *
+* with this software.                                                          *
+* If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.             *
+\******************************************************************************/
+
+/*
+ * Runs the vector ops which have AVX2 or AVX-512 versions (vu/avx.h) on
+ * random register, accumulator and flags states and checks that every
+ * version leaves exactly the same state behind as the SSE2 one.  For each
+ * op it also prints a digest of the reference results and the time per op
+ * of each version.
+ *
+ * cc -std=gnu89 -O2 -DARCH_MIN_SSE2 -DM64P_PLUGIN_API -DM64P_CORE_PROTOTYPES \
+ *    -I../mupen64plus-core/src/api -I../libretro-common/include \
+ *    vufuzz.c ../libretro-common/features/features_cpu.c \
+ *    ../libretro-common/compat/compat_strl.c -o vufuzz
+ *
+ * Built without -DARCH_MIN_SSE2 the reference is the scalar C code;  the
+ * digests of both builds must match.
+ */
+
+#include "rsp.c"
+
+#include <time.h>
+
+RSP_INFO rsp_info;
+
+EXPORT m64p_error CALL ConfigSetDefaultFloat(m64p_handle handle, const char *name, float value, const char *help)
+{
+    return M64ERR_SUCCESS;
+}
+
+EXPORT m64p_error CALL ConfigSetDefaultBool(m64p_handle handle, const char *name, int value, const char *help)
+{
+    return M64ERR_SUCCESS;
+}
+
+EXPORT int CALL ConfigGetParamBool(m64p_handle handle, const char *name)
+{
+    return 0;
+}
+
+static const struct {
+    int op;
+    const char *name;
+} fuzzed[] = {
+    { 000, "VMULF" }, { 001, "VMULU" }, { 004, "VMUDL" }, { 005, "VMUDM" },
+    { 006, "VMUDN" }, { 007, "VMUDH" }, { 010, "VMACF" }, { 011, "VMACU" },
+    { 014, "VMADL" }, { 015, "VMADM" }, { 016, "VMADN" }, { 017, "VMADH" },
+    { 044, "VCL" }, { 045, "VCH" },
+    { 060, "VRCP" }, { 061, "VRCPL" }, { 062, "VRCPH" }
+};
+#define FUZZED  (sizeof(fuzzed) / sizeof(fuzzed[0]))
+
+struct vu_state {
+    short VR[32][N];
+    short VACC[3][N];
+    short ne[N], co[N], clip[N], comp[N], vce[N];
+    int DivIn, DivOut, DPH;
+};
+
+static void save_state(struct vu_state *s)
+{
+    memcpy(s->VR, VR, sizeof(s->VR));
+    memcpy(s->VACC, VACC, sizeof(s->VACC));
+    memcpy(s->ne, ne, sizeof(s->ne));
+    memcpy(s->co, co, sizeof(s->co));
+    memcpy(s->clip, clip, sizeof(s->clip));
+    memcpy(s->comp, comp, sizeof(s->comp));
+    memcpy(s->vce, vce, sizeof(s->vce));
+    s->DivIn = DivIn;
+    s->DivOut = DivOut;
+    s->DPH = DPH;
+}
+
+static void load_state(const struct vu_state *s)
+{
+    memcpy(VR, s->VR, sizeof(s->VR));
+    memcpy(VACC, s->VACC, sizeof(s->VACC));
+    memcpy(ne, s->ne, sizeof(s->ne));
+    memcpy(co, s->co, sizeof(s->co));
+    memcpy(clip, s->clip, sizeof(s->clip));
+    memcpy(comp, s->comp, sizeof(s->comp));
+    memcpy(vce, s->vce, sizeof(s->vce));
+    DivIn = s->DivIn;
+    DivOut = s->DivOut;
+    DPH = s->DPH;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+/* Random lane values, biased towards the ones where clamps and carries hit. */
+static short random_lane(void)
+{
+    static const short edges[] = {
+        0x0000, 0x0001, -0x0001, 0x7FFF, -0x8000, 0x4000, -0x4000, 0x7FFE,
+        -0x7FFF, 0x00FF, 0x0100, -0x0100, 0x3FFF, -0x3FFF, 0x8001 - 0x10000, 2
+    };
+    const uint32_t r = rng();
+
+    return (r & 3) ? (short)(r >> 8) : edges[(r >> 2) & 15];
+}
+
+static void random_state(struct vu_state *s)
+{
+    int i, j;
+
+    for (i = 0; i < 32; i++)
+        for (j = 0; j < N; j++)
+            s->VR[i][j] = random_lane();
+    for (i = 0; i < 3; i++)
+        for (j = 0; j < N; j++)
+            s->VACC[i][j] = random_lane();
+    for (j = 0; j < N; j++)
+    {
+        const uint32_t r = rng();
+
+        s->ne[j] = (r >> 0) & 1;
+        s->co[j] = (r >> 1) & 1;
+        s->clip[j] = (r >> 2) & 1;
+        s->comp[j] = (r >> 3) & 1;
+        s->vce[j] = (r >> 4) & 1;
+    }
+    s->DivIn = (int)rng() - (int)rng();
+    s->DivOut = (int)rng();
+    s->DPH = rng() & 1;
+}
+
+/* Prints the lanes which differ, returns non-zero if any. */
+static int compare(const char *name, const char *version,
+                   const struct vu_state *ref, const struct vu_state *got)
+{
+    static const char *acc_names[3] = { "ACC_H", "ACC_M", "ACC_L" };
+    int i, j, differ = 0;
+
+#define LANES(what, a, b) \
+    for (j = 0; j < N; j++) \
+        if ((a)[j] != (b)[j]) { \
+            fprintf(stderr, "%s %s: %s[%d] is %04X, expected %04X\n", name, \
+                    version, what, j, (unsigned short)(b)[j], \
+                    (unsigned short)(a)[j]); \
+            differ = 1; \
+        }
+
+    for (i = 0; i < 32; i++)
+    {
+        char what[8];
+
+        sprintf(what, "VR%d", i);
+        LANES(what, ref->VR[i], got->VR[i]);
+    }
+    for (i = 0; i < 3; i++)
+        LANES(acc_names[i], ref->VACC[i], got->VACC[i]);
+    LANES("ne", ref->ne, got->ne);
+    LANES("co", ref->co, got->co);
+    LANES("clip", ref->clip, got->clip);
+    LANES("comp", ref->comp, got->comp);
+    LANES("vce", ref->vce, got->vce);
+#undef LANES
+
+    if (ref->DivIn != got->DivIn || ref->DivOut != got->DivOut
+     || ref->DPH != got->DPH)
+    {
+        fprintf(stderr, "%s %s: divide state differs\n", name, version);
+        differ = 1;
+    }
+    return differ;
+}
+
+static uint64_t digest(uint64_t hash, const struct vu_state *s)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i;
+
+    for (i = 0; i < sizeof(*s); i++)
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double time_op(void (*op)(int, int, int, int))
+{
+    const unsigned long calls = 4000000;
+    unsigned long i;
+    double start;
+
+    start = now();
+    for (i = 0; i < calls; i++)
+        op((int)(i * 7) & 31, (int)(i * 3) & 31, (int)(i * 5) & 31, (int)i & 15);
+    return (now() - start) / calls * 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *versions[] = { "sse2", "avx2", "avx512" };
+    void (*ops[3][64])(int, int, int, int);
+    struct vu_state start, ref, got;
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    unsigned long it;
+    int backends = 1;
+    int failed = 0;
+    size_t i;
+    int b;
+
+    if (argc > 2)
+        rng_state = strtoull(argv[2], NULL, 0) | 1;
+
+    memcpy(ops[0], COP2_C2, sizeof(ops[0]));
+#ifdef VU_AVX
+    backends = detect_vu_backend() + 1;
+    for (b = 1; b < backends; b++)
+    {
+        set_vu_backend(b);
+        memcpy(ops[b], COP2_C2, sizeof(ops[b]));
+    }
+    set_vu_backend(VU_BACKEND_SSE2);
+#else
+    versions[0] = "scalar";
+#endif
+
+    for (i = 0; i < FUZZED; i++)
+    {
+        const int op = fuzzed[i].op;
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        int op_failed = 0;
+
+        for (it = 0; it < iterations; it++)
+        {
+            const int vd = rng() & 31, vs = rng() & 31, vt = rng() & 31;
+            const int e = rng() & 15;
+
+            random_state(&start);
+            load_state(&start);
+            ops[0][op](vd, vs, vt, e);
+            save_state(&ref);
+            hash = digest(hash, &ref);
+
+            for (b = 1; b < backends && op_failed < 10; b++)
+            {
+                if (ops[b][op] == ops[0][op])
+                    continue;
+                load_state(&start);
+                ops[b][op](vd, vs, vt, e);
+                save_state(&got);
+                if (compare(fuzzed[i].name, versions[b], &ref, &got))
+                {
+                    fprintf(stderr, "    (vd %d, vs %d, vt %d, e %d)\n",
+                            vd, vs, vt, e);
+                    op_failed++;
+                }
+            }
+        }
+
+        printf("%-6s %016llX", fuzzed[i].name, (unsigned long long)hash);
+        for (b = 0; b < backends; b++)
+            if (b == 0 || ops[b][op] != ops[b - 1][op])
+                printf("  %s %5.2f ns", versions[b], time_op(ops[b][op]));
+        printf("%s\n", op_failed ? "  FAILED" : "");
+        failed += op_failed != 0;
+    }
+
+    return failed != 0;
+}
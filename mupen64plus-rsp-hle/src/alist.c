@@ -32,6 +32,13 @@
 #include "hle_internal.h"
 #include "memory.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALIST_NEON
+#endif
+
 struct ramp_t
 {
     int64_t value;
@@ -47,11 +54,83 @@ static void swap(int16_t **a, int16_t **b)
     *a = tmp;
 }
 
-#define sample(hle, pos)      ((int16_t*)(hle)->alist_buffer + ((pos) ^ S))
-#define alist_u8(hle, dmem)   (u8((hle)->alist_buffer, (dmem)))
-#define alist_s16(hle, dmem)  ((int16_t*)u16((hle)->alist_buffer, (dmem)))
+/* The audio buffer holds the samples in host order: the S16 swizzle is
+ * undone by alist_load and redone by alist_save, so that the samples are
+ * contiguous and only the bytes keep a (S8 ^ S16) swizzle. */
+#define sample(hle, pos)      ((int16_t*)(hle)->alist_buffer + (pos))
+#define alist_u8(hle, dmem)   ((hle)->alist_buffer + ((dmem) ^ (S8 ^ S16)))
+#define alist_s16(hle, dmem)  ((int16_t*)((hle)->alist_buffer + (dmem)))
 #define sample_mix(dst, src, gain)  (clamp_s16(*(dst) + (((src) * (gain)) >> 15)))
 
+/* copies count words between RDRAM and the audio buffer, swapping the
+ * samples of each word on little endian hosts */
+static void swap_samples(uint8_t* dst, const uint8_t* src, size_t count)
+{
+#ifdef MSB_FIRST
+   memcpy(dst, src, count * 4);
+#else
+   while (count)
+   {
+      uint32_t word;
+
+      memcpy(&word, src, 4);
+      word = (word << 16) | (word >> 16);
+      memcpy(dst, &word, 4);
+
+      src += 4;
+      dst += 4;
+      --count;
+   }
+#endif
+}
+
+/* dst[i] = clamp(dst[i] + ((src[i] * gains[i]) >> 15)) for 8 samples */
+static INLINE void mix8(int16_t* dst, const int16_t* src, const int16_t* gains)
+{
+#if defined(__SSE2__)
+   __m128i d  = _mm_loadu_si128((const __m128i*)dst);
+   __m128i s  = _mm_loadu_si128((const __m128i*)src);
+   __m128i g  = _mm_loadu_si128((const __m128i*)gains);
+   __m128i lo = _mm_mullo_epi16(s, g);
+   __m128i hi = _mm_mulhi_epi16(s, g);
+   __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+   __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+   __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(d, d), 16);
+   __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(d, d), 16);
+
+   _mm_storeu_si128((__m128i*)dst,
+         _mm_packs_epi32(_mm_add_epi32(d0, p0), _mm_add_epi32(d1, p1)));
+#elif defined(ALIST_NEON)
+   int16x8_t d  = vld1q_s16(dst);
+   int16x8_t s  = vld1q_s16(src);
+   int16x8_t g  = vld1q_s16(gains);
+   int32x4_t p0 = vshrq_n_s32(vmull_s16(vget_low_s16(s), vget_low_s16(g)), 15);
+   int32x4_t p1 = vshrq_n_s32(vmull_s16(vget_high_s16(s), vget_high_s16(g)), 15);
+
+   vst1q_s16(dst, vcombine_s16(
+            vqmovn_s32(vaddw_s16(p0, vget_low_s16(d))),
+            vqmovn_s32(vaddw_s16(p1, vget_high_s16(d)))));
+#else
+   size_t i;
+
+   for (i = 0; i < 8; ++i)
+      dst[i] = sample_mix(&dst[i], src[i], gains[i]);
+#endif
+}
+
+/* mixes 8 input samples into n buffers, one gain per buffer and sample */
+static void alist_envmix_mix8(size_t n, int16_t** dst, int16_t gains[][8], const int16_t* in)
+{
+    size_t i;
+    int16_t src[8];
+
+    /* the input may be one of the outputs */
+    memcpy(src, in, sizeof(src));
+
+    for(i = 0; i < n; ++i)
+        mix8(dst[i], src, gains[i]);
+}
+
 static void alist_envmix_mix(size_t n, int16_t** dst, const int16_t* gains, int16_t src)
 {
     size_t i;
@@ -133,7 +212,7 @@ void alist_load(struct hle_t* hle, uint16_t dmem, uint32_t address, uint16_t cou
     dmem    &= ~3;
     address &= ~7;
     count = align(count, 8);
-    memcpy(hle->alist_buffer + dmem, hle->dram + address, count);
+    swap_samples(hle->alist_buffer + dmem, hle->dram + address, count >> 2);
 }
 
 void alist_save(struct hle_t* hle, uint16_t dmem, uint32_t address, uint16_t count)
@@ -142,7 +221,7 @@ void alist_save(struct hle_t* hle, uint16_t dmem, uint32_t address, uint16_t cou
     dmem    &= ~3;
     address &= ~7;
     count = align(count, 8);
-    memcpy(hle->dram + address, hle->alist_buffer + dmem, count);
+    swap_samples(hle->dram + address, hle->alist_buffer + dmem, count >> 2);
 }
 
 void alist_move(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count)
@@ -216,22 +295,67 @@ void alist_interleave(struct hle_t* hle, uint16_t dmemo, uint16_t left, uint16_t
       uint16_t r1 = *(srcR++);
       uint16_t r2 = *(srcR++);
 
-#ifdef MSB_FIRST
       *(dst++) = l1;
       *(dst++) = r1;
       *(dst++) = l2;
       *(dst++) = r2;
-#else
-      *(dst++) = r2;
-      *(dst++) = l2;
-      *(dst++) = r1;
-      *(dst++) = l1;
-#endif
       --count;
    }
 }
 
 
+/* mixes count samples with linearly ramped gains, 8 samples at a time */
+static void alist_envmix_ramps(size_t n,
+      int16_t* dl, int16_t* dr, int16_t* wl, int16_t* wr, const int16_t* in,
+      size_t count, int16_t dry, int16_t wet, struct ramp_t* ramps)
+{
+    size_t k = 0;
+    int16_t* buffers[4];
+
+    for (; k + 8 <= count; k += 8)
+    {
+       int16_t gains[4][8];
+       size_t x;
+
+       for (x = 0; x < 8; ++x)
+       {
+          int16_t l_vol = ramp_step(&ramps[0]);
+          int16_t r_vol = ramp_step(&ramps[1]);
+
+          gains[0][x] = clamp_s16((l_vol * dry + 0x4000) >> 15);
+          gains[1][x] = clamp_s16((r_vol * dry + 0x4000) >> 15);
+          gains[2][x] = clamp_s16((l_vol * wet + 0x4000) >> 15);
+          gains[3][x] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+       }
+
+       buffers[0] = dl + k;
+       buffers[1] = dr + k;
+       buffers[2] = wl + k;
+       buffers[3] = wr + k;
+
+       alist_envmix_mix8(n, buffers, gains, in + k);
+    }
+
+    for (; k < count; ++k)
+    {
+       int16_t gains[4];
+       int16_t l_vol = ramp_step(&ramps[0]);
+       int16_t r_vol = ramp_step(&ramps[1]);
+
+       buffers[0] = dl + k;
+       buffers[1] = dr + k;
+       buffers[2] = wl + k;
+       buffers[3] = wr + k;
+
+       gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
+       gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
+       gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
+       gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+
+       alist_envmix_mix(n, buffers, gains, in[k]);
+    }
+}
+
 void alist_envmix_exp(
         struct hle_t* hle,
         bool init,
@@ -248,6 +372,8 @@ void alist_envmix_exp(
     struct ramp_t ramps[2];
     int32_t exp_seq[2];
     int32_t exp_rates[2];
+    int16_t  gains[4][8];
+    int16_t* buffers[4];
     int x, y;
     size_t n                = (aux) ? 4 : 2;
 
@@ -304,24 +430,22 @@ void alist_envmix_exp(
 
        for (x = 0; x < 8; ++x)
        {
-          int16_t  gains[4];
-          int16_t* buffers[4];
           int16_t l_vol = ramp_step(&ramps[0]);
           int16_t r_vol = ramp_step(&ramps[1]);
 
-          buffers[0] = dl + (ptr^S);
-          buffers[1] = dr + (ptr^S);
-          buffers[2] = wl + (ptr^S);
-          buffers[3] = wr + (ptr^S);
+          gains[0][x] = clamp_s16((l_vol * dry + 0x4000) >> 15);
+          gains[1][x] = clamp_s16((r_vol * dry + 0x4000) >> 15);
+          gains[2][x] = clamp_s16((l_vol * wet + 0x4000) >> 15);
+          gains[3][x] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+       }
 
-          gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-          gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-          gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-          gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+       buffers[0] = dl + ptr;
+       buffers[1] = dr + ptr;
+       buffers[2] = wl + ptr;
+       buffers[3] = wr + ptr;
 
-          alist_envmix_mix(n, buffers, gains, in[ptr^S]);
-          ++ptr;
-       }
+       alist_envmix_mix8(n, buffers, gains, in + ptr);
+       ptr += 8;
     }
 
     *(int16_t *)(save_buffer +  0) = wet;                       /* 0-1 */
@@ -349,7 +473,6 @@ void alist_envmix_ge(
         const int32_t *rate,
         uint32_t address)
 {
-    unsigned k;
     struct ramp_t ramps[2];
     size_t n                = (aux) ? 4 : 2;
 
@@ -384,25 +507,7 @@ void alist_envmix_ge(
     }
 
     count >>= 1;
-    for (k = 0; k < count; ++k)
-    {
-       int16_t  gains[4];
-       int16_t* buffers[4];
-       int16_t l_vol = ramp_step(&ramps[0]);
-       int16_t r_vol = ramp_step(&ramps[1]);
-
-       buffers[0] = dl + (k^S);
-       buffers[1] = dr + (k^S);
-       buffers[2] = wl + (k^S);
-       buffers[3] = wr + (k^S);
-
-       gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-       gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-       gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-       gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
-
-       alist_envmix_mix(n, buffers, gains, in[k^S]);
-    }
+    alist_envmix_ramps(n, dl, dr, wl, wr, in, count, dry, wet, ramps);
 
     *(int16_t *)(save_buffer +  0) = wet;                       /* 0-1 */
     *(int16_t *)(save_buffer +  2) = dry;                       /* 2-3 */
@@ -428,7 +533,6 @@ void alist_envmix_lin(
         const int32_t *rate,
         uint32_t address)
 {
-    size_t k;
     struct ramp_t ramps[2];
     short *save_buffer = (short*)((uint8_t*)hle->dram + address);
 
@@ -460,24 +564,7 @@ void alist_envmix_lin(
     }
 
     count >>= 1;
-    for(k = 0; k < count; ++k) {
-        int16_t  gains[4];
-        int16_t* buffers[4];
-        int16_t l_vol = ramp_step(&ramps[0]);
-        int16_t r_vol = ramp_step(&ramps[1]);
-
-        buffers[0] = dl + (k^S);
-        buffers[1] = dr + (k^S);
-        buffers[2] = wl + (k^S);
-        buffers[3] = wr + (k^S);
-
-        gains[0] = clamp_s16((l_vol * dry + 0x4000) >> 15);
-        gains[1] = clamp_s16((r_vol * dry + 0x4000) >> 15);
-        gains[2] = clamp_s16((l_vol * wet + 0x4000) >> 15);
-        gains[3] = clamp_s16((r_vol * wet + 0x4000) >> 15);
-
-        alist_envmix_mix(4, buffers, gains, in[k^S]);
-    }
+    alist_envmix_ramps(4, dl, dr, wl, wr, in, count, dry, wet, ramps);
 
     *(int16_t *)(save_buffer +  0) = wet;                           /* 0-1 */
     *(int16_t *)(save_buffer +  2) = dry;                           /* 2-3 */
@@ -516,20 +603,43 @@ void alist_envmix_nead(
 
     while (count)
     {
+#if defined(__SSE2__)
+       /* (int32_t)x * (uint32_t)e >> 16 keeps the high half of the unsigned
+        * product, minus e when x is negative */
+       const __m128i e0 = _mm_set1_epi16(env_values[0]);
+       const __m128i e1 = _mm_set1_epi16(env_values[1]);
+       const __m128i e2 = _mm_set1_epi16(env_values[2]);
+       __m128i x  = _mm_loadu_si128((const __m128i*)in);
+       __m128i sx = _mm_srai_epi16(x, 15);
+       __m128i l  = _mm_xor_si128(_mm_sub_epi16(_mm_mulhi_epu16(x, e0), _mm_and_si128(sx, e0)), _mm_set1_epi16(xors[0]));
+       __m128i r  = _mm_xor_si128(_mm_sub_epi16(_mm_mulhi_epu16(x, e1), _mm_and_si128(sx, e1)), _mm_set1_epi16(xors[1]));
+       __m128i l2 = _mm_xor_si128(_mm_sub_epi16(_mm_mulhi_epu16(l, e2), _mm_and_si128(_mm_srai_epi16(l, 15), e2)), _mm_set1_epi16(xors[2]));
+       __m128i r2 = _mm_xor_si128(_mm_sub_epi16(_mm_mulhi_epu16(r, e2), _mm_and_si128(_mm_srai_epi16(r, 15), e2)), _mm_set1_epi16(xors[3]));
+
+       _mm_storeu_si128((__m128i*)dl, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)dl), l));
+       _mm_storeu_si128((__m128i*)dr, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)dr), r));
+       _mm_storeu_si128((__m128i*)wl, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)wl), l2));
+       _mm_storeu_si128((__m128i*)wr, _mm_adds_epi16(_mm_loadu_si128((const __m128i*)wr), r2));
+#else
        size_t i;
+       int16_t src[8];
+
+       /* the input may be one of the outputs */
+       memcpy(src, in, sizeof(src));
 
        for(i = 0; i < 8; ++i)
        {
-          int16_t l  = (((int32_t)in[i^S] * (uint32_t)env_values[0]) >> 16) ^ xors[0];
-          int16_t r  = (((int32_t)in[i^S] * (uint32_t)env_values[1]) >> 16) ^ xors[1];
+          int16_t l  = (((int32_t)src[i] * (uint32_t)env_values[0]) >> 16) ^ xors[0];
+          int16_t r  = (((int32_t)src[i] * (uint32_t)env_values[1]) >> 16) ^ xors[1];
           int16_t l2 = (((int32_t)l * (uint32_t)env_values[2]) >> 16) ^ xors[2];
           int16_t r2 = (((int32_t)r * (uint32_t)env_values[2]) >> 16) ^ xors[3];
 
-          dl[i^S] = clamp_s16(dl[i^S] + l);
-          dr[i^S] = clamp_s16(dr[i^S] + r);
-          wl[i^S] = clamp_s16(wl[i^S] + l2);
-          wr[i^S] = clamp_s16(wr[i^S] + r2);
+          dl[i] = clamp_s16(dl[i] + l);
+          dr[i] = clamp_s16(dr[i] + r);
+          wl[i] = clamp_s16(wl[i] + l2);
+          wr[i] = clamp_s16(wr[i] + r2);
        }
+#endif
 
        env_values[0] += env_steps[0];
        env_values[1] += env_steps[1];
@@ -550,8 +660,16 @@ void alist_mix(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count
    int16_t       *dst = (int16_t*)(hle->alist_buffer + dmemo);
    const int16_t *src = (int16_t*)(hle->alist_buffer + dmemi);
 
+   int16_t gains[8];
+
    count >>= 1;
 
+   gains[0] = gains[1] = gains[2] = gains[3] = gain;
+   gains[4] = gains[5] = gains[6] = gains[7] = gain;
+
+   for (; count >= 8; count -= 8, dst += 8, src += 8)
+      mix8(dst, src, gains);
+
    while(count)
    {
       *dst = sample_mix(dst, *src, gain);
@@ -568,6 +686,30 @@ void alist_multQ44(struct hle_t* hle, uint16_t dmem, uint16_t count, int8_t gain
 
    count >>= 1;
 
+#if defined(__SSE2__)
+   for (; count >= 8; count -= 8, dst += 8)
+   {
+      const __m128i g = _mm_set1_epi16(gain);
+      __m128i d  = _mm_loadu_si128((const __m128i*)dst);
+      __m128i lo = _mm_mullo_epi16(d, g);
+      __m128i hi = _mm_mulhi_epi16(d, g);
+
+      _mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(
+               _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 4),
+               _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 4)));
+   }
+#elif defined(ALIST_NEON)
+   for (; count >= 8; count -= 8, dst += 8)
+   {
+      const int16x4_t g = vdup_n_s16(gain);
+      int16x8_t d = vld1q_s16(dst);
+
+      vst1q_s16(dst, vcombine_s16(
+               vqshrn_n_s32(vmull_s16(vget_low_s16(d), g), 4),
+               vqshrn_n_s32(vmull_s16(vget_high_s16(d), g), 4)));
+   }
+#endif
+
    while(count)
    {
       *dst = clamp_s16(*dst * gain >> 4);
@@ -584,6 +726,16 @@ void alist_add(struct hle_t* hle, uint16_t dmemo, uint16_t dmemi, uint16_t count
 
    count >>= 1;
 
+#if defined(__SSE2__)
+   for (; count >= 8; count -= 8, dst += 8, src += 8)
+      _mm_storeu_si128((__m128i*)dst, _mm_adds_epi16(
+               _mm_loadu_si128((const __m128i*)dst),
+               _mm_loadu_si128((const __m128i*)src)));
+#elif defined(ALIST_NEON)
+   for (; count >= 8; count -= 8, dst += 8, src += 8)
+      vst1q_s16(dst, vqaddq_s16(vld1q_s16(dst), vld1q_s16(src)));
+#endif
+
    while(count)
    {
       *dst = clamp_s16(*dst + *src);
@@ -655,12 +807,25 @@ void alist_resample(
    while (count)
    {
       const int16_t* lut = RESAMPLE_LUT + ((pitch_accu & 0xfc00) >> 8);
-
+#if defined(__SSE2__)
+      __m128i dot = _mm_madd_epi16(
+            _mm_loadl_epi64((const __m128i*)sample(hle, ipos)),
+            _mm_loadl_epi64((const __m128i*)lut));
+
+      dot = _mm_add_epi32(dot, _mm_shuffle_epi32(dot, _MM_SHUFFLE(1, 1, 1, 1)));
+      *sample(hle, opos++) = clamp_s16(_mm_cvtsi128_si32(dot) >> 15);
+#elif defined(ALIST_NEON)
+      int32x4_t dot = vmull_s16(vld1_s16(sample(hle, ipos)), vld1_s16(lut));
+      int32x2_t sum = vadd_s32(vget_low_s32(dot), vget_high_s32(dot));
+
+      *sample(hle, opos++) = clamp_s16(vget_lane_s32(vpadd_s32(sum, sum), 0) >> 15);
+#else
       *sample(hle, opos++) = clamp_s16( (
                (*sample(hle, ipos    ) * lut[0]) +
                (*sample(hle, ipos + 1) * lut[1]) +
                (*sample(hle, ipos + 2) * lut[2]) +
                (*sample(hle, ipos + 3) * lut[3]) ) >> 15);
+#endif
 
       pitch_accu += pitch;
       ipos += (pitch_accu >> 16);
@@ -798,7 +963,8 @@ void alist_filter(
    int16_t* const lutt6 = (int16_t*)(hle->dram + lut_address[0]);
    int16_t* const lutt5 = (int16_t*)(hle->dram + lut_address[1]);
 
-   int16_t* in1 = (int16_t*)(hle->dram + address);
+   int16_t last[8];
+   const int16_t* in1 = last;
    int16_t* in2 = (int16_t*)(hle->alist_buffer + dmem);
 
    for (x = 0; x < 8; ++x)
@@ -807,96 +973,101 @@ void alist_filter(
       lutt5[x] = lutt6[x] = v;
    }
 
+   /* the previous samples are kept in RDRAM order */
+   for (x = 0; x < 8; ++x)
+      last[x^S] = ((int16_t*)(hle->dram + address))[x];
+
    for (x = 0; x < count; x += 16)
    {
       int32_t v[8];
 
-      v[1] =  in1[0] * lutt6[6];
-      v[1] += in1[3] * lutt6[7];
-      v[1] += in1[2] * lutt6[4];
-      v[1] += in1[5] * lutt6[5];
-      v[1] += in1[4] * lutt6[2];
-      v[1] += in1[7] * lutt6[3];
-      v[1] += in1[6] * lutt6[0];
-      v[1] += in2[1] * lutt6[1]; /* 1 */
-
-      v[0] =  in1[3] * lutt6[6];
-      v[0] += in1[2] * lutt6[7];
-      v[0] += in1[5] * lutt6[4];
-      v[0] += in1[4] * lutt6[5];
-      v[0] += in1[7] * lutt6[2];
-      v[0] += in1[6] * lutt6[3];
-      v[0] += in2[1] * lutt6[0];
-      v[0] += in2[0] * lutt6[1];
-
-      v[3] =  in1[2] * lutt6[6];
-      v[3] += in1[5] * lutt6[7];
-      v[3] += in1[4] * lutt6[4];
-      v[3] += in1[7] * lutt6[5];
-      v[3] += in1[6] * lutt6[2];
-      v[3] += in2[1] * lutt6[3];
-      v[3] += in2[0] * lutt6[0];
-      v[3] += in2[3] * lutt6[1];
-
-      v[2] =  in1[5] * lutt6[6];
-      v[2] += in1[4] * lutt6[7];
-      v[2] += in1[7] * lutt6[4];
-      v[2] += in1[6] * lutt6[5];
-      v[2] += in2[1] * lutt6[2];
-      v[2] += in2[0] * lutt6[3];
-      v[2] += in2[3] * lutt6[0];
-      v[2] += in2[2] * lutt6[1];
-
-      v[5] =  in1[4] * lutt6[6];
-      v[5] += in1[7] * lutt6[7];
-      v[5] += in1[6] * lutt6[4];
-      v[5] += in2[1] * lutt6[5];
-      v[5] += in2[0] * lutt6[2];
-      v[5] += in2[3] * lutt6[3];
-      v[5] += in2[2] * lutt6[0];
-      v[5] += in2[5] * lutt6[1];
-
-      v[4] =  in1[7] * lutt6[6];
-      v[4] += in1[6] * lutt6[7];
-      v[4] += in2[1] * lutt6[4];
-      v[4] += in2[0] * lutt6[5];
-      v[4] += in2[3] * lutt6[2];
-      v[4] += in2[2] * lutt6[3];
-      v[4] += in2[5] * lutt6[0];
-      v[4] += in2[4] * lutt6[1];
-
-      v[7] =  in1[6] * lutt6[6];
-      v[7] += in2[1] * lutt6[7];
-      v[7] += in2[0] * lutt6[4];
-      v[7] += in2[3] * lutt6[5];
-      v[7] += in2[2] * lutt6[2];
-      v[7] += in2[5] * lutt6[3];
-      v[7] += in2[4] * lutt6[0];
-      v[7] += in2[7] * lutt6[1];
-
-      v[6] =  in2[1] * lutt6[6];
-      v[6] += in2[0] * lutt6[7];
-      v[6] += in2[3] * lutt6[4];
-      v[6] += in2[2] * lutt6[5];
-      v[6] += in2[5] * lutt6[2];
-      v[6] += in2[4] * lutt6[3];
-      v[6] += in2[7] * lutt6[0];
-      v[6] += in2[6] * lutt6[1];
-
-      outp[1] = ((v[1] + 0x4000) >> 15);
-      outp[0] = ((v[0] + 0x4000) >> 15);
-      outp[3] = ((v[3] + 0x4000) >> 15);
-      outp[2] = ((v[2] + 0x4000) >> 15);
-      outp[5] = ((v[5] + 0x4000) >> 15);
-      outp[4] = ((v[4] + 0x4000) >> 15);
-      outp[7] = ((v[7] + 0x4000) >> 15);
-      outp[6] = ((v[6] + 0x4000) >> 15);
+      v[1] =  in1[0^S] * lutt6[6];
+      v[1] += in1[3^S] * lutt6[7];
+      v[1] += in1[2^S] * lutt6[4];
+      v[1] += in1[5^S] * lutt6[5];
+      v[1] += in1[4^S] * lutt6[2];
+      v[1] += in1[7^S] * lutt6[3];
+      v[1] += in1[6^S] * lutt6[0];
+      v[1] += in2[1^S] * lutt6[1]; /* 1 */
+
+      v[0] =  in1[3^S] * lutt6[6];
+      v[0] += in1[2^S] * lutt6[7];
+      v[0] += in1[5^S] * lutt6[4];
+      v[0] += in1[4^S] * lutt6[5];
+      v[0] += in1[7^S] * lutt6[2];
+      v[0] += in1[6^S] * lutt6[3];
+      v[0] += in2[1^S] * lutt6[0];
+      v[0] += in2[0^S] * lutt6[1];
+
+      v[3] =  in1[2^S] * lutt6[6];
+      v[3] += in1[5^S] * lutt6[7];
+      v[3] += in1[4^S] * lutt6[4];
+      v[3] += in1[7^S] * lutt6[5];
+      v[3] += in1[6^S] * lutt6[2];
+      v[3] += in2[1^S] * lutt6[3];
+      v[3] += in2[0^S] * lutt6[0];
+      v[3] += in2[3^S] * lutt6[1];
+
+      v[2] =  in1[5^S] * lutt6[6];
+      v[2] += in1[4^S] * lutt6[7];
+      v[2] += in1[7^S] * lutt6[4];
+      v[2] += in1[6^S] * lutt6[5];
+      v[2] += in2[1^S] * lutt6[2];
+      v[2] += in2[0^S] * lutt6[3];
+      v[2] += in2[3^S] * lutt6[0];
+      v[2] += in2[2^S] * lutt6[1];
+
+      v[5] =  in1[4^S] * lutt6[6];
+      v[5] += in1[7^S] * lutt6[7];
+      v[5] += in1[6^S] * lutt6[4];
+      v[5] += in2[1^S] * lutt6[5];
+      v[5] += in2[0^S] * lutt6[2];
+      v[5] += in2[3^S] * lutt6[3];
+      v[5] += in2[2^S] * lutt6[0];
+      v[5] += in2[5^S] * lutt6[1];
+
+      v[4] =  in1[7^S] * lutt6[6];
+      v[4] += in1[6^S] * lutt6[7];
+      v[4] += in2[1^S] * lutt6[4];
+      v[4] += in2[0^S] * lutt6[5];
+      v[4] += in2[3^S] * lutt6[2];
+      v[4] += in2[2^S] * lutt6[3];
+      v[4] += in2[5^S] * lutt6[0];
+      v[4] += in2[4^S] * lutt6[1];
+
+      v[7] =  in1[6^S] * lutt6[6];
+      v[7] += in2[1^S] * lutt6[7];
+      v[7] += in2[0^S] * lutt6[4];
+      v[7] += in2[3^S] * lutt6[5];
+      v[7] += in2[2^S] * lutt6[2];
+      v[7] += in2[5^S] * lutt6[3];
+      v[7] += in2[4^S] * lutt6[0];
+      v[7] += in2[7^S] * lutt6[1];
+
+      v[6] =  in2[1^S] * lutt6[6];
+      v[6] += in2[0^S] * lutt6[7];
+      v[6] += in2[3^S] * lutt6[4];
+      v[6] += in2[2^S] * lutt6[5];
+      v[6] += in2[5^S] * lutt6[2];
+      v[6] += in2[4^S] * lutt6[3];
+      v[6] += in2[7^S] * lutt6[0];
+      v[6] += in2[6^S] * lutt6[1];
+
+      outp[1^S] = ((v[1] + 0x4000) >> 15);
+      outp[0^S] = ((v[0] + 0x4000) >> 15);
+      outp[3^S] = ((v[3] + 0x4000) >> 15);
+      outp[2^S] = ((v[2] + 0x4000) >> 15);
+      outp[5^S] = ((v[5] + 0x4000) >> 15);
+      outp[4^S] = ((v[4] + 0x4000) >> 15);
+      outp[7^S] = ((v[7] + 0x4000) >> 15);
+      outp[6^S] = ((v[6] + 0x4000) >> 15);
       in1 = in2;
       in2 += 8;
       outp += 8;
    }
 
-   memcpy(hle->dram + address, in2 - 8, 16);
+   for (x = 0; x < 8; ++x)
+      ((int16_t*)(hle->dram + address))[x] = in2[(x^S) - 8];
    memcpy(hle->alist_buffer + dmem, outbuff, count);
 }
 
@@ -943,17 +1114,17 @@ void alist_polef(
       {
          int32_t accu = frame[i] * gain;
          accu += h1[i]*l1 + h2_before[i]*l2 + rdot(i, h2, frame + i);
-         dst[i^S] = clamp_s16(accu >> 14);
+         dst[i] = clamp_s16(accu >> 14);
       }
 
-      l1 = dst[6^S];
-      l2 = dst[7^S];
+      l1 = dst[6];
+      l2 = dst[7];
 
       dst += 8;
       count -= 16;
    }while(count);
 
-   dram_store_u32(hle, (uint32_t*)(dst - 4), address, 2);
+   dram_store_u16(hle, (uint16_t*)(dst - 4), address, 4);
 }
 
 void alist_iirf(
@@ -1003,7 +1174,7 @@ void alist_iirf(
 
          accu         += vmulf(table[8], frame[index]) * 2;
          prev          = vmulf(table[9], frame[index]) * 2;
-         dst[i^S]      = frame[i] = accu;
+         dst[i]        = frame[i] = accu;
          index         = (index+1)&7;
          dmemi        += 2;
       }
@@ -25,6 +25,13 @@
 
 #include "arithmetics.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_NEON
+#endif
+
 const int16_t RESAMPLE_LUT[64 * 4] = {
     (int16_t)0x0c39, (int16_t)0x66ad, (int16_t)0x0d46, (int16_t)0xffdf,
     (int16_t)0x0b39, (int16_t)0x6696, (int16_t)0x0e5f, (int16_t)0xffd8,
@@ -102,10 +109,89 @@ int32_t rdot(size_t n, const int16_t *x, const int16_t *y)
    return accu;
 }
 
+#if defined(__SSE2__)
+/* Every output is src[i] << 11 plus a dot product with the previous samples
+ * and the inputs before it: book2 shifted by k + 1 lanes is the column of
+ * src[k], and the columns are accumulated in pairs with pmaddwd. */
+#define ADPCM_COLUMNS(k) \
+   do { \
+      __m128i c0 = _mm_slli_si128(book2, 2 * (k) + 2); \
+      __m128i c1 = _mm_slli_si128(book2, 2 * (k) + 4); \
+      __m128i x  = _mm_set1_epi32((uint16_t)src[k] | ((uint32_t)(uint16_t)src[(k) + 1] << 16)); \
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(c0, c1), x)); \
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(c0, c1), x)); \
+   } while (0)
+
+static void adpcm_compute_residuals8(int16_t* dst, const int16_t* src,
+        const int16_t* cb_entry, const int16_t* last_samples)
+{
+   const __m128i book1 = _mm_loadu_si128((const __m128i*)cb_entry);
+   const __m128i book2 = _mm_loadu_si128((const __m128i*)(cb_entry + 8));
+   const __m128i input = _mm_loadu_si128((const __m128i*)src);
+   const __m128i last  = _mm_set1_epi32((uint16_t)last_samples[0] | ((uint32_t)(uint16_t)last_samples[1] << 16));
+   __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(book1, book2), last);
+   __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(book1, book2), last);
+
+   lo = _mm_add_epi32(lo, _mm_slli_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(input, input), 16), 11));
+   hi = _mm_add_epi32(hi, _mm_slli_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(input, input), 16), 11));
+
+   ADPCM_COLUMNS(0);
+   ADPCM_COLUMNS(2);
+   ADPCM_COLUMNS(4);
+   ADPCM_COLUMNS(6);
+
+   _mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(_mm_srai_epi32(lo, 11), _mm_srai_epi32(hi, 11)));
+}
+#undef ADPCM_COLUMNS
+#elif defined(AUDIO_NEON)
+static void adpcm_compute_residuals8(int16_t* dst, const int16_t* src,
+        const int16_t* cb_entry, const int16_t* last_samples)
+{
+   const int16x8_t book1 = vld1q_s16(cb_entry);
+   const int16x8_t book2 = vld1q_s16(cb_entry + 8);
+   const int16x8_t zero  = vdupq_n_s16(0);
+   int16x8_t input       = vld1q_s16(src);
+   int32x4_t lo = vshll_n_s16(vget_low_s16(input), 11);
+   int32x4_t hi = vshll_n_s16(vget_high_s16(input), 11);
+   int16x8_t column;
+
+   lo = vmlal_n_s16(lo, vget_low_s16(book1), last_samples[0]);
+   hi = vmlal_n_s16(hi, vget_high_s16(book1), last_samples[0]);
+   lo = vmlal_n_s16(lo, vget_low_s16(book2), last_samples[1]);
+   hi = vmlal_n_s16(hi, vget_high_s16(book2), last_samples[1]);
+
+   /* book2 shifted by k + 1 lanes is the column of src[k] */
+#define ADPCM_COLUMN(k) \
+   column = vextq_s16(zero, book2, 7 - (k)); \
+   lo = vmlal_n_s16(lo, vget_low_s16(column), src[k]); \
+   hi = vmlal_n_s16(hi, vget_high_s16(column), src[k])
+
+   ADPCM_COLUMN(0);
+   ADPCM_COLUMN(1);
+   ADPCM_COLUMN(2);
+   ADPCM_COLUMN(3);
+   ADPCM_COLUMN(4);
+   ADPCM_COLUMN(5);
+   ADPCM_COLUMN(6);
+#undef ADPCM_COLUMN
+
+   vst1q_s16(dst, vcombine_s16(vqshrn_n_s32(lo, 11), vqshrn_n_s32(hi, 11)));
+}
+#endif
+
 void adpcm_compute_residuals(int16_t* dst, const int16_t* src,
         const int16_t* cb_entry, const int16_t* last_samples, size_t count)
 {
    size_t i;
+
+#if defined(__SSE2__) || defined(AUDIO_NEON)
+   if (count == 8)
+   {
+      adpcm_compute_residuals8(dst, src, cb_entry, last_samples);
+      return;
+   }
+#endif
+
    const int16_t* const book1 = cb_entry;
    const int16_t* const book2 = cb_entry + 8;
 
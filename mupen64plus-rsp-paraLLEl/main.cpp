@@ -66,6 +66,24 @@ static bool read_block(FILE *file, const char *tag, void *buffer, size_t size)
    return true;
 }
 
+// Newer traces record the RDRAM pages which changed after the registers.
+static void skip_rdram(FILE *file, const char *tag)
+{
+   char tmp[9] = {};
+   while (fread(tmp, 1, 8, file) == 8 && strcmp(tmp, tag) == 0)
+   {
+      uint32_t offset;
+      uint32_t len;
+
+      if (fread(&offset, sizeof(offset), 1, file) != 1)
+         throw runtime_error("Wrong EOF");
+      if (fread(&len, sizeof(len), 1, file) != 1)
+         throw runtime_error("Wrong EOF");
+      fseek(file, len, SEEK_CUR);
+   }
+   fseek(file, -8, SEEK_CUR);
+}
+
 static bool read_poke(FILE *file, RSP::CPU &cpu)
 {
    char tmp[9] = {};
@@ -133,6 +151,7 @@ static void validate_trace(RSP::CPU &cpu, const char *path)
          read_block(file, "VCO     ", &VCO, sizeof(VCO));
          read_block(file, "VCC     ", &VCC, sizeof(VCC));
          read_block(file, "VCE     ", &VCE, sizeof(VCE));
+         skip_rdram(file, "RDRAM   ");
 
          rsp_set_flags(state.cp2.flags[RSP::RSP_VCO].e, VCO);
          rsp_set_flags(state.cp2.flags[RSP::RSP_VCC].e, VCC);
@@ -172,6 +191,7 @@ static void validate_trace(RSP::CPU &cpu, const char *path)
          read_block(file, "VCO  END", &VCO, sizeof(VCO));
          read_block(file, "VCC  END", &VCC, sizeof(VCC));
          read_block(file, "VCE  END", &VCE, sizeof(VCE));
+         skip_rdram(file, "RDRAMEND");
 
          unsigned errors = 0;
 
@@ -327,4 +347,6 @@ int main(int argc, char *argv[])
       validate_trace(cpu, argv[1]);
    else
       return 1;
+
+   cpu.print_jit_stats();
 }
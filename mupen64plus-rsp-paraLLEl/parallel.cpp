@@ -93,6 +93,10 @@ EXPORT m64p_error CALL parallelRSPPluginGetVersion(m64p_plugin_type *PluginType,
 EXPORT void CALL parallelRSPRomClosed(void)
 {
    *RSP::rsp.SP_PC_REG = 0x00000000;
+
+#ifdef INTENSE_DEBUG
+   RSP::cpu.print_jit_stats();
+#endif
 }
 
 EXPORT void CALL parallelRSPInitiateRSP(RSP_INFO Rsp_Info, unsigned int *CycleCount)
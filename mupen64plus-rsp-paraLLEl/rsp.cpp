@@ -1,5 +1,6 @@
 #include "rsp.hpp"
 #include <utility>
+#include <chrono>
 
 using namespace std;
 
@@ -410,7 +411,7 @@ Func CPU::jit_region(uint64_t hash, unsigned pc, unsigned count)
       if (pipe_pending_local_branch_delay || pipe_pending_branch_delay) { \
          APPEND("if (branch && pipe_branch) {\n"); \
          APPEND("  STATE->pc = %u;\n", branch_delay * 4); \
-         APPEND("  PROMOTE_DELAY_SLOT();\n"); \
+         PROMOTE_DELAY_SLOT(); \
          APPEND("  EXIT(MODE_CONTINUE);\n"); \
          APPEND("} else if (branch) {\n"); \
          APPEND("  goto pc_%03x;\n", branch_delay * 4); \
@@ -1066,8 +1067,8 @@ struct cpu_state
    unsigned *dmem;
    unsigned *imem;
 };
-#define UNLIKELY(x) __builtin_expect(!!x, 0)
-#define LIKELY(x) __builtin_expect(!!x, 1)
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define LIKELY(x) __builtin_expect(!!(x), 1)
 #define MASK_SA(x) ((x) & 31)
 
 enum ReturnMode {
@@ -1238,15 +1239,38 @@ DECL_COP2(RESERVED);
    full_code += body;
    full_code += "}\n";
 
+   auto start = chrono::steady_clock::now();
    unique_ptr<Block> block(new Block(symbol_table));
-   if (!block->compile(hash, full_code))
+   bool compiled = block->compile(hash, full_code);
+   uint64_t usec = chrono::duration_cast<chrono::microseconds>(
+         chrono::steady_clock::now() - start).count();
+
+   jit_stats.total_compile_usec += usec;
+   jit_stats.max_compile_usec = max(jit_stats.max_compile_usec, usec);
+   if (!compiled)
+   {
+      jit_stats.failed_blocks++;
       return nullptr;
+   }
+   jit_stats.compiled_blocks++;
 
    auto ret = block->get_func();
    cached_blocks[pc][hash] = move(block);
    return ret;
 }
 
+void CPU::print_jit_stats()
+{
+   fprintf(stderr, "RSP JIT stats:\n");
+   fprintf(stderr, "  Compiled blocks: %llu (%llu failed)\n",
+         static_cast<unsigned long long>(jit_stats.compiled_blocks),
+         static_cast<unsigned long long>(jit_stats.failed_blocks));
+   fprintf(stderr, "  Compile latency: %llu us average, %llu us max\n",
+         static_cast<unsigned long long>(jit_stats.compiled_blocks + jit_stats.failed_blocks ?
+            jit_stats.total_compile_usec / (jit_stats.compiled_blocks + jit_stats.failed_blocks) : 0),
+         static_cast<unsigned long long>(jit_stats.max_compile_usec));
+}
+
 void CPU::print_registers()
 {
    fprintf(stderr, "RSP state:\n");
@@ -1327,9 +1351,9 @@ void RSP_CALL(void *cpu, unsigned target, unsigned ret)
    static_cast<CPU *>(cpu)->call(target, ret);
 }
 
-void RSP_RETURN(void *cpu, unsigned pc)
+int RSP_RETURN(void *cpu, unsigned pc)
 {
-   static_cast<CPU *>(cpu)->ret(pc);
+   return static_cast<CPU *>(cpu)->ret(pc);
 }
 
 void RSP_EXIT(void *cpu, int mode)
@@ -32,6 +32,14 @@ namespace RSP
       MODE_CHECK_FLAGS = 4
    };
 
+   struct JITStats
+   {
+      uint64_t compiled_blocks = 0;
+      uint64_t failed_blocks = 0;
+      uint64_t total_compile_usec = 0;
+      uint64_t max_compile_usec = 0;
+   };
+
    class alignas(64) CPU
    {
       public:
@@ -70,6 +78,12 @@ namespace RSP
          int ret(uint32_t pc);
          void exit(ReturnMode mode);
 
+         const JITStats &get_jit_stats() const
+         {
+            return jit_stats;
+         }
+         void print_jit_stats();
+
       private:
          CPUState state;
          Func blocks[IMEM_WORDS] = {};
@@ -97,6 +111,8 @@ namespace RSP
          unsigned call_stack_ptr = 0;
 
          unsigned analyze_static_end(unsigned pc, unsigned end);
+
+         JITStats jit_stats;
    };
 }
 
@@ -36,6 +36,7 @@ typedef struct {
     int rgb_alpha_dither;
     int realblendershiftersneeded;
     int interpixelblendershiftersneeded;
+    int interpixelstateneeded;
 } MODEDERIVS;
 
 typedef struct {
@@ -135,56 +136,56 @@ static int render_cycle_mode_counts[4];
 
 int32_t irand(void);
 
-static int8_t get_dither_noise_type;
-static int scfield;
-static int sckeepodd;
-
-static int ti_format;
-static int ti_size;
-static int ti_width;
-static uint32_t ti_address;
-
-static int fb_format;
-static int fb_size;
-static int fb_width;
-static uint32_t fb_address;
-static uint32_t zb_address;
-
-static uint32_t max_level;
-static int32_t min_level;
-static int16_t primitive_lod_frac;
-
-static uint32_t primitive_z;
-static uint16_t primitive_delta_z;
-
-static uint32_t fill_color;
-
-static int16_t *combiner_rgbsub_a_r[2];
-static int16_t *combiner_rgbsub_a_g[2];
-static int16_t *combiner_rgbsub_a_b[2];
-static int16_t *combiner_rgbsub_b_r[2];
-static int16_t *combiner_rgbsub_b_g[2];
-static int16_t *combiner_rgbsub_b_b[2];
-static int16_t *combiner_rgbmul_r[2];
-static int16_t *combiner_rgbmul_g[2];
-static int16_t *combiner_rgbmul_b[2];
-static int16_t *combiner_rgbadd_r[2];
-static int16_t *combiner_rgbadd_g[2];
-static int16_t *combiner_rgbadd_b[2];
-
-static int16_t *combiner_alphasub_a[2];
-static int16_t *combiner_alphasub_b[2];
-static int16_t *combiner_alphamul[2];
-static int16_t *combiner_alphaadd[2];
-
-static int16_t *blender1a_r[2];
-static int16_t *blender1a_g[2];
-static int16_t *blender1a_b[2];
-static int16_t *blender1b_a[2];
-static int16_t *blender2a_r[2];
-static int16_t *blender2a_g[2];
-static int16_t *blender2a_b[2];
-static int16_t *blender2b_a[2];
+static TLS int8_t get_dither_noise_type;
+static TLS int scfield;
+static TLS int sckeepodd;
+
+static TLS int ti_format;
+static TLS int ti_size;
+static TLS int ti_width;
+static TLS uint32_t ti_address;
+
+static TLS int fb_format;
+static TLS int fb_size;
+static TLS int fb_width;
+static TLS uint32_t fb_address;
+static TLS uint32_t zb_address;
+
+static TLS uint32_t max_level;
+static TLS int32_t min_level;
+static TLS int16_t primitive_lod_frac;
+
+static TLS uint32_t primitive_z;
+static TLS uint16_t primitive_delta_z;
+
+static TLS uint32_t fill_color;
+
+static TLS int16_t *combiner_rgbsub_a_r[2];
+static TLS int16_t *combiner_rgbsub_a_g[2];
+static TLS int16_t *combiner_rgbsub_a_b[2];
+static TLS int16_t *combiner_rgbsub_b_r[2];
+static TLS int16_t *combiner_rgbsub_b_g[2];
+static TLS int16_t *combiner_rgbsub_b_b[2];
+static TLS int16_t *combiner_rgbmul_r[2];
+static TLS int16_t *combiner_rgbmul_g[2];
+static TLS int16_t *combiner_rgbmul_b[2];
+static TLS int16_t *combiner_rgbadd_r[2];
+static TLS int16_t *combiner_rgbadd_g[2];
+static TLS int16_t *combiner_rgbadd_b[2];
+
+static TLS int16_t *combiner_alphasub_a[2];
+static TLS int16_t *combiner_alphasub_b[2];
+static TLS int16_t *combiner_alphamul[2];
+static TLS int16_t *combiner_alphaadd[2];
+
+static TLS int16_t *blender1a_r[2];
+static TLS int16_t *blender1a_g[2];
+static TLS int16_t *blender1a_b[2];
+static TLS int16_t *blender1b_a[2];
+static TLS int16_t *blender2a_r[2];
+static TLS int16_t *blender2a_g[2];
+static TLS int16_t *blender2a_b[2];
+static TLS int16_t *blender2b_a[2];
 
 #define COLOR_RED(val)       (val.col[0])
 #define COLOR_GREEN(val)     (val.col[1])
@@ -200,25 +201,62 @@ static int16_t *blender2b_a[2];
 #define TRELATIVE(x, y)     ((x) - ((y) << 3));
 #define UPPER ((sfrac + tfrac) & 0x20)
 
-static int32_t k0_tf = 0, k1_tf = 0, k2_tf = 0, k3_tf = 0;
-static int16_t k4 = 0, k5 = 0;
+static TLS int32_t k0_tf = 0, k1_tf = 0, k2_tf = 0, k3_tf = 0;
+static TLS int16_t k4 = 0, k5 = 0;
 
-static TILE tile[8];
+static TLS TILE tile[8];
 
-static OTHER_MODES other_modes;
-static COMBINE_MODES combine;
+static TLS OTHER_MODES other_modes;
+static TLS COMBINE_MODES combine;
 
-static COLOR key_width;
-static COLOR key_scale;
-static COLOR key_center;
-static COLOR fog_color;
-static COLOR blend_color;
-static COLOR prim_color;
-static COLOR env_color;
+static TLS COLOR key_width;
+static TLS COLOR key_scale;
+static TLS COLOR key_center;
+static TLS COLOR fog_color;
+static TLS COLOR blend_color;
+static TLS COLOR prim_color;
+static TLS COLOR env_color;
 
 static int rdp_pipeline_crashed;
 
-static RECTANGLE __clip = {
+#ifdef HAVE_RDP_THREADS
+/*
+ * Every worker replays the whole command list against its own copy of the
+ * rasterizer state, but only shades the scanlines it owns.
+ */
+static unsigned rdp_num_workers = 1;
+static TLS unsigned rdp_worker_id;
+
+/*
+ * Set while the main worker shades every scanline of a primitive, see
+ * render_spans.
+ */
+static TLS int rdp_sequential_spans;
+
+/* worker which shaded the last pixel of the 1- and 2-cycle primitives */
+static TLS unsigned rdp_carry_owner;
+
+#define RDP_OWNS_SCANLINE(y)    (rdp_sequential_spans \
+    ? rdp_worker_id == 0 : (unsigned)(y) % rdp_num_workers == rdp_worker_id)
+#define RDP_IS_MAIN_WORKER()    (rdp_worker_id == 0)
+
+static void rdp_start_workers(void);
+static void rdp_stop_workers(void);
+static void rdp_begin_sequential_spans(void);
+static void rdp_end_sequential_spans(int start, int end, int flip);
+#else
+#define RDP_OWNS_SCANLINE(y)    1
+#define RDP_IS_MAIN_WORKER()    1
+#endif
+
+/* Every worker runs into the same crash, only the main one records it. */
+static void rdp_pipeline_crash(void)
+{
+    if (RDP_IS_MAIN_WORKER())
+        rdp_pipeline_crashed = 1;
+}
+
+static TLS RECTANGLE __clip = {
     0, 0, 0x2000, 0x2000
 };
 
@@ -238,9 +276,9 @@ static void (*fbread2_func[4])(uint32_t, uint32_t*) = {
     fbread2_4, fbread2_8, fbread2_16, fbread2_32
 };
 
-void (*fbread1_ptr)(uint32_t, uint32_t*);
-void (*fbread2_ptr)(uint32_t, uint32_t*);
-void (*fbwrite_ptr)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+static TLS void (*fbread1_ptr)(uint32_t, uint32_t*);
+static TLS void (*fbread2_ptr)(uint32_t, uint32_t*);
+static TLS void (*fbwrite_ptr)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 
 #define PAIRWRITE16(in, rval, hval) {            \
    (in) &= (RDRAM_MASK >> 1);	                   \
@@ -270,22 +308,22 @@ uint32_t internal_vi_v_current_line = 0;
 uint32_t old_vi_origin = 0;
 uint32_t oldhstart = 0;
 uint32_t oldsomething = 0;
-int blshifta = 0, blshiftb = 0, pastblshifta = 0, pastblshiftb = 0;
-int32_t pastrawdzmem = 0;
-int32_t iseed = 1;
+static TLS int blshifta = 0, blshiftb = 0, pastblshifta = 0, pastblshiftb = 0;
+static TLS int32_t pastrawdzmem = 0;
+static TLS int32_t iseed = 1;
 
-static SPAN span[1024];
-uint8_t cvgbuf[1024];
+static TLS SPAN span[1024];
+static TLS uint8_t cvgbuf[1024];
 
-static int32_t spans_d_rgba[4];
-static int32_t spans_d_stwz[4];
-static uint16_t spans_dzpix;
+static TLS int32_t spans_d_rgba[4];
+static TLS int32_t spans_d_stwz[4];
+static TLS uint16_t spans_dzpix;
 
-static int32_t spans_d_rgba_dy[4];
-static int32_t spans_cd_rgba[4];
-static int spans_cdz;
+static TLS int32_t spans_d_rgba_dy[4];
+static TLS int32_t spans_cd_rgba[4];
+static TLS int spans_cdz;
 
-static int32_t spans_d_stwz_dy[4];
+static TLS int32_t spans_d_stwz_dy[4];
 
 typedef struct
 {
@@ -308,26 +346,26 @@ typedef struct
 #define ZMODE_TRANSPARENT        2
 #define ZMODE_DECAL                3
 
-COLOR combined_color;
-COLOR texel0_color;
-COLOR texel1_color;
-COLOR nexttexel_color;
-COLOR shade_color;
-static int16_t noise = 0;
+static TLS COLOR combined_color;
+static TLS COLOR texel0_color;
+static TLS COLOR texel1_color;
+static TLS COLOR nexttexel_color;
+static TLS COLOR shade_color;
+static TLS int16_t noise = 0;
 static int16_t one_color = 0x100;
 static int16_t zero_color = 0x00;
 
 static int16_t blenderone    = 0xff;
 
-COLOR pixel_color;
-COLOR inv_pixel_color;
-COLOR blended_pixel_color;
-COLOR memory_color;
-COLOR pre_memory_color;
+static TLS COLOR pixel_color;
+static TLS COLOR inv_pixel_color;
+static TLS COLOR blended_pixel_color;
+static TLS COLOR memory_color;
+static TLS COLOR pre_memory_color;
 
 int oldscyl = 0;
 
-uint8_t __TMEM[0x1000]; 
+static TLS uint8_t __TMEM[0x1000]; 
 
 #define tlut ((uint16_t*)(&__TMEM[0x800]))
 
@@ -343,7 +381,7 @@ typedef struct{
     int onelessthanmid;
 }SPANSIGS;
 
-static int16_t lod_frac = 0;
+static TLS int16_t lod_frac = 0;
 struct {uint32_t shift; uint32_t add;} z_dec_table[8] = {
      6, 0x00000,
      5, 0x20000,
@@ -374,9 +412,9 @@ static void (*render_spans_2cycle_func[4])(int, int, int, int) =
     render_spans_2cycle_notex, render_spans_2cycle_notexel1, render_spans_2cycle_notexelnext, render_spans_2cycle_complete
 };
 
-static void (*render_spans_1cycle_ptr)(int, int, int, int);
+static TLS void (*render_spans_1cycle_ptr)(int, int, int, int);
 
-static void (*render_spans_2cycle_ptr)(int start, int end, int tilenum, int flip);
+static TLS void (*render_spans_2cycle_ptr)(int start, int end, int tilenum, int flip);
 
 uint16_t z_com_table[0x40000];
 uint32_t z_complete_dec_table[0x4000];
@@ -1107,7 +1145,8 @@ static void precalculate_everything(void)
     }
 }
 
-void rdp_init(void)
+/* Resets the rasterizer state owned by the calling thread. */
+static void rdp_init_state(void)
 {
     int i;
 
@@ -1143,12 +1182,11 @@ void rdp_init(void)
                       &blender1b_a[1], 0, 0);
     SET_BLENDER_INPUT(1, 1, &blender2a_r[1], &blender2a_g[1], &blender2a_b[1],
                       &blender2b_a[1], 0, 0);
+    memset(&other_modes, 0, sizeof(other_modes));
+    memset(&combine, 0, sizeof(combine));
     other_modes.f.stalederivs = 1;
     memset(__TMEM, 0, 0x1000);
 
-    for (i = 0; i < sizeof(hidden_bits); i++)
-        hidden_bits[i] = 0x03;
-
     memset(tile, 0, sizeof(tile));
     for (i = 0; i < 8; i++)
     {
@@ -1161,6 +1199,41 @@ void rdp_init(void)
     memset(&env_color, 0, sizeof(COLOR));
     memset(&key_scale, 0, sizeof(COLOR));
     memset(&key_center, 0, sizeof(COLOR));
+    memset(&key_width, 0, sizeof(COLOR));
+    memset(&fog_color, 0, sizeof(COLOR));
+    memset(&blend_color, 0, sizeof(COLOR));
+
+    ti_format = ti_size = ti_width = 0;
+    ti_address = 0;
+    fb_format = fb_size = fb_width = 0;
+    fb_address = zb_address = 0;
+    fill_color = 0;
+    primitive_z = 0;
+    primitive_delta_z = 0;
+    primitive_lod_frac = 0;
+    max_level = 0;
+    min_level = 0;
+    scfield = sckeepodd = 0;
+    __clip.xl = __clip.yl = 0;
+    __clip.xh = __clip.yh = 0x2000;
+    iseed = 1;
+#ifdef HAVE_RDP_THREADS
+    rdp_sequential_spans = 0;
+    rdp_carry_owner = 0;
+#endif
+}
+
+void rdp_init(void)
+{
+    int i;
+
+#ifdef HAVE_RDP_THREADS
+    rdp_stop_workers();
+#endif
+    rdp_init_state();
+
+    for (i = 0; i < sizeof(hidden_bits); i++)
+        hidden_bits[i] = 0x03;
 
     rdp_pipeline_crashed = 0;
     memset(&onetimewarnings, 0, sizeof(onetimewarnings));
@@ -1182,6 +1255,10 @@ void rdp_init(void)
 
     rdram_8 = (uint8_t*)gfx_info.RDRAM;
     rdram_16 = (uint16_t*)gfx_info.RDRAM;
+
+#ifdef HAVE_RDP_THREADS
+    rdp_start_workers();
+#endif
 }
 
 static INLINE void SET_SUBA_RGB_INPUT(int16_t **input_r, int16_t **input_g, int16_t **input_b, int code)
@@ -3808,7 +3885,8 @@ static void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS, int32_t
     int upper = 0;
     int bilerp = cycle ? other_modes.bi_lerp1 : other_modes.bi_lerp0;
     int convert = other_modes.convert_one && cycle;
-    COLOR t0, t1, t2, t3;
+    /* the fetchers leave the texels of formats 5 to 7 alone */
+    COLOR t0 = {{0}}, t1 = {{0}}, t2 = {{0}}, t3 = {{0}};
     int sss1, sst1, sss2, sst2;
 
     sss1 = SSS;
@@ -5071,7 +5149,7 @@ static void render_spans_1cycle_complete(int start, int end, int tilenum, int fl
     for (i = start; i <= end; i++)
     {
        SPAN *span_ptr = &span[i];
-        if (!span_ptr || span_ptr->validline == 0)
+        if (!span_ptr || span_ptr->validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
@@ -5257,7 +5335,7 @@ static void render_spans_1cycle_notexel1(int start, int end, int tilenum, int fl
     for (i = start; i <= end; i++)
     {
        SPAN *span_ptr = &span[i];
-        if (!span_ptr || span_ptr->validline == 0)
+        if (!span_ptr || span_ptr->validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
@@ -5431,7 +5509,7 @@ static void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
     for (i = start; i <= end; i++)
     {
        SPAN *span_ptr = &span[i];
-        if (!span_ptr || span_ptr->validline == 0)
+        if (!span_ptr || span_ptr->validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span_ptr->lx;
         xend   = span_ptr->unscrx;
@@ -5868,7 +5946,7 @@ static void render_spans_2cycle_complete(int start, int end, int tilenum, int fl
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (span[i].validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span[i].lx;
         xend = span[i].unscrx;
@@ -6055,7 +6133,7 @@ static void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (span[i].validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span[i].lx;
         xend = span[i].unscrx;
@@ -6236,7 +6314,7 @@ static void render_spans_2cycle_notexel1(int start, int end, int tilenum, int fl
 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (span[i].validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span[i].lx;
         xend = span[i].unscrx;
@@ -6412,7 +6490,7 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (span[i].validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         xstart = span[i].lx;
         xend = span[i].unscrx;
@@ -6499,7 +6577,7 @@ static void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 
 static void render_spans_fill_4(int start, int end, int flip)
 {
-    rdp_pipeline_crashed = 1;
+    rdp_pipeline_crash();
 }
 
 static void render_spans_fill_8(int start, int end, int flip)
@@ -6525,13 +6603,16 @@ static void render_spans_fill_8(int start, int end, int flip)
          length -= flip;
          if (length < 0)
             continue;
-         if (onetimewarnings.fillmbitcrashes == 0)
-            DisplayError("render_spans_fill:  RDP crashed");
-         onetimewarnings.fillmbitcrashes = 1;
-         rdp_pipeline_crashed = 1;
+         if (RDP_IS_MAIN_WORKER())
+         {
+            if (onetimewarnings.fillmbitcrashes == 0)
+               DisplayError("render_spans_fill:  RDP crashed");
+            onetimewarnings.fillmbitcrashes = 1;
+            if (fastkillbits) /* left out for performance */
+               DisplayError("Exact fill abort timing not implemented.");
+         }
+         rdp_pipeline_crash();
          end = i; /* premature termination of render_spans */
-         if (fastkillbits) /* left out for performance */
-            DisplayError("Exact fill abort timing not implemented.");
          break;
       }
    }
@@ -6546,7 +6627,7 @@ static void render_spans_fill_8(int start, int end, int flip)
       curpixel   = fb_width * i + x;
       length      = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!span[i].validline || !RDP_OWNS_SCANLINE(i))
          continue;
 
       for (j = 0, fb = fb_address + curpixel; j <= length; j++, fb += xinc)
@@ -6581,13 +6662,16 @@ static void render_spans_fill_16(int start, int end, int flip)
          length -= flip;
          if (length < 0)
             continue;
-         if (onetimewarnings.fillmbitcrashes == 0)
-            DisplayError("render_spans_fill:  RDP crashed");
-         onetimewarnings.fillmbitcrashes = 1;
-         rdp_pipeline_crashed = 1;
+         if (RDP_IS_MAIN_WORKER())
+         {
+            if (onetimewarnings.fillmbitcrashes == 0)
+               DisplayError("render_spans_fill:  RDP crashed");
+            onetimewarnings.fillmbitcrashes = 1;
+            if (fastkillbits) /* left out for performance */
+               DisplayError("Exact fill abort timing not implemented.");
+         }
+         rdp_pipeline_crash();
          end = i; /* premature termination of render_spans */
-         if (fastkillbits) /* left out for performance */
-            DisplayError("Exact fill abort timing not implemented.");
          break;
 	  }
    }
@@ -6604,7 +6688,7 @@ static void render_spans_fill_16(int start, int end, int flip)
       curpixel   = fb_width * i + x;
       length     = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!span[i].validline || !RDP_OWNS_SCANLINE(i))
          continue;
 
       for (j = 0, fb = (fb_address >> 1) + curpixel; j <= length; j++, fb += xinc)
@@ -6640,13 +6724,16 @@ static void render_spans_fill_32(int start, int end, int flip)
          length -= flip;
          if (length < 0)
             continue;
-         if (onetimewarnings.fillmbitcrashes == 0)
-            DisplayError("render_spans_fill:  RDP crashed");
-         onetimewarnings.fillmbitcrashes = 1;
-         rdp_pipeline_crashed = 1;
+         if (RDP_IS_MAIN_WORKER())
+         {
+            if (onetimewarnings.fillmbitcrashes == 0)
+               DisplayError("render_spans_fill:  RDP crashed");
+            onetimewarnings.fillmbitcrashes = 1;
+            if (fastkillbits) /* left out for performance */
+               DisplayError("Exact fill abort timing not implemented.");
+         }
+         rdp_pipeline_crash();
          end = i; /* premature termination of render_spans */
-         if (fastkillbits) /* left out for performance */
-            DisplayError("Exact fill abort timing not implemented.");
          break;
       }
    }
@@ -6661,7 +6748,7 @@ static void render_spans_fill_32(int start, int end, int flip)
       curpixel   = fb_width * i + x;
       length     = flip ? (xstart - xendsc) : (xendsc - xstart);
 
-      if (!span[i].validline)
+      if (!span[i].validline || !RDP_OWNS_SCANLINE(i))
          continue;
 
       for (j = 0, fb = (fb_address >> 2) + curpixel; j <= length; j++, fb += xinc)
@@ -6771,7 +6858,7 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
 
     if (fb_size == PIXEL_SIZE_32BIT)
     {
-        rdp_pipeline_crashed = 1;
+        rdp_pipeline_crash();
         return;
     }
 
@@ -6794,7 +6881,7 @@ static void render_spans_copy(int start, int end, int tilenum, int flip)
                 
     for (i = start; i <= end; i++)
     {
-        if (span[i].validline == 0)
+        if (span[i].validline == 0 || !RDP_OWNS_SCANLINE(i))
             continue;
         s = span[i].stwz[0];
         t = span[i].stwz[1];
@@ -6893,6 +6980,7 @@ static void deduce_derivatives(void)
     int texel1_used_in_cc1 = 0, texel0_used_in_cc1 = 0, texel0_used_in_cc0 = 0, texel1_used_in_cc0 = 0;
     int texels_in_cc0 = 0, texels_in_cc1 = 0;
     int lod_frac_used_in_cc1 = 0, lod_frac_used_in_cc0 = 0;
+    int combined_used_in_cc1 = 0, combined_used_in_cc0 = 0;
     int lodfracused = 0;
 
     other_modes.f.partialreject_1cycle = (blender2b_a[0] == &COLOR_ALPHA(inv_pixel_color) && blender1b_a[0] == &COLOR_ALPHA(pixel_color));
@@ -6927,6 +7015,14 @@ static void deduce_derivatives(void)
         combiner_alphamul[0] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_a[0] == &COLOR_ALPHA(texel0_color) || combiner_alphasub_b[0] == &COLOR_ALPHA(texel0_color) || combiner_alphaadd[0] == &COLOR_ALPHA(texel0_color) || 
         combiner_rgbmul_r[0] == &COLOR_ALPHA(texel0_color))
         texel0_used_in_cc0 = 1;
+    if (combiner_rgbmul_r[1] == &COLOR_RED(combined_color) || combiner_rgbsub_a_r[1] == &COLOR_RED(combined_color) || combiner_rgbsub_b_r[1] == &COLOR_RED(combined_color) || combiner_rgbadd_r[1] == &COLOR_RED(combined_color) ||
+        combiner_alphamul[1] == &COLOR_ALPHA(combined_color) || combiner_alphasub_a[1] == &COLOR_ALPHA(combined_color) || combiner_alphasub_b[1] == &COLOR_ALPHA(combined_color) || combiner_alphaadd[1] == &COLOR_ALPHA(combined_color) ||
+        combiner_rgbmul_r[1] == &COLOR_ALPHA(combined_color))
+        combined_used_in_cc1 = 1;
+    if (combiner_rgbmul_r[0] == &COLOR_RED(combined_color) || combiner_rgbsub_a_r[0] == &COLOR_RED(combined_color) || combiner_rgbsub_b_r[0] == &COLOR_RED(combined_color) || combiner_rgbadd_r[0] == &COLOR_RED(combined_color) ||
+        combiner_alphamul[0] == &COLOR_ALPHA(combined_color) || combiner_alphasub_a[0] == &COLOR_ALPHA(combined_color) || combiner_alphasub_b[0] == &COLOR_ALPHA(combined_color) || combiner_alphaadd[0] == &COLOR_ALPHA(combined_color) ||
+        combiner_rgbmul_r[0] == &COLOR_ALPHA(combined_color))
+        combined_used_in_cc0 = 1;
     texels_in_cc0 = texel0_used_in_cc0 || texel1_used_in_cc0;
     texels_in_cc1 = texel0_used_in_cc1 || texel1_used_in_cc1;    
 
@@ -6961,6 +7057,23 @@ static void deduce_derivatives(void)
         get_dither_noise_type = 2;
 
     other_modes.f.dolod = other_modes.tex_lod_en || lodfracused;
+
+    /*
+     * Modes whose output depends on the pixel shaded just before, whichever
+     * scanline it was on: dither noise (iseed), the combined color read by
+     * the first combiner cycle, and the first cycle of the 2-cycle blender
+     * (memory_color and pastrawdzmem are those of the previous pixel).
+     */
+    other_modes.f.interpixelstateneeded =
+        (other_modes.alpha_compare_en && other_modes.dither_alpha_en)
+     || ((other_modes.cycle_type == CYCLE_TYPE_1 || other_modes.cycle_type == CYCLE_TYPE_2)
+        && (get_dither_noise_type == 0 || other_modes.rgb_dither_sel == 2))
+     || (other_modes.cycle_type == CYCLE_TYPE_1 && combined_used_in_cc1)
+     || (other_modes.cycle_type == CYCLE_TYPE_2
+        && (combined_used_in_cc0
+         || other_modes.f.special_bsel0
+         || blender1a_r[0] == &COLOR_RED(memory_color)
+         || blender2a_r[0] == &COLOR_RED(memory_color)));
 }
 
 static void render_spans(
@@ -6980,6 +7093,11 @@ static void render_spans(
     ++render_cycle_mode_counts[other_modes.cycle_type];
 #endif
 
+#ifdef HAVE_RDP_THREADS
+    if (other_modes.f.interpixelstateneeded && rdp_num_workers > 1)
+        rdp_begin_sequential_spans();
+#endif
+
     switch (other_modes.cycle_type)
     {
        case CYCLE_TYPE_1:
@@ -6995,6 +7113,11 @@ static void render_spans(
           render_spans_fill(yhlimit, yllimit, flip);
           break;
     }
+
+#ifdef HAVE_RDP_THREADS
+    if (rdp_num_workers > 1)
+        rdp_end_sequential_spans(yhlimit, yllimit, flip);
+#endif
 }
 
 static NOINLINE void loading_pipeline(
@@ -7029,7 +7152,7 @@ static NOINLINE void loading_pipeline(
 
     if (end > start && ltlut)
     {
-        rdp_pipeline_crashed = 1;
+        rdp_pipeline_crash();
         return;
     }
 
@@ -7043,7 +7166,7 @@ static NOINLINE void loading_pipeline(
     switch (ti_size)
     {
        case PIXEL_SIZE_4BIT:
-          rdp_pipeline_crashed = 1;
+          rdp_pipeline_crash();
           return;
        case PIXEL_SIZE_8BIT:
           tiadvance = 8;
@@ -7420,6 +7543,9 @@ int32_t irand(void)
 
 void rdp_close(void)
 {
+#ifdef HAVE_RDP_THREADS
+    rdp_stop_workers();
+#endif
 }
 
 static STRICTINLINE int finalize_spanalpha(
@@ -7765,7 +7891,8 @@ struct stepwalker_info
    uint8_t xfrac;
 };
 
-static int cmd_cur;
+static TLS int cmd_cur; /* command being executed by this thread */
+static int cmd_pos; /* end of the commands already handed out for execution */
 static int cmd_ptr; /* for 64-bit elements, always <= +0x7FFF */
 
 /* static DP_FIFO cmd_fifo; */
@@ -7959,9 +8086,272 @@ static void count_DP_commands(void)
 }
 #endif
 
+static void rdp_execute_commands(int begin, int end)
+{
+    for (cmd_cur = begin; cmd_cur - end < 0; )
+    {
+        uint32_t w1    = cmd_data[cmd_cur + 0].UW32[0];
+        uint32_t w2    = cmd_data[cmd_cur + 0].UW32[1];
+        int command    = (w1 >> 24) % 64;
+        int cmd_length = sizeof(int64_t)/sizeof(int64_t) * DP_CMD_LEN_W[command];
+
+#ifdef HAVE_RDP_DUMP
+        if (RDP_IS_MAIN_WORKER())
+           rdp_dump_emit_command(command,
+                 (const uint32_t*)(cmd_data + cmd_cur), cmd_length * 2);
+#endif
+
+        rdp_command_table[command](w1, w2);
+        cmd_cur += cmd_length;
+    }
+}
+
+#ifdef HAVE_RDP_THREADS
+#include <pthread.h>
+#include <features/features_cpu.h>
+
+#define RDP_MAX_WORKERS 16
+
+static pthread_t rdp_workers[RDP_MAX_WORKERS];
+static pthread_mutex_t rdp_work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rdp_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rdp_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned rdp_work_generation;
+static unsigned rdp_work_pending;
+static int rdp_work_quit;
+static void (*rdp_work_task)(unsigned, unsigned, void*);
+static void* rdp_work_arg;
+
+static pthread_cond_t rdp_barrier_cond = PTHREAD_COND_INITIALIZER;
+static unsigned rdp_barrier_generation;
+static unsigned rdp_barrier_waiting;
+
+/* state of the last pixel shaded, handed over to the main worker */
+static COLOR rdp_carry_combined_color;
+static COLOR rdp_carry_memory_color;
+static int32_t rdp_carry_pastrawdzmem;
+
+/* 0:  one per logical core. The scanline split has shown no speedup on the
+ * dumps tried so far, so it stays opt-in. */
+static unsigned angrylion_threads = 1;
+
+void angrylion_set_threads(unsigned threads)
+{
+   angrylion_threads = threads;
+}
+
+static void* rdp_worker_main(void* arg)
+{
+    unsigned generation = 0;
+
+    rdp_worker_id = (unsigned)(uintptr_t)arg;
+    rdp_init_state();
+
+    pthread_mutex_lock(&rdp_work_mutex);
+    for (;;)
+    {
+        while (generation == rdp_work_generation && !rdp_work_quit)
+            pthread_cond_wait(&rdp_work_cond, &rdp_work_mutex);
+        if (rdp_work_quit)
+            break;
+        generation = rdp_work_generation;
+        pthread_mutex_unlock(&rdp_work_mutex);
+
+        rdp_work_task(rdp_worker_id, rdp_num_workers, rdp_work_arg);
+
+        pthread_mutex_lock(&rdp_work_mutex);
+        if (--rdp_work_pending == 0)
+            pthread_cond_signal(&rdp_done_cond);
+    }
+    pthread_mutex_unlock(&rdp_work_mutex);
+    return NULL;
+}
+
+static void rdp_start_workers(void)
+{
+    unsigned i;
+    unsigned count = angrylion_threads;
+
+    if (count == 0)
+        count = cpu_features_get_core_amount();
+    if (count > RDP_MAX_WORKERS)
+        count = RDP_MAX_WORKERS;
+
+    rdp_worker_id = 0;
+    rdp_work_generation = 0;
+    rdp_work_quit = 0;
+    rdp_num_workers = count ? count : 1;
+
+    for (i = 1; i < rdp_num_workers; i++)
+        if (pthread_create(&rdp_workers[i], NULL, rdp_worker_main,
+                           (void*)(uintptr_t)i) != 0)
+            break;
+    rdp_num_workers = i;
+}
+
+static void rdp_stop_workers(void)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&rdp_work_mutex);
+    rdp_work_quit = 1;
+    pthread_cond_broadcast(&rdp_work_cond);
+    pthread_mutex_unlock(&rdp_work_mutex);
+
+    for (i = 1; i < rdp_num_workers; i++)
+        pthread_join(rdp_workers[i], NULL);
+    rdp_num_workers = 1;
+}
+
+void rdp_run_on_workers(void (*task)(unsigned, unsigned, void*), void* arg)
+{
+    if (rdp_num_workers <= 1)
+    {
+        task(0, 1, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&rdp_work_mutex);
+    rdp_work_task = task;
+    rdp_work_arg = arg;
+    rdp_work_pending = rdp_num_workers - 1;
+    ++rdp_work_generation;
+    pthread_cond_broadcast(&rdp_work_cond);
+    pthread_mutex_unlock(&rdp_work_mutex);
+
+    task(0, rdp_num_workers, arg);
+
+    pthread_mutex_lock(&rdp_work_mutex);
+    while (rdp_work_pending != 0)
+        pthread_cond_wait(&rdp_done_cond, &rdp_work_mutex);
+    pthread_mutex_unlock(&rdp_work_mutex);
+}
+
+/* Waits until every worker has reached the same point of the command list. */
+static void rdp_worker_barrier(void)
+{
+    unsigned generation;
+
+    pthread_mutex_lock(&rdp_work_mutex);
+    generation = rdp_barrier_generation;
+    if (++rdp_barrier_waiting == rdp_num_workers)
+    {
+        rdp_barrier_waiting = 0;
+        ++rdp_barrier_generation;
+        pthread_cond_broadcast(&rdp_barrier_cond);
+    }
+    else
+        while (generation == rdp_barrier_generation)
+            pthread_cond_wait(&rdp_barrier_cond, &rdp_work_mutex);
+    pthread_mutex_unlock(&rdp_work_mutex);
+}
+
+/*
+ * Primitives whose pixels depend on the pixel shaded before them are shaded
+ * by the main worker alone, in the order of a single thread, with the state
+ * left by the last pixel whichever worker shaded it. The other workers wait
+ * so that no scanline is shaded out of order.
+ */
+static void rdp_begin_sequential_spans(void)
+{
+    if (rdp_worker_id == rdp_carry_owner)
+    {
+        COLOR_ASSIGN(rdp_carry_combined_color, combined_color);
+        COLOR_ASSIGN(rdp_carry_memory_color, memory_color);
+        rdp_carry_pastrawdzmem = pastrawdzmem;
+    }
+    rdp_worker_barrier();
+
+    if (RDP_IS_MAIN_WORKER())
+    {
+        COLOR_ASSIGN(combined_color, rdp_carry_combined_color);
+        COLOR_ASSIGN(memory_color, rdp_carry_memory_color);
+        pastrawdzmem = rdp_carry_pastrawdzmem;
+    }
+    rdp_sequential_spans = 1;
+}
+
+static void rdp_end_sequential_spans(int start, int end, int flip)
+{
+    int i;
+
+    if (rdp_sequential_spans)
+    {
+        rdp_sequential_spans = 0;
+        rdp_carry_owner = 0;
+        rdp_worker_barrier();
+        return;
+    }
+
+    if (other_modes.cycle_type != CYCLE_TYPE_1 && other_modes.cycle_type != CYCLE_TYPE_2)
+        return;
+
+    /* every worker finds the same last shaded scanline */
+    for (i = end; i >= start; i--)
+    {
+        const int length = flip
+            ? span[i].lx - span[i].rx : span[i].rx - span[i].lx;
+
+        if (span[i].validline && length >= 0)
+        {
+            rdp_carry_owner = (unsigned)i % rdp_num_workers;
+            break;
+        }
+    }
+}
+
+static void rdp_command_task(unsigned id, unsigned count, void* arg)
+{
+    const int* range = (const int*)arg;
+
+    rdp_execute_commands(range[0], range[1]);
+}
+
+static void rdp_run_commands(int begin, int end)
+{
+    int range[2];
+
+    if (begin == end)
+        return;
+    range[0] = begin;
+    range[1] = end;
+    rdp_run_on_workers(rdp_command_task, range);
+}
+
+/*
+ * Workers only see their own scanlines, so anything that reads RDRAM back
+ * into TMEM has to wait until every earlier primitive has been drawn.
+ */
+static int rdp_command_is_load(int command)
+{
+    return (command == 0x30 || command == 0x33 || command == 0x34);
+}
+
+static int rdp_command_is_draw(int command)
+{
+    return ((command >= 0x08 && command <= 0x0F)
+         || command == 0x24 || command == 0x25 || command == 0x36);
+}
+#else
+void angrylion_set_threads(unsigned threads)
+{
+}
+
+void rdp_run_on_workers(void (*task)(unsigned, unsigned, void*), void* arg)
+{
+    task(0, 1, arg);
+}
+
+#define rdp_run_commands rdp_execute_commands
+#endif
+
 void process_RDP_list(void)
 {
     int length;
+    int batch;
+#ifdef HAVE_RDP_THREADS
+    int drawn = 0;
+#endif
     unsigned int offset;
     const uint32_t DP_CURRENT = *GET_GFX_INFO(DPC_CURRENT_REG) & 0x00FFFFF8;
     const uint32_t DP_END     = *GET_GFX_INFO(DPC_END_REG)     & 0x00FFFFF8;
@@ -8016,29 +8406,35 @@ void process_RDP_list(void)
     if (rdp_pipeline_crashed != 0)
         goto exit_a;
 
-    while (cmd_cur - cmd_ptr < 0)
+    batch = cmd_pos;
+    while (cmd_pos - cmd_ptr < 0)
     {
-        uint32_t w1    = cmd_data[cmd_cur + 0].UW32[0];
-        uint32_t w2    = cmd_data[cmd_cur + 0].UW32[1];
+        uint32_t w1    = cmd_data[cmd_pos + 0].UW32[0];
         int command    = (w1 >> 24) % 64;
         int cmd_length = sizeof(int64_t)/sizeof(int64_t) * DP_CMD_LEN_W[command];
 #ifdef TRACE_DP_COMMANDS
         ++cmd_count[command];
 #endif
-        if (cmd_ptr - cmd_cur - cmd_length < 0)
-            goto exit_b;
+        if (cmd_ptr - cmd_pos - cmd_length < 0)
+            break;
 
-#ifdef HAVE_RDP_DUMP
-        rdp_dump_emit_command(command,
-              (const uint32_t*)(cmd_data + cmd_cur), cmd_length * 2);
+#ifdef HAVE_RDP_THREADS
+        if (rdp_command_is_load(command) && drawn)
+        {
+            rdp_run_commands(batch, cmd_pos);
+            batch = cmd_pos;
+            drawn = 0;
+        }
+        drawn |= rdp_command_is_draw(command);
 #endif
-
-        rdp_command_table[command](w1, w2);
-        cmd_cur += cmd_length;
-    };
+        cmd_pos += cmd_length;
+    }
+    rdp_run_commands(batch, cmd_pos);
+    if (cmd_pos - cmd_ptr < 0)
+        goto exit_b;
 exit_a:
     cmd_ptr = 0;
-    cmd_cur = 0;
+    cmd_pos = 0;
 exit_b:
     *GET_GFX_INFO(DPC_START_REG)
   = *GET_GFX_INFO(DPC_CURRENT_REG)
@@ -8051,6 +8447,8 @@ static void invalid(uint32_t w1, uint32_t w2)
 {
     const unsigned int command = (w1 & 0x3F000000) >> 24;
 
+    if (!RDP_IS_MAIN_WORKER())
+        return;
     invalid_command[0] = '0' | command >> 3;
     invalid_command[1] = '0' | command & 07;
     DisplayError(invalid_command);
@@ -8390,7 +8788,7 @@ no_read_zbuffer_coefficients:
 
     for (k = ycur; k <= ylfar; k++)
     {
-        static int minmax[2];
+        static TLS int minmax[2];
         int stickybit;
         int xlrsc[2];
         const int spix = k & 3;
@@ -8888,6 +9286,9 @@ static void sync_full(uint32_t w1, uint32_t w2)
    fprintf(stderr, "Sync full\n");
    fprintf(stderr, "===================\n");
 #endif
+    if (!RDP_IS_MAIN_WORKER())
+        return;
+
     *gfx_info.MI_INTR_REG |= DP_INTERRUPT;
     gfx_info.CheckInterrupts();
 
@@ -9161,7 +9562,7 @@ static void fill_rect(uint32_t w1, uint32_t w2)
     allinval = 1;
     for (k = ycur; k <= ylfar; k++)
     {
-        static int maxxmx, minxhx;
+        static TLS int maxxmx, minxhx;
         int xrsc, xlsc, stickybit;
         const int32_t xleft = xl & ~0x00000001, xright = xh & ~0x00000001;
         const int yhclose = yhlimit & ~3;
@@ -5,6 +5,12 @@
 #include "vi.h"
 #include "api/libretro.h"
 
+#if !defined(USE_SSE_SUPPORT) && defined(HAVE_NEON) && \
+    (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define USE_NEON_SUPPORT
+#include <arm_neon.h>
+#endif
+
 typedef struct {
     uint8_t r, g, b, cvg;
 } CCVG;
@@ -83,6 +89,24 @@ static CVtcmaskDERIVATIVE cvarray[0x100];
 	bend += blueptr[tempb];												\
 }
 
+#ifdef USE_SSE_SUPPORT
+/*
+ * Vector form of eight VI_COMPARE steps: +1 for every neighbour whose 5-bit
+ * component is above the centre's, -1 for every one below it.
+ */
+static STRICTINLINE int32_t vi_restore_sum(__m128i neighbours, int32_t center)
+{
+    const __m128i c = _mm_set1_epi16((int16_t)((center >> 3) & 0x1f));
+    __m128i sum = _mm_sub_epi16(
+        _mm_cmplt_epi16(neighbours, c), _mm_cmpgt_epi16(neighbours, c));
+
+    sum = _mm_madd_epi16(sum, _mm_set1_epi16(1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
 extern retro_log_printf_t log_cb;
 extern retro_environment_t environ_cb;
 
@@ -387,11 +411,22 @@ no_frame_buffer:
     }
 }
 
-static void do_frame_buffer_proper(
-    uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
-    int linecount)
+struct vi_line_batch
+{
+    uint32_t prescale_ptr;
+    int hres, vres, x_start, vitype, linecount;
+};
+
+/*
+ * Filters output lines [first, last).  Every line is computed from RDRAM
+ * alone, the caches below only save refetching the previous line, so the
+ * frame can be split into bands that are filtered independently.  The gamma
+ * dither is the exception: it draws from the same irand sequence as the RDP.
+ */
+static void do_frame_buffer_lines(
+    const struct vi_line_batch* batch, int first, int last)
 {
-    CCVG viaa_array[2048];
+    CCVG viaa_array[2 * 1025]; /* one guard entry in front of each line */
     CCVG divot_array[2048];
     CCVG *viaa_cache, *viaa_cache_next, *divot_cache, *divot_cache_next;
     CCVG *tempccvgptr;
@@ -401,6 +436,11 @@ static void do_frame_buffer_proper(
     uint32_t prevy = 0;
     uint32_t y_start = (vi_y_scale >> 16) & 0x0FFF;
 	uint32_t frame_buffer = vi_origin & 0x00FFFFFF;
+    uint32_t prescale_ptr = batch->prescale_ptr;
+    const int hres = batch->hres;
+    const int vitype = batch->vitype;
+    const int linecount = batch->linecount;
+    int x_start = batch->x_start;
     signed int cache_marker_init;
     int line_x = 0, next_line_x = 0, prev_line_x = 0, far_line_x = 0;
     int prev_scan_x = 0, scan_x = 0, next_scan_x = 0, far_scan_x = 0;
@@ -416,25 +456,20 @@ static void do_frame_buffer_proper(
     const int gamma_dither     = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000004);
     const int gamma            = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000008);
     const int divot            = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000010);
-    const int clock_enable     = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000020);
     const int extralines       =  !(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000100);
     const int fsaa             =  !(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000200);
     const int dither_filter    = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00010000);
     const int gamma_and_dither = (gamma << 1) | gamma_dither;
     const int lerp_en          = fsaa | extralines;
 
-    if (frame_buffer == 0)
-        return;
-
-    if (clock_enable)
-        DisplayError(
-            "rdp_update: vbus_clock_enable bit set in VI_CONTROL_REG "\
-            "register. Never run this code on your N64! It's rumored that "\
-            "turning this bit on will result in permanent damage to the "\
-            "hardware! Emulation will now continue.");
-
-    viaa_cache = &viaa_array[0];
-    viaa_cache_next = &viaa_array[1024];
+    /*
+     * The divot filter of the first pixel reads the entry left of it, which
+     * is never fetched; keep it defined so every band filters the same way.
+     */
+    memset(&viaa_array[0], 0, sizeof(CCVG));
+    memset(&viaa_array[1025], 0, sizeof(CCVG));
+    viaa_cache = &viaa_array[1];
+    viaa_cache_next = &viaa_array[1026];
     divot_cache = &divot_array[0];
     divot_cache_next = &divot_array[1024];
 
@@ -448,12 +483,14 @@ static void do_frame_buffer_proper(
     slowbright = brightness >> 1;
 #endif
     pixels = 0;
+    y_start += first * y_add;
+    prescale_ptr += first * linecount;
 
-    for (j = 0; j < vres; j++)
+    for (j = first; j < last; j++)
     {
         x_start = (vi_x_scale >> 16) & 0x0FFF;
 
-        if ((y_start >> 10) == (prevy + 1) && j)
+        if ((y_start >> 10) == (prevy + 1) && j != first)
         {
             cache_marker = cache_next_marker;
             cache_next_marker = cache_marker_init;
@@ -472,7 +509,7 @@ static void do_frame_buffer_proper(
                 divot_cache_next = tempccvgptr;
             }
         }
-        else if ((y_start >> 10) != prevy || !j)
+        else if ((y_start >> 10) != prevy || j == first)
         {
             cache_marker = cache_next_marker = cache_marker_init;
             if (divot == 0)
@@ -705,6 +742,44 @@ static void do_frame_buffer_proper(
         y_start += y_add;
     }
 }
+
+static void vi_line_task(unsigned id, unsigned count, void* arg)
+{
+    const struct vi_line_batch* batch = (const struct vi_line_batch*)arg;
+
+    do_frame_buffer_lines(
+        batch, batch->vres * id / count, batch->vres * (id + 1) / count);
+}
+
+static void do_frame_buffer_proper(
+    uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
+    int linecount)
+{
+    struct vi_line_batch batch;
+    const int clock_enable = !!(*GET_GFX_INFO(VI_STATUS_REG) & 0x00000020);
+
+    if ((vi_origin & 0x00FFFFFF) == 0)
+        return;
+
+    if (clock_enable)
+        DisplayError(
+            "rdp_update: vbus_clock_enable bit set in VI_CONTROL_REG "\
+            "register. Never run this code on your N64! It's rumored that "\
+            "turning this bit on will result in permanent damage to the "\
+            "hardware! Emulation will now continue.");
+
+    batch.prescale_ptr = prescale_ptr;
+    batch.hres = hres;
+    batch.vres = vres;
+    batch.x_start = x_start;
+    batch.vitype = vitype;
+    batch.linecount = linecount;
+    if (*GET_GFX_INFO(VI_STATUS_REG) & 0x00000004)
+        vi_line_task(0, 1, &batch);
+    else
+        rdp_run_on_workers(vi_line_task, &batch);
+}
+
 static void do_frame_buffer_raw(
     uint32_t prescale_ptr, int hres, int vres, int x_start, int vitype,
     int linecount)
@@ -990,41 +1065,55 @@ STRICTINLINE static void video_filter32(
     *endb = colb & 0xFF;
 }
 
+/* median(a, b, c), which is what the divot filter picks per component */
+#define VI_MEDIAN3(a, b, c) \
+    ((a) < (b) ? ((b) < (c) ? (b) : ((a) < (c) ? (c) : (a))) \
+               : ((a) < (c) ? (a) : ((b) < (c) ? (c) : (b))))
+
 STRICTINLINE static void divot_filter(
     CCVG* final, CCVG centercolor, CCVG leftcolor, CCVG rightcolor)
 {
-    uint32_t leftr, leftg, leftb;
-    uint32_t rightr, rightg, rightb;
-    uint32_t centerr, centerg, centerb;
+#if defined(USE_SSE_SUPPORT) || defined(USE_NEON_SUPPORT)
+    uint32_t center, left, right, median;
+#endif
 
     *final = centercolor;
     if ((centercolor.cvg & leftcolor.cvg & rightcolor.cvg) == 7)
         return;
 
-    leftr = leftcolor.r;    
-    leftg = leftcolor.g;    
-    leftb = leftcolor.b;
-    rightr = rightcolor.r;    
-    rightg = rightcolor.g;    
-    rightb = rightcolor.b;
-    centerr = centercolor.r;
-    centerg = centercolor.g;
-    centerb = centercolor.b;
-
-    if ((leftr >= centerr && rightr >= leftr) || (leftr >= rightr && centerr >= leftr))
-        final -> r = leftr;
-    else if ((rightr >= centerr && leftr >= rightr) || (rightr >= leftr && centerr >= rightr))
-        final -> r = rightr;
-
-    if ((leftg >= centerg && rightg >= leftg) || (leftg >= rightg && centerg >= leftg))
-        final -> g = leftg;
-    else if ((rightg >= centerg && leftg >= rightg) || (rightg >= leftg && centerg >= rightg))
-        final -> g = rightg;
-
-    if ((leftb >= centerb && rightb >= leftb) || (leftb >= rightb && centerb >= leftb))
-        final -> b = leftb;
-    else if ((rightb >= centerb && leftb >= rightb) || (rightb >= leftb && centerb >= rightb))
-        final -> b = rightb;
+#if defined(USE_SSE_SUPPORT)
+    memcpy(&center, &centercolor, sizeof(CCVG));
+    memcpy(&left, &leftcolor, sizeof(CCVG));
+    memcpy(&right, &rightcolor, sizeof(CCVG));
+    {
+        const __m128i c = _mm_cvtsi32_si128(center);
+        const __m128i l = _mm_cvtsi32_si128(left);
+        const __m128i r = _mm_cvtsi32_si128(right);
+
+        median = _mm_cvtsi128_si32(_mm_max_epu8(
+            _mm_min_epu8(l, r), _mm_min_epu8(_mm_max_epu8(l, r), c)));
+    }
+    memcpy(final, &median, sizeof(CCVG));
+    final -> cvg = centercolor.cvg;
+#elif defined(USE_NEON_SUPPORT)
+    memcpy(&center, &centercolor, sizeof(CCVG));
+    memcpy(&left, &leftcolor, sizeof(CCVG));
+    memcpy(&right, &rightcolor, sizeof(CCVG));
+    {
+        const uint8x8_t c = vreinterpret_u8_u32(vdup_n_u32(center));
+        const uint8x8_t l = vreinterpret_u8_u32(vdup_n_u32(left));
+        const uint8x8_t r = vreinterpret_u8_u32(vdup_n_u32(right));
+
+        median = vget_lane_u32(vreinterpret_u32_u8(vmax_u8(
+            vmin_u8(l, r), vmin_u8(vmax_u8(l, r), c))), 0);
+    }
+    memcpy(final, &median, sizeof(CCVG));
+    final -> cvg = centercolor.cvg;
+#else
+    final -> r = VI_MEDIAN3(leftcolor.r, centercolor.r, rightcolor.r);
+    final -> g = VI_MEDIAN3(leftcolor.g, centercolor.g, rightcolor.g);
+    final -> b = VI_MEDIAN3(leftcolor.b, centercolor.b, rightcolor.b);
+#endif
 }
 
 STRICTINLINE static void restore_filter16(
@@ -1049,6 +1138,22 @@ STRICTINLINE static void restore_filter16(
 
     if (maxpix <= idxlim16 && leftuppix <= idxlim16)
 	{
+#ifdef USE_SSE_SUPPORT
+		const __m128i mask = _mm_set1_epi16(0x1f);
+		const __m128i pixels = _mm_setr_epi16(
+			rdram_16[(leftuppix + 0) ^ WORD_ADDR_XOR],
+			rdram_16[(leftuppix + 1) ^ WORD_ADDR_XOR],
+			rdram_16[(leftuppix + 2) ^ WORD_ADDR_XOR],
+			rdram_16[(leftdownpix + 0) ^ WORD_ADDR_XOR],
+			rdram_16[(leftdownpix + 1) ^ WORD_ADDR_XOR],
+			rdram_16[maxpix ^ WORD_ADDR_XOR],
+			rdram_16[(toleftpix + 0) ^ WORD_ADDR_XOR],
+			rdram_16[(toleftpix + 2) ^ WORD_ADDR_XOR]);
+
+		rend += vi_restore_sum(_mm_and_si128(_mm_srli_epi16(pixels, 11), mask), rend);
+		gend += vi_restore_sum(_mm_and_si128(_mm_srli_epi16(pixels, 6), mask), gend);
+		bend += vi_restore_sum(_mm_and_si128(_mm_srli_epi16(pixels, 1), mask), bend);
+#else
 		VI_COMPARE_OPT(leftuppix);
 		VI_COMPARE_OPT(leftuppix + 1);
 		VI_COMPARE_OPT(leftuppix + 2);
@@ -1057,6 +1162,7 @@ STRICTINLINE static void restore_filter16(
 		VI_COMPARE_OPT(maxpix);
 		VI_COMPARE_OPT(toleftpix);
 		VI_COMPARE_OPT(toleftpix + 2);
+#endif
 	}
 	else
 	{
@@ -1097,6 +1203,24 @@ STRICTINLINE static void restore_filter32(
 
     if (maxpix <= idxlim32 && leftuppix <= idxlim32)
 	{
+#ifdef USE_SSE_SUPPORT
+		const __m128i mask = _mm_set1_epi32(0x1f);
+		const __m128i lo = _mm_setr_epi32(
+			rdram[leftuppix + 0], rdram[leftuppix + 1],
+			rdram[leftuppix + 2], rdram[leftdownpix + 0]);
+		const __m128i hi = _mm_setr_epi32(
+			rdram[leftdownpix + 1], rdram[maxpix],
+			rdram[toleftpix + 0], rdram[toleftpix + 2]);
+
+		rend += vi_restore_sum(_mm_packs_epi32(
+			_mm_srli_epi32(lo, 27), _mm_srli_epi32(hi, 27)), rend);
+		gend += vi_restore_sum(_mm_packs_epi32(
+			_mm_and_si128(_mm_srli_epi32(lo, 19), mask),
+			_mm_and_si128(_mm_srli_epi32(hi, 19), mask)), gend);
+		bend += vi_restore_sum(_mm_packs_epi32(
+			_mm_and_si128(_mm_srli_epi32(lo, 11), mask),
+			_mm_and_si128(_mm_srli_epi32(hi, 11), mask)), bend);
+#else
 		VI_COMPARE32_OPT(leftuppix);
 		VI_COMPARE32_OPT(leftuppix + 1);
 		VI_COMPARE32_OPT(leftuppix + 2);
@@ -1105,6 +1229,7 @@ STRICTINLINE static void restore_filter32(
 		VI_COMPARE32_OPT(maxpix);
 		VI_COMPARE32_OPT(toleftpix);
 		VI_COMPARE32_OPT(toleftpix + 2);
+#endif
 	}
 	else
 	{
@@ -181,6 +181,13 @@ enum {
 
 extern void process_RDP_list(void);
 
+/*
+ * Calls task(id, count, arg) once on each of the count rasterizer threads,
+ * the caller being id 0, and returns after all of them have finished.
+ */
+extern void rdp_run_on_workers(
+    void (*task)(unsigned id, unsigned count, void* arg), void* arg);
+
 int32_t irand(void);
 
 extern uint32_t internal_vi_v_current_line;
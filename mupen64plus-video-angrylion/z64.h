@@ -72,6 +72,17 @@
 #define ALIGNED         __attribute__((aligned(16)))
 #endif
 
+/*
+ * Rasterizer state is duplicated per worker thread (see process_RDP_list),
+ * so it has to be declared thread-local when the worker pool is available.
+ */
+#if !defined(_WIN32) && !defined(IOS) && !defined(EMSCRIPTEN) && !defined(VITA) && !defined(NO_RDP_THREADS)
+#define HAVE_RDP_THREADS
+#define TLS             __thread
+#else
+#define TLS
+#endif
+
 #ifndef PRESCALE_WIDTH
 #define PRESCALE_WIDTH  640
 #endif
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 
 #define CRC32_POLYNOMIAL     0x04C11DB7
 
@@ -59,6 +60,93 @@ uint32_t CRC_CalculatePalette(uint32_t crc, const void * buffer, uint32_t count
 	return crc ^ orig;
 }
 
+static const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t XXH_rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t XXH_read64(const uint8_t * p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t XXH_read32(const uint8_t * p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t XXH64_round(uint64_t acc, uint64_t input)
+{
+	acc += input * XXH_PRIME64_2;
+	acc = XXH_rotl64(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t XXH64_mergeRound(uint64_t acc, uint64_t val)
+{
+	acc ^= XXH64_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// Reads the buffer in host byte order, so hashes are only comparable within one process.
+uint64_t Hash_Calculate( uint64_t hash, const void * buffer, uint32_t count )
+{
+	const uint8_t * p = (const uint8_t*) buffer;
+	const uint8_t * const end = p + count;
+	uint64_t h;
+
+	if (count >= 32) {
+		// Four independent lanes, 32 bytes per iteration
+		const uint8_t * const limit = end - 32;
+		uint64_t v1 = hash + XXH_PRIME64_1 + XXH_PRIME64_2;
+		uint64_t v2 = hash + XXH_PRIME64_2;
+		uint64_t v3 = hash;
+		uint64_t v4 = hash - XXH_PRIME64_1;
+		do {
+			v1 = XXH64_round(v1, XXH_read64(p));
+			v2 = XXH64_round(v2, XXH_read64(p + 8));
+			v3 = XXH64_round(v3, XXH_read64(p + 16));
+			v4 = XXH64_round(v4, XXH_read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = XXH_rotl64(v1, 1) + XXH_rotl64(v2, 7) + XXH_rotl64(v3, 12) + XXH_rotl64(v4, 18);
+		h = XXH64_mergeRound(h, v1);
+		h = XXH64_mergeRound(h, v2);
+		h = XXH64_mergeRound(h, v3);
+		h = XXH64_mergeRound(h, v4);
+	} else
+		h = hash + XXH_PRIME64_5;
+
+	h += count;
+
+	for (; p + 8 <= end; p += 8)
+		h = XXH_rotl64(h ^ XXH64_round(0, XXH_read64(p)), 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+	if (p + 4 <= end) {
+		h = XXH_rotl64(h ^ (XXH_read32(p) * XXH_PRIME64_1), 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; ++p)
+		h = XXH_rotl64(h ^ (*p * XXH_PRIME64_5), 11) * XXH_PRIME64_1;
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
 uint32_t textureCRC(uint8_t * addr, uint32_t height, uint32_t stride)
 {
 	const uint32_t width = stride / 8;
@@ -5,5 +5,7 @@ void CRC_BuildTable();
 // CRC32
 uint32_t CRC_Calculate( uint32_t crc, const void *buffer, uint32_t count );
 uint32_t CRC_CalculatePalette( uint32_t crc, const void *buffer, uint32_t count );
+// 64-bit XXH64 hash, seeded with the hash of the previous block to chain blocks
+uint64_t Hash_Calculate( uint64_t hash, const void *buffer, uint32_t count );
 // Fast checksum calculation from Glide64
 uint32_t textureCRC(uint8_t * addr, uint32_t height, uint32_t stride);
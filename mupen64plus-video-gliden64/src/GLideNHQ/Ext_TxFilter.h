@@ -159,7 +159,7 @@ typedef void (*dispInfoFuncExt)(const wchar_t *format, ...);
 #ifdef TXFILTER_DLL
 typedef unsigned char  uint8;
 typedef unsigned short uint16;
-typedef unsigned long  uint32;
+typedef unsigned int   uint32;
 
 boolean ext_ghq_init(int maxwidth, /* maximum texture width supported by hardware */
 					 int maxheight,/* maximum texture height supported by hardware */
@@ -210,7 +210,7 @@ boolean ext_ghq_reloadhirestex();
 
 typedef unsigned char  uint8;
 typedef unsigned short uint16;
-typedef unsigned long  uint32;
+typedef unsigned int   uint32;
 
 #ifdef __cplusplus
 extern "C"{
@@ -23,6 +23,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <string.h>
 #include "TextureFilters.h"
+#include "TxThreadPool.h"
+
+/* source rows per xBRZ tile */
+#define XBRZ_TILE_ROWS 16
 
 /************************************************************************/
 /* 2X filters                                                           */
@@ -728,3 +732,53 @@ void filter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, u
 	return;
 	}
 }
+
+/* xBRZ scales any slice of source rows of the whole image, see xbrz::scale */
+static void filter_8888_rows(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter, int yFirst, int yLast) {
+	size_t factor;
+	switch (filter & ENHANCEMENT_MASK) {
+	case BRZ2X_ENHANCEMENT: factor = 2; break;
+	case BRZ3X_ENHANCEMENT: factor = 3; break;
+	case BRZ4X_ENHANCEMENT: factor = 4; break;
+	case BRZ5X_ENHANCEMENT: factor = 5; break;
+	case BRZ6X_ENHANCEMENT: factor = 6; break;
+	default: return;
+	}
+	xbrz::scale(factor, (const uint32_t *)const_cast<const uint32 *>(src), (uint32_t *)dest, srcwidth, srcheight, xbrz::ColorFormat::ABGR,
+				xbrz::ScalerCfg(), yFirst, yLast);
+}
+
+void filter_8888_threaded(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter, uint32 scale, unsigned int numcore) {
+	if ((filter & ENHANCEMENT_MASK) >= BRZ2X_ENHANCEMENT &&
+		(filter & ENHANCEMENT_MASK) <= BRZ6X_ENHANCEMENT) {
+		/* xBRZ looks at the whole image, so it is split into small tiles
+		 * which the threads pick up as they get done, without seams. */
+		const int rows = XBRZ_TILE_ROWS;
+		TxThreadPool::getInstance()->run((srcheight + rows - 1) / rows, [=](unsigned int i) {
+			filter_8888_rows(src, srcwidth, srcheight, dest, filter, i * rows, (i + 1) * rows);
+		});
+		return;
+	}
+
+	/* the other filters see each band as an image of its own */
+	unsigned int blkrow = 0;
+	while (numcore > 1 && blkrow == 0) {
+		blkrow = (srcheight >> 2) / numcore;
+		numcore--;
+	}
+	if (blkrow > 0 && numcore > 1) {
+		const uint32 blkheight = blkrow << 2;
+		const uint32 srcStride = srcwidth * blkheight;
+		const uint32 destStride = srcStride * scale * scale;
+		const unsigned int last = numcore - 1;
+		TxThreadPool::getInstance()->run(numcore, [=](unsigned int i) {
+			filter_8888(src + srcStride * i,
+						srcwidth,
+						(i < last) ? blkheight : srcheight - blkheight * last,
+						dest + destStride * i,
+						filter);
+		});
+	} else {
+		filter_8888(src, srcwidth, srcheight, dest, filter);
+	}
+}
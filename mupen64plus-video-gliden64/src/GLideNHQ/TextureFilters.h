@@ -54,6 +54,8 @@ void SmoothFilter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *d
 
 /* helper */
 void filter_8888(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter);
+/* filter_8888 split across numcore threads of TxThreadPool */
+void filter_8888_threaded(uint32 *src, uint32 srcwidth, uint32 srcheight, uint32 *dest, uint32 filter, uint32 scale, unsigned int numcore);
 
 #if !_16BPP_HACK
 void hq4x_init(void);
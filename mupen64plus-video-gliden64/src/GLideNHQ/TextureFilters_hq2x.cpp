@@ -25,6 +25,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "TextureFilters.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <string.h>
+#endif
+
 /************************************************************************/
 /* hq2x filters                                                         */
 /************************************************************************/
@@ -268,6 +273,77 @@ static int hq2x_interp_32_diff(uint32 p1, uint32 p2)
   return 0;
 }
 
+/* neighbours of c[4] which differ from it */
+static unsigned char hq2x_32_mask(const uint32* c)
+{
+  unsigned char mask = 0;
+
+  if (hq2x_interp_32_diff(c[0], c[4]))
+	mask |= 1 << 0;
+  if (hq2x_interp_32_diff(c[1], c[4]))
+	mask |= 1 << 1;
+  if (hq2x_interp_32_diff(c[2], c[4]))
+	mask |= 1 << 2;
+  if (hq2x_interp_32_diff(c[3], c[4]))
+	mask |= 1 << 3;
+  if (hq2x_interp_32_diff(c[5], c[4]))
+	mask |= 1 << 4;
+  if (hq2x_interp_32_diff(c[6], c[4]))
+	mask |= 1 << 5;
+  if (hq2x_interp_32_diff(c[7], c[4]))
+	mask |= 1 << 6;
+  if (hq2x_interp_32_diff(c[8], c[4]))
+	mask |= 1 << 7;
+
+  return mask;
+}
+
+#if defined(__SSE2__)
+/* hq2x_interp_32_diff of four pixel pairs, all bits set where they differ */
+static __m128i hq2x_interp_32_diff4(__m128i p1, __m128i p2)
+{
+  const __m128i lo = _mm_set1_epi32(0xFF);
+  __m128i r, g, b, y, u, v, out;
+  __m128i same = _mm_cmpeq_epi32(_mm_and_si128(_mm_xor_si128(p1, p2), _mm_set1_epi32(0xF8F8F8)), _mm_setzero_si128());
+
+  r = _mm_sub_epi32(_mm_and_si128(p1, lo), _mm_and_si128(p2, lo));
+  g = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(p1, 8), lo), _mm_and_si128(_mm_srli_epi32(p2, 8), lo));
+  b = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(p1, 16), lo), _mm_and_si128(_mm_srli_epi32(p2, 16), lo));
+
+  y = _mm_add_epi32(_mm_add_epi32(r, g), b);
+  u = _mm_sub_epi32(r, b);
+  v = _mm_sub_epi32(_mm_add_epi32(g, g), _mm_add_epi32(r, b));
+
+  out = _mm_or_si128(_mm_cmpgt_epi32(y, _mm_set1_epi32(INTERP_Y_LIMIT)), _mm_cmplt_epi32(y, _mm_set1_epi32(-INTERP_Y_LIMIT)));
+  out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(u, _mm_set1_epi32(INTERP_U_LIMIT)), _mm_cmplt_epi32(u, _mm_set1_epi32(-INTERP_U_LIMIT))));
+  out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi32(v, _mm_set1_epi32(INTERP_V_LIMIT)), _mm_cmplt_epi32(v, _mm_set1_epi32(-INTERP_V_LIMIT))));
+
+  return _mm_andnot_si128(same, out);
+}
+
+/* neighbour masks of the four pixels at src1[0..3], none of them on an edge */
+static void hq2x_32_mask4(unsigned char* mask, const uint32* src0, const uint32* src1, const uint32* src2)
+{
+  const __m128i c = _mm_loadu_si128((const __m128i*)src1);
+  __m128i m;
+  int bits;
+
+  m = _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src0 - 1)), c), _mm_set1_epi32(1 << 0));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)src0), c), _mm_set1_epi32(1 << 1)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src0 + 1)), c), _mm_set1_epi32(1 << 2)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src1 - 1)), c), _mm_set1_epi32(1 << 3)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src1 + 1)), c), _mm_set1_epi32(1 << 4)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src2 - 1)), c), _mm_set1_epi32(1 << 5)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)src2), c), _mm_set1_epi32(1 << 6)));
+  m = _mm_or_si128(m, _mm_and_si128(hq2x_interp_32_diff4(_mm_loadu_si128((const __m128i*)(src2 + 1)), c), _mm_set1_epi32(1 << 7)));
+
+  m = _mm_packs_epi32(m, m);
+  m = _mm_packus_epi16(m, m);
+  bits = _mm_cvtsi128_si32(m);
+  memcpy(mask, &bits, 4);
+}
+#endif
+
 /*static void interp_set(unsigned bits_per_pixel)
 {
    interp_bits_per_pixel = bits_per_pixel;
@@ -526,6 +602,10 @@ static void hq2xS_16_def(uint16* dst0, uint16* dst1, const uint16* src0, const u
 static void hq2x_32_def(uint32* dst0, uint32* dst1, const uint32* src0, const uint32* src1, const uint32* src2, unsigned count)
 {
   unsigned i;
+#if defined(__SSE2__)
+  unsigned char masks[4];
+  int vector = 0;
+#endif
 
   for(i=0;i<count;++i) {
 	unsigned char mask;
@@ -556,24 +636,17 @@ static void hq2x_32_def(uint32* dst0, uint32* dst1, const uint32* src0, const ui
 	  c[8] = src2[0];
 	}
 
-	mask = 0;
-
-	if (hq2x_interp_32_diff(c[0], c[4]))
-	  mask |= 1 << 0;
-	if (hq2x_interp_32_diff(c[1], c[4]))
-	  mask |= 1 << 1;
-	if (hq2x_interp_32_diff(c[2], c[4]))
-	  mask |= 1 << 2;
-	if (hq2x_interp_32_diff(c[3], c[4]))
-	  mask |= 1 << 3;
-	if (hq2x_interp_32_diff(c[5], c[4]))
-	  mask |= 1 << 4;
-	if (hq2x_interp_32_diff(c[6], c[4]))
-	  mask |= 1 << 5;
-	if (hq2x_interp_32_diff(c[7], c[4]))
-	  mask |= 1 << 6;
-	if (hq2x_interp_32_diff(c[8], c[4]))
-	  mask |= 1 << 7;
+#if defined(__SSE2__)
+	/* groups of four pixels away from the row ends get their masks at once */
+	if (!(i & 3)) {
+	  vector = i > 0 && i + 4 < count;
+	  if (vector)
+		hq2x_32_mask4(masks, src0, src1, src2);
+	}
+	mask = vector ? masks[i & 3] : hq2x_32_mask(c);
+#else
+	mask = hq2x_32_mask(c);
+#endif
 
 #define P0 dst0[0]
 #define P1 dst0[1]
@@ -15,6 +15,7 @@
 
 #include "TextureFilters_xbrz.h"
 #include <cassert>
+#include <cmath>
 #include <algorithm>
 #include <vector>
 
@@ -1093,6 +1094,9 @@ void xbrz::init()
 	}
 }
 
+//There is no SIMD version of the scalers: every blend decision reads DistYCbCrBuffer, a 64 MB table indexed by the
+//colour difference, so they are bound by those lookups and the per pixel branches rather than by arithmetic.
+//filter_8888_threaded() spreads them over the thread pool in row tiles instead.
 void xbrz::scale(size_t factor, const uint32_t* src, uint32_t* trg, int srcWidth, int srcHeight, ColorFormat colFmt, const xbrz::ScalerCfg& cfg, int yFirst, int yLast)
 {
 	switch (colFmt)
@@ -31,11 +31,21 @@
 #include <zlib.h>
 #include <memory.h>
 #include <stdlib.h>
+#include <algorithm>
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 TxCache::~TxCache()
 {
 	/* free memory, clean up, etc */
 	clear();
+	unmap();
 
 	delete _txUtil;
 }
@@ -50,6 +60,19 @@ TxCache::TxCache(int options, int cachesize, const wchar_t *path, const wchar_t
 	_callback = callback;
 	_totalSize = 0;
 
+	_gzdest0 = NULL;
+	_gzdest1 = NULL;
+	_gzdestLen = 0;
+
+	_mapped = NULL;
+	_mappedSize = 0;
+	_mappedTable = NULL;
+	_mappedCount = 0;
+#ifdef WIN32
+	_mappedFile = NULL;
+	_mappedMapping = NULL;
+#endif
+
 	/* save path name */
 	if (path)
 		_path.assign(path);
@@ -91,7 +114,7 @@ TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 
 		if (_options & (GZ_TEXCACHE|GZ_HIRESTEXCACHE)) {
 			/* zlib compress it. compression level:1 (best speed) */
-			uint32 destLen = _gzdestLen;
+			uLongf destLen = _gzdestLen;
 			dest = (dest == _gzdest0) ? _gzdest1 : _gzdest0;
 			if (compress2(dest, &destLen, info->data, dataSize, 1) != Z_OK) {
 				dest = info->data;
@@ -186,7 +209,7 @@ TxCache::add(uint64 checksum, GHQTexInfo *info, int dataSize)
 boolean
 TxCache::get(uint64 checksum, GHQTexInfo *info)
 {
-	if (!checksum || _cache.empty()) return 0;
+	if (!checksum || (_cache.empty() && !_mappedCount)) return 0;
 
 	/* find a match in cache */
 	std::map<uint64, TXCACHE*>::iterator itMap = _cache.find(checksum);
@@ -203,7 +226,7 @@ TxCache::get(uint64 checksum, GHQTexInfo *info)
 
 		/* zlib decompress it */
 		if (info->format & GL_TEXFMT_GZ) {
-			uint32 destLen = _gzdestLen;
+			uLongf destLen = _gzdestLen;
 			uint8 *dest = (_gzdest0 == info->data) ? _gzdest1 : _gzdest0;
 			if (uncompress(dest, &destLen, info->data, ((*itMap).second)->size) != Z_OK) {
 				DBG_INFO(80, wst("Error: zlib decompression failed!\n"));
@@ -217,6 +240,32 @@ TxCache::get(uint64 checksum, GHQTexInfo *info)
 		return 1;
 	}
 
+	/* try the mapped file. the texture data is used in place and only
+	 * inflated when it is requested, like the memory cache does. */
+	const TxCacheIndexEntry *entry = find_mapped(checksum);
+	if (entry) {
+		info->data = _mapped + entry->offset;
+		info->width = entry->width;
+		info->height = entry->height;
+		info->format = entry->format;
+		info->texture_format = entry->texture_format;
+		info->pixel_type = entry->pixel_type;
+		info->is_hires_tex = entry->is_hires_tex;
+
+		if (info->format & GL_TEXFMT_GZ) {
+			uLongf destLen = _gzdestLen;
+			uint8 *dest = (_gzdest0 == info->data) ? _gzdest1 : _gzdest0;
+			if (!dest || uncompress(dest, &destLen, info->data, entry->size) != Z_OK) {
+				DBG_INFO(80, wst("Error: zlib decompression failed!\n"));
+				return 0;
+			}
+			info->data = dest;
+			info->format &= ~GL_TEXFMT_GZ;
+		}
+
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -374,6 +423,130 @@ TxCache::load(const wchar_t *path, const wchar_t *filename, int config)
 	return !_cache.empty();
 }
 
+boolean
+TxCache::map(const wchar_t *path, const wchar_t *filename, int config)
+{
+	/* find it on disk */
+	unmap();
+
+#ifdef WIN32
+	wchar_t curpath[MAX_PATH];
+	GETCWD(MAX_PATH, curpath);
+	CHDIR(path);
+
+	HANDLE file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER size;
+		HANDLE mapping = NULL;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+			mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			_mapped = (uint8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (_mapped) {
+				_mappedSize = (size_t)size.QuadPart;
+				_mappedFile = file;
+				_mappedMapping = mapping;
+			} else {
+				CloseHandle(mapping);
+			}
+		}
+		if (!_mapped) CloseHandle(file);
+	}
+#else
+	char cbuf[MAX_PATH];
+	char curpath[MAX_PATH];
+	GETCWD(MAX_PATH, curpath);
+	wcstombs(cbuf, path, MAX_PATH);
+	CHDIR(cbuf);
+
+	wcstombs(cbuf, filename, MAX_PATH);
+
+	int fd = open(cbuf, O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (addr != MAP_FAILED) {
+				_mapped = (uint8*)addr;
+				_mappedSize = (size_t)st.st_size;
+			}
+		}
+		/* the mapping keeps its own reference to the file */
+		close(fd);
+	}
+#endif
+
+	DBG_INFO(80, wst("mapped:%x size:%d file:%ls\n"), _mapped, _mappedSize, filename);
+
+	if (_mapped) {
+		/* check the header and that the table fits in the file. payloads
+		 * are checked when they are looked up. */
+		const TxCacheIndexHeader *header = (const TxCacheIndexHeader*)_mapped;
+		if (_mappedSize < sizeof(TxCacheIndexHeader) ||
+			memcmp(header->magic, TXCACHEINDEX_MAGIC, 8) ||
+			header->version != TXCACHEINDEX_VERSION ||
+			header->config != config ||
+			header->count > (_mappedSize - sizeof(TxCacheIndexHeader)) / sizeof(TxCacheIndexEntry)) {
+			DBG_INFO(80, wst("Error: %ls is not a matching texture cache index!\n"), filename);
+			unmap();
+		} else {
+			_mappedTable = (const TxCacheIndexEntry*)(_mapped + sizeof(TxCacheIndexHeader));
+			_mappedCount = header->count;
+
+			if (_callback)
+				(*_callback)(wst("[%d] textures mapped - %ls\n"), _mappedCount, filename);
+		}
+	}
+
+	CHDIR(curpath);
+
+	return _mappedCount != 0;
+}
+
+void
+TxCache::unmap()
+{
+	if (_mapped) {
+#ifdef WIN32
+		UnmapViewOfFile(_mapped);
+		CloseHandle((HANDLE)_mappedMapping);
+		CloseHandle((HANDLE)_mappedFile);
+		_mappedMapping = NULL;
+		_mappedFile = NULL;
+#else
+		munmap(_mapped, _mappedSize);
+#endif
+	}
+
+	_mapped = NULL;
+	_mappedSize = 0;
+	_mappedTable = NULL;
+	_mappedCount = 0;
+}
+
+static bool
+TxCacheIndexLess(const TxCacheIndexEntry &entry, uint64 checksum)
+{
+	return entry.checksum < checksum;
+}
+
+const TxCacheIndexEntry *
+TxCache::find_mapped(uint64 checksum)
+{
+	if (!_mappedCount) return NULL;
+
+	const TxCacheIndexEntry *entry = std::lower_bound(_mappedTable, _mappedTable + _mappedCount, checksum, TxCacheIndexLess);
+	if (entry == _mappedTable + _mappedCount || entry->checksum != checksum)
+		return NULL;
+
+	if (entry->offset > _mappedSize || entry->size > _mappedSize - entry->offset) {
+		DBG_INFO(80, wst("Error: texture cache index entry out of range!\n"));
+		return NULL;
+	}
+
+	return entry;
+}
+
 boolean
 TxCache::del(uint64 checksum)
 {
@@ -405,6 +578,8 @@ TxCache::is_cached(uint64 checksum)
 	std::map<uint64, TXCACHE*>::iterator itMap = _cache.find(checksum);
 	if (itMap != _cache.end()) return 1;
 
+	if (find_mapped(checksum)) return 1;
+
 	return 0;
 }
 
@@ -26,6 +26,7 @@
 
 #include "TxInternal.h"
 #include "TxUtil.h"
+#include "TxCacheIndex.h"
 #include <list>
 #include <map>
 
@@ -36,6 +37,16 @@ private:
   uint8 *_gzdest0;
   uint8 *_gzdest1;
   uint32 _gzdestLen;
+  /* memory mapped indexed cache, see TxCacheIndex.h */
+  uint8 *_mapped;
+  size_t _mappedSize;
+  const TxCacheIndexEntry *_mappedTable;
+#ifdef WIN32
+  void *_mappedFile;
+  void *_mappedMapping;
+#endif
+  const TxCacheIndexEntry *find_mapped(uint64 checksum);
+  void unmap();
 protected:
   int _options;
   tx_wstring _ident;
@@ -50,8 +61,10 @@ protected:
   int _totalSize;
   int _cacheSize;
   std::map<uint64, TXCACHE*> _cache;
+  uint32 _mappedCount;
   boolean save(const wchar_t *path, const wchar_t *filename, const int config);
   boolean load(const wchar_t *path, const wchar_t *filename, const int config);
+  boolean map(const wchar_t *path, const wchar_t *filename, const int config);
   boolean del(uint64 checksum); /* checksum hi:palette low:texture */
   boolean is_cached(uint64 checksum); /* checksum hi:palette low:texture */
   void clear();
@@ -0,0 +1,66 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __TXCACHEINDEX_H__
+#define __TXCACHEINDEX_H__
+
+#include <stdint.h>
+
+/* Indexed texture cache (.hti), written by tools/htc2hti from a .htc and
+ * memory mapped by TxCache::map.
+ *
+ *   TxCacheIndexHeader
+ *   TxCacheIndexEntry[count]    sorted by checksum
+ *   payloads                    each aligned to TXCACHEINDEX_ALIGN
+ *
+ * A payload is the raw texture, or a zlib stream if GL_TEXFMT_GZ is set in
+ * format, exactly as the entry was stored in the .htc.  All fields are
+ * little endian.
+ *
+ * GLideNHQ is not compiled in this tree: Makefile.common links
+ * TxFilterStub.cpp in its place, so nothing maps an .hti until GLideNHQ is
+ * added to the build.  tools/htc2hti builds on its own.
+ */
+
+#define TXCACHEINDEX_MAGIC   "GHQINDEX"
+#define TXCACHEINDEX_VERSION 1
+#define TXCACHEINDEX_ALIGN   16
+
+struct TxCacheIndexHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t config;      /* same as the .htc header */
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct TxCacheIndexEntry {
+  uint64_t checksum;   /* hi:palette low:texture */
+  uint64_t offset;     /* from the start of the file */
+  uint32_t size;
+  int32_t width;
+  int32_t height;
+  uint32_t format;
+  uint16_t texture_format;
+  uint16_t pixel_type;
+  uint8_t is_hires_tex;
+  uint8_t reserved[3];
+};
+
+#endif /* __TXCACHEINDEX_H__ */
@@ -25,14 +25,13 @@
 #pragma warning(disable: 4786)
 #endif
 
-#include <functional>
-#include <thread>
 #include <stdlib.h>
 
 #include <osal_files.h>
 #include "TxFilter.h"
 #include "TextureFilters.h"
 #include "TxDbg.h"
+#include "TxThreadPool.h"
 #include "bldno.h"
 
 void TxFilter::clear()
@@ -46,6 +45,9 @@ void TxFilter::clear()
 	/* free memory */
 	TxMemBuf::getInstance()->shutdown();
 
+	/* stop the worker threads */
+	TxThreadPool::getInstance()->shutdown();
+
 	/* clear other stuff */
 	delete _txImage;
 	delete _txQuantize;
@@ -94,6 +96,7 @@ TxFilter::TxFilter(int maxwidth, int maxheight, int maxbpp, int options,
 
 	/* get number of CPU cores. */
 	_numcore = _txUtil->getNumberofProcessors();
+	TxThreadPool::getInstance()->init(_numcore);
 
 	_initialized = 0;
 
@@ -291,44 +294,7 @@ TxFilter::filter(uint8 *src, int srcwidth, int srcheight, uint16 srcformat, uint
 
 				tmptex = (texture == _tex1) ? _tex2 : _tex1;
 
-				uint8 *_texture = texture;
-				uint8 *_tmptex  = tmptex;
-
-				unsigned int numcore = _numcore;
-				unsigned int blkrow = 0;
-				while (numcore > 1 && blkrow == 0) {
-					blkrow = (srcheight >> 2) / numcore;
-					numcore--;
-				}
-				if (blkrow > 0 && numcore > 1) {
-					std::thread *thrd[MAX_NUMCORE];
-					unsigned int i;
-					int blkheight = blkrow << 2;
-					unsigned int srcStride = (srcwidth * blkheight) << 2;
-					unsigned int destStride = srcStride * scale * scale;
-					for (i = 0; i < numcore - 1; i++) {
-						thrd[i] = new std::thread(std::bind(filter_8888,
-																(uint32*)_texture,
-																srcwidth,
-																blkheight,
-																(uint32*)_tmptex,
-																filter));
-						_texture += srcStride;
-						_tmptex  += destStride;
-					}
-					thrd[i] = new std::thread(std::bind(filter_8888,
-															(uint32*)_texture,
-															srcwidth,
-															srcheight - blkheight * i,
-															(uint32*)_tmptex,
-															filter));
-					for (i = 0; i < numcore; i++) {
-						thrd[i]->join();
-						delete thrd[i];
-					}
-				} else {
-					filter_8888((uint32*)_texture, srcwidth, srcheight, (uint32*)_tmptex, filter);
-				}
+				filter_8888_threaded((uint32*)texture, srcwidth, srcheight, (uint32*)tmptex, filter, scale, _numcore);
 
 				if (filter & ENHANCEMENT_MASK) {
 					srcwidth  *= scale;
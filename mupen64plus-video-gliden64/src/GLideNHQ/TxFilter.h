@@ -63,6 +63,10 @@ public:
 		   const wchar_t * texPackPath,
 		   const wchar_t *ident,
 		   dispInfoFuncExt callback);
+  /* Filters on the calling thread and the TxThreadPool workers. There is
+   * deliberately no asynchronous variant: Textures.cpp uploads the result
+   * as soon as txfilter_filter returns, and the libretro build links
+   * TxFilterStub instead of this library. */
   boolean filter(uint8 *src,
 				  int srcwidth,
 				  int srcheight,
@@ -99,14 +99,18 @@ TxHiResCache::TxHiResCache(int maxwidth, int maxheight, int maxbpp, int options,
 #if DUMP_CACHE
   /* read in hires texture cache */
   if (_options & DUMP_HIRESTEXCACHE) {
-	/* find it on disk */
+	/* find it on disk. prefer the indexed cache made by tools/htc2hti,
+	 * which is mapped instead of read into memory. */
 	tx_wstring filename = _ident + wst("_HIRESTEXTURES.") + TEXCACHE_EXT;
+	tx_wstring indexname = _ident + wst("_HIRESTEXTURES.") + TEXCACHE_INDEX_EXT;
 	tx_wstring cachepath(_path);
 	cachepath += OSAL_DIR_SEPARATOR_STR;
 	cachepath += wst("cache");
 	int config = _options & (HIRESTEXTURES_MASK|TILE_HIRESTEX|FORCE16BPP_HIRESTEX|GZ_HIRESTEXCACHE|LET_TEXARTISTS_FLY);
 
-	_haveCache = TxCache::load(cachepath.c_str(), filename.c_str(), config);
+	_haveCache = TxCache::map(cachepath.c_str(), indexname.c_str(), config);
+	if (!_haveCache)
+	  _haveCache = TxCache::load(cachepath.c_str(), filename.c_str(), config);
   }
 #endif
 
@@ -117,7 +121,7 @@ TxHiResCache::TxHiResCache(int maxwidth, int maxheight, int maxbpp, int options,
 boolean
 TxHiResCache::empty()
 {
-  return _cache.empty();
+  return _cache.empty() && !_mappedCount;
 }
 
 boolean
@@ -278,9 +282,9 @@ TxHiResCache::loadHiResTextures(const wchar_t * dir_path, boolean replace)
 	pfname = strstr(fname, ident.c_str());
 	if (pfname != fname) pfname = 0;
 	if (pfname) {
-      if (sscanf(pfname + ident.size(), "#%08lX#%01lX#%01lX#%08lX", &chksum, &fmt, &siz, &palchksum) == 4)
+      if (sscanf(pfname + ident.size(), "#%08X#%01X#%01X#%08X", &chksum, &fmt, &siz, &palchksum) == 4)
 		pfname += (ident.size() + CRCFMTSIZ_LEN + PALCRC_LEN);
-      else if (sscanf(pfname + ident.size(), "#%08lX#%01lX#%01lX", &chksum, &fmt, &siz) == 3)
+      else if (sscanf(pfname + ident.size(), "#%08X#%01X#%01X", &chksum, &fmt, &siz) == 3)
 		pfname += (ident.size() + CRCFMTSIZ_LEN);
 	  else
 		pfname = 0;
@@ -27,10 +27,8 @@
 
 /* NOTE: The codes are not optimized. They can be made faster. */
 
-#include <functional>
-#include <thread>
-
 #include "TxQuantize.h"
+#include "TxThreadPool.h"
 
 TxQuantize::TxQuantize()
 {
@@ -889,31 +887,16 @@ TxQuantize::quantize(uint8* src, uint8* dest, int width, int height, uint16 srcf
 			numcore--;
 		}
 		if (blkrow > 0 && numcore > 1) {
-			std::thread *thrd[MAX_NUMCORE];
-			unsigned int i;
-			int blkheight = blkrow << 2;
-			unsigned int srcStride = (width * blkheight) << (2 - bpp_shift);
-			unsigned int destStride = srcStride << bpp_shift;
-			for (i = 0; i < numcore - 1; i++) {
-				thrd[i] = new std::thread(std::bind(quantizer,
-														this,
-														(uint32*)src,
-														(uint32*)dest,
-														width,
-														blkheight));
-				src  += srcStride;
-				dest += destStride;
-			}
-			thrd[i] = new std::thread(std::bind(quantizer,
-													this,
-													(uint32*)src,
-													(uint32*)dest,
-													width,
-													height - blkheight * i));
-			for (i = 0; i < numcore; i++) {
-				thrd[i]->join();
-				delete thrd[i];
-			}
+			const int blkheight = blkrow << 2;
+			const unsigned int srcStride = (width * blkheight) << (2 - bpp_shift);
+			const unsigned int destStride = srcStride << bpp_shift;
+			const unsigned int last = numcore - 1;
+			TxThreadPool::getInstance()->run(numcore, [=](unsigned int i) {
+				(*this.*quantizer)((uint32*)(src + srcStride * i),
+								   (uint32*)(dest + destStride * i),
+								   width,
+								   (i < last) ? blkheight : height - blkheight * last);
+			});
 		} else {
 			(*this.*quantizer)((uint32*)src, (uint32*)dest, width, height);
 		}
@@ -943,31 +926,16 @@ TxQuantize::quantize(uint8* src, uint8* dest, int width, int height, uint16 srcf
 			numcore--;
 		}
 		if (blkrow > 0 && numcore > 1) {
-			std::thread *thrd[MAX_NUMCORE];
-			unsigned int i;
-			int blkheight = blkrow << 2;
-			unsigned int srcStride = (width * blkheight) << 2;
-			unsigned int destStride = srcStride >> bpp_shift;
-			for (i = 0; i < numcore - 1; i++) {
-				thrd[i] = new std::thread(std::bind(quantizer,
-														this,
-														(uint32*)src,
-														(uint32*)dest,
-														width,
-														blkheight));
-				src  += srcStride;
-				dest += destStride;
-			}
-			thrd[i] = new std::thread(std::bind(quantizer,
-													this,
-													(uint32*)src,
-													(uint32*)dest,
-													width,
-													height - blkheight * i));
-			for (i = 0; i < numcore; i++) {
-				thrd[i]->join();
-				delete thrd[i];
-			}
+			const int blkheight = blkrow << 2;
+			const unsigned int srcStride = (width * blkheight) << 2;
+			const unsigned int destStride = srcStride >> bpp_shift;
+			const unsigned int last = numcore - 1;
+			TxThreadPool::getInstance()->run(numcore, [=](unsigned int i) {
+				(*this.*quantizer)((uint32*)(src + srcStride * i),
+								   (uint32*)(dest + destStride * i),
+								   width,
+								   (i < last) ? blkheight : height - blkheight * last);
+			});
 		} else {
 			(*this.*quantizer)((uint32*)src, (uint32*)dest, width, height);
 		}
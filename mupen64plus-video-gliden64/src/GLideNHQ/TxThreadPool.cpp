@@ -0,0 +1,119 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "TxThreadPool.h"
+
+TxThreadPool::TxThreadPool() :
+	_job(NULL), _count(0), _next(0), _pending(0), _quit(false)
+{
+}
+
+TxThreadPool::~TxThreadPool()
+{
+	shutdown();
+}
+
+void
+TxThreadPool::init(unsigned int numthreads)
+{
+	std::lock_guard<std::mutex> serial(_runMutex);
+
+	if (numthreads < 1) numthreads = 1;
+	if (_threads.size() == numthreads - 1)
+		return;
+
+	/* restart with the new number of workers */
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+	for (size_t i = 0; i < _threads.size(); i++)
+		_threads[i].join();
+	_threads.clear();
+
+	_quit = false;
+	for (unsigned int i = 0; i < numthreads - 1; i++)
+		_threads.push_back(std::thread(&TxThreadPool::worker, this));
+}
+
+void
+TxThreadPool::shutdown()
+{
+	init(1);
+}
+
+unsigned int
+TxThreadPool::size()
+{
+	std::lock_guard<std::mutex> serial(_runMutex);
+	return (unsigned int)_threads.size() + 1;
+}
+
+void
+TxThreadPool::worker()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_quit) {
+		if (_next < _count) {
+			unsigned int i = _next++;
+			lock.unlock();
+			(*_job)(i);
+			lock.lock();
+			if (--_pending == 0)
+				_done.notify_all();
+		} else {
+			_wake.wait(lock);
+		}
+	}
+}
+
+void
+TxThreadPool::run(unsigned int count, const std::function<void(unsigned int)> &job)
+{
+	std::lock_guard<std::mutex> serial(_runMutex);
+
+	if (count <= 1 || _threads.empty()) {
+		for (unsigned int i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_job = &job;
+	_count = count;
+	_next = 0;
+	_pending = count;
+	_wake.notify_all();
+
+	/* the calling thread takes its share instead of sleeping */
+	while (_next < _count) {
+		unsigned int i = _next++;
+		lock.unlock();
+		job(i);
+		lock.lock();
+		--_pending;
+	}
+	_done.wait(lock, [this] { return _pending == 0; });
+
+	_job = NULL;
+	_count = 0;
+	_next = 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef __TXTHREADPOOL_H__
+#define __TXTHREADPOOL_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Worker threads shared by the texture filters and quantizers, started
+ * once instead of for every texture.  Like the rest of GLideNHQ this is
+ * not compiled by Makefile.common, which links TxFilterStub.cpp; it is
+ * exercised by tools/txbench. */
+class TxThreadPool
+{
+private:
+	std::vector<std::thread> _threads;
+	std::mutex _runMutex;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	const std::function<void(unsigned int)> *_job;
+	unsigned int _count;
+	unsigned int _next;
+	unsigned int _pending;
+	bool _quit;
+	TxThreadPool();
+	void worker();
+public:
+	static TxThreadPool* getInstance() {
+		static TxThreadPool txThreadPool;
+		return &txThreadPool;
+	}
+	~TxThreadPool();
+	/* numthreads counts the calling thread */
+	void init(unsigned int numthreads);
+	void shutdown();
+	unsigned int size();
+	/* calls job(0) ... job(count - 1) on the workers and the calling thread,
+	 * and returns once all of them are done */
+	void run(unsigned int count, const std::function<void(unsigned int)> &job);
+};
+
+#endif /* __TXTHREADPOOL_H__ */
@@ -31,6 +31,7 @@
 
 /* extension for cache files */
 #define TEXCACHE_EXT wst("htc")
+#define TEXCACHE_INDEX_EXT wst("hti")
 
 class TxUtil
 {
@@ -0,0 +1,191 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Converts a texture cache dumped by GLideNHQ (<rom>_HIRESTEXTURES.htc) into
+ * the indexed format of TxCacheIndex.h, which TxCache maps instead of
+ * reading it into memory.  Put the result next to the .htc in the cache
+ * folder as <rom>_HIRESTEXTURES.hti.
+ *
+ * c++ -O2 htc2hti.cpp -lz -o htc2hti
+ *
+ * With -u zlib compressed textures are stored inflated, so that they are
+ * used straight from the mapping at the cost of a bigger file.
+ */
+
+#include "../TxCacheIndex.h"
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+/* TxInternal.h */
+#define GL_TEXFMT_GZ 0x80000000
+
+static bool
+readEntry(gzFile gzfp, TxCacheIndexEntry *entry)
+{
+  memset(entry, 0, sizeof(*entry));
+
+  return gzread(gzfp, &entry->checksum, 8) == 8 &&
+	gzread(gzfp, &entry->width, 4) == 4 &&
+	gzread(gzfp, &entry->height, 4) == 4 &&
+	gzread(gzfp, &entry->format, 4) == 4 &&
+	gzread(gzfp, &entry->texture_format, 2) == 2 &&
+	gzread(gzfp, &entry->pixel_type, 2) == 2 &&
+	gzread(gzfp, &entry->is_hires_tex, 1) == 1 &&
+	gzread(gzfp, &entry->size, 4) == 4;
+}
+
+static bool
+entryLess(const TxCacheIndexEntry &a, const TxCacheIndexEntry &b)
+{
+  return a.checksum < b.checksum;
+}
+
+static bool
+entryEqual(const TxCacheIndexEntry &a, const TxCacheIndexEntry &b)
+{
+  return a.checksum == b.checksum;
+}
+
+int
+main(int argc, char **argv)
+{
+  bool inflate = false;
+  int arg = 1;
+
+  if (arg < argc && !strcmp(argv[arg], "-u")) {
+	inflate = true;
+	arg++;
+  }
+
+  if (argc - arg != 2) {
+	fprintf(stderr, "usage: %s [-u] <in.htc> <out.hti>\n", argv[0]);
+	return 1;
+  }
+
+  gzFile gzfp = gzopen(argv[arg], "rb");
+  if (!gzfp) {
+	fprintf(stderr, "cannot open %s\n", argv[arg]);
+	return 1;
+  }
+
+  TxCacheIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TXCACHEINDEX_MAGIC, 8);
+  header.version = TXCACHEINDEX_VERSION;
+
+  if (gzread(gzfp, &header.config, 4) != 4) {
+	fprintf(stderr, "%s is not a texture cache\n", argv[arg]);
+	return 1;
+  }
+
+  /* count the entries first so that the payloads can be written straight
+   * behind the table. */
+  std::vector<TxCacheIndexEntry> table;
+  TxCacheIndexEntry entry;
+  while (readEntry(gzfp, &entry)) {
+	if (gzseek(gzfp, entry.size, SEEK_CUR) < 0)
+	  break;
+	table.push_back(entry);
+  }
+
+  FILE *fp = fopen(argv[arg + 1], "wb");
+  if (!fp) {
+	fprintf(stderr, "cannot create %s\n", argv[arg + 1]);
+	return 1;
+  }
+
+  /* the header and table are filled in at the end */
+  uint64_t offset = sizeof(header) + table.size() * sizeof(TxCacheIndexEntry);
+  std::vector<uint8_t> data((size_t)offset), inflated;
+  size_t i, count = table.size();
+  uint64_t inSize = 0;
+
+  if (fwrite(data.data(), 1, data.size(), fp) != data.size()) {
+	fprintf(stderr, "write error on %s\n", argv[arg + 1]);
+	return 1;
+  }
+
+  gzrewind(gzfp);
+  gzseek(gzfp, 4, SEEK_CUR);
+
+  for (i = 0; i < count; i++) {
+	if (!readEntry(gzfp, &entry)) break;
+
+	data.resize(entry.size);
+	if (gzread(gzfp, data.data(), entry.size) != (int)entry.size) break;
+	inSize += entry.size;
+
+	const uint8_t *payload = data.data();
+	if (inflate && (entry.format & GL_TEXFMT_GZ)) {
+	  /* no format stores more than 4 bytes per texel */
+	  uLongf destLen = (uLongf)entry.width * entry.height * 4;
+	  inflated.resize(destLen);
+	  if (uncompress(inflated.data(), &destLen, data.data(), entry.size) == Z_OK) {
+		payload = inflated.data();
+		entry.size = (uint32_t)destLen;
+		entry.format &= ~GL_TEXFMT_GZ;
+	  } else {
+		fprintf(stderr, "%08X %08X: zlib decompression failed, stored as is\n",
+				(uint32_t)(entry.checksum >> 32), (uint32_t)entry.checksum);
+	  }
+	}
+
+	static const uint8_t padding[TXCACHEINDEX_ALIGN] = { 0 };
+	size_t pad = (size_t)(-offset & (TXCACHEINDEX_ALIGN - 1));
+	offset += pad;
+	entry.offset = offset;
+	table[i] = entry;
+
+	if (fwrite(padding, 1, pad, fp) != pad ||
+		fwrite(payload, 1, entry.size, fp) != entry.size) {
+	  fprintf(stderr, "write error on %s\n", argv[arg + 1]);
+	  return 1;
+	}
+	offset += entry.size;
+  }
+  gzclose(gzfp);
+
+  if (i != count) {
+	fprintf(stderr, "%s is truncated after %u textures\n", argv[arg], (unsigned)i);
+	table.resize(i);
+  }
+
+  /* TxCache::load keeps the first of several textures with one checksum */
+  std::stable_sort(table.begin(), table.end(), entryLess);
+  table.erase(std::unique(table.begin(), table.end(), entryEqual), table.end());
+  header.count = (uint32_t)table.size();
+
+  fseek(fp, 0, SEEK_SET);
+  if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+	  (!table.empty() && fwrite(table.data(), sizeof(TxCacheIndexEntry), table.size(), fp) != table.size()) ||
+	  fclose(fp)) {
+	fprintf(stderr, "write error on %s\n", argv[arg + 1]);
+	return 1;
+  }
+
+  printf("%u textures, %.02fmb of texture data -> %.02fmb\n",
+		 header.count, (double)inSize / 1000000, (double)offset / 1000000);
+
+  return 0;
+}
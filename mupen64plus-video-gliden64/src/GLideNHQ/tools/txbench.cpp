@@ -0,0 +1,239 @@
+/*
+ * Texture Filtering
+ * Version:  1.0
+ *
+ * this is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * this is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Make; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Runs every texture enhancement and filter over a set of textures and
+ * reports how many megapixels of source texture each one handles per
+ * second, on the calling thread alone and on the TxThreadPool.  The digest
+ * of the single threaded results must not change between builds, e.g. with
+ * and without -U__SSE2__.
+ *
+ * c++ -std=c++11 -O2 -DOS_LINUX -DNDEBUG -I.. txbench.cpp ../TextureFilters.cpp \
+ *    ../TextureFilters_2xsai.cpp ../TextureFilters_hq2x.cpp ../TextureFilters_hq4x.cpp \
+ *    ../TextureFilters_xbrz.cpp ../TxThreadPool.cpp -lpng -lpthread -o txbench
+ *
+ * txbench [-j threads] [-t seconds] [texture.png ...]
+ *
+ * Without textures a fixed set of generated ones is used.  Dumps written
+ * with DUMP_TEX make a good corpus.
+ */
+
+#include "../TextureFilters.h"
+#include "../TxThreadPool.h"
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+struct Texture {
+  int width;
+  int height;
+  std::vector<uint32> data;
+};
+
+static const struct {
+  const char *name;
+  uint32 filter;
+  uint32 scale;
+} filters[] = {
+  { "2x",      X2_ENHANCEMENT,    2 },
+  { "2xSaI",   X2SAI_ENHANCEMENT, 2 },
+  { "hq2x",    HQ2X_ENHANCEMENT,  2 },
+  { "hq2xS",   HQ2XS_ENHANCEMENT, 2 },
+  { "lq2x",    LQ2X_ENHANCEMENT,  2 },
+  { "lq2xS",   LQ2XS_ENHANCEMENT, 2 },
+  { "hq4x",    HQ4X_ENHANCEMENT,  4 },
+  { "xBRZ2x",  BRZ2X_ENHANCEMENT, 2 },
+  { "xBRZ3x",  BRZ3X_ENHANCEMENT, 3 },
+  { "xBRZ4x",  BRZ4X_ENHANCEMENT, 4 },
+  { "xBRZ5x",  BRZ5X_ENHANCEMENT, 5 },
+  { "xBRZ6x",  BRZ6X_ENHANCEMENT, 6 },
+  { "smooth1", SMOOTH_FILTER_1,   1 },
+  { "smooth2", SMOOTH_FILTER_2,   1 },
+  { "smooth3", SMOOTH_FILTER_3,   1 },
+  { "smooth4", SMOOTH_FILTER_4,   1 },
+  { "sharp1",  SHARP_FILTER_1,    1 },
+  { "sharp2",  SHARP_FILTER_2,    1 },
+};
+#define NUM_FILTERS (sizeof(filters) / sizeof(filters[0]))
+
+static double now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool loadPNG(const char *filename, Texture *tex)
+{
+  png_image image;
+
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&image, filename))
+	return false;
+
+  /* RGBA bytes are the ABGR texels the filters work on */
+  image.format = PNG_FORMAT_RGBA;
+  tex->width = image.width;
+  tex->height = image.height;
+  tex->data.resize(image.width * image.height);
+  if (!png_image_finish_read(&image, NULL, &tex->data[0], 0, NULL)) {
+	png_image_free(&image);
+	return false;
+  }
+  return true;
+}
+
+static uint32 rng_state = 0x9E3779B9;
+
+static uint32 rng()
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* Flat areas, gradients, hard diagonal edges and some noise, which is
+ * roughly what N64 textures are made of. */
+static void generate(int width, int height, Texture *tex)
+{
+  const uint32 palette[4] = { rng() | 0xFF000000, rng() | 0xFF000000, rng() & 0x7FFFFFFF, rng() };
+  int x, y;
+
+  tex->width = width;
+  tex->height = height;
+  tex->data.resize(width * height);
+  for (y = 0; y < height; y++) {
+	for (x = 0; x < width; x++) {
+	  uint32 c;
+	  switch (((x / 16) + (y / 16)) & 3) {
+	  case 0:
+		c = palette[((x + y) / 8) & 1];
+		break;
+	  case 1:
+		c = 0xFF000000 | ((x * 255 / width) << 16) | ((y * 255 / height) << 8) | 0x40;
+		break;
+	  case 2:
+		c = palette[(x > y) ? 2 : 3];
+		break;
+	  default:
+		c = palette[rng() & 3] ^ (rng() & 0x00070707);
+	  }
+	  tex->data[y * width + x] = c;
+	}
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Texture> corpus;
+  unsigned int numthreads = std::thread::hardware_concurrency();
+  double seconds = 0.5;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+	if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+	  numthreads = atoi(argv[++i]);
+	} else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+	  seconds = atof(argv[++i]);
+	} else {
+	  Texture tex;
+	  if (!loadPNG(argv[i], &tex)) {
+		fprintf(stderr, "cannot read %s\n", argv[i]);
+		return 1;
+	  }
+	  corpus.push_back(tex);
+	}
+  }
+  if (numthreads < 1) numthreads = 1;
+
+  if (corpus.empty()) {
+	static const int sizes[][2] = {
+	  { 16, 16 }, { 32, 32 }, { 64, 32 }, { 64, 64 }, { 128, 64 }, { 32, 128 },
+	  { 128, 128 }, { 256, 128 }, { 256, 256 }, { 320, 240 }
+	};
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+	  Texture tex;
+	  generate(sizes[i][0], sizes[i][1], &tex);
+	  corpus.push_back(tex);
+	}
+  }
+
+  size_t maxpixels = 0, pixels = 0;
+  for (size_t t = 0; t < corpus.size(); t++) {
+	size_t n = corpus[t].data.size();
+	pixels += n;
+	if (n > maxpixels) maxpixels = n;
+  }
+  std::vector<uint32> dest(maxpixels * 36);
+
+  xbrz::init();
+
+  printf("%u textures, %.2f megapixels, %u threads\n",
+		 (unsigned)corpus.size(), pixels / 1e6, numthreads);
+
+  for (size_t f = 0; f < NUM_FILTERS; f++) {
+	const uint32 filter = filters[f].filter;
+	const uint32 scale = filters[f].scale;
+	uint64 hash = 0xCBF29CE484222325ULL;
+	double rate[2];
+	int pass;
+
+	for (pass = 0; pass < 2; pass++) {
+	  const unsigned int threads = pass ? numthreads : 1;
+	  double start, elapsed;
+	  size_t done = 0;
+	  int rounds = 0;
+
+	  TxThreadPool::getInstance()->init(threads);
+	  start = now();
+	  do {
+		for (size_t t = 0; t < corpus.size(); t++) {
+		  Texture &tex = corpus[t];
+		  if (pass == 0 && rounds == 0)
+			std::fill(dest.begin(), dest.end(), 0);
+		  filter_8888_threaded(&tex.data[0], tex.width, tex.height, &dest[0], filter, scale, threads);
+		  done += tex.data.size();
+
+		  if (pass == 0 && rounds == 0) {
+			const size_t n = tex.data.size() * scale * scale;
+			for (size_t p = 0; p < n; p++)
+			  hash = (hash ^ dest[p]) * 0x100000001B3ULL;
+		  }
+		}
+		rounds++;
+		elapsed = now() - start;
+	  } while (elapsed < seconds);
+	  rate[pass] = done / elapsed / 1e6;
+	}
+
+	printf("%-8s %016llX  %8.2f MP/s  %8.2f MP/s\n", filters[f].name,
+		   (unsigned long long)hash, rate[0], rate[1]);
+  }
+
+  TxThreadPool::getInstance()->shutdown();
+
+  return 0;
+}
@@ -16,6 +16,7 @@
 #include "FrameBuffer.h"
 #include "Config.h"
 #include "GLideNHQ/Ext_TxFilter.h"
+#include "main/profile.h"
 
 using namespace std;
 
@@ -507,10 +508,7 @@ void TextureCache::destroy()
 {
 	current[0] = current[1] = NULL;
 
-	for (Textures::const_iterator cur = m_textures.cbegin(); cur != m_textures.cend(); ++cur)
-		glDeleteTextures( 1, &cur->glName );
-	m_textures.clear();
-	m_lruTextureLocations.clear();
+	_clear();
 
 	for (FBTextures::const_iterator cur = m_fbTextures.cbegin(); cur != m_fbTextures.cend(); ++cur)
 		glDeleteTextures( 1, &cur->second.glName );
@@ -519,34 +517,139 @@ void TextureCache::destroy()
 	m_cachedBytes = 0;
 }
 
-void TextureCache::_checkCacheSize()
+void TextureCache::_countStats(uint32_t _hits, uint32_t _misses, uint32_t _evictions, uint32_t _collisions)
+{
+	m_hits += _hits;
+	m_misses += _misses;
+	m_evictions += _evictions;
+	m_collisions += _collisions;
+	timed_sections_count_texture_cache(_hits, _misses, _evictions, _collisions, m_cachedBytes);
+}
+
+void TextureCache::_unlink(CachedTexture * _pTexture)
+{
+	if (_pTexture->lruPrev != NULL)
+		_pTexture->lruPrev->lruNext = _pTexture->lruNext;
+	else
+		m_lruHead = _pTexture->lruNext;
+	if (_pTexture->lruNext != NULL)
+		_pTexture->lruNext->lruPrev = _pTexture->lruPrev;
+	else
+		m_lruTail = _pTexture->lruPrev;
+	_pTexture->lruPrev = _pTexture->lruNext = NULL;
+}
+
+void TextureCache::_touch(CachedTexture * _pTexture)
 {
-	if (m_cachedBytes <= m_maxBytes)
+	if (m_lruHead == _pTexture)
 		return;
+	if (_pTexture->lruPrev != NULL || _pTexture->lruNext != NULL || m_lruTail == _pTexture)
+		_unlink(_pTexture);
+	_pTexture->lruNext = m_lruHead;
+	if (m_lruHead != NULL)
+		m_lruHead->lruPrev = _pTexture;
+	else
+		m_lruTail = _pTexture;
+	m_lruHead = _pTexture;
+}
 
-	Textures::iterator iter = m_textures.end();
-	do {
-		--iter;
-		CachedTexture& tex = *iter;
-		m_cachedBytes -= tex.textureBytes;
-		glDeleteTextures(1, &tex.glName);
-		m_lruTextureLocations.erase(tex.crc);
-	} while (m_cachedBytes > m_maxBytes && iter != m_textures.cbegin());
-	m_textures.erase(iter, m_textures.end());
+CachedTexture * TextureCache::_findTexture(uint64_t _crc)
+{
+	if (m_table.empty())
+		return NULL;
+	const size_t mask = m_table.size() - 1;
+	for (size_t i = (size_t)_crc & mask; m_table[i] != NULL; i = (i + 1) & mask) {
+		if (m_table[i]->crc == _crc)
+			return m_table[i];
+	}
+	return NULL;
 }
 
-CachedTexture * TextureCache::_addTexture(uint32_t _crc32)
+void TextureCache::_growTable()
+{
+	std::vector<CachedTexture*> table(m_table.empty() ? 256 : m_table.size() * 2, (CachedTexture*)NULL);
+	const size_t mask = table.size() - 1;
+	for (size_t j = 0; j < m_table.size(); ++j) {
+		if (m_table[j] == NULL)
+			continue;
+		size_t i = (size_t)m_table[j]->crc & mask;
+		while (table[i] != NULL)
+			i = (i + 1) & mask;
+		table[i] = m_table[j];
+	}
+	m_table.swap(table);
+}
+
+void TextureCache::_removeTexture(CachedTexture * _pTexture)
+{
+	const size_t mask = m_table.size() - 1;
+	size_t i = (size_t)_pTexture->crc & mask;
+	while (m_table[i] != _pTexture)
+		i = (i + 1) & mask;
+
+	// Backward shift deletion: move up every following entry of the run
+	// which would no longer be reachable from its home slot.
+	for (size_t j = i;;) {
+		m_table[i] = NULL;
+		for (;;) {
+			j = (j + 1) & mask;
+			if (m_table[j] == NULL) {
+				_unlink(_pTexture);
+				if (current[0] == _pTexture)
+					current[0] = NULL;
+				if (current[1] == _pTexture)
+					current[1] = NULL;
+				m_cachedBytes -= _pTexture->textureBytes;
+				glDeleteTextures(1, &_pTexture->glName);
+				delete _pTexture;
+				--m_numTextures;
+				return;
+			}
+			const size_t home = (size_t)m_table[j]->crc & mask;
+			if (((j - home) & mask) >= ((j - i) & mask))
+				break;
+		}
+		m_table[i] = m_table[j];
+		i = j;
+	}
+}
+
+void TextureCache::_checkCacheSize()
+{
+	uint32_t evictions = 0;
+	CachedTexture * pTexture = m_lruTail;
+	while (m_cachedBytes > m_maxBytes && pTexture != NULL) {
+		CachedTexture * pPrev = pTexture->lruPrev;
+		if (pTexture != current[0] && pTexture != current[1]) {
+			_removeTexture(pTexture);
+			++evictions;
+		}
+		pTexture = pPrev;
+	}
+	if (evictions != 0)
+		_countStats(0, 0, evictions, 0);
+}
+
+CachedTexture * TextureCache::_addTexture(uint64_t _crc)
 {
 	if (m_curUnpackAlignment == 0)
 		glGetIntegerv(GL_UNPACK_ALIGNMENT, &m_curUnpackAlignment);
 	_checkCacheSize();
+	if ((m_numTextures + 1) * 2 > m_table.size())
+		_growTable();
 	GLuint glName;
 	glGenTextures(1, &glName);
-	m_textures.emplace_front(glName);
-	Textures::iterator new_iter = m_textures.begin();
-	new_iter->crc = _crc32;
-	m_lruTextureLocations.insert(std::pair<uint32_t, Textures::iterator>(_crc32, new_iter));
-	return &(*new_iter);
+	CachedTexture * pTexture = new CachedTexture(glName);
+	pTexture->crc = _crc;
+	pTexture->textureBytes = 0;
+	const size_t mask = m_table.size() - 1;
+	size_t i = (size_t)_crc & mask;
+	while (m_table[i] != NULL)
+		i = (i + 1) & mask;
+	m_table[i] = pTexture;
+	++m_numTextures;
+	_touch(pTexture);
+	return pTexture;
 }
 
 void TextureCache::removeFrameBufferTexture(CachedTexture * _pTexture)
@@ -1137,28 +1240,28 @@ struct TextureParams
 };
 
 static
-uint32_t _calculateCRC(uint32_t t, const TextureParams & _params)
+uint64_t _calculateCRC(uint32_t t, const TextureParams & _params)
 {
 	const uint32_t line = gSP.textureTile[t]->line;
 	const uint32_t lineBytes = line << 3;
 
 	const uint64_t *src = (uint64_t*)&TMEM[gSP.textureTile[t]->tmem];
-	uint32_t crc = 0xFFFFFFFF;
-	crc = CRC_Calculate(crc, src, _params.height*lineBytes);
+	uint64_t crc = 0xFFFFFFFF;
+	crc = Hash_Calculate(crc, src, _params.height*lineBytes);
 
 	if (gSP.textureTile[t]->size == G_IM_SIZ_32b) {
 		src = (uint64_t*)&TMEM[gSP.textureTile[t]->tmem + 256];
-		crc = CRC_Calculate(crc, src, _params.height*lineBytes);
+		crc = Hash_Calculate(crc, src, _params.height*lineBytes);
 	}
 
 	if (gDP.otherMode.textureLUT != G_TT_NONE || gSP.textureTile[t]->format == G_IM_FMT_CI) {
 		if (gSP.textureTile[t]->size == G_IM_SIZ_4b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC16[gSP.textureTile[t]->palette], 4 );
+			crc = Hash_Calculate( crc, &gDP.paletteCRC16[gSP.textureTile[t]->palette], 4 );
 		else if (gSP.textureTile[t]->size == G_IM_SIZ_8b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC256, 4 );
+			crc = Hash_Calculate( crc, &gDP.paletteCRC256, 4 );
 	}
 
-	crc = CRC_Calculate(crc, &_params, sizeof(_params));
+	crc = Hash_Calculate(crc, &_params, sizeof(_params));
 
 	return crc;
 }
@@ -1257,37 +1360,37 @@ void TextureCache::activateMSDummy(uint32_t _t)
 void TextureCache::_updateBackground()
 {
 	uint32_t numBytes = gSP.bgImage.width * gSP.bgImage.height << gSP.bgImage.size >> 1;
-	uint32_t crc;
+	uint64_t crc;
 
-	crc = CRC_Calculate( 0xFFFFFFFF, &RDRAM[gSP.bgImage.address], numBytes );
+	crc = Hash_Calculate( 0xFFFFFFFF, &RDRAM[gSP.bgImage.address], numBytes );
 
 	if (gDP.otherMode.textureLUT != G_TT_NONE || gSP.bgImage.format == G_IM_FMT_CI) {
 		if (gSP.bgImage.size == G_IM_SIZ_4b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC16[gSP.bgImage.palette], 4 );
+			crc = Hash_Calculate( crc, &gDP.paletteCRC16[gSP.bgImage.palette], 4 );
 		else if (gSP.bgImage.size == G_IM_SIZ_8b)
-			crc = CRC_Calculate( crc, &gDP.paletteCRC256, 4 );
+			crc = Hash_Calculate( crc, &gDP.paletteCRC256, 4 );
 	}
 
 	uint32_t params[4] = {gSP.bgImage.width, gSP.bgImage.height, gSP.bgImage.format, gSP.bgImage.size};
-	crc = CRC_Calculate(crc, params, sizeof(uint32_t)*4);
-
-	Texture_Locations::iterator locations_iter = m_lruTextureLocations.find(crc);
-	if (locations_iter != m_lruTextureLocations.end()) {
-		Textures::iterator iter = locations_iter->second;
-		CachedTexture & current = *iter;
-		m_textures.splice(m_textures.begin(), m_textures, iter);
-
-		assert(current.width == gSP.bgImage.width);
-		assert(current.height == gSP.bgImage.height);
-		assert(current.format == gSP.bgImage.format);
-		assert(current.size == gSP.bgImage.size);
-
-		activateTexture(0, &current);
-		m_hits++;
-		return;
+	crc = Hash_Calculate(crc, params, sizeof(uint32_t)*4);
+
+	CachedTexture * pFound = _findTexture(crc);
+	if (pFound != NULL) {
+		if (pFound->width == gSP.bgImage.width &&
+			pFound->height == gSP.bgImage.height &&
+			pFound->format == gSP.bgImage.format &&
+			pFound->size == gSP.bgImage.size) {
+			_touch(pFound);
+			activateTexture(0, pFound);
+			_countStats(1, 0, 0, 0);
+			return;
+		}
+		// Same hash, different texture: drop the cached one and load this one
+		_removeTexture(pFound);
+		_countStats(0, 0, 0, 1);
 	}
 
-	m_misses++;
+	_countStats(0, 1, 0, 0);
 
 	glActiveTexture( GL_TEXTURE0 );
 	CachedTexture * pCurrent = _addTexture(crc);
@@ -1339,12 +1442,9 @@ void TextureCache::_clear()
 {
 	current[0] = current[1] = NULL;
 
-	for (Textures::const_iterator cur = m_textures.cbegin(); cur != m_textures.cend(); ++cur) {
-		m_cachedBytes -= cur->textureBytes;
-		glDeleteTextures(1, &cur->glName);
-	}
-	m_textures.clear();
-	m_lruTextureLocations.clear();
+	while (m_lruHead != NULL)
+		_removeTexture(m_lruHead);
+	m_table.clear();
 }
 
 void TextureCache::update(uint32_t _t)
@@ -1407,7 +1507,7 @@ void TextureCache::update(uint32_t _t)
 	TileSizes sizes;
 	_calcTileSizes(_t, sizes, gDP.loadTile);
 
-	uint32_t crc;
+	uint64_t crc;
 	{
 	TextureParams params;
 	params.width = sizes.width;
@@ -1431,31 +1531,31 @@ void TextureCache::update(uint32_t _t)
 		return;
 	}
 
-	Texture_Locations::iterator locations_iter = m_lruTextureLocations.find(crc);
-	if (locations_iter != m_lruTextureLocations.end()) {
-		Textures::iterator iter = locations_iter->second;
-		CachedTexture & current = *iter;
-		m_textures.splice(m_textures.begin(), m_textures, iter);
-
-		assert(current.width == sizes.width);
-		assert(current.height == sizes.height);
-		assert(current.clampWidth == sizes.clampWidth);
-		assert(current.clampHeight == sizes.clampHeight);
-		assert(current.maskS == gSP.textureTile[_t]->masks);
-		assert(current.maskT == gSP.textureTile[_t]->maskt);
-		assert(current.mirrorS == gSP.textureTile[_t]->mirrors);
-		assert(current.mirrorT == gSP.textureTile[_t]->mirrort);
-		assert(current.clampS == gSP.textureTile[_t]->clamps);
-		assert(current.clampT == gSP.textureTile[_t]->clampt);
-		assert(current.format == gSP.textureTile[_t]->format);
-		assert(current.size == gSP.textureTile[_t]->size);
-
-		activateTexture(_t, &current);
-		m_hits++;
-		return;
+	CachedTexture * pFound = _findTexture(crc);
+	if (pFound != NULL) {
+		if (pFound->width == sizes.width &&
+			pFound->height == sizes.height &&
+			pFound->clampWidth == sizes.clampWidth &&
+			pFound->clampHeight == sizes.clampHeight &&
+			pFound->maskS == gSP.textureTile[_t]->masks &&
+			pFound->maskT == gSP.textureTile[_t]->maskt &&
+			pFound->mirrorS == gSP.textureTile[_t]->mirrors &&
+			pFound->mirrorT == gSP.textureTile[_t]->mirrort &&
+			pFound->clampS == gSP.textureTile[_t]->clamps &&
+			pFound->clampT == gSP.textureTile[_t]->clampt &&
+			pFound->format == gSP.textureTile[_t]->format &&
+			pFound->size == gSP.textureTile[_t]->size) {
+			_touch(pFound);
+			activateTexture(_t, pFound);
+			_countStats(1, 0, 0, 0);
+			return;
+		}
+		// Same hash, different texture: drop the cached one and load this one
+		_removeTexture(pFound);
+		_countStats(0, 0, 0, 1);
 	}
 
-	m_misses++;
+	_countStats(0, 1, 0, 0);
 
 	glActiveTexture( GL_TEXTURE0 + _t );
 
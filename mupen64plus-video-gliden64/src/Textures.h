@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include <map>
+#include <vector>
 
 #include "CRC.h"
 #include "convert.h"
@@ -15,10 +16,10 @@ typedef uint32_t (*GetTexelFunc)( uint64_t *src, uint16_t x, uint16_t i, uint8_t
 
 struct CachedTexture
 {
-	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone) {}
+	CachedTexture(GLuint _glName) : glName(_glName), max_level(0), frameBufferTexture(fbNone), lruPrev(NULL), lruNext(NULL) {}
 
 	GLuint	glName;
-	uint32_t		crc;
+	uint64_t		crc;
 //	float	fulS, fulT;
 //	WORD	ulS, ulT, lrS, lrT;
 	float	offsetS, offsetT;
@@ -45,6 +46,10 @@ struct CachedTexture
 		fbOneSample = 1,
 		fbMultiSample = 2
 	} frameBufferTexture;
+
+	// Links of the texture cache LRU list, most recently used first
+	CachedTexture * lruPrev;
+	CachedTexture * lruNext;
 };
 
 
@@ -65,7 +70,9 @@ struct TextureCache
 	static TextureCache & get();
 
 private:
-	TextureCache() : m_pDummy(NULL), m_hits(0), m_misses(0), m_maxBytes(0), m_cachedBytes(0), m_curUnpackAlignment(4), m_toggleDumpTex(false)
+	TextureCache() : m_numTextures(0), m_lruHead(NULL), m_lruTail(NULL), m_pDummy(NULL),
+		m_hits(0), m_misses(0), m_evictions(0), m_collisions(0),
+		m_maxBytes(0), m_cachedBytes(0), m_curUnpackAlignment(4), m_toggleDumpTex(false)
 	{
 		current[0] = NULL;
 		current[1] = NULL;
@@ -74,7 +81,13 @@ private:
 	TextureCache(const TextureCache &);
 
 	void _checkCacheSize();
-	CachedTexture * _addTexture(uint32_t _crc32);
+	CachedTexture * _addTexture(uint64_t _crc);
+	CachedTexture * _findTexture(uint64_t _crc);
+	void _removeTexture(CachedTexture * _pTexture);
+	void _growTable();
+	void _touch(CachedTexture * _pTexture);
+	void _unlink(CachedTexture * _pTexture);
+	void _countStats(uint32_t _hits, uint32_t _misses, uint32_t _evictions, uint32_t _collisions);
 	void _load(uint32_t _tile, CachedTexture *_pTexture);
 	bool _loadHiresTexture(uint32_t _tile, CachedTexture *_pTexture, uint64_t & _ricecrc);
 	void _loadBackground(CachedTexture *pTexture);
@@ -84,15 +97,17 @@ private:
 	void _initDummyTexture(CachedTexture * _pDummy);
 	void _getTextureDestData(CachedTexture& tmptex, uint32_t* pDest, GLuint glInternalFormat, GetTexelFunc GetTexel, uint16_t* pLine);
 
-	typedef std::list<CachedTexture> Textures;
-	typedef std::map<uint32_t, Textures::iterator> Texture_Locations;
 	typedef std::map<uint32_t, CachedTexture> FBTextures;
-	Textures m_textures;
-	Texture_Locations m_lruTextureLocations;
+	// Open addressing with linear probing, indexed by the low bits of the texture hash.
+	// The size is a power of two and the table is kept at most half full.
+	std::vector<CachedTexture*> m_table;
+	uint32_t m_numTextures;
+	CachedTexture * m_lruHead;
+	CachedTexture * m_lruTail;
 	FBTextures m_fbTextures;
 	CachedTexture * m_pDummy;
 	CachedTexture * m_pMSDummy;
-	uint32_t m_hits, m_misses;
+	uint32_t m_hits, m_misses, m_evictions, m_collisions;
 	uint32_t m_maxBytes;
 	uint32_t m_cachedBytes;
 	GLint m_curUnpackAlignment;
@@ -26,6 +26,13 @@
 #include "../../Graphics/image_convert.h"
 #include "../../Graphics/3dmath.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#include <arm_neon.h>
+#define GSP_NEON
+#endif
+
 using namespace std;
 
 float identityMatrix[4][4] =
@@ -279,6 +286,26 @@ void gln64gSPClipVertex(uint32_t v)
 	if (vtx.w < 0.01f)  vtx.clip |= CLIP_Z;
 }
 
+static void gln64gSPTextureGenVertex(SPVertex & _vtx)
+{
+	float fLightDir[3] = {_vtx.nx, _vtx.ny, _vtx.nz};
+	float x, y;
+	if (gSP.lookatEnable) {
+		x = DotProduct(&gSP.lookat[0].x, fLightDir);
+		y = DotProduct(&gSP.lookat[1].x, fLightDir);
+	} else {
+		x = fLightDir[0];
+		y = fLightDir[1];
+	}
+	if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
+		_vtx.s = acosf(x) * 325.94931f;
+		_vtx.t = acosf(y) * 325.94931f;
+	} else { // G_TEXTURE_GEN
+		_vtx.s = (x + 1.0f) * 512.0f;
+		_vtx.t = (y + 1.0f) * 512.0f;
+	}
+}
+
 void gln64gSPProcessVertex(uint32_t v)
 {
 	if (gSP.changed & CHANGED_MATRIX)
@@ -313,28 +340,355 @@ void gln64gSPProcessVertex(uint32_t v)
 		else
 			gln64gSPLightVertex(vtx);
 
-		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0) {
-			float fLightDir[3] = {vtx.nx, vtx.ny, vtx.nz};
-			float x, y;
-			if (gSP.lookatEnable) {
-				x = DotProduct(&gSP.lookat[0].x, fLightDir);
-				y = DotProduct(&gSP.lookat[1].x, fLightDir);
-			} else {
-				x = fLightDir[0];
-				y = fLightDir[1];
-			}
-			if (gSP.geometryMode & G_TEXTURE_GEN_LINEAR) {
-				vtx.s = acosf(x) * 325.94931f;
-				vtx.t = acosf(y) * 325.94931f;
-			} else { // G_TEXTURE_GEN
-				vtx.s = (x + 1.0f) * 512.0f;
-				vtx.t = (y + 1.0f) * 512.0f;
-			}
-		}
+		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0)
+			gln64gSPTextureGenVertex(vtx);
 	} else
 		vtx.HWLight = 0;
 }
 
+/* Four lanes of floats and of masks for the batched vertex path below.
+ * Every backend does exactly the operations of the per-vertex functions in
+ * the same order, so both paths give the same results. */
+#if defined(__SSE2__)
+typedef __m128 v4f;
+typedef __m128i v4u;
+
+static INLINE v4f v4Load(const float * _p) { return _mm_loadu_ps(_p); }
+static INLINE void v4Store(float * _p, v4f _a) { _mm_storeu_ps(_p, _a); }
+static INLINE void v4StoreU(uint32_t * _p, v4u _a) { _mm_storeu_si128((__m128i*)_p, _a); }
+static INLINE v4f v4Set(float _f) { return _mm_set1_ps(_f); }
+static INLINE v4f v4Add(v4f _a, v4f _b) { return _mm_add_ps(_a, _b); }
+static INLINE v4f v4Sub(v4f _a, v4f _b) { return _mm_sub_ps(_a, _b); }
+static INLINE v4f v4Mul(v4f _a, v4f _b) { return _mm_mul_ps(_a, _b); }
+static INLINE v4f v4Div(v4f _a, v4f _b) { return _mm_div_ps(_a, _b); }
+static INLINE v4f v4Sqrt(v4f _a) { return _mm_sqrt_ps(_a); }
+static INLINE v4u v4Gt(v4f _a, v4f _b) { return _mm_castps_si128(_mm_cmpgt_ps(_a, _b)); }
+static INLINE v4u v4Lt(v4f _a, v4f _b) { return _mm_castps_si128(_mm_cmplt_ps(_a, _b)); }
+static INLINE v4u v4Ne(v4f _a, v4f _b) { return _mm_castps_si128(_mm_cmpneq_ps(_a, _b)); }
+static INLINE v4u v4Or(v4u _a, v4u _b) { return _mm_or_si128(_a, _b); }
+static INLINE v4u v4Bit(v4u _m, uint32_t _bit) { return _mm_and_si128(_m, _mm_set1_epi32(_bit)); }
+static INLINE v4f v4Select(v4u _m, v4f _a, v4f _b)
+{
+	const __m128 m = _mm_castsi128_ps(_m);
+	return _mm_or_ps(_mm_and_ps(m, _a), _mm_andnot_ps(m, _b));
+}
+#elif defined(GSP_NEON)
+typedef float32x4_t v4f;
+typedef uint32x4_t v4u;
+
+static INLINE v4f v4Load(const float * _p) { return vld1q_f32(_p); }
+static INLINE void v4Store(float * _p, v4f _a) { vst1q_f32(_p, _a); }
+static INLINE void v4StoreU(uint32_t * _p, v4u _a) { vst1q_u32(_p, _a); }
+static INLINE v4f v4Set(float _f) { return vdupq_n_f32(_f); }
+static INLINE v4f v4Add(v4f _a, v4f _b) { return vaddq_f32(_a, _b); }
+static INLINE v4f v4Sub(v4f _a, v4f _b) { return vsubq_f32(_a, _b); }
+static INLINE v4f v4Mul(v4f _a, v4f _b) { return vmulq_f32(_a, _b); }
+static INLINE v4f v4Div(v4f _a, v4f _b) { return vdivq_f32(_a, _b); }
+static INLINE v4f v4Sqrt(v4f _a) { return vsqrtq_f32(_a); }
+static INLINE v4u v4Gt(v4f _a, v4f _b) { return vcgtq_f32(_a, _b); }
+static INLINE v4u v4Lt(v4f _a, v4f _b) { return vcltq_f32(_a, _b); }
+static INLINE v4u v4Ne(v4f _a, v4f _b) { return vmvnq_u32(vceqq_f32(_a, _b)); }
+static INLINE v4u v4Or(v4u _a, v4u _b) { return vorrq_u32(_a, _b); }
+static INLINE v4u v4Bit(v4u _m, uint32_t _bit) { return vandq_u32(_m, vdupq_n_u32(_bit)); }
+static INLINE v4f v4Select(v4u _m, v4f _a, v4f _b) { return vbslq_f32(_m, _a, _b); }
+#else
+struct v4f { float f[4]; };
+struct v4u { uint32_t u[4]; };
+
+#define V4_LANES(_type, _expr) \
+	_type r; \
+	for (int i = 0; i < 4; ++i) \
+		_expr; \
+	return r
+
+static INLINE v4f v4Load(const float * _p) { V4_LANES(v4f, r.f[i] = _p[i]); }
+static INLINE void v4Store(float * _p, v4f _a) { for (int i = 0; i < 4; ++i) _p[i] = _a.f[i]; }
+static INLINE void v4StoreU(uint32_t * _p, v4u _a) { for (int i = 0; i < 4; ++i) _p[i] = _a.u[i]; }
+static INLINE v4f v4Set(float _f) { V4_LANES(v4f, r.f[i] = _f); }
+static INLINE v4f v4Add(v4f _a, v4f _b) { V4_LANES(v4f, r.f[i] = _a.f[i] + _b.f[i]); }
+static INLINE v4f v4Sub(v4f _a, v4f _b) { V4_LANES(v4f, r.f[i] = _a.f[i] - _b.f[i]); }
+static INLINE v4f v4Mul(v4f _a, v4f _b) { V4_LANES(v4f, r.f[i] = _a.f[i] * _b.f[i]); }
+static INLINE v4f v4Div(v4f _a, v4f _b) { V4_LANES(v4f, r.f[i] = _a.f[i] / _b.f[i]); }
+static INLINE v4f v4Sqrt(v4f _a) { V4_LANES(v4f, r.f[i] = sqrtf(_a.f[i])); }
+static INLINE v4u v4Gt(v4f _a, v4f _b) { V4_LANES(v4u, r.u[i] = _a.f[i] > _b.f[i] ? ~0U : 0U); }
+static INLINE v4u v4Lt(v4f _a, v4f _b) { V4_LANES(v4u, r.u[i] = _a.f[i] < _b.f[i] ? ~0U : 0U); }
+static INLINE v4u v4Ne(v4f _a, v4f _b) { V4_LANES(v4u, r.u[i] = _a.f[i] != _b.f[i] ? ~0U : 0U); }
+static INLINE v4u v4Or(v4u _a, v4u _b) { V4_LANES(v4u, r.u[i] = _a.u[i] | _b.u[i]); }
+static INLINE v4u v4Bit(v4u _m, uint32_t _bit) { V4_LANES(v4u, r.u[i] = _m.u[i] & _bit); }
+static INLINE v4f v4Select(v4u _m, v4f _a, v4f _b) { V4_LANES(v4f, r.f[i] = _m.u[i] ? _a.f[i] : _b.f[i]); }
+
+#undef V4_LANES
+#endif
+
+/* One vertex load in structure-of-arrays form. The arrays are padded to a
+ * multiple of four; results in the padding lanes are thrown away. */
+struct SPVertexBatch
+{
+	float x[INDEXMAP_SIZE], y[INDEXMAP_SIZE], z[INDEXMAP_SIZE], w[INDEXMAP_SIZE];
+	float ox[INDEXMAP_SIZE], oy[INDEXMAP_SIZE], oz[INDEXMAP_SIZE];
+	float nx[INDEXMAP_SIZE], ny[INDEXMAP_SIZE], nz[INDEXMAP_SIZE];
+	float r[INDEXMAP_SIZE], g[INDEXMAP_SIZE], b[INDEXMAP_SIZE];
+	uint32_t clip[INDEXMAP_SIZE];
+};
+
+static SPVertexBatch vertexBatch;
+
+static void gln64gSPTransformVertices(SPVertexBatch & _b, uint32_t _lanes, float _mtx[4][4])
+{
+	v4f m[4][4];
+	for (int j = 0; j < 4; ++j)
+		for (int k = 0; k < 4; ++k)
+			m[j][k] = v4Set(_mtx[j][k]);
+
+	for (uint32_t i = 0; i < _lanes; i += 4) {
+		const v4f x = v4Load(&_b.x[i]);
+		const v4f y = v4Load(&_b.y[i]);
+		const v4f z = v4Load(&_b.z[i]);
+		v4Store(&_b.x[i], v4Add(v4Add(v4Add(v4Mul(x, m[0][0]), v4Mul(y, m[1][0])), v4Mul(z, m[2][0])), m[3][0]));
+		v4Store(&_b.y[i], v4Add(v4Add(v4Add(v4Mul(x, m[0][1]), v4Mul(y, m[1][1])), v4Mul(z, m[2][1])), m[3][1]));
+		v4Store(&_b.z[i], v4Add(v4Add(v4Add(v4Mul(x, m[0][2]), v4Mul(y, m[1][2])), v4Mul(z, m[2][2])), m[3][2]));
+		v4Store(&_b.w[i], v4Add(v4Add(v4Add(v4Mul(x, m[0][3]), v4Mul(y, m[1][3])), v4Mul(z, m[2][3])), m[3][3]));
+	}
+}
+
+static void gln64gSPClipVertices(SPVertexBatch & _b, uint32_t _lanes)
+{
+	const v4f zero = v4Set(0.0f);
+	const v4f minW = v4Set(0.01f);
+	for (uint32_t i = 0; i < _lanes; i += 4) {
+		const v4f x = v4Load(&_b.x[i]);
+		const v4f y = v4Load(&_b.y[i]);
+		const v4f w = v4Load(&_b.w[i]);
+		const v4f negW = v4Sub(zero, w);
+		v4u clip = v4Bit(v4Gt(x, w), CLIP_POSX);
+		clip = v4Or(clip, v4Bit(v4Lt(x, negW), CLIP_NEGX));
+		clip = v4Or(clip, v4Bit(v4Gt(y, w), CLIP_POSY));
+		clip = v4Or(clip, v4Bit(v4Lt(y, negW), CLIP_NEGY));
+		clip = v4Or(clip, v4Bit(v4Lt(w, minW), CLIP_Z));
+		v4StoreU(&_b.clip[i], clip);
+	}
+}
+
+static void gln64gSPTransformNormals(SPVertexBatch & _b, uint32_t _lanes, float _mtx[4][4])
+{
+	v4f m[3][3];
+	for (int j = 0; j < 3; ++j)
+		for (int k = 0; k < 3; ++k)
+			m[j][k] = v4Set(_mtx[j][k]);
+
+	const v4f zero = v4Set(0.0f);
+	for (uint32_t i = 0; i < _lanes; i += 4) {
+		const v4f x = v4Load(&_b.nx[i]);
+		const v4f y = v4Load(&_b.ny[i]);
+		const v4f z = v4Load(&_b.nz[i]);
+		v4f nx = v4Add(v4Add(v4Mul(m[0][0], x), v4Mul(m[1][0], y)), v4Mul(m[2][0], z));
+		v4f ny = v4Add(v4Add(v4Mul(m[0][1], x), v4Mul(m[1][1], y)), v4Mul(m[2][1], z));
+		v4f nz = v4Add(v4Add(v4Mul(m[0][2], x), v4Mul(m[1][2], y)), v4Mul(m[2][2], z));
+		const v4f len2 = v4Add(v4Add(v4Mul(nx, nx), v4Mul(ny, ny)), v4Mul(nz, nz));
+		const v4u nonZero = v4Ne(len2, zero);
+		const v4f len = v4Sqrt(len2);
+		nx = v4Select(nonZero, v4Div(nx, len), nx);
+		ny = v4Select(nonZero, v4Div(ny, len), ny);
+		nz = v4Select(nonZero, v4Div(nz, len), nz);
+		v4Store(&_b.nx[i], nx);
+		v4Store(&_b.ny[i], ny);
+		v4Store(&_b.nz[i], nz);
+	}
+}
+
+static void gln64gSPLightVertices(SPVertexBatch & _b, uint32_t _lanes)
+{
+	const SPLight & ambient = gSP.lights[gSP.numLights];
+	const v4f zero = v4Set(0.0f);
+	const v4f one = v4Set(1.0f);
+	for (uint32_t i = 0; i < _lanes; i += 4) {
+		const v4f nx = v4Load(&_b.nx[i]);
+		const v4f ny = v4Load(&_b.ny[i]);
+		const v4f nz = v4Load(&_b.nz[i]);
+		v4f r = v4Set(ambient.r);
+		v4f g = v4Set(ambient.g);
+		v4f b = v4Set(ambient.b);
+		for (int l = 0; l < gSP.numLights; ++l) {
+			const SPLight & light = gSP.lights[l];
+			v4f intensity = v4Add(v4Add(v4Mul(nx, v4Set(light.x)), v4Mul(ny, v4Set(light.y))), v4Mul(nz, v4Set(light.z)));
+			intensity = v4Select(v4Lt(intensity, zero), zero, intensity);
+			r = v4Add(r, v4Mul(v4Set(light.r), intensity));
+			g = v4Add(g, v4Mul(v4Set(light.g), intensity));
+			b = v4Add(b, v4Mul(v4Set(light.b), intensity));
+		}
+		v4Store(&_b.r[i], v4Select(v4Lt(r, one), r, one));
+		v4Store(&_b.g[i], v4Select(v4Lt(g, one), g, one));
+		v4Store(&_b.b[i], v4Select(v4Lt(b, one), b, one));
+	}
+}
+
+static void gln64gSPPointLightVertices(SPVertexBatch & _b, uint32_t _lanes)
+{
+	const SPLight & ambient = gSP.lights[gSP.numLights];
+	const v4f zero = v4Set(0.0f);
+	const v4f one = v4Set(1.0f);
+	const v4f attenuationScale = v4Set(65535.0f);
+	for (uint32_t i = 0; i < _lanes; i += 4) {
+		const v4f x = v4Load(&_b.ox[i]);
+		const v4f y = v4Load(&_b.oy[i]);
+		const v4f z = v4Load(&_b.oz[i]);
+		v4f r = v4Set(ambient.r);
+		v4f g = v4Set(ambient.g);
+		v4f b = v4Set(ambient.b);
+		for (int l = 0; l < gSP.numLights; ++l) {
+			const SPLight & light = gSP.lights[l];
+			const v4f lx = v4Sub(v4Set(light.posx), x);
+			const v4f ly = v4Sub(v4Set(light.posy), y);
+			const v4f lz = v4Sub(v4Set(light.posz), z);
+			const v4f len2 = v4Add(v4Add(v4Mul(lx, lx), v4Mul(ly, ly)), v4Mul(lz, lz));
+			const v4f len = v4Sqrt(len2);
+			const v4f at = v4Add(v4Add(v4Set(light.ca), v4Mul(v4Div(len, attenuationScale), v4Set(light.la))),
+				v4Mul(v4Div(len2, attenuationScale), v4Set(light.qa)));
+			const v4f intensity = v4Select(v4Gt(at, zero), v4Div(one, at), zero);
+			const v4u lit = v4Gt(intensity, zero);
+			r = v4Select(lit, v4Add(r, v4Mul(v4Set(light.r), intensity)), r);
+			g = v4Select(lit, v4Add(g, v4Mul(v4Set(light.g), intensity)), g);
+			b = v4Select(lit, v4Add(b, v4Mul(v4Set(light.b), intensity)), b);
+		}
+		v4Store(&_b.r[i], v4Select(v4Gt(r, one), one, r));
+		v4Store(&_b.g[i], v4Select(v4Gt(g, one), one, g));
+		v4Store(&_b.b[i], v4Select(v4Gt(b, one), one, b));
+	}
+}
+
+/* Processes the vertices v0 .. v0 + n - 1 of a vertex load like
+ * gln64gSPProcessVertex, four at a time. The geometry mode, the matrices
+ * and the lighting functions are looked at once for the whole load. */
+void gln64gSPProcessVertices(uint32_t v0, uint32_t n)
+{
+	if (gln64gSPTransformVertex != gln64gSPTransformVertex_default ||
+		gln64gSPBillboardVertex != gln64gSPBillboardVertex_default) {
+		for (uint32_t i = 0; i < n; ++i)
+			gln64gSPProcessVertex(v0 + i);
+		return;
+	}
+
+	if (gSP.changed & CHANGED_MATRIX)
+		gln64gSPCombineMatrices();
+
+	OGLVideo & ogl = video();
+	OGLRender & render = ogl.getRender();
+	SPVertexBatch & batch = vertexBatch;
+	const uint32_t lanes = (n + 3) & ~3U;
+	const bool lighting = (gSP.geometryMode & G_LIGHTING) != 0;
+	const bool pointLighting = lighting && (gSP.geometryMode & G_POINT_LIGHTING) != 0;
+	const bool batchedLighting = lighting &&
+		gln64gSPLightVertex == gln64gSPLightVertex_default &&
+		gln64gSPPointLightVertex == gln64gSPPointLightVertex_default;
+	const bool hwLighting = !pointLighting && config.generalEmulation.enableHWLighting != 0;
+
+	for (uint32_t i = 0; i < lanes; ++i) {
+		if (i < n) {
+			const SPVertex & vtx = render.getVertex(v0 + i);
+			batch.x[i] = vtx.x;
+			batch.y[i] = vtx.y;
+			batch.z[i] = vtx.z;
+			batch.nx[i] = vtx.nx;
+			batch.ny[i] = vtx.ny;
+			batch.nz[i] = vtx.nz;
+		} else
+			batch.x[i] = batch.y[i] = batch.z[i] = batch.nx[i] = batch.ny[i] = batch.nz[i] = 0.0f;
+		batch.ox[i] = batch.x[i];
+		batch.oy[i] = batch.y[i];
+		batch.oz[i] = batch.z[i];
+	}
+
+	gln64gSPTransformVertices(batch, lanes, gSP.matrix.combined);
+
+	if (ogl.isAdjustScreen() && (gDP.colorImage.width > VI.width * 98 / 100)) {
+		const float adjustScale = ogl.getAdjustScale();
+		const bool adjustW = gSP.matrix.projection[3][2] == -1.f;
+		for (uint32_t i = 0; i < n; ++i) {
+			batch.x[i] *= adjustScale;
+			if (adjustW)
+				batch.w[i] *= adjustScale;
+		}
+	}
+
+	if (gSP.viewport.vscale[0] < 0) {
+		for (uint32_t i = 0; i < n; ++i)
+			batch.x[i] = -batch.x[i];
+	}
+
+	if (gSP.matrix.billboard) {
+		// Vertex 0 is the billboard origin. If this load replaces it, it is added to itself
+		// first and the result is added to the rest, as the per-vertex path does.
+		uint32_t i = 0;
+		float bx, by, bz, bw;
+		if (v0 == 0) {
+			bx = batch.x[0] += batch.x[0];
+			by = batch.y[0] += batch.y[0];
+			bz = batch.z[0] += batch.z[0];
+			bw = batch.w[0] += batch.w[0];
+			i = 1;
+		} else {
+			const SPVertex & vtx0 = render.getVertex(0);
+			bx = vtx0.x;
+			by = vtx0.y;
+			bz = vtx0.z;
+			bw = vtx0.w;
+		}
+		for (; i < n; ++i) {
+			batch.x[i] += bx;
+			batch.y[i] += by;
+			batch.z[i] += bz;
+			batch.w[i] += bw;
+		}
+	}
+
+	gln64gSPClipVertices(batch, lanes);
+
+	if (lighting) {
+		gln64gSPTransformNormals(batch, lanes, gSP.matrix.modelView[gSP.matrix.modelViewi]);
+		if (batchedLighting) {
+			if (pointLighting)
+				gln64gSPPointLightVertices(batch, lanes);
+			else if (!hwLighting)
+				gln64gSPLightVertices(batch, lanes);
+		}
+	}
+
+	for (uint32_t i = 0; i < n; ++i) {
+		SPVertex & vtx = render.getVertex(v0 + i);
+		vtx.x = batch.x[i];
+		vtx.y = batch.y[i];
+		vtx.z = batch.z[i];
+		vtx.w = batch.w[i];
+		vtx.clip = batch.clip[i];
+		if (!lighting) {
+			vtx.HWLight = 0;
+			continue;
+		}
+		vtx.nx = batch.nx[i];
+		vtx.ny = batch.ny[i];
+		vtx.nz = batch.nz[i];
+		if (!batchedLighting) {
+			float vPos[3] = {batch.ox[i], batch.oy[i], batch.oz[i]};
+			if (pointLighting)
+				gln64gSPPointLightVertex(vtx, vPos);
+			else
+				gln64gSPLightVertex(vtx);
+		} else if (hwLighting) {
+			vtx.HWLight = gSP.numLights;
+			vtx.r = vtx.nx;
+			vtx.g = vtx.ny;
+			vtx.b = vtx.nz;
+		} else {
+			vtx.HWLight = 0;
+			vtx.r = batch.r[i];
+			vtx.g = batch.g[i];
+			vtx.b = batch.b[i];
+		}
+		if (GBI.isTextureGen() && (gSP.geometryMode & G_TEXTURE_GEN) != 0)
+			gln64gSPTextureGenVertex(vtx);
+	}
+}
+
 void gln64gSPLoadUcodeEx( uint32_t uc_start, uint32_t uc_dstart, uint16_t uc_dsize )
 {
 	gSP.matrix.modelViewi = 0;
@@ -562,9 +916,9 @@ void gln64gSPVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.b = vertex->color.b * 0.0039215689f;
 				vtx.a = vertex->color.a * 0.0039215689f;
 			}
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -604,9 +958,9 @@ void gln64gSPCIVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = color[0] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -641,9 +995,9 @@ void gln64gSPDMAVertex( uint32_t a, uint32_t n, uint32_t v0 )
 				vtx.a = *(uint8_t*)&gfx_info.RDRAM[(address + 9) ^ 3] * 0.0039215689f;
 			}
 
-			gln64gSPProcessVertex(v);
 			address += 10;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
@@ -679,9 +1033,9 @@ void gln64gSPCBFDVertex( uint32_t a, uint32_t n, uint32_t v0 )
 			vtx.g = vertex->color.g * 0.0039215689f;
 			vtx.b = vertex->color.b * 0.0039215689f;
 			vtx.a = vertex->color.a * 0.0039215689f;
-			gln64gSPProcessVertex(v);
 			vertex++;
 		}
+		gln64gSPProcessVertices(v0, n);
 	} else {
 		LOG(LOG_ERROR, "Using Vertex outside buffer v0=%i, n=%i\n", v0, n);
 	}
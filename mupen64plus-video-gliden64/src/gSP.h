@@ -90,6 +90,7 @@ void gln64gSPSetDMATexOffset(uint32_t _addr);
 void gln64gSPSetVertexColorBase( uint32_t base );
 void gln64gSPSetVertexNormaleBase( uint32_t base );
 void gln64gSPProcessVertex(uint32_t v);
+void gln64gSPProcessVertices(uint32_t v0, uint32_t n);
 void gln64gSPCoordMod(uint32_t _w0, uint32_t _w1);
 
 void gln64gSPTriangleUnknown();
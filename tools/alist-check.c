@@ -0,0 +1,275 @@
+/* alist-check
+ * Runs randomized audio list commands through the alist kernels of rsp-hle
+ * and checks their output, to keep the SSE2/NEON kernels bit-exact with the
+ * scalar ones:
+ *
+ *     make alist-check alist-check-scalar
+ *     alist-check-scalar -o scalar.txt
+ *     alist-check -c scalar.txt
+ *
+ * usage: alist-check [-n commands] [-s seed] [-o hashes.txt] [-c hashes.txt]
+ *
+ *   -n  commands to run (default 200000)
+ *   -s  seed of the generator (default 12345)
+ *   -o  writes "command opcode hash" for every command
+ *   -c  checks the commands against a file written by -o and exits with 2 at
+ *       the first difference
+ *
+ * Each command starts from random RDRAM, loads it into the audio buffer with
+ * alist_load, runs one of the kernels with random parameters (a quarter of
+ * the time on samples close to the clamping limits) and saves the buffer
+ * back with alist_save. The hash covers the saved buffer and the RDRAM state
+ * of the command (ADPCM, resampler and filter history). alist-check-scalar
+ * is the same program built without the SIMD kernels.
+ *
+ * With the default count and seed, the total is also checked against the one
+ * of the code before the audio buffer was kept in host sample order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "hle_internal.h"
+#include "alist.h"
+
+#define DEFAULT_COMMANDS	200000
+#define DEFAULT_SEED		12345
+#define DEFAULT_TOTAL		UINT64_C(0x7e5f010b9b27e40d)
+
+#define DRAM_SIZE	0x200000
+#define STATE		0x1000		/* history of the commands */
+#define STATE_SIZE	0x400
+#define INPUT		0x100000
+#define OUTPUT		0x180000
+#define BUFFER_SIZE	0x1000
+#define OPCODES		16
+
+static uint8_t dram[DRAM_SIZE];
+static struct hle_t hle;
+static uint32_t seed;
+
+void HleWarnMessage(void *user_defined, const char *message, ...)
+{
+}
+
+void HleVerboseMessage(void *user_defined, const char *message, ...)
+{
+}
+
+/* xorshift32 */
+static uint32_t rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* 16-byte aligned offset below max */
+#define OFFSET(r, max)	(((r) % ((max) / 16)) * 16)
+
+static uint64_t fnv1a(const uint8_t *data, size_t size)
+{
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+	while (size--)
+		hash = (hash ^ *data++) * UINT64_C(0x100000001b3);
+	return hash;
+}
+
+static void run_command(unsigned opcode)
+{
+	int16_t vol[2], target[2], xors[4], book[16 * 16], table[32];
+	int32_t rate[2];
+	uint16_t env_values[3], env_steps[3];
+	uint32_t lut[2], r[10];
+	unsigned i;
+
+	for (i = 0; i < 0x4000; i++)
+		dram[INPUT + i] = rnd();
+	for (i = 0; i < STATE_SIZE; i++)
+		dram[STATE + i] = rnd();
+	for (i = 0; i < 2; i++) {
+		vol[i] = rnd();
+		target[i] = rnd();
+		rate[i] = (int32_t)rnd() >> (rnd() % 16);
+	}
+	for (i = 0; i < 4; i++)
+		xors[i] = (rnd() & 1) ? -1 : 0;
+	for (i = 0; i < 3; i++) {
+		env_values[i] = rnd();
+		env_steps[i] = rnd();
+	}
+	for (i = 0; i < 256; i++)
+		book[i] = rnd();
+	for (i = 0; i < 32; i++)
+		table[i] = rnd();
+	/* samples which saturate */
+	if (rnd() % 4 == 0)
+		for (i = 0; i < 0x4000; i += 2)
+			dram[INPUT + i] = (rnd() & 1) ? 0x80 : 0x7f;
+	/* the arguments of the command */
+	for (i = 0; i < 10; i++)
+		r[i] = rnd();
+
+	alist_load(&hle, 0, INPUT, BUFFER_SIZE);
+
+	switch (opcode) {
+	case 0:
+		alist_mix(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x800), OFFSET(r[2], 0x400), r[3]);
+		break;
+	case 1:
+		alist_add(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x800), OFFSET(r[2], 0x400));
+		break;
+	case 2:
+		alist_multQ44(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x400), r[2]);
+		break;
+	case 3:
+		alist_envmix_exp(&hle, r[0] & 1, r[1] & 1, OFFSET(r[2], 0x800), OFFSET(r[3], 0x800),
+				 OFFSET(r[4], 0x800), OFFSET(r[5], 0x800), OFFSET(r[6], 0x800),
+				 OFFSET(r[7], 0x200), r[8], r[9], vol, target, rate, STATE);
+		break;
+	case 4:
+		alist_envmix_ge(&hle, r[0] & 1, r[1] & 1, OFFSET(r[2], 0x800), OFFSET(r[3], 0x800),
+				OFFSET(r[4], 0x800), OFFSET(r[5], 0x800), OFFSET(r[6], 0x800),
+				OFFSET(r[7], 0x200), r[8], r[9], vol, target, rate, STATE);
+		break;
+	case 5:
+		alist_envmix_lin(&hle, r[0] & 1, OFFSET(r[1], 0x800), OFFSET(r[2], 0x800),
+				 OFFSET(r[3], 0x800), OFFSET(r[4], 0x800), OFFSET(r[5], 0x800),
+				 OFFSET(r[6], 0x200), r[7], r[8], vol, target, rate, STATE);
+		break;
+	case 6:
+		alist_envmix_nead(&hle, r[0] & 1, OFFSET(r[1], 0x800), OFFSET(r[2], 0x800),
+				  OFFSET(r[3], 0x800), OFFSET(r[4], 0x800), OFFSET(r[5], 0x800),
+				  OFFSET(r[6], 0x200), env_values, env_steps, xors);
+		break;
+	case 7:
+		alist_resample(&hle, r[0] & 1, 0, OFFSET(r[1], 0x800), OFFSET(r[2], 0x600) + 16,
+			       OFFSET(r[3], 0x100), r[4] % 0x20000, STATE);
+		break;
+	case 8:
+		alist_adpcm(&hle, r[0] & 1, r[1] & 1, r[2] & 1, OFFSET(r[3], 0x600),
+			    OFFSET(r[4], 0x600), ((r[5] % 8) + 1) * 32, book, STATE + 0x100, STATE);
+		break;
+	case 9:
+		lut[0] = STATE + 0x200;
+		lut[1] = STATE + 0x220;
+		alist_filter(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x400), STATE, lut);
+		break;
+	case 10:
+		alist_polef(&hle, r[0] & 1, OFFSET(r[1], 0x800), OFFSET(r[2], 0x800),
+			    OFFSET(r[3], 0x200) + 16, r[4], table, STATE);
+		break;
+	case 11:
+		alist_iirf(&hle, r[0] & 1, OFFSET(r[1], 0x800), OFFSET(r[2], 0x800),
+			   OFFSET(r[3], 0x200) + 16, table, STATE);
+		break;
+	case 12:
+		alist_interleave(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x800), OFFSET(r[2], 0x800),
+				 OFFSET(r[3], 0x200));
+		break;
+	case 13:
+		alist_move(&hle, r[0] % 0x800, r[1] % 0x800, r[2] % 0x200);
+		break;
+	case 14:
+		alist_copy_every_other_sample(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x800),
+					      OFFSET(r[2], 0x100));
+		break;
+	case 15:
+		alist_resample_zoh(&hle, OFFSET(r[0], 0x800), OFFSET(r[1], 0x600), OFFSET(r[2], 0x100),
+				   r[3] % 0x20000, r[4] & 0xffff);
+		break;
+	}
+
+	alist_save(&hle, 0, OUTPUT, BUFFER_SIZE);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n commands] [-s seed] [-o hashes.txt] [-c hashes.txt]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned commands = DEFAULT_COMMANDS, command;
+	const char *output_path = NULL, *check_path = NULL;
+	FILE *output = NULL, *check = NULL;
+	uint32_t initial_seed = DEFAULT_SEED;
+	uint64_t total = 0;
+	int i, mismatch = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (i + 1 == argc) {
+			usage(argv[0]);
+			return 1;
+		} else if (!strcmp(argv[i], "-n"))
+			commands = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s"))
+			initial_seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-o"))
+			output_path = argv[++i];
+		else if (!strcmp(argv[i], "-c"))
+			check_path = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (initial_seed == 0) {
+		fprintf(stderr, "the seed can't be 0\n");
+		return 1;
+	}
+	seed = initial_seed;
+
+	if (output_path && !(output = fopen(output_path, "w"))) {
+		fprintf(stderr, "cannot create %s\n", output_path);
+		return 1;
+	}
+	if (check_path && !(check = fopen(check_path, "r"))) {
+		fprintf(stderr, "cannot open %s\n", check_path);
+		return 1;
+	}
+
+	hle.dram = dram;
+
+	for (command = 0; command < commands; command++) {
+		unsigned opcode = command % OPCODES;
+		uint64_t hash;
+
+		run_command(opcode);
+		hash = fnv1a(dram + OUTPUT, BUFFER_SIZE) ^ fnv1a(dram + STATE, STATE_SIZE) * 3;
+		total = total * 31 + hash;
+
+		if (output)
+			fprintf(output, "%u %u %016llx\n", command, opcode, (unsigned long long)hash);
+		if (check) {
+			unsigned long long expected;
+			unsigned expected_command;
+
+			if (fscanf(check, "%u %*u %llx", &expected_command, &expected) != 2 ||
+			    expected_command != command || expected != (unsigned long long)hash) {
+				fprintf(stderr, "command %u (opcode %u) differs from %s\n",
+					command, opcode, check_path);
+				mismatch = 1;
+				break;
+			}
+		}
+	}
+
+	printf("%u commands: total %016llx\n", command, (unsigned long long)total);
+	if (!mismatch && commands == DEFAULT_COMMANDS && initial_seed == DEFAULT_SEED &&
+	    total != DEFAULT_TOTAL) {
+		fprintf(stderr, "the total should be %016llx\n", (unsigned long long)DEFAULT_TOTAL);
+		mismatch = 1;
+	}
+
+	if (output && fclose(output)) {
+		fprintf(stderr, "write error on %s\n", output_path);
+		return 1;
+	}
+
+	return mismatch ? 2 : 0;
+}
@@ -0,0 +1,537 @@
+/* angrylion-replay
+ * Replays an RDP dump (RDPDUMP1, as written by the angrylion and paraLLEl
+ * plugins built with HAVE_RDP_DUMP, see mupen64plus-video-paraLLEl/rdp_dump.c)
+ * through mupen64plus-video-angrylion with different numbers of rendering
+ * threads, and checks that RDRAM ends up the same after every command list:
+ *
+ *     angrylion-replay [-t threads,...] [-o hashes.txt] [-c hashes.txt] [-v] dump.rdp
+ *     angrylion-replay -g lists [-s seed] out.rdp
+ *
+ *   -t  thread counts to run (default 1,2,3,4); the first one is the
+ *       reference the others are compared to, list by list
+ *   -o  writes the hash of RDRAM after every command list of the reference
+ *   -c  compares the reference to hashes written by -o
+ *   -v  prints the hash of every command list
+ *   -g  writes a synthetic dump of random primitives instead, in modes
+ *       which carry state from one pixel to the next (dither noise, 2-cycle
+ *       memory blending, alpha compare dither) as well as in plain ones
+ *
+ * Each thread count runs in its own process, so that every run starts from
+ * the same rasterizer state. The time each run takes is reported too.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "vi.h"
+#include "rdp.h"
+#include "api/libretro.h"
+
+#define RDRAM_SIZE	0x800000
+#define DMEM_SIZE	0x1000
+#define MAX_RUNS	16
+
+enum {
+	DUMP_UPDATE_DRAM = 1,
+	DUMP_BEGIN_COMMAND_LIST = 2,
+	DUMP_END_COMMAND_LIST = 3,
+	DUMP_RDP_COMMAND = 4,
+	DUMP_EOF = 5
+};
+
+extern void angrylion_set_threads(unsigned threads);
+
+/* what the plugin expects from the core and the frontend */
+GFX_INFO gfx_info;
+RECT __src, __dst;
+int32_t pitchindwords;
+uint32_t *blitter_buf_lock;
+retro_log_printf_t log_cb;
+
+static uint8_t *ram;
+static uint8_t sp_dmem[DMEM_SIZE];
+static uint8_t sp_imem[DMEM_SIZE];
+static uint32_t regs[32];
+
+static uint8_t *dump;
+static size_t dump_size;
+
+static void check_interrupts(void)
+{
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t hash_rdram(void)
+{
+	const uint64_t *p = (const uint64_t *)ram;
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	size_t i;
+
+	for (i = 0; i < RDRAM_SIZE / 8; i++)
+		hash = (hash ^ p[i]) * UINT64_C(0x100000001b3);
+	return hash;
+}
+
+static int read_u32(size_t *pos, uint32_t *v)
+{
+	if (*pos + 4 > dump_size)
+		return 0;
+	memcpy(v, dump + *pos, 4);
+	*pos += 4;
+	return 1;
+}
+
+static int load_dump(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	long size;
+
+	if (!f)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	dump = malloc(size);
+	dump_size = size;
+	if (!dump || fread(dump, 1, size, f) != (size_t)size) {
+		fclose(f);
+		return 0;
+	}
+	fclose(f);
+	return dump_size >= 12 && !memcmp(dump, "RDPDUMP1", 8);
+}
+
+/* Hands the commands queued in DMEM to the plugin, as an XBUS transfer. */
+static void flush_commands(uint32_t *bytes)
+{
+	if (*bytes == 0)
+		return;
+	*gfx_info.DPC_STATUS_REG |= 1; /* DP_STATUS_XBUS_DMA */
+	*gfx_info.DPC_START_REG = *gfx_info.DPC_CURRENT_REG = 0;
+	*gfx_info.DPC_END_REG = *bytes;
+	process_RDP_list();
+	*bytes = 0;
+}
+
+/* Replays the dump, storing the hash of RDRAM after every command list.
+ * Returns the number of lists, or -1 if the dump is broken. */
+static int replay(unsigned threads, uint64_t *hashes, unsigned max_lists)
+{
+	size_t pos = 12;
+	unsigned lists = 0;
+	uint32_t queued = 0;
+
+	ram = calloc(1, RDRAM_SIZE);
+	if (!ram)
+		return -1;
+	gfx_info.RDRAM = ram;
+	gfx_info.DMEM = sp_dmem;
+	gfx_info.IMEM = sp_imem;
+	gfx_info.MI_INTR_REG = &regs[0];
+	gfx_info.DPC_START_REG = &regs[1];
+	gfx_info.DPC_END_REG = &regs[2];
+	gfx_info.DPC_CURRENT_REG = &regs[3];
+	gfx_info.DPC_STATUS_REG = &regs[4];
+	gfx_info.DPC_CLOCK_REG = &regs[5];
+	gfx_info.DPC_BUFBUSY_REG = &regs[6];
+	gfx_info.DPC_PIPEBUSY_REG = &regs[7];
+	gfx_info.DPC_TMEM_REG = &regs[8];
+	gfx_info.VI_STATUS_REG = &regs[9];
+	gfx_info.VI_ORIGIN_REG = &regs[10];
+	gfx_info.VI_WIDTH_REG = &regs[11];
+	gfx_info.VI_INTR_REG = &regs[12];
+	gfx_info.VI_V_CURRENT_LINE_REG = &regs[13];
+	gfx_info.VI_TIMING_REG = &regs[14];
+	gfx_info.VI_V_SYNC_REG = &regs[15];
+	gfx_info.VI_H_SYNC_REG = &regs[16];
+	gfx_info.VI_LEAP_REG = &regs[17];
+	gfx_info.VI_H_START_REG = &regs[18];
+	gfx_info.VI_V_START_REG = &regs[19];
+	gfx_info.VI_V_BURST_REG = &regs[20];
+	gfx_info.VI_X_SCALE_REG = &regs[21];
+	gfx_info.VI_Y_SCALE_REG = &regs[22];
+	gfx_info.CheckInterrupts = check_interrupts;
+
+	angrylion_set_threads(threads);
+	rdp_init();
+
+	for (;;) {
+		uint32_t cmd, offset, size, command, words;
+
+		if (!read_u32(&pos, &cmd))
+			return -1;
+		switch (cmd) {
+		case DUMP_EOF:
+			rdp_close();
+			return lists;
+		case DUMP_UPDATE_DRAM:
+			if (!read_u32(&pos, &offset) || !read_u32(&pos, &size)
+			    || offset + size > RDRAM_SIZE || pos + size > dump_size)
+				return -1;
+			memcpy(ram + offset, dump + pos, size);
+			pos += size;
+			break;
+		case DUMP_BEGIN_COMMAND_LIST:
+			break;
+		case DUMP_END_COMMAND_LIST:
+			flush_commands(&queued);
+			if (lists < max_lists)
+				hashes[lists] = hash_rdram();
+			lists++;
+			break;
+		case DUMP_RDP_COMMAND:
+			if (!read_u32(&pos, &command) || !read_u32(&pos, &words)
+			    || words * 4 > DMEM_SIZE || pos + words * 4 > dump_size)
+				return -1;
+			if (queued + words * 4 > DMEM_SIZE)
+				flush_commands(&queued);
+			memcpy(sp_dmem + queued, dump + pos, words * 4);
+			queued += words * 4;
+			pos += words * 4;
+			break;
+		default:
+			return -1;
+		}
+	}
+}
+
+/* Synthetic dumps */
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static uint32_t rnd_range(uint32_t lo, uint32_t hi)
+{
+	return lo + rnd() % (hi - lo + 1);
+}
+
+static void put_u32(FILE *f, uint32_t v)
+{
+	fwrite(&v, 4, 1, f);
+}
+
+static void put_command(FILE *f, const uint32_t *w, uint32_t words)
+{
+	put_u32(f, DUMP_RDP_COMMAND);
+	put_u32(f, w[0] >> 24 & 0x3f);
+	put_u32(f, words);
+	fwrite(w, 4, words, f);
+}
+
+static void put_command2(FILE *f, uint32_t w1, uint32_t w2)
+{
+	uint32_t w[2];
+
+	w[0] = w1;
+	w[1] = w2;
+	put_command(f, w, 2);
+}
+
+#define FB_WIDTH	320
+#define FB_HEIGHT	240
+#define FB_ADDRESS	0x100000
+#define Z_ADDRESS	0x200000
+#define TEX_ADDRESS	0x300000
+
+/* Other modes in 1- or 2-cycle mode, biased towards the modes that use the
+ * state of the previous pixel. */
+static void put_other_modes(FILE *f)
+{
+	uint32_t w1 = rnd() & 0x00ffffff;
+	uint32_t w2 = rnd();
+
+	w1 = (w1 & ~0x00300000) | (rnd() & 1) << 20;
+	switch (rnd() % 4) {
+	case 0: /* 2-cycle, memory color and alpha in the first cycle */
+		w1 = (w1 & ~0x00300000) | 1 << 20;
+		w2 = (w2 & ~0xcc000000) | 1 << 30 | 1 << 26;
+		w2 = (w2 & ~0x00003000) | 1 << 12;
+		break;
+	case 1: /* noise dither */
+		w1 = (w1 & ~0x000000f0) | 2 << 6 | 2 << 4;
+		break;
+	case 2: /* alpha compare with dithered threshold */
+		w2 |= 0x3;
+		break;
+	}
+	put_command2(f, 0x2f000000 | w1, w2);
+}
+
+static void put_triangle(FILE *f)
+{
+	uint32_t w[44];
+	unsigned command = 0x08 | (rnd() & 7), words = 8, i;
+	int yh = rnd_range(0, FB_HEIGHT - 8) * 4, ym, yl;
+	int32_t xh = rnd_range(0, FB_WIDTH) << 16, xm, xl;
+
+	yl = yh + rnd_range(8, 160) * 4;
+	ym = rnd_range(yh, yl);
+	xm = xh + (int32_t)rnd_range(0, 200 << 16) - (100 << 16);
+	xl = xm + (int32_t)rnd_range(0, 200 << 16) - (100 << 16);
+
+	w[0] = command << 24 | (rnd() & 1) << 23 | (rnd() & 7) << 16 | (yl & 0x3fff);
+	w[1] = (ym & 0x3fff) << 16 | (yh & 0x3fff);
+	w[2] = xl;
+	w[3] = rnd_range(0, 4 << 16) - (2 << 16);
+	w[4] = xh;
+	w[5] = rnd_range(0, 4 << 16) - (2 << 16);
+	w[6] = xm;
+	w[7] = rnd_range(0, 4 << 16) - (2 << 16);
+	if (command & 4) { /* shade */
+		for (i = 0; i < 16; i++)
+			w[words + i] = i < 4 ? rnd() : rnd() & 0x0003ffff;
+		words += 16;
+	}
+	if (command & 2) { /* texture */
+		for (i = 0; i < 16; i++)
+			w[words + i] = i < 4 ? rnd() & 0x0fff0fff : rnd() & 0x0003ffff;
+		words += 16;
+	}
+	if (command & 1) { /* z */
+		w[words + 0] = rnd() & 0x7fffffff;
+		for (i = 1; i < 4; i++)
+			w[words + i] = rnd() & 0x00ffffff;
+		words += 4;
+	}
+	put_command(f, w, words);
+}
+
+static void put_texture_rectangle(FILE *f)
+{
+	uint32_t w[4];
+	uint32_t xh = rnd_range(0, FB_WIDTH - 1) * 4, yh = rnd_range(0, FB_HEIGHT - 1) * 4;
+	uint32_t xl = xh + rnd_range(4, 128) * 4, yl = yh + rnd_range(4, 96) * 4;
+
+	w[0] = 0x24000000 | (xl & 0xfff) << 12 | (yl & 0xfff);
+	w[1] = (rnd() & 7) << 24 | xh << 12 | yh;
+	w[2] = rnd();
+	w[3] = rnd() & 0x0fff0fff;
+	put_command(f, w, 4);
+}
+
+static void put_command_list(FILE *f)
+{
+	unsigned i, primitives = rnd_range(4, 24);
+
+	put_u32(f, DUMP_BEGIN_COMMAND_LIST);
+	put_command2(f, 0x3f000000 | (rnd() & 1 ? 3 : 2) << 19 | (FB_WIDTH - 1), FB_ADDRESS);
+	put_command2(f, 0x3e000000, Z_ADDRESS);
+	put_command2(f, 0x2d000000, (FB_WIDTH * 4) << 12 | FB_HEIGHT * 4);
+
+	/* a 64x32 16-bit texture into TMEM, and tiles pointing at it */
+	put_command2(f, 0x3d000000 | 2 << 19 | 63, TEX_ADDRESS + (rnd() & 0xfff0));
+	put_command2(f, 0x35000000 | 2 << 19 | 16 << 9, 0x07000000);
+	put_command2(f, 0x27000000, 0);
+	put_command2(f, 0x34000000, 0x07000000 | (63 * 4) << 12 | 31 * 4);
+	for (i = 0; i < 8; i++) {
+		put_command2(f, 0x35000000 | (rnd() & 0x00f80000) | 16 << 9 | (rnd() & 0x1ff),
+			     i << 24 | (rnd() & 0x00fffff));
+		put_command2(f, 0x32000000, i << 24 | (63 * 4) << 12 | 31 * 4);
+	}
+
+	for (i = 0; i < primitives; i++) {
+		put_command2(f, 0x27000000, 0);
+		if (rnd() % 3 == 0)
+			put_other_modes(f);
+		if (rnd() % 3 == 0)
+			put_command2(f, 0x3c000000 | (rnd() & 0x00ffffff), rnd());
+		if (rnd() % 2 == 0)
+			put_command2(f, 0x38000000 + (rnd() % 4) * 0x01000000 + (rnd() & 0xffff),
+				     rnd());
+		if (rnd() % 8 == 0)
+			put_texture_rectangle(f);
+		else
+			put_triangle(f);
+	}
+
+	put_command2(f, 0x29000000, 0);
+	put_u32(f, DUMP_END_COMMAND_LIST);
+}
+
+static int generate(const char *path, unsigned lists)
+{
+	FILE *f = fopen(path, "wb");
+	uint32_t offset, i;
+
+	if (!f)
+		return 0;
+	fwrite("RDPDUMP1", 8, 1, f);
+	put_u32(f, RDRAM_SIZE);
+
+	/* random texels and a random frame and depth buffer to blend with */
+	for (offset = FB_ADDRESS; offset < TEX_ADDRESS + 0x10000; offset += 0x1000) {
+		put_u32(f, DUMP_UPDATE_DRAM);
+		put_u32(f, offset);
+		put_u32(f, 0x1000);
+		for (i = 0; i < 0x1000 / 4; i++)
+			put_u32(f, rnd());
+	}
+	for (i = 0; i < lists; i++)
+		put_command_list(f);
+	put_u32(f, DUMP_EOF);
+	return fclose(f) == 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-t threads,...] [-o hashes.txt] [-c hashes.txt] [-v] dump.rdp\n"
+		"       %s -g lists [-s seed] out.rdp\n", name, name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned threads[MAX_RUNS] = { 1, 2, 3, 4 }, runs = 4, max_lists, i, run;
+	const char *output = NULL, *check = NULL, *list;
+	int verbose = 0, lists = 0, result[MAX_RUNS], failed = 0, opt;
+	unsigned generate_lists = 0;
+	double seconds[MAX_RUNS];
+	uint64_t *hashes;
+
+	while ((opt = getopt(argc, argv, "t:o:c:vg:s:")) != -1) {
+		switch (opt) {
+		case 't':
+			for (runs = 0, list = optarg; *list && runs < MAX_RUNS; runs++) {
+				threads[runs] = strtoul(list, (char **)&list, 0);
+				if (*list == ',')
+					list++;
+			}
+			break;
+		case 'o': output = optarg; break;
+		case 'c': check = optarg; break;
+		case 'v': verbose = 1; break;
+		case 'g': generate_lists = strtoul(optarg, NULL, 0); break;
+		case 's': seed = strtoul(optarg, NULL, 0) | 1; break;
+		default: usage(argv[0]);
+		}
+	}
+	if (optind + 1 != argc || runs == 0)
+		usage(argv[0]);
+
+	if (generate_lists) {
+		if (!generate(argv[optind], generate_lists)) {
+			fprintf(stderr, "cannot write %s\n", argv[optind]);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (!load_dump(argv[optind])) {
+		fprintf(stderr, "cannot read %s\n", argv[optind]);
+		return 1;
+	}
+
+	/* one hash per list at most, the lists are at least 12 bytes apart */
+	max_lists = dump_size / 12 + 1;
+	hashes = mmap(NULL, (size_t)runs * max_lists * sizeof(*hashes),
+		      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (hashes == MAP_FAILED)
+		return 1;
+
+	for (run = 0; run < runs; run++) {
+		int fds[2], status;
+		pid_t pid;
+
+		if (pipe(fds) != 0)
+			return 1;
+		pid = fork();
+		if (pid == 0) {
+			double start = now();
+			int count = replay(threads[run], hashes + (size_t)run * max_lists, max_lists);
+
+			start = now() - start;
+			if (write(fds[1], &count, sizeof(count)) != sizeof(count)
+			    || write(fds[1], &start, sizeof(start)) != sizeof(start))
+				_exit(1);
+			_exit(0);
+		}
+		close(fds[1]);
+		result[run] = -1;
+		if (pid < 0
+		    || read(fds[0], &result[run], sizeof(result[run])) != sizeof(result[run])
+		    || read(fds[0], &seconds[run], sizeof(seconds[run])) != sizeof(seconds[run]))
+			result[run] = -1;
+		close(fds[0]);
+		if (pid > 0)
+			waitpid(pid, &status, 0);
+		if (result[run] < 0) {
+			fprintf(stderr, "%u threads: replay failed\n", threads[run]);
+			return 1;
+		}
+		printf("%u threads: %d lists in %.3f s\n", threads[run], result[run], seconds[run]);
+	}
+	lists = result[0];
+
+	if (verbose)
+		for (i = 0; i < (unsigned)lists && i < max_lists; i++)
+			printf("%u %016llx\n", i, (unsigned long long)hashes[i]);
+
+	for (run = 1; run < runs; run++) {
+		const uint64_t *h = hashes + (size_t)run * max_lists;
+		unsigned differences = 0, first = 0;
+
+		for (i = 0; i < (unsigned)lists && i < max_lists; i++) {
+			if (h[i] != hashes[i] && differences++ == 0)
+				first = i;
+		}
+		if (result[run] != lists || differences) {
+			printf("%u threads: %u of %d lists differ from %u threads, first at list %u\n",
+			       threads[run], differences, lists, threads[0], first);
+			failed = 1;
+		}
+	}
+
+	if (output) {
+		FILE *f = fopen(output, "w");
+
+		if (!f)
+			return 1;
+		for (i = 0; i < (unsigned)lists && i < max_lists; i++)
+			fprintf(f, "%u %016llx\n", i, (unsigned long long)hashes[i]);
+		fclose(f);
+	}
+
+	if (check) {
+		FILE *f = fopen(check, "r");
+		unsigned index, differences = 0, count = 0;
+		unsigned long long hash;
+
+		if (!f) {
+			fprintf(stderr, "cannot read %s\n", check);
+			return 1;
+		}
+		while (fscanf(f, "%u %llx", &index, &hash) == 2) {
+			count++;
+			if (index >= (unsigned)lists || index >= max_lists || hashes[index] != hash)
+				differences++;
+		}
+		fclose(f);
+		if (differences || count != (unsigned)lists) {
+			printf("%u of %u lists differ from %s\n", differences, count, check);
+			failed = 1;
+		}
+	}
+
+	if (!failed)
+		printf("same RDRAM after every list\n");
+	return failed;
+}
@@ -0,0 +1,389 @@
+/* fb-check
+ * Drives the framebuffer tracking of the core (mupen64plus-core/src/rdp/fb.c)
+ * with random frame buffer infos and CPU accesses, and checks what it tells
+ * the video plugin against a plain scan of the infos on every access:
+ *
+ *     fb-check [-n frames] [-s seed]
+ *
+ * Every fBRead must come for the same address, and the words passed to
+ * fBWrite before it (or before the next display list) must be the words the
+ * CPU wrote, each once, in increasing order and merged into maximal runs.
+ *
+ * The second part plays the x86 dynarec, whose compiled accesses bypass the
+ * rdramFB handlers while fast_memory is on: fast_memory must go off as soon
+ * as a framebuffer gets protected, so that a read-back of what the plugin
+ * rendered goes through fBRead and sees its pixels.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "plugin/plugin.h"
+#include "r4300/r4300.h"
+#include "rdp/fb.h"
+#include "rdp/rdp_core.h"
+#include "ri/ri_controller.h"
+
+#define RDRAM_SIZE	0x800000
+#define REGIONS		0x10000
+#define ACCESSES	20000
+#define LOG_SIZE	(1 << 24)
+
+/* what fb.c needs from the rest of the core */
+int fast_memory = 1;
+unsigned int r4300emu;
+gfx_plugin_functions gfx;
+
+static void (*mapped[REGIONS])(void);
+static unsigned invalidations;
+static uint32_t dram[RDRAM_SIZE / 4];
+
+void read_rdram(void) {}
+void read_rdramb(void) {}
+void read_rdramh(void) {}
+void read_rdramd(void) {}
+void write_rdram(void) {}
+void write_rdramb(void) {}
+void write_rdramh(void) {}
+void write_rdramd(void) {}
+void read_rdramFB(void) {}
+void read_rdramFBb(void) {}
+void read_rdramFBh(void) {}
+void read_rdramFBd(void) {}
+void write_rdramFB(void) {}
+void write_rdramFBb(void) {}
+void write_rdramFBh(void) {}
+void write_rdramFBd(void) {}
+
+void map_region(uint16_t region, int type,
+		void (*read8)(void), void (*read16)(void), void (*read32)(void), void (*read64)(void),
+		void (*write8)(void), void (*write16)(void), void (*write32)(void), void (*write64)(void))
+{
+	mapped[region] = read32;
+}
+
+int read_rdram_dram(void *opaque, uint32_t address, uint32_t *value)
+{
+	*value = dram[(address & (RDRAM_SIZE - 1)) >> 2];
+	return 0;
+}
+
+int write_rdram_dram(void *opaque, uint32_t address, uint32_t value, uint32_t mask)
+{
+	uint32_t *word = &dram[(address & (RDRAM_SIZE - 1)) >> 2];
+
+	*word = (*word & ~mask) | (value & mask);
+	return 0;
+}
+
+void invalidate_r4300_cached_code(uint32_t address, size_t size)
+{
+	invalidations++;
+}
+
+static struct rdp_core dp;
+static struct ri_controller ri;
+static FrameBufferInfo infos[FB_INFOS_COUNT];
+static uint32_t seed;
+
+/* what the plugin is told, one line per fBRead or written word */
+static char *log_fb, *log_ref;
+static size_t log_fb_size, log_ref_size;
+static uint32_t run_end = UINT32_MAX;
+static int unmerged;
+/* what fBRead copies back to the page read, 0 for nothing */
+static uint32_t rendered;
+
+/* the reference: pages not read since the infos were taken, words written
+ * since the plugin was last told */
+static unsigned char ref_dirty[RDRAM_SIZE >> 12];
+static unsigned char ref_written[RDRAM_SIZE >> 2];
+static uint32_t ref_words[ACCESSES];
+static unsigned ref_words_count;
+
+static uint32_t rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static void fb_get_infos(void *p)
+{
+	memcpy(p, infos, sizeof(infos));
+}
+
+static void fb_read(uint32_t address)
+{
+	if (rendered) {
+		uint32_t page = (address & (RDRAM_SIZE - 1)) >> 12, i;
+
+		for (i = 0; i < 0x400; i++)
+			dram[(page << 10) + i] = rendered;
+	}
+	log_fb_size += sprintf(log_fb + log_fb_size, "R %06x\n", address & (RDRAM_SIZE - 1));
+	run_end = UINT32_MAX;
+}
+
+static void fb_write(uint32_t address, uint32_t size)
+{
+	uint32_t offset;
+
+	address &= RDRAM_SIZE - 1;
+	if (address == run_end)
+		unmerged = 1;
+	for (offset = 0; offset < size; offset += 4)
+		log_fb_size += sprintf(log_fb + log_fb_size, "W %06x\n", address + offset);
+	run_end = address + size;
+}
+
+static int ref_in_framebuffer(uint32_t address)
+{
+	int i;
+
+	for (i = 0; i < FB_INFOS_COUNT; i++) {
+		uint32_t begin = infos[i].addr & (RDRAM_SIZE - 1);
+		uint32_t end = begin + infos[i].width * infos[i].height * infos[i].size;
+
+		if (end > RDRAM_SIZE)
+			end = RDRAM_SIZE;
+		if (infos[i].addr && address >= begin && address < end)
+			return 1;
+	}
+	return 0;
+}
+
+static void ref_write(uint32_t address)
+{
+	if (!ref_written[address >> 2]) {
+		ref_written[address >> 2] = 1;
+		ref_words[ref_words_count++] = address >> 2;
+	}
+}
+
+static int compare_words(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void ref_flush(void)
+{
+	unsigned i;
+
+	qsort(ref_words, ref_words_count, sizeof(ref_words[0]), compare_words);
+	for (i = 0; i < ref_words_count; i++) {
+		log_ref_size += sprintf(log_ref + log_ref_size, "W %06x\n", ref_words[i] << 2);
+		ref_written[ref_words[i]] = 0;
+	}
+	ref_words_count = 0;
+}
+
+static void random_infos(void)
+{
+	int i;
+
+	memset(infos, 0, sizeof(infos));
+	for (i = 0; i < FB_INFOS_COUNT; i++) {
+		if (rnd() % 3 == 0)
+			continue;
+		infos[i].addr = 0x80000000 | (rnd() % 0x7ff000 & ~1);
+		infos[i].width = 1 + rnd() % 640;
+		infos[i].height = 1 + rnd() % 480;
+		infos[i].size = 1 << (rnd() % 3);
+	}
+}
+
+/* a word address near one of the infos most of the time */
+static uint32_t random_address(void)
+{
+	unsigned k = rnd() % FB_INFOS_COUNT;
+	uint32_t address;
+
+	if (k < FB_INFOS_COUNT - 1 && infos[k].addr)
+		address = (infos[k].addr & (RDRAM_SIZE - 1)) + rnd() % 0x40000 - 0x1000;
+	else
+		address = rnd();
+	return address & (RDRAM_SIZE - 4);
+}
+
+static int protected_region(uint32_t address)
+{
+	return mapped[0x8000 | (address >> 16)] == read_rdramFB;
+}
+
+static void protect(void)
+{
+	uint32_t page;
+	int i;
+
+	protect_framebuffers(&dp);
+	memset(ref_dirty, 0, sizeof(ref_dirty));
+	for (i = 0; i < FB_INFOS_COUNT; i++) {
+		uint32_t begin = infos[i].addr & (RDRAM_SIZE - 1);
+		uint32_t end = begin + infos[i].width * infos[i].height * infos[i].size;
+
+		if (end > RDRAM_SIZE)
+			end = RDRAM_SIZE;
+		if (infos[i].addr)
+			for (page = begin >> 12; page <= (end - 1) >> 12; page++)
+				ref_dirty[page] = 1;
+	}
+}
+
+static int unprotect(void)
+{
+	int i;
+
+	unprotect_framebuffers(&dp);
+	run_end = UINT32_MAX;
+	ref_flush();
+	for (i = 0; i < REGIONS; i++) {
+		if (mapped[i] == read_rdramFB) {
+			fprintf(stderr, "region %04x still protected\n", i);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* the accesses through the rdramFB handlers */
+static int check_handlers(unsigned frames)
+{
+	unsigned frame, n;
+
+	for (frame = 0; frame < frames; frame++) {
+		random_infos();
+		protect();
+
+		for (n = 0; n < ACCESSES; n++) {
+			uint32_t address = random_address(), value;
+
+			if (!protected_region(address))
+				continue;
+
+			if (rnd() & 1) {
+				if (ref_in_framebuffer(address) && ref_dirty[address >> 12]) {
+					ref_flush();
+					log_ref_size += sprintf(log_ref + log_ref_size, "R %06x\n", address);
+					ref_dirty[address >> 12] = 0;
+				}
+				read_rdram_fb(&dp, 0x80000000 | address, &value);
+			} else {
+				if (ref_in_framebuffer(address))
+					ref_write(address);
+				write_rdram_fb(&dp, 0x80000000 | address, rnd(), ~UINT32_C(0));
+			}
+		}
+
+		if (!unprotect())
+			return 0;
+		if (log_fb_size != log_ref_size || memcmp(log_fb, log_ref, log_ref_size)) {
+			fprintf(stderr, "frame %u: the plugin was told something else than by the reference\n", frame);
+			return 0;
+		}
+		if (unmerged) {
+			fprintf(stderr, "frame %u: adjacent runs passed to fBWrite separately\n", frame);
+			return 0;
+		}
+		log_fb_size = log_ref_size = 0;
+	}
+
+	printf("%u frames through the handlers: ok\n", frames);
+	return 1;
+}
+
+/* compiled accesses, which go straight to RDRAM while fast_memory is on */
+static int check_compiled(unsigned frames)
+{
+	unsigned frame, first_frame = frames / 2;
+	uint32_t address = 0x100000 + 4 * (rnd() % (320 * 240 / 2)), value;
+
+	r4300emu = CORE_DYNAREC;
+	fast_memory = 1;
+	invalidations = 0;
+	init_fb(&dp.fb);
+
+	for (frame = 0; frame < frames; frame++) {
+		memset(infos, 0, sizeof(infos));
+		if (frame >= first_frame) {
+			infos[0].addr = 0x80100000;
+			infos[0].width = 320;
+			infos[0].height = 240;
+			infos[0].size = 2;
+		}
+		protect();
+
+		if (frame < first_frame) {
+			if (!fast_memory || invalidations) {
+				fprintf(stderr, "frame %u: fast_memory turned off without a framebuffer\n", frame);
+				return 0;
+			}
+		} else if (fast_memory || invalidations != 1) {
+			fprintf(stderr, "frame %u: fast_memory still on with a framebuffer protected\n", frame);
+			return 0;
+		}
+
+		/* with fast_memory off, the compiled read goes through the handler */
+		if (frame >= first_frame) {
+			rendered = 0x5a5a0000 | frame;
+			dram[address >> 2] = 0;
+			read_rdram_fb(&dp, 0x80000000 | address, &value);
+			rendered = 0;
+			if (value != (0x5a5a0000 | frame)) {
+				fprintf(stderr, "frame %u: read back %08x instead of the rendered frame\n", frame, value);
+				return 0;
+			}
+		}
+
+		log_fb_size = log_ref_size = 0;
+		if (!unprotect())
+			return 0;
+	}
+
+	printf("%u frames of compiled accesses: ok\n", frames);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned frames = 200;
+	int i;
+
+	seed = 12345;
+	for (i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "-n"))
+			frames = strtoul(argv[i + 1], NULL, 0);
+		else if (!strcmp(argv[i], "-s"))
+			seed = strtoul(argv[i + 1], NULL, 0);
+		else
+			break;
+	}
+	if (i != argc || seed == 0) {
+		fprintf(stderr, "usage: %s [-n frames] [-s seed]\n", argv[0]);
+		return 1;
+	}
+
+	log_fb = malloc(LOG_SIZE);
+	log_ref = malloc(LOG_SIZE);
+	if (!log_fb || !log_ref) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	ri.rdram.dram = dram;
+	ri.rdram.dram_size = RDRAM_SIZE;
+	dp.ri = &ri;
+	gfx.fBGetFrameBufferInfo = fb_get_infos;
+	gfx.fBRead = fb_read;
+	gfx.fBWrite = fb_write;
+	init_fb(&dp.fb);
+
+	if (!check_handlers(frames) || !check_compiled(frames))
+		return 2;
+
+	return 0;
+}
@@ -0,0 +1,376 @@
+/* gliden64-vertex-check
+ * Runs randomized vertex loads through both vertex paths of GLideN64
+ * (mupen64plus-video-gliden64/src/gSP.cpp) and checks that the batched one,
+ * gln64gSPProcessVertices, gives bit for bit the vertices of the per-vertex
+ * one, gln64gSPProcessVertex:
+ *
+ *     make gliden64-vertex-check gliden64-vertex-check-scalar
+ *     gliden64-vertex-check-scalar -o scalar.txt
+ *     gliden64-vertex-check -c scalar.txt
+ *
+ * usage: gliden64-vertex-check [-n loads] [-s seed] [-o hashes.txt] [-c hashes.txt]
+ *
+ *   -n  vertex loads to run (default 20000)
+ *   -s  seed of the generator (default 12345)
+ *   -o  writes "load first count hash" for every load
+ *   -c  checks the loads against a file written by -o and exits with 2 at
+ *       the first difference
+ *
+ * Each load takes random matrices, lights, lookat, geometry mode,
+ * billboarding, viewport sign, screen adjustment, hardware lighting and
+ * microcode (F3DEX2 or F3DEX2CBFD, whose lighting functions differ), fills
+ * the vertex buffer with random vertices and processes a random range of it
+ * with each path. The hash covers the position, normal, color, texture
+ * coordinates, clip codes and HWLight of every vertex of the buffer.
+ * gliden64-vertex-check-scalar is the same program built with the plain C
+ * four-lane layer instead of the SSE2/NEON one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/* built in rather than linked: the tables of convert.h are defined by every
+ * file which includes it */
+#include "gSP.cpp"
+
+#define DEFAULT_LOADS	20000
+#define DEFAULT_SEED	12345
+
+/* what gSP.cpp needs from the rest of the plugin; the draw calls, the
+ * buffers and the RDP are never reached by a vertex load */
+gSPInfo gSP;
+gDPInfo gDP;
+RSPInfo __RSP;
+VIInfo VI;
+GBIInfo GBI;
+gliden64_config config;
+GFX_INFO gfx_info;
+uint8_t *RDRAM;
+uint32_t RDRAMSize;
+uint32_t G_MTX_LOAD, G_MTX_PROJECTION, G_MTX_PUSH;
+uint32_t G_CULL_BACK, G_CULL_BOTH, G_CULL_FRONT, G_SHADING_SMOOTH;
+uint32_t G_TRI1, G_TRI2, G_TRI4, G_QUAD;
+
+static uint32_t microcode_type;
+
+void GBIInfo::loadMicrocode(uint32_t uc_start, uint32_t uc_dstart, uint16_t uc_dsize)
+{
+	static MicrocodeInfo current;
+
+	current.type = microcode_type;
+	current.NoN = false;
+	current.textureGen = true;
+	current.branchLessZ = true;
+	m_pCurrent = &current;
+}
+
+void RSP_LoadMatrix(float mtx[4][4], uint32_t address) { abort(); }
+void gln64gDPSetTextureImage(uint32_t format, uint32_t size, uint32_t width, uint32_t address) { abort(); }
+void gln64gDPSetTile(uint32_t format, uint32_t size, uint32_t line, uint32_t tmem, uint32_t tile,
+		uint32_t palette, uint32_t cmt, uint32_t cms, uint32_t maskt, uint32_t masks,
+		uint32_t shiftt, uint32_t shifts) { abort(); }
+void gln64gDPSetTileSize(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs, uint32_t lrt) { abort(); }
+void gln64gDPLoadTile(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs, uint32_t lrt) { abort(); }
+void gln64gDPLoadBlock(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs, uint32_t dxt) { abort(); }
+void gln64gDPLoadTLUT(uint32_t tile, uint32_t uls, uint32_t ult, uint32_t lrs, uint32_t lrt) { abort(); }
+void DepthBuffer::setDepthAttachment(GLenum _target) { abort(); }
+void DepthBufferList::saveBuffer(uint32_t _address) { abort(); }
+DepthBuffer * DepthBufferList::findBuffer(uint32_t _address) { abort(); }
+DepthBufferList & DepthBufferList::get() { abort(); }
+FrameBuffer * FrameBufferList::findBuffer(uint32_t _startAddress) { abort(); }
+FrameBuffer * FrameBufferList::findTmpBuffer(uint32_t _address) { abort(); }
+void FrameBufferList::setBufferChanged() { abort(); }
+FrameBufferList & FrameBufferList::get() { abort(); }
+void OGLRender::addTriangle(int _v0, int _v1, int _v2) { abort(); }
+void OGLRender::drawTriangles() { abort(); }
+void OGLRender::drawLLETriangle(uint32_t _numVtx) { abort(); }
+void OGLRender::drawDMATriangles(uint32_t _numVtx) { abort(); }
+void OGLRender::drawLine(int _v0, int _v1, float _width) { abort(); }
+void rglBindFramebuffer(GLenum target, GLuint framebuffer) { abort(); }
+void rglBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
+		GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+		GLbitfield mask, GLenum filter) { abort(); }
+
+class TestVideo : public OGLVideo
+{
+public:
+	void setAdjustScreen(bool _adjust, float _scale)
+	{
+		m_bAdjustScreen = _adjust;
+		m_adjustScale = _scale;
+	}
+
+private:
+	bool _start() { return true; }
+	void _stop() {}
+	void _swapBuffers() {}
+	void _changeWindow() {}
+	bool _resizeWindow() { return true; }
+};
+
+static TestVideo test_video;
+
+OGLVideo & OGLVideo::get()
+{
+	return test_video;
+}
+
+static SPVertex input[INDEXMAP_SIZE], expected[INDEXMAP_SIZE];
+static uint32_t seed;
+
+/* xorshift32 */
+static uint32_t rnd(void)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* uniform in [-range, range] */
+static float frnd(float range)
+{
+	return ((float)(rnd() >> 8) / (1 << 23) - 1.f) * range;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *p = (const uint8_t*)data;
+
+	while (size--)
+		hash = (hash ^ *p++) * UINT64_C(0x100000001b3);
+	return hash;
+}
+
+static void random_state(void)
+{
+	int i, j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			gSP.matrix.projection[i][j] = frnd(2.f);
+			gSP.matrix.modelView[0][i][j] = frnd(2.f);
+		}
+	}
+	/* a perspective projection, which the screen adjustment looks for */
+	if (rnd() & 1)
+		gSP.matrix.projection[3][2] = -1.f;
+	gSP.matrix.modelViewi = 0;
+	gSP.matrix.billboard = rnd() % 4 == 0;
+	gSP.changed |= CHANGED_MATRIX;
+
+	microcode_type = rnd() % 4 == 0 ? F3DEX2CBFD : F3DEX2;
+	GBI.loadMicrocode(0, 0, 0);
+	gSPSetupFunctions();
+
+	gSP.numLights = rnd() % 8;
+	/* the CBFD point lighting takes light numLights - 1 as the directional one */
+	if (microcode_type == F3DEX2CBFD && gSP.numLights == 0)
+		gSP.numLights = 1;
+	for (i = 0; i <= gSP.numLights; i++) {
+		SPLight & light = gSP.lights[i];
+
+		light.r = frnd(1.f) + 1.f;
+		light.g = frnd(1.f) + 1.f;
+		light.b = frnd(1.f) + 1.f;
+		light.x = frnd(1.f);
+		light.y = frnd(1.f);
+		light.z = frnd(1.f);
+		NormalizeVector(&light.x);
+		light.posx = frnd(500.f);
+		light.posy = frnd(500.f);
+		light.posz = frnd(500.f);
+		light.posw = frnd(500.f);
+		light.ca = (rnd() % 16) / 16.f;
+		light.la = rnd() % 256;
+		light.qa = (rnd() % 32) / 8.f;
+	}
+	/* the offsets and scales of the CBFD point lights */
+	for (i = 8; i < 16; i++)
+		gSP.vertexCoordMod[i] = i < 12 ? frnd(100.f) : frnd(2.f);
+	gSP.lookatEnable = rnd() & 1;
+	for (i = 0; i < 2; i++) {
+		gSP.lookat[i].x = frnd(1.f);
+		gSP.lookat[i].y = frnd(1.f);
+		gSP.lookat[i].z = frnd(1.f);
+	}
+
+	gSP.geometryMode = 0;
+	if (rnd() & 1)
+		gSP.geometryMode |= G_LIGHTING;
+	if (rnd() & 1)
+		gSP.geometryMode |= G_POINT_LIGHTING;
+	if (rnd() & 1)
+		gSP.geometryMode |= G_TEXTURE_GEN;
+	if (rnd() & 1)
+		gSP.geometryMode |= G_TEXTURE_GEN_LINEAR;
+	gSP.viewport.vscale[0] = (rnd() & 1) ? -1.f : 1.f;
+
+	test_video.setAdjustScreen(rnd() & 1, 0.75f);
+	VI.width = 320;
+	gDP.colorImage.width = (rnd() & 1) ? 320 : 100;
+	config.generalEmulation.enableHWLighting = rnd() % 4 == 0;
+}
+
+static void random_vertices(void)
+{
+	unsigned i;
+
+	memset(input, 0, sizeof(input));
+	for (i = 0; i < INDEXMAP_SIZE; i++) {
+		SPVertex & vtx = input[i];
+
+		vtx.x = (int16_t)rnd();
+		vtx.y = (int16_t)rnd();
+		vtx.z = (int16_t)rnd();
+		vtx.w = frnd(100.f);
+		/* a zero normal now and then */
+		if (rnd() % 16) {
+			vtx.nx = (int8_t)rnd();
+			vtx.ny = (int8_t)rnd();
+			vtx.nz = (int8_t)rnd();
+		}
+		vtx.r = frnd(1.f);
+		vtx.g = frnd(1.f);
+		vtx.b = frnd(1.f);
+		vtx.a = 1.f;
+		vtx.s = frnd(10.f);
+		vtx.t = frnd(10.f);
+	}
+}
+
+/* the fields a vertex load sets, x to t, clip and HWLight */
+static int same_vertex(const SPVertex & a, const SPVertex & b)
+{
+	return !memcmp(&a.x, &b.x, (const char*)&a.HWLight - (const char*)&a.x) &&
+		a.clip == b.clip && a.HWLight == b.HWLight;
+}
+
+static uint64_t hash_vertex(uint64_t hash, const SPVertex & vtx)
+{
+	hash = fnv1a(hash, &vtx.x, (const char*)&vtx.HWLight - (const char*)&vtx.x);
+	hash = fnv1a(hash, &vtx.clip, sizeof(vtx.clip));
+	return fnv1a(hash, &vtx.HWLight, sizeof(vtx.HWLight));
+}
+
+/* runs one load through both paths, returns the hash of the batched one or
+ * reports the first vertex which differs */
+static int run_load(unsigned load, uint32_t v0, uint32_t n, uint64_t *hash)
+{
+	OGLRender & render = test_video.getRender();
+	uint32_t i;
+
+	random_state();
+	random_vertices();
+
+	for (i = 0; i < INDEXMAP_SIZE; i++)
+		render.getVertex(i) = input[i];
+	for (i = v0; i < v0 + n; i++)
+		gln64gSPProcessVertex(i);
+	for (i = 0; i < INDEXMAP_SIZE; i++)
+		expected[i] = render.getVertex(i);
+
+	for (i = 0; i < INDEXMAP_SIZE; i++)
+		render.getVertex(i) = input[i];
+	gSP.changed |= CHANGED_MATRIX;
+	gln64gSPProcessVertices(v0, n);
+
+	*hash = UINT64_C(0xcbf29ce484222325);
+	for (i = 0; i < INDEXMAP_SIZE; i++) {
+		const SPVertex & vtx = render.getVertex(i);
+
+		if (!same_vertex(vtx, expected[i])) {
+			fprintf(stderr, "load %u (vertices %u to %u, geometry mode %x, microcode %u): "
+				"vertex %u differs from gln64gSPProcessVertex\n",
+				load, v0, v0 + n - 1, gSP.geometryMode, microcode_type, i);
+			return 0;
+		}
+		*hash = hash_vertex(*hash, vtx);
+	}
+	return 1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n loads] [-s seed] [-o hashes.txt] [-c hashes.txt]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned loads = DEFAULT_LOADS, load;
+	const char *output_path = NULL, *check_path = NULL;
+	FILE *output = NULL, *check = NULL;
+	uint32_t initial_seed = DEFAULT_SEED;
+	uint64_t total = 0;
+	int i, mismatch = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (i + 1 == argc) {
+			usage(argv[0]);
+			return 1;
+		} else if (!strcmp(argv[i], "-n"))
+			loads = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-s"))
+			initial_seed = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-o"))
+			output_path = argv[++i];
+		else if (!strcmp(argv[i], "-c"))
+			check_path = argv[++i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (initial_seed == 0) {
+		fprintf(stderr, "the seed can't be 0\n");
+		return 1;
+	}
+	seed = initial_seed;
+
+	if (output_path && !(output = fopen(output_path, "w"))) {
+		fprintf(stderr, "cannot create %s\n", output_path);
+		return 1;
+	}
+	if (check_path && !(check = fopen(check_path, "r"))) {
+		fprintf(stderr, "cannot open %s\n", check_path);
+		return 1;
+	}
+
+	for (load = 0; load < loads; load++) {
+		/* loads from vertex 0 are the common case */
+		uint32_t v0 = rnd() % 4 == 0 ? 0 : rnd() % INDEXMAP_SIZE;
+		uint32_t n = 1 + rnd() % (INDEXMAP_SIZE - v0);
+		uint64_t hash;
+
+		if (!run_load(load, v0, n, &hash)) {
+			mismatch = 1;
+			break;
+		}
+		total = total * 31 + hash;
+
+		if (output)
+			fprintf(output, "%u %u %u %016llx\n", load, v0, n, (unsigned long long)hash);
+		if (check) {
+			unsigned long long expected_hash;
+			unsigned expected_load;
+
+			if (fscanf(check, "%u %*u %*u %llx", &expected_load, &expected_hash) != 2 ||
+			    expected_load != load || expected_hash != (unsigned long long)hash) {
+				fprintf(stderr, "load %u differs from %s\n", load, check_path);
+				mismatch = 1;
+				break;
+			}
+		}
+	}
+
+	printf("%u loads: total %016llx\n", load, (unsigned long long)total);
+
+	if (output && fclose(output)) {
+		fprintf(stderr, "write error on %s\n", output_path);
+		return 1;
+	}
+
+	return mismatch ? 2 : 0;
+}
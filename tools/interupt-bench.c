@@ -0,0 +1,437 @@
+/* interupt-bench
+ * Replays a trace of interrupt queue operations on the queue of the core
+ * (mupen64plus-core/src/r4300/event_queue.c) and on a reference copy of the
+ * singly linked list it started from, checks that both end up in the same
+ * state after every operation and reports the time each of them takes:
+ *
+ *     interupt-bench [-n rounds] [trace.bin]
+ *
+ * Cores built with PERF_TEST=1 record the trace while running and write it
+ * to mupen64plus_events.bin in the system directory on exit, see
+ * r4300bench.sh. Without a trace a synthetic one is generated, with the
+ * event mix of a game: VI, AI, SI, PI, SP and DP events rescheduled as they
+ * fire, COMPARE, SPECIAL and CHECK interrupts, and lookups.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "r4300/event_queue.h"
+#include "r4300/interupt.h"
+
+/* The singly linked list queue, as a reference for other structures. */
+struct list_node
+{
+	struct interrupt_event data;
+	struct list_node *next;
+};
+
+struct list_queue
+{
+	struct list_node nodes[POOL_CAPACITY];
+	struct list_node *stack[POOL_CAPACITY];
+	size_t index;
+	struct list_node *first;
+};
+
+static void list_clear(struct list_queue *q)
+{
+	size_t i;
+
+	for (i = 0; i < POOL_CAPACITY; ++i)
+		q->stack[i] = &q->nodes[i];
+	q->index = 0;
+	q->first = NULL;
+}
+
+static void list_free(struct list_queue *q, struct list_node *node)
+{
+	if (q->index == 0 || node == NULL)
+		return;
+	q->stack[--q->index] = node;
+}
+
+static int list_before(unsigned int evt1, unsigned int evt2, int type2,
+		       unsigned int now, int special_done)
+{
+	if (evt1 - now < 0x80000000u) {
+		if (evt2 - now < 0x80000000u)
+			return (evt1 - now) < (evt2 - now);
+		if ((now - evt2) < 0x10000000u)
+			return type2 == SPECIAL_INT && special_done;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int list_get(const struct list_queue *q, int type)
+{
+	const struct list_node *e = q->first;
+
+	if (e == NULL)
+		return 0;
+	if (e->data.type == type)
+		return e->data.count;
+	for (; e->next != NULL && e->next->data.type != type; e = e->next);
+	return (e->next != NULL) ? e->next->data.count : 0;
+}
+
+static void list_insert(struct list_queue *q, int type, unsigned int count,
+			unsigned int now, int special_done)
+{
+	struct list_node *event;
+	struct list_node *e;
+	int special = (type == SPECIAL_INT);
+
+	if (list_get(q, type))
+		return;
+	if (q->index >= POOL_CAPACITY)
+		return;
+	event = q->stack[q->index++];
+	event->data.count = count;
+	event->data.type = type;
+
+	if (q->first == NULL) {
+		q->first = event;
+		event->next = NULL;
+	} else if (list_before(count, q->first->data.count, q->first->data.type, now, special_done) && !special) {
+		event->next = q->first;
+		q->first = event;
+	} else {
+		for (e = q->first;
+		     e->next != NULL &&
+		     (!list_before(count, e->next->data.count, e->next->data.type, now, special_done) || special);
+		     e = e->next);
+
+		if (e->next != NULL && !special)
+			for (; e->next != NULL && e->next->data.count == count; e = e->next);
+
+		event->next = e->next;
+		e->next = event;
+	}
+}
+
+static void list_push(struct list_queue *q, int type, unsigned int count)
+{
+	struct list_node *event;
+
+	if (q->index >= POOL_CAPACITY)
+		return;
+	event = q->stack[q->index++];
+	event->data.count = count;
+	event->data.type = type;
+	event->next = q->first;
+	q->first = event;
+}
+
+static void list_pop(struct list_queue *q)
+{
+	struct list_node *e = q->first;
+
+	q->first = e->next;
+	list_free(q, e);
+}
+
+static void list_remove(struct list_queue *q, int type)
+{
+	struct list_node *e = q->first;
+	struct list_node *to_del;
+
+	if (e == NULL)
+		return;
+	if (e->data.type == type) {
+		q->first = e->next;
+		list_free(q, e);
+		return;
+	}
+	for (; e->next != NULL && e->next->data.type != type; e = e->next);
+	if (e->next != NULL) {
+		to_del = e->next;
+		e->next = to_del->next;
+		list_free(q, to_del);
+	}
+}
+
+static void list_rebase(struct list_queue *q, unsigned int now, unsigned int base)
+{
+	struct list_node *e;
+
+	for (e = q->first; e != NULL; e = e->next)
+		e->data.count = (e->data.count - now) + base;
+}
+
+/* volatile so that the lookups aren't optimized out */
+static volatile unsigned int sink;
+
+static void replay_queue(struct interrupt_queue *q, const struct event_queue_record *r, size_t n)
+{
+	struct node *e;
+	size_t i;
+
+	for (i = 0; i < n; ++i, ++r) {
+		switch (r->op) {
+		case EVENT_QUEUE_CLEAR:
+			clear_queue(q);
+			break;
+		case EVENT_QUEUE_INSERT:
+			insert_event(q, r->type, r->count, r->now, r->special_done);
+			break;
+		case EVENT_QUEUE_PUSH:
+			push_event(q, r->type, r->count);
+			break;
+		case EVENT_QUEUE_POP:
+			if (q->first != NULL)
+				pop_event(q);
+			break;
+		case EVENT_QUEUE_FIND:
+			e = find_event(q, r->type);
+			sink += (e != NULL) ? e->data.count : 0;
+			break;
+		case EVENT_QUEUE_REMOVE:
+			remove_event_type(q, r->type);
+			break;
+		case EVENT_QUEUE_REBASE:
+			rebase_events(q, r->now, r->count);
+			break;
+		}
+	}
+}
+
+static void replay_list(struct list_queue *q, const struct event_queue_record *r, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; ++i, ++r) {
+		switch (r->op) {
+		case EVENT_QUEUE_CLEAR:
+			list_clear(q);
+			break;
+		case EVENT_QUEUE_INSERT:
+			list_insert(q, r->type, r->count, r->now, r->special_done);
+			break;
+		case EVENT_QUEUE_PUSH:
+			list_push(q, r->type, r->count);
+			break;
+		case EVENT_QUEUE_POP:
+			if (q->first != NULL)
+				list_pop(q);
+			break;
+		case EVENT_QUEUE_FIND:
+			sink += list_get(q, r->type);
+			break;
+		case EVENT_QUEUE_REMOVE:
+			list_remove(q, r->type);
+			break;
+		case EVENT_QUEUE_REBASE:
+			list_rebase(q, r->now, r->count);
+			break;
+		}
+	}
+}
+
+/* both queues must hold the same events in the same order */
+static int same_queues(const struct interrupt_queue *q, const struct list_queue *l)
+{
+	const struct node *e = q->first;
+	const struct list_node *f = l->first;
+
+	for (; e != NULL && f != NULL; e = e->next, f = f->next)
+		if (e->data.type != f->data.type || e->data.count != f->data.count)
+			return 0;
+
+	return e == NULL && f == NULL;
+}
+
+static int verify(const struct event_queue_record *trace, size_t n)
+{
+	static struct interrupt_queue q;
+	static struct list_queue l;
+	size_t i;
+
+	clear_queue(&q);
+	list_clear(&l);
+
+	for (i = 0; i < n; ++i) {
+		replay_queue(&q, &trace[i], 1);
+		replay_list(&l, &trace[i], 1);
+
+		if (trace[i].op == EVENT_QUEUE_FIND) {
+			struct node *e = find_event(&q, trace[i].type);
+			if (((e != NULL) ? e->data.count : 0) != list_get(&l, trace[i].type)) {
+				fprintf(stderr, "operation %u: lookups of type 0x%x differ\n",
+					(unsigned int)i, trace[i].type);
+				return 0;
+			}
+		}
+
+		if (!same_queues(&q, &l)) {
+			fprintf(stderr, "operation %u (op %u, type 0x%x, count %08x): queues differ\n",
+				(unsigned int)i, trace[i].op, trace[i].type, trace[i].count);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static const int device_types[] = { VI_INT, AI_INT, SI_INT, PI_INT, SP_INT, DP_INT };
+#define DEVICE_TYPES (sizeof(device_types) / sizeof(device_types[0]))
+
+static struct event_queue_record *record(struct event_queue_record *r, int op, int type,
+					 unsigned int count, unsigned int now)
+{
+	r->op = op;
+	r->special_done = 1;
+	r->type = type;
+	r->count = count;
+	r->now = now;
+	return r + 1;
+}
+
+/* Runs a model of the devices: each one reschedules its event when it
+ * fires, the CPU looks events up and raises CHECK_INT now and then. */
+static struct event_queue_record *generate(size_t n)
+{
+	struct event_queue_record *trace = malloc(n * sizeof(*trace));
+	struct event_queue_record *r = trace, *end;
+	unsigned int due[DEVICE_TYPES];
+	unsigned int now = 0, compare = 0;
+	int check = 0;
+	size_t i;
+
+	if (trace == NULL)
+		return NULL;
+	end = trace + n - 4;
+
+	srand(1);
+	r = record(r, EVENT_QUEUE_CLEAR, 0, 0, now);
+	r = record(r, EVENT_QUEUE_INSERT, SPECIAL_INT, 0, now);
+	for (i = 0; i < DEVICE_TYPES; ++i) {
+		due[i] = now + 1000 + rand() % 100000;
+		r = record(r, EVENT_QUEUE_INSERT, device_types[i], due[i], now);
+	}
+	compare = now + 500000;
+	r = record(r, EVENT_QUEUE_INSERT, COMPARE_INT, compare, now);
+
+	while (r < end) {
+		unsigned int next = compare;
+		int type = COMPARE_INT;
+
+		if (check) {
+			r = record(r, EVENT_QUEUE_POP, 0, 0, now);
+			check = 0;
+			continue;
+		}
+
+		for (i = 0; i < DEVICE_TYPES; ++i) {
+			if (due[i] - now < next - now) {
+				next = due[i];
+				type = device_types[i];
+			}
+		}
+
+		/* the CPU runs until the next event, looking some up */
+		now += (next - now) / 2;
+		r = record(r, EVENT_QUEUE_FIND, device_types[rand() % DEVICE_TYPES], 0, now);
+		if (rand() % 8 == 0) {
+			r = record(r, EVENT_QUEUE_PUSH, CHECK_INT, now, now);
+			check = 1;
+			continue;
+		}
+		now = next;
+
+		r = record(r, EVENT_QUEUE_POP, 0, 0, now);
+		if (type == COMPARE_INT) {
+			compare = now + 100000 + rand() % 1000000;
+			r = record(r, EVENT_QUEUE_INSERT, COMPARE_INT, compare, now);
+		} else {
+			for (i = 0; device_types[i] != type; ++i);
+			due[i] = now + ((type == VI_INT) ? 781250 : 1000 + rand() % 200000);
+			/* a DMA may be cancelled and restarted before it completes */
+			if (type != VI_INT && rand() % 16 == 0) {
+				r = record(r, EVENT_QUEUE_INSERT, type, due[i], now);
+				r = record(r, EVENT_QUEUE_REMOVE, type, 0, now);
+				due[i] += 5000;
+			}
+			r = record(r, EVENT_QUEUE_INSERT, type, due[i], now);
+		}
+	}
+
+	return trace;
+}
+
+static struct event_queue_record *load(const char *path, size_t *n)
+{
+	struct event_queue_record *trace;
+	FILE *f = fopen(path, "rb");
+	long size;
+
+	if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0) {
+		if (f)
+			fclose(f);
+		return NULL;
+	}
+	rewind(f);
+
+	*n = (size_t)size / sizeof(*trace);
+	trace = malloc(*n * sizeof(*trace) + 1);
+	if (trace != NULL && fread(trace, sizeof(*trace), *n, f) != *n) {
+		free(trace);
+		trace = NULL;
+	}
+	fclose(f);
+	return trace;
+}
+
+int main(int argc, char **argv)
+{
+	static struct interrupt_queue q;
+	static struct list_queue l;
+	struct event_queue_record *trace;
+	size_t n = 1000000;
+	int rounds = 20;
+	double t_queue, t_list;
+	clock_t start;
+	int i;
+
+	if (argc >= 3 && !strcmp(argv[1], "-n")) {
+		rounds = atoi(argv[2]);
+		argv += 2;
+		argc -= 2;
+	}
+	if (argc > 2 || rounds < 1) {
+		fprintf(stderr, "usage: %s [-n rounds] [trace.bin]\n", argv[0]);
+		return 1;
+	}
+
+	trace = (argc == 2) ? load(argv[1], &n) : generate(n);
+	if (trace == NULL) {
+		fprintf(stderr, "cannot read %s\n", argv[1]);
+		return 1;
+	}
+
+	if (!verify(trace, n))
+		return 1;
+
+	start = clock();
+	for (i = 0; i < rounds; ++i) {
+		clear_queue(&q);
+		replay_queue(&q, trace, n);
+	}
+	t_queue = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	start = clock();
+	for (i = 0; i < rounds; ++i) {
+		list_clear(&l);
+		replay_list(&l, trace, n);
+	}
+	t_list = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%u operations, %d rounds, same queue states\n", (unsigned int)n, rounds);
+	printf("event_queue %8.2f ns/op\n", t_queue * 1e9 / ((double)n * rounds));
+	printf("linked list %8.2f ns/op\n", t_list * 1e9 / ((double)n * rounds));
+
+	free(trace);
+	return 0;
+}
@@ -0,0 +1,540 @@
+/* m64p-bench
+ * Runs the libretro core without a frontend, as fast as it goes, and
+ * reports the frames per second and the percentiles of the time spent in
+ * each retro_run. Every frame handed to the video callback is hashed, so
+ * that runs of two builds can be checked against each other.
+ *
+ * usage: m64p-bench [-n frames] [-w warmup] [-i input.log] [-r input.log]
+ *                   [-o hashes.txt] [-c hashes.txt] [-d directory] [-f] [-v]
+ *                   <core.so> <rom> [option=value ...]
+ *
+ *   -n  frames to run (default 600), not counting the warmup
+ *   -w  frames to run before the timing starts (default 0); their hashes
+ *       are written and checked all the same
+ *   -i  input log to replay, see below; without it nothing is pressed
+ *   -r  records the pads to an input log, with a line for every port on
+ *       the first frame and one whenever a pad changes; -i replays it
+ *   -o  writes "frame hash width height" for every frame
+ *   -c  checks the frames against a file written by -o and exits with 2 at
+ *       the first difference
+ *   -d  system and save directory of the core (default .)
+ *   -f  tells the core the frontend is fast-forwarding, for
+ *       mupen64-fastforward=frontend
+ *   -v  prints the core messages below warnings as well
+ *
+ * The options are core options, e.g. mupen64-cpucore=pure_interpreter. As
+ * there is no GPU, mupen64-gfxplugin defaults to angrylion, which renders
+ * to a software framebuffer; the others need a hardware context which
+ * m64p-bench does not provide. Audio is thrown away.
+ *
+ * The input log is a text file of lines
+ *
+ *     <frame> <port> <buttons> [<left x> <left y> <right x> <right y>]
+ *
+ * sorted by frame. From the given frame on, the RETRO_DEVICE_ID_JOYPAD_*
+ * bits of buttons (hexadecimal) are held on the port and the sticks are at
+ * the given positions (-32768..32767), until the next line for the port.
+ * Lines starting with # are ignored. Replays are only deterministic with
+ * options which don't depend on the host speed, e.g. with the frame
+ * duplication and the audio/video threads of the plugins turned off.
+ *
+ * It needs nothing but libretro.h and libdl, the core is loaded at run time:
+ *
+ *     make m64p-bench
+ *     m64p-bench -n 1800 -o base.txt mupen64plus_libretro.so game.z64
+ *     m64p-bench -n 1800 -c base.txt ./new/mupen64plus_libretro.so game.z64
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include "libretro.h"
+
+#define MAX_OPTIONS	64
+#define MAX_PORTS	4
+
+struct option {
+	const char *key;
+	const char *value;
+};
+
+struct input_event {
+	unsigned frame;
+	unsigned port;
+	unsigned buttons;
+	int16_t analog[4];
+};
+
+struct pad {
+	unsigned buttons;
+	int16_t analog[4];
+};
+
+static struct option options[MAX_OPTIONS];
+static unsigned num_options;
+static const char *directory = ".";
+static int verbose, fastforwarding;
+
+static struct input_event *events;
+static unsigned num_events, next_event;
+static struct pad pads[MAX_PORTS];
+static struct pad recorded[MAX_PORTS];
+
+static unsigned bytes_per_pixel = 2;
+static uint64_t frame_hash;
+static unsigned frame_width, frame_height;
+
+static void log_printf(enum retro_log_level level, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!verbose && level < RETRO_LOG_WARN)
+		return;
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+static bool environment(unsigned cmd, void *data)
+{
+	unsigned i;
+
+	switch (cmd) {
+	case RETRO_ENVIRONMENT_GET_VARIABLE: {
+		struct retro_variable *var = data;
+		for (i = 0; i < num_options; i++) {
+			if (!strcmp(options[i].key, var->key)) {
+				var->value = options[i].value;
+				return true;
+			}
+		}
+		var->value = NULL;
+		return false;
+	}
+	case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+		*(bool *)data = false;
+		return true;
+	case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+		((struct retro_log_callback *)data)->log = log_printf;
+		return true;
+	case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+		switch (*(const enum retro_pixel_format *)data) {
+		case RETRO_PIXEL_FORMAT_XRGB8888:
+			bytes_per_pixel = 4;
+			return true;
+		case RETRO_PIXEL_FORMAT_0RGB1555:
+		case RETRO_PIXEL_FORMAT_RGB565:
+			bytes_per_pixel = 2;
+			return true;
+		default:
+			return false;
+		}
+	case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+	case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+		*(const char **)data = directory;
+		return true;
+	case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+		*(bool *)data = true;
+		return true;
+	case RETRO_ENVIRONMENT_GET_FASTFORWARDING:
+		*(bool *)data = fastforwarding;
+		return true;
+	case RETRO_ENVIRONMENT_SET_VARIABLES:
+	case RETRO_ENVIRONMENT_SET_GEOMETRY:
+	case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+		return true;
+	default:
+		/* notably no hardware rendering */
+		return false;
+	}
+}
+
+/* FNV-1a over the visible pixels, a NULL frame repeats the previous one */
+static void video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	unsigned x, y;
+
+	if (!data)
+		return;
+
+	for (y = 0; y < height; y++) {
+		const uint8_t *row = (const uint8_t *)data + y * pitch;
+		for (x = 0; x < width * bytes_per_pixel; x++)
+			hash = (hash ^ row[x]) * UINT64_C(0x100000001b3);
+	}
+
+	frame_hash = hash;
+	frame_width = width;
+	frame_height = height;
+}
+
+static void audio_sample(int16_t left, int16_t right)
+{
+}
+
+static size_t audio_sample_batch(const int16_t *data, size_t frames)
+{
+	return frames;
+}
+
+static void input_poll(void)
+{
+}
+
+static int16_t input_state(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+	if (port >= MAX_PORTS)
+		return 0;
+
+	switch (device) {
+	case RETRO_DEVICE_JOYPAD:
+		return (pads[port].buttons >> id) & 1;
+	case RETRO_DEVICE_ANALOG:
+		if (index > RETRO_DEVICE_INDEX_ANALOG_RIGHT || id > RETRO_DEVICE_ID_ANALOG_Y)
+			return 0;
+		return pads[port].analog[index * 2 + id];
+	default:
+		return 0;
+	}
+}
+
+static int load_input(const char *path)
+{
+	char line[256];
+	unsigned capacity = 0, number = 0;
+	FILE *f = fopen(path, "r");
+
+	if (!f) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		struct input_event event;
+		int analog[4] = { 0, 0, 0, 0 };
+		int fields, i;
+
+		number++;
+		if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+
+		fields = sscanf(line, "%u %u %x %d %d %d %d", &event.frame, &event.port,
+				&event.buttons, &analog[0], &analog[1], &analog[2], &analog[3]);
+		if ((fields != 3 && fields != 7) || event.port >= MAX_PORTS ||
+		    (num_events && event.frame < events[num_events - 1].frame)) {
+			fprintf(stderr, "%s:%u: bad input event\n", path, number);
+			fclose(f);
+			return 0;
+		}
+		for (i = 0; i < 4; i++)
+			event.analog[i] = (int16_t)(analog[i] < -32768 ? -32768 : analog[i] > 32767 ? 32767 : analog[i]);
+
+		if (num_events == capacity) {
+			capacity = capacity ? capacity * 2 : 256;
+			events = realloc(events, capacity * sizeof(*events));
+			if (!events) {
+				fprintf(stderr, "out of memory\n");
+				fclose(f);
+				return 0;
+			}
+		}
+		events[num_events++] = event;
+	}
+
+	fclose(f);
+	return 1;
+}
+
+static void apply_input(unsigned frame)
+{
+	while (next_event < num_events && events[next_event].frame <= frame) {
+		const struct input_event *event = &events[next_event++];
+		pads[event->port].buttons = event->buttons;
+		memcpy(pads[event->port].analog, event->analog, sizeof(event->analog));
+	}
+}
+
+/* a line for each port whose pad changed since the last one written */
+static void record_input(FILE *f, unsigned frame)
+{
+	unsigned port;
+
+	for (port = 0; port < MAX_PORTS; port++) {
+		const struct pad *pad = &pads[port];
+
+		if (frame != 0 && !memcmp(pad, &recorded[port], sizeof(*pad)))
+			continue;
+		fprintf(f, "%u %u %x %d %d %d %d\n", frame, port, pad->buttons,
+			pad->analog[0], pad->analog[1], pad->analog[2], pad->analog[3]);
+		recorded[port] = *pad;
+	}
+}
+
+static void *load_file(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	void *data = NULL;
+	long length;
+
+	if (!f)
+		return NULL;
+	if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0 &&
+	    fseek(f, 0, SEEK_SET) == 0 && (data = malloc(length))) {
+		if (fread(data, 1, length, f) == (size_t)length) {
+			*size = length;
+		} else {
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+	return data;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_times(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, unsigned count, unsigned p)
+{
+	return sorted[(count - 1) * p / 100];
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n frames] [-w warmup] [-i input.log] [-r input.log]\n"
+		"       [-o hashes.txt] [-c hashes.txt] [-d directory] [-f] [-v] <core.so> <rom> [option=value ...]\n", name);
+}
+
+#define LOAD(sym) \
+	if (!(*(void **)&sym = dlsym(core, #sym))) { \
+		fprintf(stderr, "%s: no %s\n", core_path, #sym); \
+		return 1; \
+	}
+
+int main(int argc, char **argv)
+{
+	void (*retro_set_environment)(retro_environment_t);
+	void (*retro_set_video_refresh)(retro_video_refresh_t);
+	void (*retro_set_audio_sample)(retro_audio_sample_t);
+	void (*retro_set_audio_sample_batch)(retro_audio_sample_batch_t);
+	void (*retro_set_input_poll)(retro_input_poll_t);
+	void (*retro_set_input_state)(retro_input_state_t);
+	void (*retro_init)(void);
+	void (*retro_deinit)(void);
+	bool (*retro_load_game)(const struct retro_game_info *);
+	void (*retro_unload_game)(void);
+	void (*retro_run)(void);
+	size_t (*retro_serialize_size)(void);
+	bool (*retro_serialize)(void *, size_t);
+
+	unsigned frames = 600, warmup = 0, frame, mismatch = 0;
+	const char *input_path = NULL, *record_path = NULL, *output_path = NULL, *check_path = NULL;
+	const char *core_path, *rom_path;
+	FILE *record = NULL, *output = NULL, *check = NULL;
+	struct retro_game_info game;
+	double *times, start, elapsed;
+	uint64_t state_hash = UINT64_C(0xcbf29ce484222325);
+	size_t state_size;
+	void *core;
+	int i, has_gfx = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "-v"))
+			verbose = 1;
+		else if (!strcmp(argv[i], "-f"))
+			fastforwarding = 1;
+		else if (i + 1 == argc)
+			break;
+		else if (!strcmp(argv[i], "-n"))
+			frames = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-w"))
+			warmup = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-i"))
+			input_path = argv[++i];
+		else if (!strcmp(argv[i], "-r"))
+			record_path = argv[++i];
+		else if (!strcmp(argv[i], "-o"))
+			output_path = argv[++i];
+		else if (!strcmp(argv[i], "-c"))
+			check_path = argv[++i];
+		else if (!strcmp(argv[i], "-d"))
+			directory = argv[++i];
+		else
+			break;
+	}
+	if (argc - i < 2 || frames == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	core_path = argv[i++];
+	rom_path = argv[i++];
+
+	for (; i < argc; i++) {
+		char *separator = strchr(argv[i], '=');
+		if (!separator || num_options == MAX_OPTIONS) {
+			usage(argv[0]);
+			return 1;
+		}
+		*separator = '\0';
+		options[num_options].key = argv[i];
+		options[num_options].value = separator + 1;
+		has_gfx |= !strcmp(argv[i], "mupen64-gfxplugin");
+		num_options++;
+	}
+	if (!has_gfx && num_options < MAX_OPTIONS) {
+		options[num_options].key = "mupen64-gfxplugin";
+		options[num_options].value = "angrylion";
+		num_options++;
+	}
+
+	if (input_path && !load_input(input_path))
+		return 1;
+	if (record_path && !(record = fopen(record_path, "w"))) {
+		fprintf(stderr, "cannot create %s\n", record_path);
+		return 1;
+	}
+	if (output_path && !(output = fopen(output_path, "w"))) {
+		fprintf(stderr, "cannot create %s\n", output_path);
+		return 1;
+	}
+	if (check_path && !(check = fopen(check_path, "r"))) {
+		fprintf(stderr, "cannot open %s\n", check_path);
+		return 1;
+	}
+
+	core = dlopen(core_path, RTLD_NOW | RTLD_LOCAL);
+	if (!core) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	LOAD(retro_set_environment);
+	LOAD(retro_set_video_refresh);
+	LOAD(retro_set_audio_sample);
+	LOAD(retro_set_audio_sample_batch);
+	LOAD(retro_set_input_poll);
+	LOAD(retro_set_input_state);
+	LOAD(retro_init);
+	LOAD(retro_deinit);
+	LOAD(retro_load_game);
+	LOAD(retro_unload_game);
+	LOAD(retro_run);
+	LOAD(retro_serialize_size);
+	LOAD(retro_serialize);
+
+	memset(&game, 0, sizeof(game));
+	game.path = rom_path;
+	game.data = load_file(rom_path, &game.size);
+	if (!game.data) {
+		fprintf(stderr, "cannot read %s\n", rom_path);
+		return 1;
+	}
+
+	retro_set_environment(environment);
+	retro_set_video_refresh(video_refresh);
+	retro_set_audio_sample(audio_sample);
+	retro_set_audio_sample_batch(audio_sample_batch);
+	retro_set_input_poll(input_poll);
+	retro_set_input_state(input_state);
+	retro_init();
+	if (!retro_load_game(&game)) {
+		fprintf(stderr, "%s: cannot load %s\n", core_path, rom_path);
+		return 1;
+	}
+
+	times = malloc(frames * sizeof(*times));
+	if (!times) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	start = now();
+	for (frame = 0; frame < warmup + frames; frame++) {
+		double before;
+
+		if (frame == warmup)
+			start = now();
+
+		apply_input(frame);
+		if (record)
+			record_input(record, frame);
+		before = now();
+		retro_run();
+		if (frame >= warmup)
+			times[frame - warmup] = now() - before;
+
+		if (output)
+			fprintf(output, "%u %016llx %u %u\n", frame,
+				(unsigned long long)frame_hash, frame_width, frame_height);
+		if (check && !mismatch) {
+			unsigned long long expected;
+			unsigned expected_frame;
+
+			if (fscanf(check, "%u %llx %*u %*u", &expected_frame, &expected) != 2 ||
+			    expected_frame != frame || expected != (unsigned long long)frame_hash) {
+				fprintf(stderr, "frame %u differs from %s\n", frame, check_path);
+				mismatch = 1;
+				break;
+			}
+		}
+	}
+	elapsed = now() - start;
+
+	state_size = retro_serialize_size();
+	if (state_size) {
+		uint8_t *state = malloc(state_size);
+		size_t k;
+
+		if (state && retro_serialize(state, state_size))
+			for (k = 0; k < state_size; k++)
+				state_hash = (state_hash ^ state[k]) * UINT64_C(0x100000001b3);
+		free(state);
+	}
+
+	if (!mismatch) {
+		unsigned timed = frames;
+
+		printf("%u frames in %.3f s: %.2f fps\n", timed, elapsed, timed / elapsed);
+		qsort(times, timed, sizeof(*times), compare_times);
+		printf("frame time p50=%.3f ms - p90=%.3f ms - p99=%.3f ms - max=%.3f ms\n",
+		       1000 * percentile(times, timed, 50), 1000 * percentile(times, timed, 90),
+		       1000 * percentile(times, timed, 99), 1000 * percentile(times, timed, 100));
+	}
+	printf("last frame %016llx (%ux%u) - state %016llx (%zu bytes)\n",
+	       (unsigned long long)frame_hash, frame_width, frame_height,
+	       (unsigned long long)state_hash, state_size);
+
+	if (record && fclose(record)) {
+		fprintf(stderr, "write error on %s\n", record_path);
+		return 1;
+	}
+	if (output && fclose(output)) {
+		fprintf(stderr, "write error on %s\n", output_path);
+		return 1;
+	}
+
+	retro_unload_game();
+	retro_deinit();
+	dlclose(core);
+	free(times);
+	free(events);
+	free((void *)game.data);
+
+	return mismatch ? 2 : 0;
+}
@@ -0,0 +1,144 @@
+/* membench-rom
+ * Writes a ROM which does nothing but loads and stores to RDRAM, to measure
+ * the memory access path of the r4300 interpreters:
+ *
+ *     membench-rom [-t] membench.z64
+ *     r4300bench.sh <retroarch> <core> membench.z64
+ *
+ * The program is the IPL3 of the ROM, so it runs from SP DMEM right after
+ * the simulated PIF boot. It walks a 64KB buffer at 0x00100000 forever,
+ * alternately through KSEG0 and KSEG1; every 16 bytes it does one access of
+ * each size, LW/LBU/LHU/LD and SW/SB/SH/SD, which are 8 of the 12
+ * instructions of the loop. Interrupts stay masked, so only the VI
+ * interrupt events end the frames.
+ *
+ * With -t the buffer is reached through a 16MB TLB page at virtual address 0
+ * instead, and the TLB entry is written again (TLBWI) on every pass over it,
+ * like games which remap their TLB every frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ROM_SIZE	0x100000
+#define IPL3_START	0x40
+
+/* registers */
+enum { zero = 0, t0 = 8, t1, t2, t3, t4, t5, t6, t7, t9 = 25 };
+
+#define I_TYPE(op, rs, rt, imm) (((uint32_t)(op) << 26) | ((rs) << 21) | ((rt) << 16) | ((imm) & 0xffff))
+#define R_TYPE(rs, rt, rd, funct) (((rs) << 21) | ((rt) << 16) | ((rd) << 11) | (funct))
+
+#define LUI(rt, imm)		I_TYPE(0x0f, 0, rt, imm)
+#define ADDIU(rt, rs, imm)	I_TYPE(0x09, rs, rt, imm)
+#define BNE(rs, rt, off)	I_TYPE(0x05, rs, rt, off)
+#define LBU(rt, off, base)	I_TYPE(0x24, base, rt, off)
+#define LHU(rt, off, base)	I_TYPE(0x25, base, rt, off)
+#define LW(rt, off, base)	I_TYPE(0x23, base, rt, off)
+#define LD(rt, off, base)	I_TYPE(0x37, base, rt, off)
+#define SB(rt, off, base)	I_TYPE(0x28, base, rt, off)
+#define SH(rt, off, base)	I_TYPE(0x29, base, rt, off)
+#define SW(rt, off, base)	I_TYPE(0x2b, base, rt, off)
+#define SD(rt, off, base)	I_TYPE(0x3f, base, rt, off)
+#define ORI(rt, rs, imm)	I_TYPE(0x0d, rs, rt, imm)
+#define MTC0(rt, rd)		(((uint32_t)0x10 << 26) | (0x04 << 21) | ((rt) << 16) | ((rd) << 11))
+#define TLBWI			(((uint32_t)0x10 << 26) | (1 << 25) | 0x02)
+#define ADDU(rd, rs, rt)	R_TYPE(rs, rt, rd, 0x21)
+#define XOR(rd, rs, rt)		R_TYPE(rs, rt, rd, 0x26)
+#define J(target)		(((uint32_t)0x02 << 26) | (((target) >> 2) & 0x3ffffff))
+#define NOP			0
+
+/* cop0 registers */
+enum { Index = 0, EntryLo0 = 2, EntryLo1 = 3, PageMask = 5, EntryHi = 10 };
+
+static uint8_t rom[ROM_SIZE];
+static uint32_t program[64];
+static unsigned int length;
+
+static void emit(uint32_t op)
+{
+	program[length++] = op;
+}
+
+static void put32(uint32_t offset, uint32_t value)
+{
+	rom[offset + 0] = (uint8_t)(value >> 24);
+	rom[offset + 1] = (uint8_t)(value >> 16);
+	rom[offset + 2] = (uint8_t)(value >> 8);
+	rom[offset + 3] = (uint8_t)value;
+}
+
+int main(int argc, char **argv)
+{
+	int tlb = 0;
+	unsigned int outer;
+	FILE *f;
+	size_t i;
+
+	if (argc == 3 && !strcmp(argv[1], "-t")) {
+		tlb = 1;
+		argv++;
+		argc--;
+	}
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s [-t] <rom.z64>\n", argv[0]);
+		return 1;
+	}
+
+	if (tlb) {
+		emit(LUI(t1, 0x01ff));
+		emit(ORI(t1, t1, 0xe000));
+		emit(MTC0(t1, PageMask));	/* 16MB pages */
+		emit(MTC0(zero, EntryHi));	/* virtual address 0 */
+		emit(ADDIU(t1, zero, 0x7));	/* physical address 0, D, V, G */
+		emit(MTC0(t1, EntryLo0));
+		emit(MTC0(t1, EntryLo1));
+		emit(MTC0(zero, Index));
+		emit(LUI(t0, 0x0010));		/* buffer through the TLB */
+		emit(ADDU(t9, zero, zero));
+	} else {
+		emit(LUI(t0, 0x8010));		/* buffer in KSEG0 */
+		emit(LUI(t9, 0x2000));		/* KSEG0 ^ KSEG1 */
+	}
+	emit(NOP);
+
+	outer = length;
+	if (tlb)
+		emit(TLBWI);
+	emit(ADDU(t2, t0, zero));
+	emit(ADDIU(t3, t0, 0x7fff));
+	emit(ADDIU(t3, t3, 0x7fff));
+	emit(ADDIU(t3, t3, -14));	/* t3 = t0 + 64KB - 16 */
+	emit(LW(t4, 0, t2));		/* inner: */
+	emit(LBU(t5, 4, t2));
+	emit(LHU(t6, 6, t2));
+	emit(LD(t7, 8, t2));
+	emit(ADDU(t4, t4, t5));
+	emit(ADDU(t4, t4, t6));
+	emit(SW(t4, 0, t2));
+	emit(SB(t5, 5, t2));
+	emit(SH(t6, 6, t2));
+	emit(SD(t7, 8, t2));
+	emit(BNE(t2, t3, -11));
+	emit(ADDIU(t2, t2, 16));	/* delay slot */
+	emit(J(0xa4000000 + IPL3_START + outer * 4));
+	emit(XOR(t0, t0, t9));		/* delay slot */
+
+	put32(0x00, 0x80371240);	/* PI settings */
+	put32(0x04, 0x0000000f);	/* clock rate */
+	put32(0x08, 0x80000400);	/* entry point, unused */
+	memcpy(rom + 0x20, "MEMBENCH            ", 20);
+	memcpy(rom + 0x3b, "NMBE", 4);	/* media, id, country (USA) */
+
+	for (i = 0; i < length; i++)
+		put32(IPL3_START + i * 4, program[i]);
+
+	f = fopen(argv[1], "wb");
+	if (!f || fwrite(rom, 1, sizeof(rom), f) != sizeof(rom) || fclose(f)) {
+		fprintf(stderr, "cannot write %s\n", argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
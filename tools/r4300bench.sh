@@ -0,0 +1,61 @@
+#!/bin/sh
+# Compares the r4300 interpreters on a fixed ROM segment.
+#
+# usage: r4300bench.sh <retroarch> <core> <rom> [frames]
+#
+# The core has to be built with PERF_TEST=1 so that the profiler reports the
+# r4300 MIPS. Every mode runs the same number of frames from power on with
+# angrylion, no audio and no vsync; the average of the MIPS reports of each
+# run is printed.
+
+if [ $# -lt 3 ]; then
+   echo "usage: $0 <retroarch> <core> <rom> [frames]"
+   exit 1
+fi
+
+RETROARCH=$1
+CORE=$2
+ROM=$3
+FRAMES=${4:-3600}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+run_mode()
+{
+   name=$1
+   cpucore=$2
+   fusion=$3
+
+   cat > "$WORKDIR/options.cfg" <<EOF
+mupen64-cpucore = "$cpucore"
+mupen64-cached-fusion = "$fusion"
+mupen64-gfxplugin = "angrylion"
+mupen64-rspplugin = "hle"
+EOF
+
+   cat > "$WORKDIR/retroarch.cfg" <<EOF
+core_options_path = "$WORKDIR/options.cfg"
+video_driver = "null"
+audio_driver = "null"
+video_vsync = "false"
+audio_sync = "false"
+savestate_auto_load = "false"
+EOF
+
+   "$RETROARCH" --verbose --appendconfig "$WORKDIR/retroarch.cfg" \
+      --max-frames="$FRAMES" -L "$CORE" "$ROM" > "$WORKDIR/$name.log" 2>&1
+
+   awk -v name="$name" '
+      / MIPS$/ { sum += $(NF-1); n++ }
+      END {
+         if (n == 0)
+            printf "%-20s no MIPS report (is the core built with PERF_TEST=1?)\n", name
+         else
+            printf "%-20s %8.2f MIPS (%d samples)\n", name, sum / n, n
+      }' "$WORKDIR/$name.log"
+}
+
+run_mode pure_interp pure_interpreter disabled
+run_mode cached_interp cached_interpreter disabled
+run_mode fused_cached_interp cached_interpreter enabled
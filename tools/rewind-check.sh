@@ -0,0 +1,45 @@
+#!/bin/sh
+# Checks the in-core rewind ring with a push/pop round-trip.
+#
+# usage: rewind-check.sh <m64p-bench> <core> <rom> [frames] [rewound frames]
+#
+# Runs the ROM for the given frames (default 100), then holds R3 for the
+# rewound frames (default 30). Every rewound frame but the first steps back
+# one frame, so the state must be the one of a plain run of
+# frames - rewound + 1 frames; exits with 1 otherwise. Extra core options
+# (e.g. mupen64-cpucore=pure_interpreter) can be given in M64P_OPTIONS.
+
+if [ $# -lt 3 ]; then
+   echo "usage: $0 <m64p-bench> <core> <rom> [frames] [rewound frames]"
+   exit 1
+fi
+
+BENCH=$1
+CORE=$2
+ROM=$3
+FRAMES=${4:-100}
+REWOUND=${5:-30}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+state()
+{
+   "$BENCH" -d "$WORKDIR" "$@" "$CORE" "$ROM" $M64P_OPTIONS mupen64-rewind=$RING 2>/dev/null |
+      sed -n 's/.* - state \([0-9a-f]*\) .*/\1/p'
+}
+
+# smallest ring which holds every frame
+for RING in 60 120 300 600; do
+   [ "$FRAMES" -le $RING ] && break
+done
+
+echo "$FRAMES 0 8000" > "$WORKDIR/rewind.log"	# RETRO_DEVICE_ID_JOYPAD_R3
+expected=$(state -n $((FRAMES - REWOUND + 1)))
+got=$(state -n $((FRAMES + REWOUND)) -i "$WORKDIR/rewind.log")
+
+if [ -z "$expected" ] || [ "$got" != "$expected" ]; then
+   echo "state ${got:-none} after rewinding, expected ${expected:-none}"
+   exit 1
+fi
+echo "ok ($FRAMES frames, $REWOUND rewound, state $got)"
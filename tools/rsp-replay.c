@@ -0,0 +1,346 @@
+/* rsp-replay
+ * Replays the RSP tasks recorded by mupen64plus-rsp-cxd4/rsp_dump.cpp (core
+ * built with HAVE_RSP_DUMP=1) through every RSP plugin, checks DMEM and
+ * RDRAM after each task against the recording and reports the time spent
+ * per task and the tasks per second of each plugin.
+ *
+ * usage: rsp-replay [-t] [-n iterations] <trace> [plugin.so ...]
+ *
+ * The plugins are the rsp-replay-*.so libraries built by "make rsp-replay"
+ * next to this program; they are loaded separately because cxd4 and
+ * cxd4-new export the same symbols. -t prints the time of every task.
+ * -n replays the trace several times, but only the first pass is checked:
+ * the plugins keep the registers which the last task of a pass left.
+ *
+ * Low-level plugins run every recorded DoRspCycles call. rsp-hle only runs
+ * the calls which start a task at IMEM 0, compares RDRAM only (it does not
+ * leave in DMEM what the microcode does) and does not run graphics tasks,
+ * which it hands to the video plugin.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+#include "m64p_types.h"
+#include "m64p_plugin.h"
+#include "rsp_dump_reader.h"
+
+#define RDRAM_SIZE	RSP_DUMP_RDRAM_SIZE
+#define TASK_TYPE	0xFC0
+#define M_GFXTASK	1
+#define M_AUDTASK	2
+#define MAX_REPORTS	10
+
+struct plugin {
+	const char *name;
+	void *handle;
+	void (*initiate)(RSP_INFO, unsigned int *);
+	unsigned int (*do_cycles)(unsigned int);
+	void (*rom_closed)(void);
+	int hle;
+
+	unsigned ran, failed, skipped;
+	double seconds;
+	double *task_seconds;
+};
+
+static struct rsp_dump_trace trace;
+
+static unsigned char sp_mem[0x2000];
+static unsigned char *rdram;
+static unsigned char *expected;
+static uint32_t regs[18];
+
+/* Used by the plugins, which are linked against the core. */
+RSP_INFO rsp_info;
+
+m64p_error ConfigSetDefaultFloat(m64p_handle handle, const char *name, float value, const char *help)
+{
+	return M64ERR_SUCCESS;
+}
+
+m64p_error ConfigSetDefaultBool(m64p_handle handle, const char *name, int value, const char *help)
+{
+	return M64ERR_SUCCESS;
+}
+
+int ConfigGetParamBool(m64p_handle handle, const char *name)
+{
+	return 0;
+}
+
+static void process_nothing(void)
+{
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Checks the trace records what the replay needs. */
+static int check_trace(void)
+{
+	unsigned i, pages = 0;
+
+	for (i = 0; i < trace.task_count; i++)
+		pages += trace.tasks[i].rdram_pages;
+	if (trace.task_count && !pages) {
+		fprintf(stderr, "the trace has no RDRAM records, record it again with this core\n");
+		return 0;
+	}
+	return 1;
+}
+
+static uint32_t task_pc(const struct rsp_dump_task *t)
+{
+	uint32_t pc;
+
+	memcpy(&pc, trace.data + t->pc.offset, 4);
+	return pc;
+}
+
+static uint32_t task_type(const struct rsp_dump_task *t)
+{
+	uint32_t type;
+
+	memcpy(&type, trace.data + t->dmem.offset + TASK_TYPE, 4);
+	return type;
+}
+
+static int load_plugin(struct plugin *p, const char *path)
+{
+	static const char *prefixes[] = { "cxd4", "parallelRSP", "hle" };
+	const char *base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+	char symbol[64], *name;
+	size_t i;
+
+	memset(p, 0, sizeof(*p));
+	p->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if (!p->handle) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 0;
+	}
+
+	for (i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]) && !p->initiate; i++) {
+		snprintf(symbol, sizeof(symbol), "%sInitiateRSP", prefixes[i]);
+		*(void **)&p->initiate = dlsym(p->handle, symbol);
+		snprintf(symbol, sizeof(symbol), "%sDoRspCycles", prefixes[i]);
+		*(void **)&p->do_cycles = dlsym(p->handle, symbol);
+		snprintf(symbol, sizeof(symbol), "%sRomClosed", prefixes[i]);
+		*(void **)&p->rom_closed = dlsym(p->handle, symbol);
+		p->hle = strcmp(prefixes[i], "hle") == 0;
+	}
+	if (!p->initiate || !p->do_cycles) {
+		fprintf(stderr, "%s is not an RSP plugin\n", path);
+		dlclose(p->handle);
+		return 0;
+	}
+
+	if (strncmp(base, "rsp-replay-", 11) == 0)
+		base += 11;
+	name = strdup(base);
+	if (strstr(name, ".so"))
+		*strstr(name, ".so") = '\0';
+	p->name = name;
+
+	p->task_seconds = calloc(trace.task_count ? trace.task_count : 1, sizeof(double));
+	return p->task_seconds != NULL;
+}
+
+static long count_differences(const unsigned char *a, const unsigned char *b, size_t size)
+{
+	long count = 0;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		count += a[i] != b[i];
+	return count;
+}
+
+static void replay(struct plugin *p, unsigned iterations)
+{
+	unsigned it, i, reports = 0;
+	int synced = 0;
+
+	memset(rdram, 0, RDRAM_SIZE);
+	memset(expected, 0, RDRAM_SIZE);
+	memset(regs, 0, sizeof(regs));
+	p->initiate(rsp_info, NULL);
+
+	for (it = 0; it < iterations; it++)
+	for (i = 0; i < trace.task_count; i++) {
+		const struct rsp_dump_task *t = &trace.tasks[i];
+		uint32_t pc = task_pc(t), type = task_type(t);
+		long dmem_errors = 0, rdram_errors = 0;
+		double start;
+
+		rsp_dump_apply_pages(&trace, t->rdram, t->rdram_pages, expected);
+		if (synced)
+			rsp_dump_apply_pages(&trace, t->rdram, t->rdram_pages, rdram);
+		else
+			memcpy(rdram, expected, RDRAM_SIZE);
+		memcpy(sp_mem, trace.data + t->dmem.offset, 0x1000);
+		memcpy(sp_mem + 0x1000, trace.data + t->imem.offset, 0x1000);
+		rsp_dump_apply_pages(&trace, t->rdram_end, t->rdram_end_pages, expected);
+
+		if (p->hle && (pc != 0 || type == M_GFXTASK)) {
+			p->skipped++;
+			synced = 0;
+			continue;
+		}
+
+		*rsp_info.SP_STATUS_REG = 0;
+		*rsp_info.SP_PC_REG = 0x04001000 | (pc & 0xFFC);
+		start = now();
+		p->do_cycles(0xFFFFFFFF);
+		p->task_seconds[i] += now() - start;
+		p->ran++;
+
+		if (!p->hle)
+			dmem_errors = count_differences(sp_mem, trace.data + t->dmem_end.offset, 0x1000);
+		synced = memcmp(rdram, expected, RDRAM_SIZE) == 0;
+		if (!synced)
+			rdram_errors = count_differences(rdram, expected, RDRAM_SIZE);
+
+		/* later passes start from the registers the last task left */
+		if (it == 0 && (dmem_errors || rdram_errors)) {
+			p->failed++;
+			if (reports++ < MAX_REPORTS)
+				fprintf(stderr, "%s: task %u (type %u): %ld DMEM and %ld RDRAM bytes differ\n",
+						p->name, i, (unsigned)type, dmem_errors, rdram_errors);
+		}
+	}
+
+	if (p->rom_closed)
+		p->rom_closed();
+	for (i = 0; i < trace.task_count; i++)
+		p->seconds += p->task_seconds[i];
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *defaults[] = {
+		"rsp-replay-cxd4.so", "rsp-replay-cxd4-new.so",
+		"rsp-replay-parallel.so", "rsp-replay-hle.so"
+	};
+	struct plugin plugins[16];
+	unsigned plugin_count = 0, iterations = 1, i, p;
+	unsigned types[3] = { 0, 0, 0 };
+	int per_task = 0, failed = 0, arg = 1;
+
+	for (; arg < argc && argv[arg][0] == '-'; arg++) {
+		if (strcmp(argv[arg], "-t") == 0)
+			per_task = 1;
+		else if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc)
+			iterations = (unsigned)atoi(argv[++arg]);
+		else
+			break;
+	}
+	if (arg >= argc) {
+		printf("usage: %s [-t] [-n iterations] <trace> [plugin.so ...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (!rsp_dump_load_trace(&trace, argv[arg]) || !check_trace())
+		return EXIT_FAILURE;
+
+	rdram = calloc(1, RDRAM_SIZE);
+	expected = calloc(1, RDRAM_SIZE);
+	if (!rdram || !expected) {
+		fprintf(stderr, "out of memory\n");
+		return EXIT_FAILURE;
+	}
+	rsp_info.RDRAM = rdram;
+	rsp_info.DMEM = sp_mem;
+	rsp_info.IMEM = sp_mem + 0x1000;
+	rsp_info.MI_INTR_REG = &regs[0];
+	rsp_info.SP_MEM_ADDR_REG = &regs[1];
+	rsp_info.SP_DRAM_ADDR_REG = &regs[2];
+	rsp_info.SP_RD_LEN_REG = &regs[3];
+	rsp_info.SP_WR_LEN_REG = &regs[4];
+	rsp_info.SP_STATUS_REG = &regs[5];
+	rsp_info.SP_DMA_FULL_REG = &regs[6];
+	rsp_info.SP_DMA_BUSY_REG = &regs[7];
+	rsp_info.SP_PC_REG = &regs[8];
+	rsp_info.SP_SEMAPHORE_REG = &regs[9];
+	rsp_info.DPC_START_REG = &regs[10];
+	rsp_info.DPC_END_REG = &regs[11];
+	rsp_info.DPC_CURRENT_REG = &regs[12];
+	rsp_info.DPC_STATUS_REG = &regs[13];
+	rsp_info.DPC_CLOCK_REG = &regs[14];
+	rsp_info.DPC_BUFBUSY_REG = &regs[15];
+	rsp_info.DPC_PIPEBUSY_REG = &regs[16];
+	rsp_info.DPC_TMEM_REG = &regs[17];
+	rsp_info.CheckInterrupts = process_nothing;
+	rsp_info.ProcessDlistList = process_nothing;
+	rsp_info.ProcessAlistList = process_nothing;
+	rsp_info.ProcessRdpList = process_nothing;
+	rsp_info.ShowCFB = process_nothing;
+
+	if (arg + 1 < argc) {
+		for (i = arg + 1; i < (unsigned)argc && plugin_count < 16; i++)
+			if (load_plugin(&plugins[plugin_count], argv[i]))
+				plugin_count++;
+	} else {
+		/* the default plugins live next to this program */
+		const char *slash = strrchr(argv[0], '/');
+		char path[4096];
+
+		for (i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+			snprintf(path, sizeof(path), "%.*s%s",
+					slash ? (int)(slash - argv[0] + 1) : 0, argv[0], defaults[i]);
+			if (access(path, F_OK) == 0 && load_plugin(&plugins[plugin_count], path))
+				plugin_count++;
+		}
+	}
+	if (!plugin_count) {
+		fprintf(stderr, "no RSP plugin to replay the trace with\n");
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < trace.task_count; i++) {
+		uint32_t type = task_type(&trace.tasks[i]);
+		types[type == M_GFXTASK ? 0 : type == M_AUDTASK ? 1 : 2]++;
+	}
+	printf("%u calls x %u: %u graphics, %u audio, %u other\n",
+			trace.task_count, iterations, types[0], types[1], types[2]);
+
+	for (p = 0; p < plugin_count; p++) {
+		replay(&plugins[p], iterations);
+		failed |= plugins[p].failed != 0;
+	}
+
+	if (per_task) {
+		printf("%6s %5s %6s", "task", "type", "pc");
+		for (p = 0; p < plugin_count; p++)
+			printf(" %12s", plugins[p].name);
+		printf("\n");
+		for (i = 0; i < trace.task_count; i++) {
+			printf("%6u %5u %6.3X", i, (unsigned)task_type(&trace.tasks[i]),
+					(unsigned)task_pc(&trace.tasks[i]));
+			for (p = 0; p < plugin_count; p++)
+				printf(" %9.2f us", plugins[p].task_seconds[i] / iterations * 1e6);
+			printf("\n");
+		}
+	}
+
+	printf("%-12s %8s %8s %8s %10s %10s %12s\n",
+			"plugin", "ran", "failed", "skipped", "total ms", "us/task", "tasks/s");
+	for (p = 0; p < plugin_count; p++) {
+		const struct plugin *pl = &plugins[p];
+
+		printf("%-12s %8u %8u %8u %10.2f %10.2f %12.0f\n",
+				pl->name, pl->ran, pl->failed, pl->skipped, pl->seconds * 1e3,
+				pl->ran ? pl->seconds / pl->ran * 1e6 : 0.0,
+				pl->seconds > 0.0 ? pl->ran / pl->seconds : 0.0);
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
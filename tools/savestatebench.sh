@@ -0,0 +1,62 @@
+#!/bin/sh
+# Measures the cost of the savestates on a fixed ROM segment.
+#
+# usage: savestatebench.sh <retroarch> <core> <rom> [frames]
+#
+# The core has to be built with PERF_TEST=1 so that the profiler reports the
+# size and time of both the full states (serialized every frame by the
+# frontend rewind) and the deltas of the in-core rewind ring, which is
+# enabled with 60 frames.
+
+if [ $# -lt 3 ]; then
+   echo "usage: $0 <retroarch> <core> <rom> [frames]"
+   exit 1
+fi
+
+RETROARCH=$1
+CORE=$2
+ROM=$3
+FRAMES=${4:-3600}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+cat > "$WORKDIR/options.cfg" <<EOC
+mupen64-gfxplugin = "angrylion"
+mupen64-rspplugin = "hle"
+mupen64-rewind = "60"
+EOC
+
+cat > "$WORKDIR/retroarch.cfg" <<EOC
+core_options_path = "$WORKDIR/options.cfg"
+video_driver = "null"
+audio_driver = "null"
+video_vsync = "false"
+audio_sync = "false"
+savestate_auto_load = "false"
+rewind_enable = "true"
+rewind_granularity = "1"
+EOC
+
+"$RETROARCH" --verbose --appendconfig "$WORKDIR/retroarch.cfg" \
+   --max-frames="$FRAMES" -L "$CORE" "$ROM" > "$WORKDIR/bench.log" 2>&1
+
+for section in savestate rewind; do
+   awk -v name="$section" '
+      $0 ~ (" " name ": [0-9]+ calls - ") {
+         for (i = 2; i <= NF; i++)
+         {
+            if ($i == "calls")        n = $(i-1)
+            if ($i == "bytes/call")   b = $(i-1)
+            if ($i ~ /ns\/call$/)     { t = $i; sub(/ns\/call$/, "", t) }
+         }
+         calls += n; bytes += n * b; nsec += n * t
+      }
+      END {
+         if (calls == 0)
+            printf "%-10s no report (is the core built with PERF_TEST=1?)\n", name
+         else
+            printf "%-10s %10.0f bytes/frame %10.1f us/frame (%d frames)\n",
+               name, bytes / calls, nsec / calls / 1000.0, calls
+      }' "$WORKDIR/bench.log"
+done
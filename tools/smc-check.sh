@@ -0,0 +1,46 @@
+#!/bin/sh
+# Checks that the cached interpreter runs self-modified code like the pure
+# interpreter, with and without instruction fusion.
+#
+# usage: smc-check.sh <m64p-bench> <core> [frames]
+#
+# smc-rom has to be built next to this script. The state hash of every run
+# must be the one of the pure interpreter; exits with 1 otherwise.
+
+if [ $# -lt 2 ]; then
+   echo "usage: $0 <m64p-bench> <core> [frames]"
+   exit 1
+fi
+
+BENCH=$1
+CORE=$2
+FRAMES=${3:-60}
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+"$(dirname "$0")/smc-rom" "$WORKDIR/smc.z64" || exit 1
+
+state()
+{
+   "$BENCH" -n "$FRAMES" -d "$WORKDIR" "$CORE" "$WORKDIR/smc.z64" "$@" 2>/dev/null |
+      sed -n 's/.* - state \([0-9a-f]*\) .*/\1/p'
+}
+
+expected=$(state mupen64-cpucore=pure_interpreter)
+if [ -z "$expected" ]; then
+   echo "no state hash from $BENCH"
+   exit 1
+fi
+
+status=0
+for fusion in disabled enabled; do
+   got=$(state mupen64-cpucore=cached_interpreter mupen64-cached-fusion=$fusion)
+   if [ "$got" = "$expected" ]; then
+      printf "%-30s ok\n" "cached_interpreter ($fusion)"
+   else
+      printf "%-30s state %s, expected %s\n" "cached_interpreter ($fusion)" "$got" "$expected"
+      status=1
+   fi
+done
+exit $status
@@ -0,0 +1,131 @@
+/* smc-rom
+ * Writes a ROM which patches its own code in the middle of a run of NOPs,
+ * to check the sub-page invalidation of the cached interpreter against the
+ * pure interpreter:
+ *
+ *     smc-rom smc.z64
+ *     m64p-bench -n 60 core.so smc.z64 mupen64-cpucore=pure_interpreter
+ *     m64p-bench -n 60 core.so smc.z64 mupen64-cpucore=cached_interpreter \
+ *                mupen64-cached-fusion=enabled
+ *
+ * Both runs must print the same state hash.
+ *
+ * The program is the IPL3 of the ROM, so it runs from SP DMEM right after
+ * the simulated PIF boot. It copies a routine to RDRAM whose NOPs start at
+ * the end of one 256-byte sub-page and go on in the next one, then calls it
+ * forever, every other time with one of these NOPs, in the second sub-page,
+ * replaced by an ADDIU. The counts of both ADDIUs of the routine are stored
+ * to RDRAM after each pass, so a stale instruction changes the savestate.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ROM_SIZE	0x100000
+#define IPL3_START	0x40
+
+/* routine layout, from 0x80100000 */
+#define ROUTINE		0x0e0	/* ADDIU, then NOPs up to RETURN */
+#define PATCH		0x120	/* NOP of the next sub-page which gets patched */
+#define RETURN		0x140	/* JR ra and its delay slot */
+#define RESULT		0x200
+
+/* registers */
+enum { zero = 0, t0 = 8, t1, t2, t3, t4, t5, ra = 31 };
+
+#define I_TYPE(op, rs, rt, imm) (((uint32_t)(op) << 26) | ((rs) << 21) | ((rt) << 16) | ((imm) & 0xffff))
+#define R_TYPE(rs, rt, rd, funct) (((rs) << 21) | ((rt) << 16) | ((rd) << 11) | (funct))
+
+#define LUI(rt, imm)		I_TYPE(0x0f, 0, rt, imm)
+#define ADDIU(rt, rs, imm)	I_TYPE(0x09, rs, rt, imm)
+#define ORI(rt, rs, imm)	I_TYPE(0x0d, rs, rt, imm)
+#define SW(rt, off, base)	I_TYPE(0x2b, base, rt, off)
+#define CACHE(op, off, base)	I_TYPE(0x2f, base, op, off)
+#define JR(rs)			R_TYPE(rs, 0, 0, 0x08)
+#define JALR(rd, rs)		R_TYPE(rs, 0, rd, 0x09)
+#define J(target)		(((uint32_t)0x02 << 26) | (((target) >> 2) & 0x3ffffff))
+#define NOP			0
+
+#define HIT_INVALIDATE_I	0x10
+
+static uint8_t rom[ROM_SIZE];
+static uint32_t program[128];
+static unsigned int length;
+
+static void emit(uint32_t op)
+{
+	program[length++] = op;
+}
+
+/* stores op at offset of the routine, t0 holding its base */
+static void emit_store(unsigned int offset, uint32_t op)
+{
+	if (op == NOP) {
+		emit(SW(zero, offset, t0));
+		return;
+	}
+	emit(LUI(t1, op >> 16));
+	emit(ORI(t1, t1, op & 0xffff));
+	emit(SW(t1, offset, t0));
+}
+
+static void put32(uint32_t offset, uint32_t value)
+{
+	rom[offset + 0] = (uint8_t)(value >> 24);
+	rom[offset + 1] = (uint8_t)(value >> 16);
+	rom[offset + 2] = (uint8_t)(value >> 8);
+	rom[offset + 3] = (uint8_t)value;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int offset, outer;
+	FILE *f;
+	size_t i;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <rom.z64>\n", argv[0]);
+		return 1;
+	}
+
+	emit(LUI(t0, 0x8010));		/* routine in KSEG0 */
+	emit_store(ROUTINE, ADDIU(t2, t2, 1));
+	for (offset = ROUTINE + 4; offset < RETURN; offset += 4)
+		emit_store(offset, NOP);
+	emit_store(RETURN, JR(ra));
+	emit_store(RETURN + 4, NOP);
+	emit(ORI(t3, t0, ROUTINE));
+	emit(LUI(t4, ADDIU(t5, t5, 1) >> 16));
+	emit(ORI(t4, t4, ADDIU(t5, t5, 1) & 0xffff));
+
+	outer = length;
+	emit(JALR(ra, t3));
+	emit(NOP);
+	emit(SW(t4, PATCH, t0));
+	emit(CACHE(HIT_INVALIDATE_I, PATCH, t0));
+	emit(JALR(ra, t3));
+	emit(NOP);
+	emit(SW(zero, PATCH, t0));
+	emit(CACHE(HIT_INVALIDATE_I, PATCH, t0));
+	emit(SW(t2, RESULT, t0));
+	emit(J(0xa4000000 + IPL3_START + outer * 4));
+	emit(SW(t5, RESULT + 4, t0));	/* delay slot */
+
+	put32(0x00, 0x80371240);	/* PI settings */
+	put32(0x04, 0x0000000f);	/* clock rate */
+	put32(0x08, 0x80000400);	/* entry point, unused */
+	memcpy(rom + 0x20, "SMC TEST            ", 20);
+	memcpy(rom + 0x3b, "NSME", 4);	/* media, id, country (USA) */
+
+	for (i = 0; i < length; i++)
+		put32(IPL3_START + i * 4, program[i]);
+
+	f = fopen(argv[1], "wb");
+	if (!f || fwrite(rom, 1, sizeof(rom), f) != sizeof(rom) || fclose(f)) {
+		fprintf(stderr, "cannot write %s\n", argv[1]);
+		return 1;
+	}
+
+	return 0;
+}